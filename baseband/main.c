@@ -40,9 +40,7 @@ int main() {
         memcpy(&message[HEADER_LEN], tx_payload_buffer, PAYLOADSIZE);
 
         /* casting for 32-bit fifo */
-        for (uint8_t i=0; i < buffer_size(PAYLOADSIZE, HEADER_LEN); i++) {
-            buffer[i] = ((uint32_t) message[4*i+3]) | (((uint32_t) message[4*i+2]) << 8) | (((uint32_t) message[4*i+1]) << 16) | (((uint32_t)message[4*i]) << 24);
-        }
+        pack_words(message, buffer, buffer_size(PAYLOADSIZE, HEADER_LEN));
         /* put the data to FIFO */
         backscatter_send(pio,sm,buffer,buffer_size(PAYLOADSIZE, HEADER_LEN));
         seq++;
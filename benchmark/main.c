@@ -0,0 +1,554 @@
+/**
+ * Microbenchmarks for the hot paths in project_pico_libs
+ *
+ * Every benchmark runs a fixed number of iterations, after one warm-up run it is repeated
+ * BENCH_REPEATS times and the median is reported. The results are printed as JSON:
+ *   {"benchmarks": [{"name": ..., "iterations": ..., "ns_per_call": ..., "cycles_per_call": ..., "allocs_per_call": ...}, ...]}
+ * The results of the benchmarked functions are checked by the unit tests in tests/.
+ *
+ * Host:   built against the SDK stand-in (project_pico_libs/host), heap allocations are counted by wrapping malloc.
+ * Target: built with -DBENCHMARK_ON_TARGET=ON, timed with time_us_64() and converted to cycles with clk_sys.
+ *         Allocations are not counted on the target (allocs_per_call is null).
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "backscatter.h"
+#include "packet_generation.h"
+#include "receiver_CC2500.h"
+#include "packet_log.h"
+#include "link_stats.h"
+#include "trace.h"
+#include "packet_pool.h"
+#include "frame_ring.h"
+#include "msp430_backup.h"
+#include "scheduler.h"
+#include "supply_filter.h"
+#include "rssi_parser.h"
+#include "rate_control.h"
+#include "arq.h"
+#include "fec.h"
+#include "aggregator.h"
+#include "boot_config.h"
+#include "pico/multicore.h"
+
+#define BENCH_REPEATS        5
+#define PAYLOADSIZE         14
+#define HEADER_LEN          10 // 8 header + length + seq
+#define buffer_size(x, y) (((x + y) % 4 == 0) ? ((x + y) / 4) : ((x + y) / 4 + 1))
+
+#if PICO_ON_DEVICE
+#define BENCH_COUNT_ALLOCS false
+#else
+#define BENCH_COUNT_ALLOCS true
+#endif
+
+/* heap allocation counter (host only, see -Wl,--wrap in CMakeLists.txt) */
+static volatile uint32_t allocations = 0;
+#if !PICO_ON_DEVICE
+#include "msp430_standin.h"
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t n, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+void *__wrap_malloc(size_t size)              { allocations++; return __real_malloc(size); }
+void *__wrap_calloc(size_t n, size_t size)    { allocations++; return __real_calloc(n, size); }
+void *__wrap_realloc(void *ptr, size_t size)  { allocations++; return __real_realloc(ptr, size); }
+void __wrap_free(void *ptr)                   { __real_free(ptr); }
+#endif
+
+/* results are written here such that the compiler cannot remove the benchmarked calls */
+static volatile uint32_t sink;
+
+/* state shared by the benchmarks */
+static uint16_t instructionBuffer[32];
+static struct pio_program backscatter_program;
+static uint8_t *header_tmplate;
+static uint8_t message[buffer_size(PAYLOADSIZE+2, HEADER_LEN)*4];
+static uint32_t buffer[buffer_size(PAYLOADSIZE, HEADER_LEN)];
+static uint8_t tx_payload_buffer[PAYLOADSIZE];
+static uint8_t rx_packet[RX_BUFFER_SIZE];
+static uint8_t frame[PACKET_LOG_MAX_FRAME_LEN];
+static Link_stats stats;
+static Frame_ring frames;
+
+static void bench_generatePIOprogram(uint32_t i){
+    sink = generatePIOprogram(20, 18, 100000, instructionBuffer, &backscatter_program, true);
+}
+
+static void bench_generate_sample(uint32_t i){
+    sink = generate_sample();
+}
+
+static void bench_generate_data(uint32_t i){
+    generate_data(tx_payload_buffer, PAYLOADSIZE, true);
+    sink = tx_payload_buffer[0];
+}
+
+/* everything the TX loop does per packet apart from generate_data() and the PIO */
+static void bench_build_packet(uint32_t i){
+    add_header(&message[0], i, header_tmplate);
+    memcpy(&message[HEADER_LEN], tx_payload_buffer, PAYLOADSIZE);
+    pack_words(message, buffer, buffer_size(PAYLOADSIZE, HEADER_LEN));
+    sink = buffer[0];
+}
+
+static void bench_datarate_registers(uint32_t i){
+    uint8_t e, m;
+    sink = datarate_registers(50000 + (i & 0xFF) * 100, &e, &m);
+}
+
+static void bench_filter_bandwidth_registers(uint32_t i){
+    uint8_t e, m;
+    sink = filter_bandwidth_registers(100000 + (i & 0xFF) * 1000, &e, &m);
+}
+
+static void bench_frequency_deviation_registers(uint32_t i){
+    uint8_t e, m;
+    sink = frequency_deviation_registers(20000 + (i & 0xFF) * 100, &e, &m);
+}
+
+static void bench_frequency_registers(uint32_t i){
+    uint32_t freq;
+    uint8_t channel, e, m;
+    sink = frequency_registers(2450000000 + (i & 0xFF) * 1000, &freq, &channel, &e, &m);
+}
+
+static void bench_encodePacketLog(uint32_t i){
+    Packet_status status = {.overflowed = false, .len = PAYLOADSIZE + 4, .RSSI = -60, .CRCcheck = true, .LinkQualityIndicator = 0x20};
+    sink = encodePacketLog(frame, rx_packet, status, i);
+}
+
+static void bench_link_stats_update(uint32_t i){
+    rx_packet[1] = i;            // seq
+    rx_packet[2] = (i >> 5);     // file position
+    rx_packet[3] = i;
+    link_stats_update(&stats, rx_packet, PAYLOADSIZE + 4, PAYLOADSIZE, false, true, -60, 0x20, i * 1000);
+    sink = stats.total.received;
+}
+
+/* one tracepoint (has to stay below 1us on the target) */
+static void bench_trace_record(uint32_t i){
+    trace_begin(trace_build_frame, i);
+}
+
+/* one buffer from the packet pool and back (RX path: alloc, readPacket, free) */
+static void bench_packet_pool(uint32_t i){
+    Packet_buf *packet = packet_pool_alloc();
+    packet->words[0] = i;
+    sink = packet_pool_free(packet);
+}
+
+/*
+ * frame ring under contention: core 1 (a thread on the host) publishes numbered frames as fast as possible,
+ * every call consumes one frame (see tests/test_frame_ring.c for the checks)
+ * the packets are passed as buffers of the packet pool, i.e. the pool is shared between the cores as well
+ */
+static void frame_ring_producer(){
+    uint32_t n = 0;
+    while(true){
+        Frame *frame = frame_ring_reserve(&frames);
+        Packet_buf *packet = (frame != NULL) ? packet_pool_alloc() : NULL;
+        if(packet == NULL){
+            tight_loop_contents();
+            continue;
+        }
+        frame->words = 1 + n % (PACKET_BUF_SIZE/4);
+        for(uint8_t w = 0; w < frame->words; w++){
+            packet->words[w] = n ^ (w << 24);
+        }
+        frame->packet = packet;
+        frame->seq = n;
+        frame_ring_publish(&frames);
+        n++;
+    }
+}
+
+static void bench_frame_ring_spsc(uint32_t i){
+    static bool started = false;
+    if(!started){ // start the producer with the warm-up, it must not disturb the other benchmarks
+        multicore_launch_core1(frame_ring_producer);
+        started = true;
+    }
+    Frame *frame;
+    while((frame = frame_ring_peek(&frames)) == NULL){
+        tight_loop_contents();
+    }
+    uint32_t sum = frame->seq;
+    for(uint8_t w = 0; w < frame->words; w++){
+        sum += frame->packet->words[w];
+    }
+    sink = sum + packet_pool_free(frame->packet);
+    frame_ring_release(&frames);
+}
+
+
+#if !PICO_ON_DEVICE
+/*
+ * MSP430 backup protocol against the host stand-in (host only): BACKUP_BATCH packets are backed up in one
+ * transaction and restored in one transaction
+ * the MSP430 pins are arbitrary here
+ */
+#define BACKUP_BATCH  8
+#define BACKUP_LEN   24
+
+static void bench_msp430_backup_restore(uint32_t i){
+    Packet_buf *packets[BACKUP_BATCH];
+    uint8_t lengths[BACKUP_BATCH];
+    for(uint8_t p = 0; p < BACKUP_BATCH; p++){
+        packets[p] = packet_pool_alloc();
+        memset(packets[p]->bytes, i + p, BACKUP_LEN);
+        lengths[p] = BACKUP_LEN;
+    }
+    msp430_backup(packets, lengths, BACKUP_BATCH, UINT32_MAX);
+    for(uint8_t p = 0; p < BACKUP_BATCH; p++){
+        packet_pool_free(packets[p]);
+    }
+    int16_t restored = msp430_restore(packets, lengths, NULL, BACKUP_BATCH);
+    for(int16_t p = 0; p < restored; p++){
+        packet_pool_free(packets[p]);
+    }
+    sink = restored;
+}
+#endif
+
+/*
+ * scheduler on a simulated clock and supply (see scheduler.h): a capacitor charged by the harvester,
+ * sensing and transmitting cost energy, the parameters are the ones of carrier-receiver-baseband
+ */
+#define SIM_TX_MV         2000
+#define SIM_POLL_US     100000
+#define SIM_IDLE_US    1000000
+#define SIM_TX_GAP_US   250000
+#define SIM_SENSE_COST_UV  20000 // 20 mV
+#define SIM_TX_COST_UV    150000
+static Scheduler sim_scheduler;
+static uint64_t sim_now_us;
+static uint32_t sim_supply_uv;
+static bool sim_frame;
+
+static void sim_advance(uint64_t time_us){
+    if(time_us > sim_now_us){
+        uint64_t supply = sim_supply_uv + 100000 * ((time_us - sim_now_us) / 1000);
+        sim_supply_uv = (supply < 3300000) ? supply : 3300000;
+        sim_now_us = time_us;
+    }
+}
+
+static void sim_spend(uint32_t cost_uv, uint32_t duration_us){
+    sim_supply_uv = (sim_supply_uv > cost_uv) ? sim_supply_uv - cost_uv : 0;
+    sim_advance(sim_now_us + duration_us);
+}
+
+static uint64_t sim_clock_us(){ return sim_now_us; }
+static uint16_t sim_supply_mv(){ return sim_supply_uv / 1000; }
+static void sim_sleep_until(uint64_t time_us){ sim_advance(time_us); }
+static bool sim_transmit_ready(const Scheduler *s){ return sim_frame; }
+static bool sim_sense_ready(const Scheduler *s){ return !sim_frame; }
+
+static uint32_t sim_transmit(Scheduler *s){
+    sim_spend(SIM_TX_COST_UV, 4000); // frame airtime
+    sim_frame = false;
+    return SIM_TX_GAP_US;
+}
+
+static uint32_t sim_sense(Scheduler *s){
+    sim_spend(SIM_SENSE_COST_UV, 1000);
+    sim_frame = true;
+    return 0;
+}
+
+static Sched_task sim_tasks[] = {
+    {"transmit", SIM_TX_MV, sim_transmit_ready, sim_transmit},
+    {"sense",    SIM_TX_MV, sim_sense_ready,    sim_sense},
+};
+
+static void bench_sched_step(uint32_t i){
+    if(i == 0){
+        sim_now_us = 0;
+        sim_supply_uv = 1800000; // below the threshold
+        sim_frame = false;
+        sched_init(&sim_scheduler, sim_tasks, 2, SIM_POLL_US, SIM_IDLE_US, sim_clock_us, sim_supply_mv, sim_sleep_until);
+    }
+    sink = (uint32_t) (uintptr_t) sched_step(&sim_scheduler);
+}
+
+/* supply filter (see supply_filter.h) on synthetic 1 kHz ADC samples of a constant supply with +-3 LSB noise */
+static Supply_filter supply;
+static uint32_t noise_state = 1;
+
+static uint16_t supply_sample(int32_t uv){
+    noise_state = noise_state * 1664525 + 1013904223;
+    return (int64_t) uv * 4096 / 3300000 + (int32_t) (noise_state >> 29) - 3;
+}
+
+static void bench_supply_filter_add(uint32_t i){
+    supply_filter_add(&supply, supply_sample(2500000));
+    sink = supply_filter_mv(&supply);
+}
+
+static Rssi_parser rssi;
+
+static void bench_rssi_parser_feed(uint32_t i){
+    static const char line[] = "-47\n";
+    sink = rssi_parser_feed(&rssi, line[i % 4]);
+}
+
+/*
+ * rate adaptation (see rate_control.h): the tag moves between 1 m and 6 m, the delivery of every packet is drawn
+ * from the PER of its profile at the current distance (see tests/test_rate_control.c)
+ */
+#define RATE_PROFILES 4
+static const uint32_t rate_bitrates[RATE_PROFILES] = {25000, 50000, 100000, 200000};
+static const uint32_t rate_per_ppm[RATE_PROFILES][6] = { // 1 m ... 6 m
+    {0,    0,      0,      0,       0,       0},
+    {0,    0,      0,      4000,    26000,   279000},
+    {0,    0,      2000,   146000,  735000,  993000},
+    {2000, 629000, 962000, 1000000, 1000000, 1000000},
+};
+static Rate_control rate;
+static uint32_t rate_random = 1;
+
+static bool rate_delivered(uint8_t profile, uint8_t distance_m){
+    rate_random = rate_random * 1664525 + 1013904223;
+    return (rate_random >> 8) % 1000000 >= rate_per_ppm[profile][distance_m - 1];
+}
+
+static void bench_rate_control(uint32_t i){
+    uint8_t profile = rate_control_next(&rate);
+    rate_control_feedback(&rate, profile, rate_delivered(profile, 1 + (i / 1000) % 6));
+    sink = profile;
+}
+
+/* selective-repeat ARQ (see arq.h): a frame added, received, acknowledged and released */
+static Arq_tx arq_tx;
+static Arq_rx arq_rx;
+static uint8_t arq_frame;
+
+static void bench_arq(uint32_t i){
+    bool delivered;
+    arq_tx_add(&arq_tx, &arq_frame, i, i + 1);
+    arq_rx_update(&arq_rx, i, true);
+    Arq_ack ack;
+    arq_rx_ack(&arq_rx, &ack);
+    arq_tx_feedback(&arq_tx, &ack);
+    sink = arq_tx_release(&arq_tx, i, &delivered) != NULL;
+}
+
+/* FEC (see fec.h) of a frame (seq and payload) */
+static uint8_t fec_data[1 + PAYLOADSIZE];
+static uint8_t fec_block[FEC_LEN(1 + PAYLOADSIZE)];
+
+static void bench_fec_encode(uint32_t i){
+    fec_data[0] = i;
+    fec_encode(fec_data, sizeof(fec_data), fec_block);
+}
+
+static void bench_fec_decode(uint32_t i){
+    uint8_t decoded[sizeof(fec_data)];
+    sink = fec_decode(fec_block, sizeof(fec_data), decoded, NULL);
+}
+
+/* PN9 data whitening (see whiten() in packet_generation.h) */
+static uint8_t whitening_frame[PN9_TABLE_LEN];
+
+static void bench_whiten(uint32_t i){
+    whiten(whitening_frame, PAYLOADSIZE + 2); // length byte, seq and payload
+}
+
+/* compressed payloads (see generate_compressed() in packet_generation.h) */
+static uint8_t compression_payload[PAYLOADSIZE];
+
+static void bench_generate_compressed(uint32_t i){
+    sink = generate_compressed(compression_payload, PAYLOADSIZE);
+}
+
+static void bench_decompress_samples(uint32_t i){
+    uint16_t samples[32];
+    sink = decompress_samples(&compression_payload[2], PAYLOADSIZE - 2, samples, 32);
+}
+
+/* frame aggregation (see aggregator.h): a sample queued, packed whenever the policy asks for a frame */
+#define AGG_PAYLOAD (64 - HEADER_LEN) // a buffer of the packet pool
+static Aggregator bench_aggregator;
+static uint8_t aggregator_payload[AGG_PAYLOAD];
+
+static void bench_aggregator_step(uint32_t i){
+    aggregator_push(&bench_aggregator, i, i);
+    uint8_t len = aggregator_ready(&bench_aggregator, i, AGG_PAYLOAD);
+    sink = (len != 0) ? aggregator_pack(&bench_aggregator, aggregator_payload, len) : 0;
+}
+
+/*
+ * frame formats (see Frame_format in packet_generation.h): frames of three interleaved formats (shorter preamble,
+ * CRC, another sync word with trailer) are built and told apart by frame_parse()
+ */
+static Frame_format frame_formats[3];
+static const Frame_format *frame_format_list[3] = {&frame_formats[0], &frame_formats[1], &frame_formats[2]};
+static uint8_t frame_format_bytes[PACKET_BUF_SIZE];
+static uint32_t frame_format_words[PACKET_BUF_SIZE/4];
+
+static void bench_frame_build(uint32_t i){
+    const Frame_format *f = frame_format_list[i % 3];
+    uint8_t offset = frame_header(f, frame_format_bytes, i);
+    memcpy(&frame_format_bytes[offset], tx_payload_buffer, PAYLOADSIZE);
+    uint8_t len = frame_finish(f, frame_format_bytes, PAYLOADSIZE);
+    pack_words(frame_format_bytes, frame_format_words, buffer_size(len, 0));
+    sink = frame_parse(frame_format_list, 3, frame_format_words, NULL, NULL);
+}
+
+/* last-known-good configuration (see boot_config.h): the newest of a sector with BOOT_CONFIG_RECORDS - 2 records */
+static uint8_t boot_sector[BOOT_CONFIG_RECORDS * BOOT_CONFIG_RECORD_SIZE];
+
+static void bench_boot_config_latest(uint32_t i){
+    Boot_config config;
+    sink = boot_config_latest(boot_sector, &config);
+}
+
+struct benchmark {
+    const char *name;
+    void (*run)(uint32_t i);
+    uint32_t iterations;
+};
+
+static const struct benchmark benchmarks[] = {
+    {"generatePIOprogram",             bench_generatePIOprogram,              2000},
+    {"generate_sample",                bench_generate_sample,               100000},
+    {"generate_data",                  bench_generate_data,                  20000},
+    {"build_packet",                   bench_build_packet,                  100000},
+    {"datarate_registers",             bench_datarate_registers,             50000},
+    {"filter_bandwidth_registers",     bench_filter_bandwidth_registers,     50000},
+    {"frequency_deviation_registers",  bench_frequency_deviation_registers,  50000},
+    {"frequency_registers",            bench_frequency_registers,            50000},
+    {"encodePacketLog",                bench_encodePacketLog,               100000},
+    {"link_stats_update",              bench_link_stats_update,              50000},
+    {"trace_record",                   bench_trace_record,                  100000},
+    {"packet_pool",                    bench_packet_pool,                   100000},
+    {"frame_ring_spsc",                bench_frame_ring_spsc,               100000},
+    {"supply_filter_add",              bench_supply_filter_add,             100000},
+    {"rssi_parser_feed",               bench_rssi_parser_feed,              100000},
+    {"rate_control",                   bench_rate_control,                  100000},
+    {"whiten",                         bench_whiten,                        100000},
+    {"generate_compressed",            bench_generate_compressed,           100000},
+    {"decompress_samples",             bench_decompress_samples,            100000},
+    {"aggregator",                     bench_aggregator_step,               100000},
+    {"frame_build",                    bench_frame_build,                   100000},
+    {"boot_config_latest",             bench_boot_config_latest,             20000},
+    {"fec_encode",                     bench_fec_encode,                    100000},
+    {"fec_decode",                     bench_fec_decode,                    100000},
+    {"arq",                            bench_arq,                           100000},
+    {"sched_step",                     bench_sched_step,                    100000},
+#if !PICO_ON_DEVICE
+    {"msp430_backup_restore",          bench_msp430_backup_restore,          10000},
+#endif
+};
+
+static uint64_t median(uint64_t *values, uint8_t len){
+    // insertion sort, len is small
+    for(uint8_t i = 1; i < len; i++){
+        for(uint8_t j = i; j > 0 && values[j-1] > values[j]; j--){
+            uint64_t tmp = values[j];
+            values[j] = values[j-1];
+            values[j-1] = tmp;
+        }
+    }
+    return values[len/2];
+}
+
+/* returns the median duration of one repetition [us] and the allocations of the last repetition */
+static uint64_t run_benchmark(const struct benchmark *b, uint32_t *allocs){
+    uint64_t durations[BENCH_REPEATS];
+    for(uint32_t i = 0; i < b->iterations; i++){ // warm-up (caches, lazy initialisation)
+        b->run(i);
+    }
+    for(uint8_t r = 0; r < BENCH_REPEATS; r++){
+        allocations = 0;
+        uint64_t start = time_us_64();
+        for(uint32_t i = 0; i < b->iterations; i++){
+            b->run(i);
+        }
+        durations[r] = time_us_64() - start;
+        *allocs = allocations;
+    }
+    return median(durations, BENCH_REPEATS);
+}
+
+static void setup(){
+    header_tmplate = packet_hdr_template(2500);
+    generate_data(tx_payload_buffer, PAYLOADSIZE, true);
+    memset(rx_packet, 0, sizeof(rx_packet));
+    rx_packet[0] = PAYLOADSIZE + 3;
+    link_stats_init(&stats);
+    trace_init();
+    packet_pool_init();
+    frame_ring_init(&frames);
+    supply_filter_init(&supply, 1000);
+    rssi_parser_init(&rssi);
+    rate_control_init(&rate, rate_bitrates, RATE_PROFILES, 2);
+    arq_tx_init(&arq_tx);
+    arq_rx_init(&arq_rx);
+    for(uint8_t i = 0; i < sizeof(fec_data); i++){
+        fec_data[i] = i * 37;
+    }
+    fec_encode(fec_data, sizeof(fec_data), fec_block);
+    for(uint8_t i = 0; i < PN9_TABLE_LEN; i++){
+        whitening_frame[i] = i;
+    }
+    generate_compressed(compression_payload, PAYLOADSIZE);
+    Agg_policy policy = {.target_payload = AGG_PAYLOAD, .max_latency_us = 2000000, .compressed = false};
+    aggregator_init(&bench_aggregator, &policy, 0);
+    frame_formats[0] = frame_format_cc2500;
+    frame_formats[0].preamble = 2;
+    frame_formats[0].whitening = true;
+    frame_formats[1] = frame_format_cc2500;
+    frame_formats[1].crc = true;
+    frame_formats[2] = frame_format_cc1352;
+    frame_formats[2].trailer[0] = 0x55;
+    frame_formats[2].trailer_len = 1;
+    memset(boot_sector, 0xFF, sizeof(boot_sector));
+    for(uint8_t r = 0; r < BOOT_CONFIG_RECORDS - 2; r++){
+        Boot_config config = {.baud = 50000 + 1000 * r, .carrier_hz = 2450000000, .d0 = 40, .d1 = 36, .profile = r % 3};
+        boot_config_seal(&config, r);
+        memcpy(&boot_sector[r * BOOT_CONFIG_RECORD_SIZE], &config, sizeof(config));
+    }
+#if !PICO_ON_DEVICE
+    msp430_standin_init(pio1, 3, 0);
+    msp430_backup_init(pio1, 5000000, 10, 11, 12, 2, 3, 1, 0);
+#endif
+}
+
+int main(){
+    stdio_init_all();
+#if PICO_ON_DEVICE
+    while(!stdio_usb_connected()){
+        sleep_ms(100);
+    }
+#endif
+    setup();
+    uint32_t clk_sys_mhz = clock_get_hz(clk_sys) / 1000000;
+
+    printf("{\"benchmarks\": [\n");
+    uint8_t count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+    for(uint8_t n = 0; n < count; n++){
+        const struct benchmark *b = &benchmarks[n];
+        uint32_t allocs;
+        uint64_t duration_us = run_benchmark(b, &allocs);
+        double ns_per_call = (1000.0 * duration_us) / b->iterations;
+        printf("  {\"name\": \"%s\", \"iterations\": %u, \"ns_per_call\": %.1f", b->name, b->iterations, ns_per_call);
+        if(PICO_ON_DEVICE){
+            printf(", \"cycles_per_call\": %.1f", ns_per_call * clk_sys_mhz / 1000.0);
+        }
+        if(BENCH_COUNT_ALLOCS){
+            printf(", \"allocs_per_call\": %.3f", ((double) allocs) / b->iterations);
+        }else{
+            printf(", \"allocs_per_call\": null");
+        }
+        printf("}%s\n", (n + 1 < count) ? "," : "");
+    }
+    printf("]}\n");
+    return 0;
+}
@@ -25,6 +25,7 @@
 #include "backscatter.h"
 #include "carrier_CC2500.h"
 #include "receiver_CC2500.h"
+#include "packet_log.h"
 #include "packet_generation.h"
 
 #include "hardware/uart.h"
@@ -62,6 +63,7 @@ static int chars_rxed = 0;
 #define TWOANTENNAS          true
 
 #define CARRIER_FEQ     2450000000
+#define LOG_BINARY           false // log received packets as COBS framed binary records (see packet_log.h) instead of text
 
 // RX interrupt handler
 void on_uart_rx() {
@@ -201,7 +203,11 @@ int main() {
                 // finished receiving
                 time_us = to_us_since_boot(get_absolute_time());
                 status = readPacket(rx_buffer);
-                printPacket(rx_buffer,status,time_us);
+                if(LOG_BINARY){
+                    logPacket(rx_buffer,status,time_us);
+                }else{
+                    printPacket(rx_buffer,status,time_us);
+                }
                 RX_start_listen();
                 rx_ready = true;
             break;
@@ -218,9 +224,7 @@ int main() {
                     memcpy(&message[HEADER_LEN], tx_payload_buffer, PAYLOADSIZE);
 
                     /* casting for 32-bit fifo */
-                    for (uint8_t i=0; i < buffer_size(PAYLOADSIZE, HEADER_LEN); i++) {
-                        buffer[i] = ((uint32_t) message[4*i+3]) | (((uint32_t) message[4*i+2]) << 8) | (((uint32_t) message[4*i+1]) << 16) | (((uint32_t)message[4*i]) << 24);
-                    }
+                    pack_words(message, buffer, buffer_size(PAYLOADSIZE, HEADER_LEN));
                     /* put the data to FIFO (start backscattering) */
                     startCarrier();
                     sleep_ms(1); // wait for carrier to start
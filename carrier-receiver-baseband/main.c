@@ -16,6 +16,8 @@
 #include "pico/stdlib.h"
 
 #include "pico/util/queue.h"
+#include "pico/multicore.h"
+#include "pico/flash.h"
 #include "pico/binary_info.h"
 #include "pico/util/datetime.h"
 #include "hardware/spi.h"
@@ -25,6 +27,21 @@
 #include "backscatter.h"
 #include "carrier_CC2500.h"
 #include "receiver_CC2500.h"
+#include "packet_log.h"
+#include "log_ring.h"
+#include "link_stats.h"
+#include "trace.h"
+#include "packet_pool.h"
+#include "frame_ring.h"
+#include "msp430_backup.h"
+#include "scheduler.h"
+#include "supply_monitor.h"
+#include "rssi_uart.h"
+#include "rate_control.h"
+#include "arq.h"
+#include "fec.h"
+#include "aggregator.h"
+#include "boot_flash.h"
 #include "packet_generation.h"
 
 #include "hardware/uart.h"
@@ -43,13 +60,11 @@
 // We are using pins 0 and 1, but see the GPIO function select table in the
 // datasheet for information on which other pins can be used.
 #define UART_RX_PIN        5
-#define UART_BUFFER_SIZE 256
-#define UART_END_MARK   '\n'// end of line character
 static int  chars_rxed = 0;
 /// \end::uart_advanced[]
 
-// SPI pin for MSP430
-#define MY_SPI_PORT     spi1
+// SPI pin for MSP430, driven by the PIO handshake engine (see msp430_pio.h)
+#define MSP430_PIO      pio1
 #define SPI_BAUDRATE 5000000  // 5 MHz
 #define PIN_MISO          12
 #define PIN_MOSI          11
@@ -57,14 +72,15 @@ static int  chars_rxed = 0;
 
 #define PIN_IND     0  // 实际是IND信号
 #define PIN_MODE    1
-#define PIN_REQ     2
+#define PIN_REQ     2  // has to follow PIN_MODE (PIO set pins)
 #define PIN_ACK     3
 
 
 
 // 协议参数
 #define MESSAGE_SIZE    128
-#define TIMEOUT_MS      500
+#define MSP430_RESTORE_BATCH      4 // frames restored per transaction (see msp430_backup.h)
+#define MSP430_BACKUP_BUDGET_US 2000 // time left for a backup once a low voltage has been detected
 
 
 //SPI Receiver CC2500
@@ -74,28 +90,68 @@ static int  chars_rxed = 0;
 #define RADIO_SCK               18
 
 #define TX_DURATION           5000 // send a packet every 250ms (when changing baud-rate, ensure that the TX delay is larger than the transmission time)
-#define RECEIVER              2500 // define the receiver board either 2500 or 1352
+#define RECEIVER              2500 // define the receiver board either 2500 or 1352 (its frame format, see frame_format())
+#define RECEIVER2                0 // interleave frames for another receiver board (1352 or 2500, 0: none), see frame_formats_init()
+#define PREAMBLE_BYTES           4 // preamble of the frames for RECEIVER, the CC2500 (PQT 0) looks for the sync word without a minimum
+#define FRAME_CRC            false // append the CRC-16 which the CC2500 checks (2 bytes per frame, otherwise every frame counts as CRC error)
 #define PIN_TX1                  9
 #define PIN_TX2                 22
 #define CLOCK_DIV0              20 // larger
 #define CLOCK_DIV1              18 // smaller
 #define DESIRED_BAUD        100000
 #define TWOANTENNAS           true
+#define RATE_ADAPTATION       true // choose the baseband profile of every packet from the delivery of the previous ones (see rate_control.h)
+#define RATE_PROFILES            4
+#define RATE_START               2 // CLOCK_DIV0, CLOCK_DIV1, DESIRED_BAUD
+#define ARQ_ENABLED           true // resend lost and corrupted frames (selective repeat, see arq.h)
+#define ARQ_MARGIN_US         5000 // ARQ: a frame is resent if it has not been received within its airtime and this margin
+#define WHITENING             true // PN9 data whitening of the frames, de-whitened by the receiver (the CC1352 needs whitening in its SmartRF settings)
+#define COMPRESSION          false // adaptive Rice coding of the samples (see generate_compressed()), the logged payloads need stats/functions.py decompress_log()
+#define FEC_ENABLED          false // encode seq and payload with Hamming(8,4) and interleaving (see fec.h), doubles the airtime
+#define AGGREGATION           true // queue the samples and pack them into as few full frames as the energy allows (see aggregator.h), otherwise PAYLOADSIZE per frame
+#define SAMPLE_PERIOD_US     40000 // aggregation: one sample every 40ms
+#define AGG_MAX_LATENCY_US 2000000 // aggregation: a frame is sent (shorter) once its oldest sample has waited this long
+#define AGG_TARGET_PAYLOAD max_payload // aggregation: payload bytes of a full frame (2B file position and the samples)
+#define FRAME_OVERHEAD_US     4000 // send_frame(): carrier start and margin after the airtime
 
 #define CARRIER_FEQ     2450000000
+#define LOG_BINARY           false // log received packets as COBS framed binary records (see packet_log.h) instead of text
+#define LOG_DRAIN_CORE1       true // print the log ring on core 1, otherwise drain it at idle time in the main loop
+#define LOG_DRAIN_BATCH          4 // records printed per idle drain
+#define STATS_INTERVAL_US 10000000 // report link statistics every 10s
+#define PIPELINE_CORE1       false // core 1 builds the frames (ADC, RSSI, MSP430), core 0 only transmits and receives (see frame_ring.h)
+#define PIPELINE_RETRY_US  5000000 // core 1: wait before sensing again after low voltage/weak RSSI
+#define SUPPLY_TX_MV          2000 // scheduler: supply needed to sense, recover, check the link and transmit
+#define SUPPLY_BACKUP_MV      1900 // scheduler: a waiting frame is backed up below (hysteresis to SUPPLY_TX_MV)
+#define SUPPLY_HORIZON_US    20000 // scheduler: a frame is backed up instead of sent if the supply is predicted to fall below SUPPLY_BACKUP_MV within (airtime and backup)
+#define SUPPLY_SAMPLE_HZ      1000 // supply monitor (ADC input 0, GPIO 26)
+#define SCHED_POLL_US       100000 // scheduler: supply re-check while a task waits for energy
+#define SCHED_IDLE_US      1000000 // scheduler: longest sleep
+#define TX_GAP_US           250000 // scheduler: minimal time between two transmissions
+#define RSSI_GOOD_DBM          -50 // RSSI (moving average) of the CC2640R2 needed to transmit
+#define RSSI_MAX_AGE_US    2000000 // an older RSSI is not trusted
+#define TASK_RETRY_US      5000000 // scheduler: after a failed restore/backup or an empty packet pool
+#define HEADLESS             false // fast boot: no wait for USB, the last-known-good rate profile from the flash (see boot_flash.h), the first frame right away
+#define BOOT_GOOD_PPM       500000 // headless: the active rate profile is stored once its delivery probability reaches this
+#define BOOT_STABLE_CHECKS       6 // headless: ... at this many statistics reports in a row (1 min)
+#define BOOT_STORE_US    600000000 // headless: at least 10 min between two writes of the boot configuration
+#define HOUSEKEEPING_US     100000 // scheduler: statistics, log drain and trace requests
+
+/*
+ * packet buffers held at the same time, RX needs one more whenever a packet arrives
+ * pipeline: the frame ring (also the frame core 1 builds, backs up or restores) and the ARQ window
+ * single core: the frame waiting for TX, the rest of a restored batch and the ARQ window
+ */
+#define POOL_BUDGET ((PIPELINE_CORE1 ? FRAME_RING_LENGTH : 1 + MSP430_RESTORE_BATCH) + (ARQ_ENABLED ? ARQ_WINDOW : 0) + 1)
+_Static_assert(PACKET_POOL_SLOTS >= POOL_BUDGET, "the packet pool cannot hold the frames queued for TX, the ARQ window and an RX packet");
 
 // 全局变量
 uint8_t tx_buffer[MESSAGE_SIZE];
 uint8_t rx_buffer[MESSAGE_SIZE];
 void my_init_spi() {
-    // 初始化 SPI
-    spi_init(MY_SPI_PORT, SPI_BAUDRATE);
-    spi_set_format(MY_SPI_PORT, 8, SPI_CPOL_0, SPI_CPHA_0, SPI_MSB_FIRST);
-    
-    // 设置 SPI 引脚
-    gpio_set_function(PIN_SCK, GPIO_FUNC_SPI);
-    gpio_set_function(PIN_MOSI, GPIO_FUNC_SPI);
-    gpio_set_function(PIN_MISO, GPIO_FUNC_SPI);
+    // SCK/MOSI/MISO are clocked by the PIO handshake engine, it takes over REQ and MODE (msp430_backup_init)
+    gpio_init(PIN_MISO);
+    gpio_set_dir(PIN_MISO, GPIO_IN);
     
     // 设置控制引脚
     gpio_init(PIN_REQ);
@@ -116,8 +172,8 @@ void my_init_spi() {
     memset(rx_buffer, 0, MESSAGE_SIZE);
 
     // ===== 二进制信息声明 =====
-    // SPI1 引脚声明
-    bi_decl(bi_3pins_with_func(PIN_MOSI, PIN_MISO, PIN_SCK, GPIO_FUNC_SPI));
+    // SPI 引脚声明 (PIO)
+    bi_decl(bi_3pins_with_func(PIN_MOSI, PIN_MISO, PIN_SCK, GPIO_FUNC_PIO1));
     
     // 控制引脚声明
     bi_decl(bi_1pin_with_name(PIN_REQ, "REQ"));
@@ -129,115 +185,40 @@ void my_init_spi() {
     bi_decl(bi_program_name("MSP430-SPI1-Communicator"));
     bi_decl(bi_program_description("SPI1 communication with MSP430FR5969"));
 }
-// 等待信号变化 (带超时)
-bool wait_for_signal(uint pin, bool expected_state, uint timeout_ms) {
-    absolute_time_t start_time = get_absolute_time();
-    absolute_time_t timeout_time = delayed_by_ms(start_time, timeout_ms);
-    
-    while (gpio_get(pin) != expected_state) {
-        if (absolute_time_diff_us(get_absolute_time(), timeout_time) <= 0) {
-            return false; // 超时
-        }
-        sleep_us(10);
-    }
-    return true;
-}
+/*
+ * MSP430 backup: a frame is backed up in one transaction, restored frames arrive in batches of
+ * MSP430_RESTORE_BATCH (one transaction) and are handed out one by one
+ */
+static Packet_buf *backlog[MSP430_RESTORE_BATCH];
+static uint8_t backlog_lengths[MSP430_RESTORE_BATCH];
+static uint8_t backlog_count = 0;
+static uint8_t backlog_next = 0;
 
-int8_t test_my_write(const uint8_t *data, size_t len) {
-    gpio_put(PIN_REQ, 0);  // REQ reset
-    gpio_put(PIN_MODE, 1); // 写模式
-    // printf("\n=== Testing My Write Protocol ===\n");
-    printf("Backup packet to MSP430 ...\n");
-    
-    sleep_ms(100); // 等待稳定
-    
-    gpio_put(PIN_REQ, 1);  // REQ上升沿
-    // printf("REQ set high\n");
-    //wait for ACK high
-    if (wait_for_signal(PIN_ACK, 1, TIMEOUT_MS)) {
-        // printf("ACK high received\n");
-    } else {
-        printf("ERROR: Timeout waiting for ACK high!\n");
+int8_t backup_packet(Packet_buf *packet, uint8_t len) {
+    int16_t result = msp430_backup(&packet, &len, 1, MSP430_BACKUP_BUDGET_US);
+    if (result != 1) {
+        log_printf("ERROR: MSP430 backup failed (%d)\n", result);
         return -1;
     }
-
-    // 4. SPI 数据传输 (只写)
-    printf("Beginning SPI data write...\n");
-    bool success = spi_is_writable(MY_SPI_PORT);
-    // printf("SPI writable? %s\n", success ? "yes" : "no");
-    spi_write_blocking(MY_SPI_PORT, data, len);//len 是数据长度 in bytes
-    for (size_t i = 0; i < len; ++i) {
-        // printf("%c=", rx_data[i]);
-        printf("0x%02X ", data[i]);
-        if ((i + 1) % 16 == 0) {
-            printf("\n");
-        }
-    }
-    
-    // for (int i = 0; i < len; ++i) {
-    //     int ret = spi_write_blocking(MY_SPI_PORT, &data[i], 1);
-    //     printf("Wrote byte %d: 0x%02X (ret = %d)\n", i, data[i], ret);
-    // }
-    gpio_put(PIN_REQ, 0);  
-    // printf("REQ set low to write\n");
-    printf("Backup completed\n");
     return 0;
 }
 
-int8_t test_my_read(uint32_t *data, size_t len) {
-    // printf("\n=== Testing My Read Protocol ===\n");
-    gpio_put(PIN_REQ, 0);  // REQ reset
-    gpio_put(PIN_MODE, 0); // 读模式
-    // printf("MODE set to read\n");
-    printf("Recover packet from MSP430 ...\n");
-
-    sleep_ms(100); // 等待稳定
+// frames waiting on the MSP430 or in the restored batch (the MSP430 is asked if the depth of its queue is unknown)
+bool backlog_pending() {
+    return backlog_next < backlog_count || msp430_queue_depth() != 0;
+}
 
-    // 发起请求 (REQ 低->高 上升沿)
-    gpio_put(PIN_REQ, 1);
-    // printf("REQ set high\n");
-    
-    // 等待 ACK 高 (带超时)
-    if (wait_for_signal(PIN_ACK, 1, TIMEOUT_MS)) {
-        // printf("ACK high received\n");
-    } else {
-        printf("ERROR: Timeout waiting for ACK high!\n");
-        return -1; // 超时错误
-    }
-    
-    // SPI 数据读取
-    // printf("Beginning SPI data read...\n");
-    uint32_t *rx_data = malloc(len);
-    if (!rx_data) {
-        printf("ERROR: Memory allocation failed for rx_data\n");
-        return -1; // 内存分配失败
-    }   
-    memset(rx_data, 0, len); // 清空接收缓冲区
-    spi_read_blocking(MY_SPI_PORT, 0, rx_data, len);
-    printf("Read %d bytes from SPI:\n", len);
-    for (size_t i = 0; i < len; ++i) {
-        // printf("%c=", rx_data[i]);
-        printf("0x%02X ", rx_data[i]);
-        if ((i + 1) % 16 == 0) {
-            printf("\n");
+// next restored frame (owned by the caller afterwards), NULL if the MSP430 has none or the restore failed
+Packet_buf *recover_packet() {
+    if (backlog_next == backlog_count) {
+        int16_t restored = msp430_restore(backlog, backlog_lengths, NULL, MSP430_RESTORE_BATCH);
+        if (restored < 0) {
+            log_printf("ERROR: MSP430 restore failed (%d)\n", restored);
         }
+        backlog_next = 0;
+        backlog_count = (restored > 0) ? restored : 0;
     }
-    
-    // 结束传输 (REQ 高->低 下降沿)
-    gpio_put(PIN_REQ, 0);
-    // printf("REQ set low to end read\n");
-    
-    // 等待 ACK 低
-    if (wait_for_signal(PIN_ACK, 0, TIMEOUT_MS)) {
-        // printf("ACK low detected\n");
-    } else {
-        printf("ERROR: Timeout waiting for ACK low!\n");
-        return -1; // 超时错误
-    }
-    data = rx_data; // 将读取的数据返回
-    free(rx_data); // 释放内存
-    printf("Recover packet from MSP430 successfully!\n");
-    return 0; // 成功
+    return (backlog_next < backlog_count) ? backlog[backlog_next++] : NULL;
 }
 
 // 初始化所有 GPIO 引脚
@@ -259,83 +240,763 @@ void init_gpio() {
     gpio_set_dir(PIN_ACK, GPIO_IN);
     gpio_pull_down(PIN_ACK);  // 可选：启用下拉
     
-    // SPI 引脚初始化（即使设置了SPI功能，也建议显式初始化）
-    gpio_init(PIN_SCK);
-    gpio_set_function(PIN_SCK, GPIO_FUNC_SPI);
-    
-    gpio_init(PIN_MOSI);
-    gpio_set_function(PIN_MOSI, GPIO_FUNC_SPI);
-    
+    // SPI 引脚: SCK/MOSI 由 PIO 驱动 (msp430_backup_init), MISO 是输入
     gpio_init(PIN_MISO);
-    gpio_set_function(PIN_MISO, GPIO_FUNC_SPI);
+    gpio_set_dir(PIN_MISO, GPIO_IN);
     
     printf("GPIO initialized\n");
 }
-// RX interrupt handler
-int on_uart_rx() {
-    uint16_t rx_index = 0;
-    uint8_t rx_buffer_0[UART_BUFFER_SIZE] = {0};
-    uint8_t rx_buffer_1[UART_BUFFER_SIZE] = {0};
-    while (uart_is_readable(UART_ID)) {
-        // printf("UART data received...\n");
-        int8_t ch = uart_getc(UART_ID);
-        // printf("Received char: %c\n", ch);
-        if(rx_index < UART_BUFFER_SIZE - 1) {
-            rx_buffer_0[rx_index++] = ch;
-        } else {
-            rx_index = 0; // reset index if buffer is full
-        }
+// the link is good: the RSSI of the CC2640R2 is recent and strong enough
+bool link_good() {
+    int16_t rssi = rssi_current(RSSI_MAX_AGE_US);
+    return rssi != RSSI_NONE && rssi >= RSSI_GOOD_DBM;
+}
+
+/*
+ * boot profile: time since the reset [us] at the end of every boot step (the timer starts at the reset),
+ * reported once the first frame has been sent and USB is attached
+ */
+enum boot_step {boot_main, boot_config, boot_baseband, boot_carrier, boot_receiver, boot_peripherals, boot_first_frame, BOOT_STEPS};
+static uint64_t boot_profile[BOOT_STEPS];
+static bool boot_restored = false;          // the rate profile came from the flash
+static uint8_t boot_stored = RATE_PROFILES; // rate profile in the flash (RATE_PROFILES: unknown)
+static volatile bool boot_frame = HEADLESS; // the first frame is sent right away (see frame_payload())
+static bool boot_reported = false;
+
+void boot_mark(enum boot_step step) {
+    if (boot_profile[step] == 0) {
+        boot_profile[step] = time_us_64();
+    }
+}
+
+void report_boot() {
+    if (boot_reported || boot_profile[boot_first_frame] == 0 || !stdio_usb_connected()) {
+        return;
+    }
+    log_printf("boot: main %u us | config %u us | baseband %u us | carrier %u us\n", boot_profile[boot_main], boot_profile[boot_config], boot_profile[boot_baseband], boot_profile[boot_carrier]);
+    log_printf("boot: receiver %u us | peripherals %u us | first frame %u us\n", boot_profile[boot_receiver], boot_profile[boot_peripherals], boot_profile[boot_first_frame]);
+    log_printf("boot: headless %u | restored %u\n", HEADLESS, boot_restored);
+    boot_reported = true;
+}
+
+// transmissions may start: the link is good, or the first frame of a headless boot (no RSSI is known after a reset)
+bool link_ready() {
+    return boot_frame || link_good();
+}
+
+/*
+ * rate adaptation (RATE_ADAPTATION): a frame counts as delivered if the receiver gets it back without errors
+ * (CRC or payload) before the next one is sent. The baseband and the matched receiver settings are only
+ * switched between two frames.
+ */
+static const struct {
+    uint16_t d0;
+    uint16_t d1;
+    uint32_t baud;
+} rate_profiles[RATE_PROFILES] = {
+    {38, 36, 25000}, // 40/36 does not fit into the state machine at 25 kbaud with two antennas
+    {40, 36, 50000},
+    {CLOCK_DIV0, CLOCK_DIV1, DESIRED_BAUD},
+    {40, 36, 200000},
+};
+static struct backscatter_config backscatter_conf;
+static uint16_t instructionBuffer[32] = {0}; // maximal instruction size: 32
+static Rate_control rate_control;
+static uint8_t rate_active;               // profile of the baseband and the receiver
+static int16_t rate_pending = -1;         // seq of the last frame until it is received (-1: none)
+static uint8_t rate_pending_profile;
+
+// start: profile of the baseband (see boot_profile_index())
+void rate_init(uint8_t start) {
+    uint32_t bitrates[RATE_PROFILES];
+    for (uint8_t p = 0; p < RATE_PROFILES; p++) {
+        bitrates[p] = rate_profiles[p].baud;
+    }
+    rate_control_init(&rate_control, bitrates, RATE_PROFILES, start);
+    rate_active = start;
+}
+
+// reprogram the baseband and the receiver (the TX FIFO is empty between two frames), nothing is printed directly
+void rate_apply(PIO pio, uint sm, uint8_t profile) {
+    if (!backscatter_program_update(pio, sm, rate_profiles[profile].d0, rate_profiles[profile].d1, rate_profiles[profile].baud, &backscatter_conf, instructionBuffer, TWOANTENNAS)) {
+        log_printf("ERROR: rate profile %d does not fit into the state machine\n", profile);
+        return;
+    }
+    RX_stop_listen();
+    set_frecuency_rx_quiet(CARRIER_FEQ + backscatter_conf.center_offset);
+    uint32_t deviation = set_frequency_deviation_rx_quiet(backscatter_conf.deviation);
+    uint32_t datarate = set_datarate_rx_quiet(backscatter_conf.baudrate);
+    uint32_t bandwidth = set_filter_bandwidth_rx_quiet(backscatter_conf.minRxBw);
+    RX_start_listen();
+    rate_active = profile;
+    log_printf("rate: profile %u | rx r_data %u | bw %u | f_dev %u\n", profile, datarate, bandwidth, deviation);
+}
+
+// the previous frame is lost if it has not been received yet, choose the profile of the next one
+void rate_before_send(PIO pio, uint sm, uint8_t seq) {
+    if (!RATE_ADAPTATION) {
+        return;
+    }
+    if (rate_pending >= 0) {
+        rate_control_feedback(&rate_control, rate_pending_profile, false);
+    }
+    uint8_t profile = rate_control_next(&rate_control);
+    if (profile != rate_active) {
+        rate_apply(pio, sm, profile);
+    }
+    rate_pending = seq;
+    rate_pending_profile = rate_active;
+}
+
+// after link_stats_update(): the frame seq was received
+void rate_after_receive(const Link_stats *link_stats, uint8_t seq) {
+    const struct link_stats_packet *last = link_stats_last(link_stats);
+    if (!RATE_ADAPTATION || last == NULL || rate_pending != seq) {
+        return;
+    }
+    rate_control_feedback(&rate_control, rate_pending_profile, last->crc_ok || last->bit_errors == 0);
+    rate_pending = -1;
+}
+
+/*
+ * ARQ (ARQ_ENABLED): new frames stay in the retransmission window after sending until the receiver of this
+ * board acknowledges them (see arq.h). Lost and corrupted frames are resent before new ones.
+ * Frames recovered from the MSP430 are sent once: their seq is too old for the ACK bitmaps.
+ */
+static Arq_tx arq_tx;
+static Arq_rx arq_rx;
+
+// after link_stats_update(): the frame seq was received, its ACK/NACK goes to the sender (on this board)
+void arq_after_receive(const Link_stats *link_stats, uint8_t seq) {
+    const struct link_stats_packet *last = link_stats_last(link_stats);
+    if (!ARQ_ENABLED || last == NULL) {
+        return;
+    }
+    Arq_ack ack;
+    arq_rx_update(&arq_rx, seq, last->crc_ok || last->bit_errors == 0);
+    arq_rx_ack(&arq_rx, &ack);
+    arq_tx_feedback(&arq_tx, &ack);
+}
+
+// one line pair per profile, * marks the active one
+void report_rate() {
+    if (!RATE_ADAPTATION) {
+        return;
+    }
+    for (uint8_t p = 0; p < RATE_PROFILES; p++) {
+        const Rate_stats *s = &rate_control.profiles[p];
+        log_printf("rate: %u baud%c | delivery %u ppm | goodput %u bit/s\n", s->bitrate, (p == rate_active) ? '*' : ' ', s->prob_ppm, rate_control_goodput(&rate_control, p));
+        log_printf("rate: %u baud%c | sent %u | delivered %u\n", s->bitrate, (p == rate_active) ? '*' : ' ', s->total_attempts, s->total_successes);
+    }
+}
+
+/*
+ * frame formats (see Frame_format in packet_generation.h): the frames are built at runtime for RECEIVER, the
+ * receiver of this board (statistics, ARQ, rate adaptation), and with RECEIVER2 for a second one in turn.
+ * Every receiver has its own seq, the frames of the second one are sent once.
+ */
+#define FRAME_FORMATS 2
+static Frame_format tx_formats[FRAME_FORMATS];
+static const Frame_format *tx_format_list[FRAME_FORMATS]; // frame_parse()
+static uint8_t tx_format_count = 0;
+static uint8_t tx_seqs[FRAME_FORMATS];
+static uint8_t tx_next = 0;     // format of the next frame
+static uint8_t max_payload;     // largest payload of a frame in a buffer of the pool (any format)
+static uint8_t max_overhead;    // bytes of a frame around the payload (any format)
+
+void frame_formats_init() {
+    const uint16_t receivers[FRAME_FORMATS] = {RECEIVER, RECEIVER2};
+    max_payload = AGGREGATION ? PACKET_BUF_SIZE : PAYLOADSIZE;
+    max_overhead = 0;
+    for (tx_format_count = 0; tx_format_count < FRAME_FORMATS && receivers[tx_format_count] != 0; tx_format_count++) {
+        Frame_format *format = &tx_formats[tx_format_count];
+        *format = *frame_format(receivers[tx_format_count]);
+        format->preamble = (tx_format_count == 0) ? PREAMBLE_BYTES : format->preamble;
+        format->crc = FRAME_CRC;
+        format->whitening = WHITENING;
+        tx_format_list[tx_format_count] = format;
+        tx_seqs[tx_format_count] = 0;
+        uint8_t room = PACKET_BUF_SIZE - frame_length(format, 0);
+        max_payload = min(max_payload, FEC_ENABLED ? room / 2 - 1 : room);
+        max_overhead = max(max_overhead, frame_length(format, 0));
+    }
+}
+
+/*
+ * last-known-good configuration (HEADLESS, see boot_flash.h): the rate profile which delivered last is kept in the
+ * flash and used from the reset on. It only counts if it is still a profile of this firmware.
+ */
+uint8_t boot_profile_index() {
+    Boot_config config;
+    if (!HEADLESS || !RATE_ADAPTATION || !boot_flash_load(&config) || config.profile >= RATE_PROFILES) {
+        return RATE_START;
+    }
+    if (config.d0 != rate_profiles[config.profile].d0 || config.d1 != rate_profiles[config.profile].d1 || config.baud != rate_profiles[config.profile].baud || config.carrier_hz != CARRIER_FEQ) {
+        return RATE_START;
+    }
+    boot_restored = true;
+    boot_stored = config.profile;
+    return config.profile;
+}
+
+/*
+ * keep the active profile once it delivers for BOOT_STABLE_CHECKS reports in a row (the flash is only written on a
+ * change, at most once per BOOT_STORE_US and not close to a brown-out)
+ */
+void store_boot_config() {
+    static uint8_t candidate = RATE_PROFILES;
+    static uint8_t stable = 0;         // reports in a row the candidate was good
+    static uint64_t stored_us = 0;     // last write (0: none since the reset)
+    const Rate_stats *s = &rate_control.profiles[rate_active];
+    if (!HEADLESS || !RATE_ADAPTATION) {
+        return;
+    }
+    if (!s->measured || s->prob_ppm < BOOT_GOOD_PPM || supply_mv() < SUPPLY_TX_MV) {
+        stable = 0;
+        return;
+    }
+    stable = (rate_active == candidate) ? min(stable + 1, BOOT_STABLE_CHECKS) : 1;
+    candidate = rate_active;
+    uint64_t now_us = time_us_64();
+    if (rate_active == boot_stored || stable < BOOT_STABLE_CHECKS || (stored_us != 0 && now_us - stored_us < BOOT_STORE_US)) {
+        return;
+    }
+    stored_us = now_us; // also after a failed write
+    Boot_config config = {.baud = rate_profiles[rate_active].baud, .carrier_hz = CARRIER_FEQ, .d0 = rate_profiles[rate_active].d0, .d1 = rate_profiles[rate_active].d1, .profile = rate_active};
+    if (!boot_flash_store(&config)) {
+        log_printf("ERROR: boot configuration not stored in the flash\n");
+        return;
+    }
+    boot_stored = rate_active;
+}
+
+static Fec_stats fec_stats;
+
+// decode a FEC frame in place into the frame as sent without FEC (length byte, seq, payload)
+void fec_receive(uint8_t *rx_buffer, Packet_status *status) {
+    uint8_t plain[PACKET_BUF_SIZE];
+    uint8_t len = (status->len - 2) / 2; // seq and payload
+    if (!FEC_ENABLED || status->overflowed || status->len < 2 + FEC_LEN(3) || status->len % 2 != 0 || len > sizeof(plain)) {
+        return; // a corrupted length byte: kept as received
+    }
+    fec_decode(&rx_buffer[2], len, plain, &fec_stats);
+    rx_buffer[0] = len;
+    memcpy(&rx_buffer[1], plain, len);
+    status->len = 1 + len;
+}
+
+void report_fec() {
+    if (FEC_ENABLED) {
+        log_printf("fec: decoded %u | corrected bits %u | recovered %u | uncorrectable %u\n", fec_stats.frames, fec_stats.corrected_bits, fec_stats.recovered, fec_stats.uncorrectable);
+    }
+}
+
+/*
+ * aggregation (AGGREGATION): the samples are taken every SAMPLE_PERIOD_US and queued, a frame is built
+ * when the policy of the aggregator asks for one (full, or the latency bound reached) and the supply affords it.
+ * The frames backed up on the MSP430 are packed the same way and sent as they are after the recovery.
+ */
+static Aggregator aggregator;
+static uint64_t next_sample_us = 0;
+
+void aggregation_init() {
+    Agg_policy policy = {.target_payload = AGG_TARGET_PAYLOAD, .max_latency_us = AGG_MAX_LATENCY_US, .compressed = COMPRESSION};
+    aggregator_init(&aggregator, &policy, file_position);
+    next_sample_us = time_us_64();
+}
+
+// queue the samples which are due (the ones missed during a long task are taken late)
+void take_samples() {
+    while (AGGREGATION && next_sample_us <= time_us_64()) {
+        aggregator_push(&aggregator, generate_sample(), next_sample_us);
+        next_sample_us += SAMPLE_PERIOD_US;
+    }
+}
+
+// time until the supply falls to SUPPLY_BACKUP_MV [us], 0 if it is below already, SUPPLY_NEVER if it is not falling
+uint32_t backup_time_us() {
+    if (supply_mv() <= SUPPLY_BACKUP_MV) {
+        return 0;
+    }
+    return (supply_slope() < 0) ? supply_predict_time_to(SUPPLY_BACKUP_MV) : SUPPLY_NEVER;
+}
+
+// payload bytes the supply affords: the frame and a backup have to fit before SUPPLY_BACKUP_MV is reached
+uint8_t energy_budget() {
+    uint32_t time_us = backup_time_us();
+    if (time_us == SUPPLY_NEVER) {
+        return max_payload;
+    }
+    if (time_us <= FRAME_OVERHEAD_US + MSP430_BACKUP_BUDGET_US) {
+        return 0;
+    }
+    uint32_t frame = ((uint64_t) (time_us - FRAME_OVERHEAD_US - MSP430_BACKUP_BUDGET_US) * backscatter_conf.baudrate) / 8000000;
+    if (frame < max_overhead + (FEC_ENABLED ? FEC_LEN(2) : 2)) {
+        return 0;
+    }
+    uint32_t payload = FEC_ENABLED ? (frame - max_overhead) / 2 - 1 : frame - max_overhead;
+    return min(payload, max_payload);
+}
+
+// payload bytes of the frame to build now (0: none), a headless boot sends the first samples right away
+uint8_t frame_payload(uint64_t now_us) {
+    if (!AGGREGATION) {
+        return PAYLOADSIZE;
+    }
+    if (boot_frame && aggregator_count(&aggregator) != 0) {
+        return energy_budget();
+    }
+    return aggregator_ready(&aggregator, now_us, energy_budget());
+}
+
+void report_aggregation() {
+    if (AGGREGATION) {
+        log_printf("aggregation: frames %u | full %u | samples %u | queued %u\n", aggregator.frames, aggregator.frames - aggregator.latency_frames, aggregator.packed, aggregator_count(&aggregator));
+        log_printf("aggregation: samples dropped %u\n", aggregator.dropped);
+    }
+}
+
+// deferred counterpart of link_stats_print() (summary only)
+void report_link_stats(const Link_stats *stats) {
+    Link_summary summary;
+    link_stats_summary(stats, &summary);
+    log_printf("stats: received %u | lost %u | CRC error %u | overflow %u\n", summary.received, summary.lost, summary.crc_errors, summary.overflowed);
+    log_printf("stats: window BER %u ppm | PER %u ppm | goodput %u bit/s\n", summary.ber_ppm, summary.per_ppm, summary.goodput_bps);
+    log_printf("stats: window RSSI %d dBm | total BER %u ppm | PER %u ppm\n", summary.rssi_mean, summary.ber_total_ppm, summary.per_total_ppm);
+}
+
+void report_arq() {
+    if (!ARQ_ENABLED) {
+        return;
+    }
+    log_printf("arq: sent %u | retransmitted %u | acknowledged %u | given up %u\n", arq_tx.sent, arq_tx.retransmissions, arq_tx.delivered, arq_tx.given_up);
+    log_printf("arq: delivered %u | duplicates %u | corrupted %u\n", arq_rx.unique, arq_rx.duplicates, arq_rx.corrupted);
+}
+
+void report_rssi() {
+    uint32_t lines, errors, overflows;
+    rssi_uart_counters(&lines, &errors, &overflows);
+    log_printf("rssi: average %d dBm | lines %u | invalid %u | bytes lost %u\n", rssi_current(RSSI_MAX_AGE_US), lines, errors, overflows);
+}
+
+void report_packet_pool() {
+    Packet_pool_stats pool;
+    packet_pool_summary(&pool);
+    log_printf("pool: in use %u | high water %u of %u | alloc failures %u\n", pool.in_use, pool.high_water, PACKET_POOL_SLOTS, pool.failures);
+}
 
-        if(ch == UART_END_MARK) {
-            // We have a complete line, so print it out.
-            rx_buffer_0[rx_index] = '\0'; // null-terminate the string
-            // printf("Received: %s\n", rx_buffer);
-            rx_index = 0; // reset index for next line
+void poll_link_stats(const Link_stats *stats, uint64_t *last_report_us) {
+    if (to_us_since_boot(get_absolute_time()) - *last_report_us >= STATS_INTERVAL_US) {
+        report_link_stats(stats);
+        report_rssi();
+        report_rate();
+        report_arq();
+        report_fec();
+        report_aggregation();
+        report_packet_pool();
+        store_boot_config();
+        *last_report_us = to_us_since_boot(get_absolute_time());
+    }
+    report_boot();
+}
+
+// filtered supply voltage (see supply_monitor.h)
+float get_voltage() {
+    return supply_mv() / 1000.0f;
+}
+
+// sequence number of a built frame (0 if its format is unknown)
+uint8_t frame_seq(const Packet_buf *packet) {
+    uint8_t seq = 0;
+    frame_parse(tx_format_list, tx_format_count, packet->words, &seq, NULL);
+    return seq;
+}
+
+// 32-bit words of a built frame (0 if its format is unknown, e.g. backed up before a configuration change)
+uint8_t frame_words(const Packet_buf *packet) {
+    uint8_t len = 0;
+    frame_parse(tx_format_list, tx_format_count, packet->words, NULL, &len);
+    return buffer_size(len, 0);
+}
+
+// a built frame is for the receiver of this board
+bool frame_local(const Packet_buf *packet) {
+    return frame_parse(tx_format_list, tx_format_count, packet->words, NULL, NULL) == 0;
+}
+
+/*
+ * generate new payload data and build the next frame in place for the 32-bit PIO fifo (the receivers in turn),
+ * returns the number of words
+ * payload_len: PAYLOADSIZE, with AGGREGATION the queued samples fill at most payload_len bytes (0 words: none queued)
+ */
+uint8_t build_frame(Packet_buf *packet, uint8_t payload_len) {
+    const Frame_format *format = &tx_formats[tx_next];
+    uint8_t seq = tx_seqs[tx_next];
+    trace_begin(trace_build_frame, seq);
+    /* add header to packet */
+    uint8_t offset = frame_header(format, packet->bytes, seq);
+    /* add payload to packet */
+    if (AGGREGATION) {
+        payload_len = aggregator_pack(&aggregator, &packet->bytes[offset], payload_len);
+    } else if (COMPRESSION) {
+        generate_compressed(&packet->bytes[offset], PAYLOADSIZE);
+    } else {
+        generate_data(&packet->bytes[offset], PAYLOADSIZE, true);
+    }
+    if (payload_len == 0) {
+        trace_end(trace_build_frame, seq);
+        return 0;
+    }
+
+    if (FEC_ENABLED) {
+        // the seq stays readable (frame_seq), the encoded block repeats it
+        uint8_t plain[PACKET_BUF_SIZE];
+        memcpy(plain, &packet->bytes[offset-1], 1 + payload_len);
+        fec_encode(plain, 1 + payload_len, &packet->bytes[offset]);
+        payload_len = FEC_LEN(1 + payload_len);
+    }
+    // length byte, CRC, whitening and trailer
+    uint8_t words = buffer_size(frame_finish(format, packet->bytes, payload_len), 0);
+
+    /* casting for 32-bit fifo */
+    pack_words(packet->bytes, packet->words, words);
+    tx_seqs[tx_next]++;
+    tx_next = (tx_next + 1) % tx_format_count;
+    trace_end(trace_build_frame, seq);
+    return words;
+}
+
+// buffer of the state machine frame: kept from sense/recover until the frame was sent or backed up
+Packet_buf *hold_tx_packet(Packet_buf *tx_packet) {
+    return (tx_packet != NULL) ? tx_packet : packet_pool_alloc();
+}
+
+// backscatter one frame and wait until it has been transmitted
+// local: the frame is for the receiver of this board (the other receivers give no feedback)
+void send_frame(PIO pio, uint sm, uint32_t *buffer, uint8_t words, uint8_t seq, bool local) {
+    if (local) {
+        rate_before_send(pio, sm, seq);
+    }
+    sleep_ms(1); // wait for carrier to start
+    trace_begin(trace_backscatter_send, seq);
+    backscatter_send(pio,sm,buffer,words);
+    trace_end(trace_backscatter_send, seq);
+    boot_mark(boot_first_frame);
+    boot_frame = false;
+    trace_begin(trace_airtime, seq);
+    sleep_ms(ceil((((double) words)*8000.0)/((double) backscatter_conf.baudrate))+3); // wait transmission duration (+3ms)
+    trace_end(trace_airtime, seq);
+}
+
+// keep a new frame after its first transmission (freed if ARQ is off or the window is full)
+void arq_keep(Packet_buf *packet, uint8_t seq) {
+    if (!ARQ_ENABLED || !arq_tx_add(&arq_tx, packet, seq, time_us_64() + ARQ_MARGIN_US)) {
+        packet_pool_free(packet);
+    }
+}
+
+// free the frames which left the window
+void arq_release() {
+    bool delivered;
+    Packet_buf *packet;
+    while ((packet = arq_tx_release(&arq_tx, time_us_64(), &delivered)) != NULL) {
+        if (!delivered) {
+            log_printf("ARQ: gave up packet with seq: %d\n", frame_seq(packet));
         }
+        packet_pool_free(packet);
+    }
+}
+
+// a frame waits for its retransmission
+bool arq_due() {
+    uint8_t seq;
+    return ARQ_ENABLED && arq_tx_due(&arq_tx, time_us_64(), &seq) != NULL;
+}
+
+// resend the next due frame, returns false if none is due
+bool arq_retransmit(PIO pio, uint sm) {
+    uint8_t seq;
+    Packet_buf *packet = ARQ_ENABLED ? arq_tx_due(&arq_tx, time_us_64(), &seq) : NULL;
+    if (packet == NULL) {
+        return false;
+    }
+    send_frame(pio, sm, packet->words, frame_words(packet), seq, true);
+    arq_tx_resent(&arq_tx, seq, time_us_64() + ARQ_MARGIN_US); // send_frame() waited for the airtime
+    log_printf("Retransmitted packet with seq: %d\n", seq);
+    return true;
+}
+
+// read the received packet into a buffer of the pool, update the statistics, log it and listen again
+void receive_packet(Link_stats *link_stats) {
+    uint64_t time_us = to_us_since_boot(get_absolute_time());
+    Packet_buf *packet = packet_pool_alloc();
+    if (packet == NULL) {
+        log_printf("RX: packet pool empty, packet dropped\n");
+        RX_start_listen(); // flushes the RX FIFO
+        return;
     }
-    while (uart_is_readable(UART_ID)) {
-        // printf("UART data received...\n");
-        int8_t ch = uart_getc(UART_ID);
-        // printf("Received char: %c\n", ch);
-        if(rx_index < UART_BUFFER_SIZE - 1) {
-            rx_buffer_1[rx_index++] = ch;
-        } else {
-            rx_index = 0; // reset index if buffer is full
+    uint8_t *rx_buffer = packet->bytes;
+    trace_begin(trace_read_packet, 0);
+    Packet_status status = readPacket(rx_buffer);
+    fec_receive(rx_buffer, &status);
+    trace_end(trace_read_packet, status.len);
+    trace_begin(trace_link_stats, 0);
+    link_stats_update(link_stats, rx_buffer, status.len, max_payload, status.overflowed, status.CRCcheck, status.RSSI, status.LinkQualityIndicator, time_us);
+    trace_end(trace_link_stats, 0);
+    rate_after_receive(link_stats, rx_buffer[1]);
+    arq_after_receive(link_stats, rx_buffer[1]);
+    arq_release();
+    log_ring_packet(rx_buffer,status,time_us);
+    packet_pool_free(packet);
+    trace_begin(trace_rx_start_listen, 0);
+    RX_start_listen();
+    trace_end(trace_rx_start_listen, 0);
+}
+
+/*
+ * pipeline mode (PIPELINE_CORE1): core 1 produces the frames into tx_frames and does all the slow work
+ * (soft-float sample generation, ADC, UART RSSI, blocking MSP430 SPI transfers, printing the log ring),
+ * core 0 only feeds the PIO and handles the receiver. Thus, a slow producer can never stall a transmission.
+ */
+static Frame_ring tx_frames;
+
+static void pipeline_publish(Frame *frame, Packet_buf *packet, uint8_t words, uint8_t seq, bool recovered) {
+    frame->packet = packet; // core 0 frees it after sending
+    frame->words = words;
+    frame->seq = seq;
+    frame->recovered = recovered;
+    frame->time_us = time_us_64();
+    frame_ring_publish(&tx_frames);
+}
+
+void pipeline_core1_entry() {
+    flash_safe_execute_core_init(); // core 0 may write the boot configuration (see boot_flash.h)
+    uint64_t next_sense_us = 0;
+    while (true) {
+        log_ring_drain(LOG_RING_LENGTH);
+        take_samples();
+        Frame *frame = (time_us_64() >= next_sense_us) ? frame_ring_reserve(&tx_frames) : NULL;
+        if (frame == NULL) {
+            sleep_us(100); // core 0 has enough frames queued or we wait for a retry
+            continue;
         }
+        next_sense_us = time_us_64() + PIPELINE_RETRY_US;
 
-        if(ch == UART_END_MARK) {
-            // We have a complete line, so print it out.
-            rx_buffer_1[rx_index] = '\0'; // null-terminate the string
-            // printf("Received: %s\n", rx_buffer);
-            rx_index = 0; // reset index for next line
+        float voltage = get_voltage();
+        if (voltage < 2.0) {
+            // keep the data on the MSP430 and send it once the supply has recovered
+            log_printf("Voltage is low: %d mV, backup the next packet.\n", (int32_t) (voltage*1000));
+            Packet_buf *packet = packet_pool_alloc();
+            if (packet != NULL) {
+                uint8_t words = build_frame(packet, max_payload); // all queued samples
+                if (words != 0) {
+                    backup_packet(packet, words * 4);
+                }
+                packet_pool_free(packet);
+            }
+            continue;
+        }
+        if (!link_ready()) {
+            log_printf("No or weak RSSI from CC2640R2: %d, try again.\n", rssi_current(RSSI_MAX_AGE_US));
+            continue;
+        }
+
+        if (msp430_queue_depth() != 0) { // also after a reset (unknown depth)
+            // restore as many frames as the ring can take in one transaction
+            Packet_buf *restored[FRAME_RING_LENGTH];
+            uint8_t lengths[FRAME_RING_LENGTH];
+            int16_t count = msp430_restore(restored, lengths, NULL, FRAME_RING_LENGTH - frame_ring_count(&tx_frames));
+            for (int16_t i = 0; i < count; i++) {
+                frame = (i == 0) ? frame : frame_ring_reserve(&tx_frames); // the space was checked above
+                pipeline_publish(frame, restored[i], lengths[i] / 4, frame_seq(restored[i]), true);
+            }
+            if (count > 0) {
+                next_sense_us = 0;
+                continue;
+            }
+            log_printf("Nothing restored from MSP430 (%d, %d stored), sending new data.\n", count, msp430_queue_depth());
+        }
+        uint8_t payload_len = frame_payload(time_us_64());
+        if (payload_len == 0) {
+            next_sense_us = time_us_64() + SAMPLE_PERIOD_US; // more samples or energy needed
+            continue;
+        }
+        Packet_buf *packet = packet_pool_alloc();
+        if (packet != NULL) {
+            uint8_t words = build_frame(packet, payload_len);
+            pipeline_publish(frame, packet, words, frame_seq(packet), false);
+            next_sense_us = 0;
         }
     }
+}
+
+/*
+ * single-core mode: the former state machine (sense, transmit, backup, recover) runs as tasks of
+ * the energy-aware scheduler (see scheduler.h). A task starts as soon as its preconditions hold, in between
+ * the CPU sleeps (WFE) until the next task is due, a GDO0/UART interrupt or a supply re-check.
+ */
+static Scheduler scheduler;
+static PIO task_pio;
+static uint task_sm;
+static Packet_buf *tx_packet = NULL; // frame waiting for TX (from sense/recover until sent or backed up)
+static bool tx_recovered = false;    // tx_packet was restored from the MSP430
+static Link_stats link_stats;
+static uint64_t last_report_us = 0;
+
+static uint64_t clock_us() {
+    return time_us_64();
+}
+
+/*
+ * light sleep until time_us: WFE is ended by the timer alarm of best_effort_wfe_or_timeout() or any interrupt
+ * (dormant mode would stop the clocks and the USB stdio)
+ */
+static void sleep_until_us(uint64_t time_us) {
+    best_effort_wfe_or_timeout(from_us_since_boot(time_us));
+}
+
+static bool rx_ready(const Scheduler *s) {
+    return event_pending();
+}
 
-    printf("Received: %s\n", rx_buffer_1);
-    //Convert the received data to an integer
-    int received_value = 0;
-    if (sscanf((const char *)rx_buffer_1, "%d", &received_value) == 1) {
-        printf("Received integer value: %d\n", received_value);
-        return received_value;
+static uint32_t task_receive(Scheduler *s) {
+    if (get_event() == rx_deassert_evt) {
+        receive_packet(&link_stats);
+    }
+    return 0;
+}
+
+static bool backup_ready(const Scheduler *s) {
+    // back up early if the supply is predicted to fall before the frame could be sent
+    // (queued samples: once the aggregation policy would build their frame)
+    bool pending = tx_packet != NULL || (AGGREGATION && aggregator_ready(&aggregator, s->now_us, max_payload) != 0);
+    return pending && (s->supply < SUPPLY_BACKUP_MV || backup_time_us() < SUPPLY_HORIZON_US);
+}
+
+static uint32_t task_backup(Scheduler *s) {
+    log_printf("Voltage is low: %d mV, backing up current packet...\n", s->supply);
+    if (tx_packet == NULL) {
+        tx_packet = packet_pool_alloc();
+        if (tx_packet == NULL) {
+            log_printf("No packet buffer available, backing up later.\n");
+            return TASK_RETRY_US;
+        }
+        tx_recovered = false;
+        if (build_frame(tx_packet, aggregator_ready(&aggregator, s->now_us, max_payload)) == 0) {
+            packet_pool_free(tx_packet);
+            tx_packet = NULL;
+            return 0;
+        }
+    }
+    if (backup_packet(tx_packet, frame_words(tx_packet) * 4) != 0) {
+        log_printf("Failed to backup data to MSP430. Check the connection.\n");
+        return TASK_RETRY_US;
+    }
+    packet_pool_free(tx_packet); // the frame lives on the MSP430 now
+    tx_packet = NULL;
+    return 0;
+}
+
+static bool transmit_ready(const Scheduler *s) {
+    // only start a transmission which will finish, new frames wait for space in the retransmission window
+    return ((tx_packet != NULL && !arq_tx_full(&arq_tx)) || arq_due()) && link_ready() && backup_time_us() >= SUPPLY_HORIZON_US;
+}
+
+static uint32_t task_transmit(Scheduler *s) {
+    if (arq_retransmit(task_pio, task_sm)) {
+        return TX_GAP_US; // resent frames first
+    }
+    uint8_t words = frame_words(tx_packet);
+    uint8_t seq = frame_seq(tx_packet); // recovered frames keep their seq
+    bool local = frame_local(tx_packet);
+    if (words == 0) {
+        log_printf("Dropped a recovered frame of unknown format\n");
+        packet_pool_free(tx_packet);
+        tx_packet = NULL;
+        return 0;
+    }
+    send_frame(task_pio, task_sm, tx_packet->words, words, seq, local);
+    if (tx_recovered || !local) {
+        packet_pool_free(tx_packet);
     } else {
-        printf("Failed to parse integer from received data.\n");
-        return -1; // or some error code
+        arq_keep(tx_packet, seq);
     }
+    tx_packet = NULL;
+    log_printf("Backscattered packet with seq: %d\n", seq);
+    return TX_GAP_US;
 }
 
-//Get voltage from ADC
-float get_voltage() {
-    const float conversion_factor = 3.3f / (1 << 12);
-    uint16_t result = adc_read();
-    float voltage = result * conversion_factor;
-    printf("ADC Voltage: %.2f V\n", voltage);
-    return voltage;
+static bool recover_ready(const Scheduler *s) {
+    return tx_packet == NULL && backlog_pending();
+}
+
+static uint32_t task_recover(Scheduler *s) {
+    Packet_buf *recovered = recover_packet(); // a batch is restored in one transaction
+    if (recovered == NULL) {
+        log_printf("No data stored in MSP430 or read failed, sensing new data meanwhile.\n");
+        return TASK_RETRY_US;
+    }
+    log_printf("Data recovered from MSP430 successfully (%d more stored).\n", msp430_queue_depth());
+    tx_packet = recovered;
+    tx_recovered = true;
+    return 0;
+}
+
+static bool sense_ready(const Scheduler *s) {
+    return tx_packet == NULL && frame_payload(s->now_us) != 0;
+}
+
+static uint32_t task_sense(Scheduler *s) {
+    tx_packet = packet_pool_alloc();
+    if (tx_packet == NULL) {
+        log_printf("No packet buffer available, sensing later.\n");
+        return TASK_RETRY_US;
+    }
+    if (build_frame(tx_packet, frame_payload(s->now_us)) == 0) {
+        packet_pool_free(tx_packet); // the supply changed since sense_ready()
+        tx_packet = NULL;
+        return 0;
+    }
+    tx_recovered = false;
+    return 0;
+}
+
+static bool sample_ready(const Scheduler *s) {
+    return AGGREGATION;
 }
 
+// aggregation: the sensor
+static uint32_t task_sample(Scheduler *s) {
+    take_samples();
+    return SAMPLE_PERIOD_US;
+}
+
+static uint32_t task_housekeeping(Scheduler *s) {
+    poll_link_stats(&link_stats, &last_report_us);
+    arq_release(); // frames given up
+    if (!LOG_DRAIN_CORE1) {
+        log_ring_drain(LOG_DRAIN_BATCH); // idle time
+    }
+    trace_poll(); // dump the trace on request (see trace.h)
+    return HOUSEKEEPING_US;
+}
+
+// highest priority first
+static Sched_task tasks[] = {
+    {"receive",      0,                rx_ready,       task_receive},
+    {"backup",       0,                backup_ready,   task_backup},
+    {"transmit",     SUPPLY_TX_MV,     transmit_ready, task_transmit},
+    {"recover",      SUPPLY_TX_MV,     recover_ready,  task_recover},
+    {"sense",        SUPPLY_TX_MV,     sense_ready,    task_sense},
+    {"sample",       0,                sample_ready,   task_sample},
+    {"housekeeping", 0,                NULL,           task_housekeeping},
+};
+
 int main() {
+    boot_mark(boot_main);
     /* setup SPI */
     stdio_init_all();
-    while(!stdio_usb_connected()) {
+    while(!HEADLESS && !stdio_usb_connected()) { // headless: the log is printed once USB attaches
         sleep_ms(100);
     }
     printf("Starting carrier-receiver baseband example...\n");
@@ -348,7 +1009,7 @@ int main() {
 
     // Make the SPI pins available to picotool
     bi_decl(bi_3pins_with_func(RADIO_MOSI, RADIO_MISO, RADIO_SCK, GPIO_FUNC_SPI));
-    bi_decl(bi_3pins_with_func(PIN_MOSI, PIN_MISO, PIN_SCK, GPIO_FUNC_SPI));
+    bi_decl(bi_3pins_with_func(PIN_MOSI, PIN_MISO, PIN_SCK, GPIO_FUNC_PIO1));
 
     // Chip select is active-low, so we'll initialise it to a driven-high state
     gpio_init(RX_CSN);
@@ -362,68 +1023,66 @@ int main() {
     gpio_put(CARRIER_CSN, 1);
     bi_decl(bi_1pin_with_name(CARRIER_CSN, "SPI Carrier CS"));
 
-    sleep_ms(2000);
+    if (!HEADLESS) {
+        sleep_ms(2000);
+    }
 
-    /* setup backscatter state machine */
+    /* setup backscatter state machine (last-known-good profile, RATE_START by default) */
+    uint8_t profile = boot_profile_index();
+    boot_mark(boot_config);
     PIO pio = pio0;
     uint sm = 0;
-    struct backscatter_config backscatter_conf;
-    uint16_t instructionBuffer[32] = {0}; // maximal instruction size: 32
-    backscatter_program_init(pio, sm, PIN_TX1, PIN_TX2, CLOCK_DIV0, CLOCK_DIV1, DESIRED_BAUD, &backscatter_conf, instructionBuffer, TWOANTENNAS);
+    backscatter_program_init(pio, sm, PIN_TX1, PIN_TX2, rate_profiles[profile].d0, rate_profiles[profile].d1, rate_profiles[profile].baud, &backscatter_conf, instructionBuffer, TWOANTENNAS);
+    boot_mark(boot_baseband);
 
-    static uint8_t message[buffer_size(PAYLOADSIZE+2, HEADER_LEN)*4] = {0};  // include 10 header bytes
-    static uint32_t buffer[buffer_size(PAYLOADSIZE, HEADER_LEN)] = {0}; // initialize the buffer
-    static uint8_t seq = 0;
-    uint8_t *header_tmplate = packet_hdr_template(RECEIVER);
-    uint8_t tx_payload_buffer[PAYLOADSIZE];
+    frame_formats_init();
 
     /* Setup carrier */
     printf("\nConfiguring one CC2500 as carrier generator:\n");
     setupCarrier();
     set_frecuency_tx(CARRIER_FEQ);
     sleep_ms(1);
+    boot_mark(boot_carrier);
 
     /* Start Receiver */
     printf("\nConfiguring one CC2500 to approximate the obtained radio settings:\n");
-    event_t evt = no_evt;
-    Packet_status status;
-    uint8_t rx_buffer[RX_BUFFER_SIZE];
-    uint64_t time_us;
+    link_stats_init(&link_stats);
+    link_stats.compressed = COMPRESSION;
+    rate_init(profile);
+    arq_tx_init(&arq_tx);
+    arq_rx_init(&arq_rx);
+    packet_pool_init();
     setupReceiver();
+    if (!set_frame_format_rx(&tx_formats[0])) {
+        printf("ERROR: the CC2500 can not receive the frames for RECEIVER %d\n", RECEIVER);
+    }
     set_frecuency_rx(CARRIER_FEQ + backscatter_conf.center_offset);
     set_frequency_deviation_rx(backscatter_conf.deviation);
     set_datarate_rx(backscatter_conf.baudrate);
     set_filter_bandwidth_rx(backscatter_conf.minRxBw);
     sleep_ms(1);
     RX_start_listen();
+    boot_mark(boot_receiver);
     printf("started listening\n");
-    bool rx_ready = true;
     printf("TX baudrate: %u\n", backscatter_conf.baudrate);
     printf("Freq offset: %d\n", backscatter_conf.center_offset);
     printf("Deviation  : %d\n", backscatter_conf.deviation);
     /* loop */
 
-    // Set up our UART with a baud rate.to access RSSI frim CC2640R2
-    uart_init(UART_ID, 115200);
-    gpio_set_function(UART_RX_PIN, UART_FUNCSEL_NUM(UART_ID, UART_RX_PIN));
-    // int __unused actual = uart_set_baudrate(UART_ID, BAUD_RATE);
-    // uart_set_hw_flow(UART_ID, false, false);
-    // uart_set_format(UART_ID, DATA_BITS, STOP_BITS, PARITY);
-    // int UART_IRQ = UART1_IRQ;
-
-    // // And set up and enable the interrupt handlers
-    // irq_set_exclusive_handler(UART_IRQ, on_uart_rx);
-    // irq_set_enabled(UART_IRQ, true);
-    // uart_set_irq_enables(UART_ID, true, false);
-    // irq_set_priority(UART_IRQ, 0);
+    // RSSI of the CC2640R2: received by the UART interrupt, parsed whenever it is read (see rssi_uart.h)
+    rssi_uart_init(UART_ID, BAUD_RATE, UART_RX_PIN);
 
     uint8_t test_data[] = "Hello MSP430!";
     size_t test_len = sizeof(test_data) - 1; // 不包括结尾的null
 
     uint32_t counter = 0;
-    float voltage = 0.0;
 
     init_gpio();
+    if (!msp430_backup_init(MSP430_PIO, SPI_BAUDRATE, PIN_SCK, PIN_MOSI, PIN_MISO, PIN_REQ, PIN_ACK, PIN_MODE, PIN_IND)) {
+        printf("ERROR: MSP430 backup is not available.\n");
+    }
+    int16_t stored = msp430_status(); // the queue in the FRAM survives resets of both sides
+    printf("MSP430: %d frames stored (%d: unknown, retried on the first recovery)\n", stored, MSP430_ERROR_TIMEOUT);
     // while(1){
     //     test_my_write(test_data, test_len);
     //     sleep_ms(5000); // 等待1秒
@@ -441,242 +1100,54 @@ int main() {
     //     // on_uart_rx(); // wait for 1 second before checking again
     //     // printf("Done...\n");
     // }
-    adc_init();
-    adc_gpio_init(26); // Initialize GPIO 26 for ADC
-    adc_select_input(0); // Select ADC input 0 (GPIO 26)
-    evt = init_evt; // Initialize event to no_evt
-    static bool MSP430_flag = false; // Flag to indicate if MSP430 data is available
-    static uint16_t MPS430_counter = 0; // Counter for MSP430 data
-    while (true) {
-        // evt = get_event();
-        switch(evt){
-            case rx_assert_evt:
-                // evt = get_event(); // get next event
-                // if (evt != rx_assert_evt) {
-                //     printf("Unexpected event after rx_assert_evt: %d\n", evt);
-                //     break;
-                // }
-                // started receiving
-                rx_ready = false;
-                // evt = rx_deassert_evt; // reset event to rx_deassert_evt
-            break;
-            case rx_deassert_evt:
-                // finished receiving
-                // evt = get_event(); // get next event
-                // if(evt != rx_deassert_evt) {
-                //     printf("Unexpected event after rx_deassert_evt: %d\n", evt);
-                //     evt = init_evt; // reset event to init_evt
-                //     break;
-                // }
-                time_us = to_us_since_boot(get_absolute_time());
-                status = readPacket(rx_buffer);
-                printPacket(rx_buffer,status,time_us);
-                RX_start_listen();
-                rx_ready = true;
-                // evt = init_evt; // reset event to init_evt
-            break;
-            case sleep_evt:
-                voltage = get_voltage();
-                if (voltage < 2.0) {
-                    printf("Voltage is low: %.2f V, keep sleep.\n", voltage);
-                    sleep_ms(5000); // wait for 5 seconds before checking again
-                    evt = sleep_evt; // set event to backup_evt
-                    break; // continue to the next iteration
-                } else {
-                    printf("Voltage is sufficient: %.2f V, weak up!\n", voltage);
-                    sleep_ms(5000); // wait for 5 seconds before checking again
-                    evt = init_evt;
-                    break; // continue to the next iteration
-                }
-            case init_evt:
-                // initialize the system
-                printf("Initializing system...\n");
-                voltage = get_voltage();
-                if (voltage < 2.0) {
-                    printf("Voltage is low: %.2f V, back to sleep.\n", voltage);
-                    evt = sleep_evt; // set event to sleep_evt
-                    sleep_ms(5000); // wait for 1 second before checking again
-                    break; // continue to the next iteration
-                }
-                if (MSP430_flag) {
-                    if (test_my_read(buffer, buffer_size(PAYLOADSIZE, HEADER_LEN)) == -1) {
-                        printf("No data stored in MSP430 or read failed, trying to sense new data...\n");
-                        sleep_ms(5000); // wait for 5 seconds before checking again
-                        MSP430_flag = false; // reset the flag
-                        evt = sense_evt; // set event to sense_evt
-                        break; // continue to the next iteration
-                    } else {
-                        printf("Data recovered from MSP430 successfully.\n");
-                        MSP430_counter--; // decrement the MSP430 counter
-                        if (MSP430_counter == 0) {
-                            MSP430_flag = false; // reset the flag if no more data
-                        }
-                        evt = no_evt; // transmission event
-                        sleep_ms(5000); // wait for 5 seconds before checking again
-                        break;
-                    }
-                } else {
-                    printf("No MSP430 data available, generating new data...\n");
-                    evt = sense_evt; // set event to sense_evt
-                    sleep_ms(5000); // wait for 5 seconds before checking again
-                    break; // continue to the next iteration
-                }
-                 // read data from MSP430
-            break;
-            case sense_evt:
-                /* generate new data */
-                //Pretend to generate data for transmission
-                printf("Generating new data for transmission...\n");
-                generate_data(tx_payload_buffer, PAYLOADSIZE, true);
-
-                /* add header (10 byte) to packet */
-                add_header(&message[0], seq, header_tmplate);
-                /* add payload to packet */
-                memcpy(&message[HEADER_LEN], tx_payload_buffer, PAYLOADSIZE);
-
-                /* casting for 32-bit fifo */
-                for (uint8_t i=0; i < buffer_size(PAYLOADSIZE, HEADER_LEN); i++) {
-                    buffer[i] = ((uint32_t) message[4*i+3]) | (((uint32_t) message[4*i+2]) << 8) | (((uint32_t) message[4*i+1]) << 16) | (((uint32_t)message[4*i]) << 24);
-                }
-                sleep_ms(5000); // wait for 5 seconds before checking again
-                evt = RSSI_evt; // set event to RSSI_evt
-            break;
-            case backup_evt:
-                // backup the current packet
-                printf("Backing up current packet...\n");
-                if (test_my_write(buffer, buffer_size(PAYLOADSIZE, HEADER_LEN)) == 0) {
-                    printf("Data backed up to MSP430 successfully.\n");
-                    MSP430_flag = true; // set the flag to indicate data is available
-                    MSP430_counter++; // increment the MSP430 counter
-                    evt = sleep_evt; // set event to sleep_evt
-                    sleep_ms(5000); // wait for 5 seconds before checking again
-                    break; // continue to the next iteration
-                } else {
-                    printf("Failed to backup data to MSP430. Check the connection.\n");
-                    evt = sleep_evt; // set event to sleep_evt
-                    sleep_ms(5000); // wait for 5 seconds before checking again
-                    break; // continue to the next iteration
-                }
-            break;
-            case recover_evt:
-                printf("Recovering data from MSP430...\n");
-                if (test_my_read(buffer, buffer_size(PAYLOADSIZE, HEADER_LEN)) == -1) {
-                    printf("No data stored in MSP430 or read failed, trying to sense new data...\n");
-                    sleep_ms(5000); // wait for 5 seconds before checking again
-                    MSP430_flag = false; // reset the flag
-                    evt = sense_evt; // set event to sense_evt
-                    break; // continue to the next iteration
-                } else {    
-                    printf("Data recovered from MSP430 successfully.\n");
-                    MSP430_counter--; // decrement the MSP430 counter
-                    if (MSP430_counter == 0) {
-                        MSP430_flag = false; // reset the flag if no more data
-                    }
-                    evt = no_evt; // transmission event
-                    sleep_ms(5000); // wait for 5 seconds before checking again
-                    break;
-                }
-            break;
-            case voltagecheck_evt:
-                //Check the voltage from ADC
-                printf("Checking voltage...\n");
-                voltage = get_voltage();
-                if (voltage < 2.0) {
-                    printf("Voltage is low: %.2f V, consider backup the current packet.\n", voltage);
-                    evt = backup_evt; // set event to backup_evt
-                    break; // continue to the next iteration
-                } else {
-                    printf("Voltage is sufficient: %.2f V\n", voltage);
-                    evt = RSSI_evt;
-                    break; // continue to the next iteration
-                }
-            break;
-            case RSSI_evt:
-                // This event is used to read RSSI from CC2640R2
-                // Ask for RSSI from CC2640R2 regularly
-                voltage = get_voltage();
-                if (voltage < 2.0) {
-                    printf("Voltage is low: %.2f V, consider backup the current packet.\n", voltage);
-                    evt = backup_evt; // set event to backup_evt
-                    break; // continue to the next iteration
-                }
-                printf("Checking RSSI...\n");
-                int Current_RSSI = 0;
-                Current_RSSI = on_uart_rx(); // Call the function to read data from CC2640R2
-                if (Current_RSSI != -1) {
-                    printf("Current RSSI: %d\n", Current_RSSI);
-                    // Process the received data if needed
-
-                    if (Current_RSSI < -50) {
-                        printf("Signal is weak, consider moving closer to the transmitter.\n");
-                        evt = RSSI_evt; // reset event to no_evt
-                        sleep_ms(5000); // wait for 1 second before checking again
-                        break; // continue to the next iteration
-                    } else if (Current_RSSI >= -50) {
-                        printf("Signal is strong, good connection!\n");
-                        evt = no_evt; // reset event to transmission event
-                        sleep_ms(5000); // wait for 5 seconds before checking again
-                        break;
-                    }
-                } else {
-                    printf("No data received from CC2640R2, try again.\n");
-                    // sleep_ms(1000); // wait for 1 second before checking again
-                    evt = RSSI_evt; // reset event to no_evt
-                    sleep_ms(5000); // wait for 5 seconds before checking again
-                    break; // continue to the next iteration
-                }
+    if (!supply_monitor_init(0, SUPPLY_SAMPLE_HZ)) { // GPIO 26
+        printf("ERROR: supply monitor is not available.\n");
+    }
 
-            break;
-            case no_evt: // actual transmission event
-                // backscatter new packet if receiver is listening
-                // evt = get_event(); // get next event
-                // if (evt != no_evt) {
-                //     printf("Unexpected event: %d\n", evt);
-                //     break;
-                // }
-                // printf("current event: %d\n", evt);
-                // printf("rx_ready: %d\n", rx_ready);
-                // if (rx_ready)
-                {
-
-                    /* generate new data */
-                    // generate_data(tx_payload_buffer, PAYLOADSIZE, true);
-
-                    // /* add header (10 byte) to packet */
-                    // add_header(&message[0], seq, header_tmplate);
-                    // /* add payload to packet */
-                    // memcpy(&message[HEADER_LEN], tx_payload_buffer, PAYLOADSIZE);
-
-                    // /* casting for 32-bit fifo */
-                    // for (uint8_t i=0; i < buffer_size(PAYLOADSIZE, HEADER_LEN); i++) {
-                    //     buffer[i] = ((uint32_t) message[4*i+3]) | (((uint32_t) message[4*i+2]) << 8) | (((uint32_t) message[4*i+1]) << 16) | (((uint32_t)message[4*i]) << 24);
-                    // }
-                    /* put the data to FIFO (start backscattering) */
-                    // startCarrier();
-                    sleep_ms(1); // wait for carrier to start
-                    backscatter_send(pio,sm,buffer,buffer_size(PAYLOADSIZE, HEADER_LEN));
-                    sleep_ms(ceil((((double) buffer_size(PAYLOADSIZE, HEADER_LEN))*8000.0)/((double) DESIRED_BAUD))+3); // wait transmission duration (+3ms)
-                    // stopCarrier();
-                    /* increase seq number*/ 
-                    seq++;
-                    printf("Backscattered packet with seq: %d\n", seq);
-                }
-                sleep_ms(TX_DURATION);
-                // evt = rx_assert_evt; // set event to rx_assert_evt
-                if (MSP430_flag == false) {
-                    printf("No MSP430 data available, generating new data...\n");
-                    evt = sense_evt; // set event to sense_evt
-                    sleep_ms(5000); // wait for 5 seconds before checking again
-                    break;
+    /* from here on, printing is deferred to the log ring (never blocks the TX/RX timing) */
+    log_ring_init(LOG_BINARY);
+    trace_init();
+    aggregation_init(); // the sampling starts now
+    boot_mark(boot_peripherals);
+    if (PIPELINE_CORE1) {
+        /* core 0: transmit the frames of core 1 every TX_DURATION, handle received packets in between */
+        frame_ring_init(&tx_frames);
+        multicore_launch_core1(pipeline_core1_entry);
+        absolute_time_t next_tx = get_absolute_time();
+        while (true) {
+            if (get_event() == rx_deassert_evt) {
+                receive_packet(&link_stats);
+            }
+            Frame *frame = frame_ring_peek(&tx_frames);
+            bool tx_due = absolute_time_diff_us(get_absolute_time(), next_tx) <= 0;
+            if (tx_due && arq_retransmit(pio, sm)) {
+                next_tx = delayed_by_ms(get_absolute_time(), TX_DURATION);
+            } else if (tx_due && frame != NULL && !arq_tx_full(&arq_tx)) {
+                bool local = frame_local(frame->packet);
+                send_frame(pio, sm, frame->packet->words, frame->words, frame->seq, local);
+                log_printf("Backscattered packet with seq: %d (%c)\n", frame->seq, frame->recovered ? 'r' : 'n');
+                if (frame->recovered || !local) {
+                    packet_pool_free(frame->packet);
                 } else {
-                    printf("Try to reover data from MSP430...\n");
-                    evt = recover_evt; // set event to recover_evt
-                    sleep_ms(5000); // wait for 5 seconds before checking again
-                    break;
+                    arq_keep(frame->packet, frame->seq);
                 }
-            break;
+                frame_ring_release(&tx_frames);
+                next_tx = delayed_by_ms(get_absolute_time(), TX_DURATION);
+            }
+            arq_release(); // frames given up
+            poll_link_stats(&link_stats, &last_report_us);
+            trace_poll(); // dump the trace on request (see trace.h)
+            tight_loop_contents();
         }
-        sleep_ms(1);
+    }
+    if (LOG_DRAIN_CORE1) {
+        log_ring_launch_core1();
+    }
+    task_pio = pio;
+    task_sm = sm;
+    sched_init(&scheduler, tasks, sizeof(tasks) / sizeof(tasks[0]), SCHED_POLL_US, SCHED_IDLE_US, clock_us, supply_mv, sleep_until_us);
+    while (true) {
+        sched_step(&scheduler);
     }
 
     /* stop carrier and receiver - never reached */
@@ -0,0 +1,98 @@
+/**
+ * Multi-sample frame aggregation
+ *
+ * See aggregator.h
+ *
+ */
+
+#include <string.h>
+#include "packet_generation.h"
+#include "aggregator.h"
+
+void aggregator_init(Aggregator *agg, const Agg_policy *policy, uint16_t position){
+    memset(agg, 0, sizeof(Aggregator));
+    agg->policy = *policy;
+    agg->position = position;
+}
+
+void aggregator_push(Aggregator *agg, uint16_t sample, uint64_t time_us){
+    if(agg->head - agg->tail == AGG_QUEUE_LEN){
+        agg->tail++;
+        agg->dropped++;
+    }
+    agg->samples[agg->head % AGG_QUEUE_LEN] = sample;
+    agg->times_us[agg->head % AGG_QUEUE_LEN] = time_us;
+    agg->head++;
+}
+
+uint32_t aggregator_count(const Aggregator *agg){
+    return agg->head - agg->tail;
+}
+
+// oldest queued samples which fit into a payload of len bytes, stream: coded samples (compressed policy)
+static uint8_t fit(const Aggregator *agg, uint8_t len, uint8_t *stream, uint8_t *used){
+    uint32_t count = aggregator_count(agg);
+    if(len < 2){
+        *used = 0;
+        return 0;
+    }
+    if(!agg->policy.compressed){
+        count = min(count, (uint32_t) (len - 2) / 2);
+        *used = 2 * count;
+        return count;
+    }
+    uint16_t samples[AGG_QUEUE_LEN];
+    for(uint32_t i = 0; i < count; i++){
+        samples[i] = agg->samples[(agg->tail + i) % AGG_QUEUE_LEN];
+    }
+    return compress_samples(samples, count, stream, len - 2, used);
+}
+
+// no further queued sample fits into the payload of len bytes after count samples (used bytes)
+static bool full(const Aggregator *agg, uint8_t count, uint8_t used, uint8_t len){
+    if(!agg->policy.compressed && 2 + used + 2 > len){
+        return true;
+    }
+    return count < aggregator_count(agg) || 2 + used == len;
+}
+
+uint8_t aggregator_ready(const Aggregator *agg, uint64_t now_us, uint8_t budget){
+    uint32_t count = aggregator_count(agg);
+    if(count == 0){
+        return 0;
+    }
+    uint8_t stream[256], used;
+    uint8_t target = agg->policy.target_payload;
+    uint8_t fitting = fit(agg, target, stream, &used);
+    if(budget >= target && full(agg, fitting, used, target)){
+        return target;
+    }
+    // a full frame waits for the energy, a partial one for more samples (up to the latency bound)
+    if(now_us - agg->times_us[agg->tail % AGG_QUEUE_LEN] >= agg->policy.max_latency_us && fit(agg, min(budget, target), stream, &used) > 0){
+        return min(budget, target);
+    }
+    return 0;
+}
+
+uint8_t aggregator_pack(Aggregator *agg, uint8_t *payload, uint8_t len){
+    uint8_t used;
+    uint8_t count = fit(agg, len, &payload[2], &used);
+    if(count == 0){
+        return 0;
+    }
+    agg->latency_frames += len < agg->policy.target_payload || !full(agg, count, used, len);
+    uint16_t position = agg->position + 2 * agg->tail;
+    payload[0] = (uint8_t) (position >> 8);
+    payload[1] = (uint8_t) (position & 0x00FF);
+    if(!agg->policy.compressed){
+        for(uint8_t i = 0; i < count; i++){
+            uint16_t sample = agg->samples[(agg->tail + i) % AGG_QUEUE_LEN];
+            payload[2+2*i]   = (uint8_t) (sample >> 8);
+            payload[2+2*i+1] = (uint8_t) (sample & 0x00FF);
+        }
+    }
+    agg->tail += count;
+    agg->frames++;
+    agg->packed += count;
+    return 2 + used;
+}
@@ -0,0 +1,65 @@
+/**
+ * Multi-sample frame aggregation
+ *
+ * The sensor samples are queued as they are taken, the policy decides when a frame is built and how many
+ * payload bytes it carries, such that as few and as large frames as possible are sent:
+ * - a frame is built as soon as the queued samples fill target_payload bytes
+ * - once the oldest queued sample has waited max_latency_us, a frame with all queued samples is built
+ * - the energy budget (payload bytes the supply can still afford) caps the frame: a full frame waits
+ *   for the energy, only a frame forced by the latency bound is sent smaller
+ * The payload is the 2B file position of the first sample (as generate_data() with include_index) and the
+ * samples, either raw or as compressed stream (compress_samples()). It is trimmed to the used bytes.
+ * A full queue drops its oldest samples.
+ *
+ */
+
+#ifndef AGGREGATOR_LIB
+#define AGGREGATOR_LIB
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define AGG_QUEUE_LEN           64 // samples, has to be a power of two
+
+struct agg_policy {
+    uint8_t target_payload;    // payload bytes of a full frame (including the 2B file position)
+    uint32_t max_latency_us;   // longest wait of a sample in the queue
+    bool compressed;           // samples as compressed stream (see generate_compressed())
+};
+typedef struct agg_policy Agg_policy;
+
+struct aggregator {
+    Agg_policy policy;
+    uint16_t samples[AGG_QUEUE_LEN];
+    uint64_t times_us[AGG_QUEUE_LEN]; // when the samples were queued
+    uint32_t head;             // samples queued so far
+    uint32_t tail;             // samples packed or dropped so far
+    uint16_t position;         // file position of the first sample (tail 0)
+    uint32_t frames;
+    uint32_t packed;           // samples
+    uint32_t dropped;          // samples, full queue
+    uint32_t latency_frames;   // frames sent before they were full (latency bound)
+};
+typedef struct aggregator Aggregator;
+
+// position: file position of the first sample which will be queued
+void aggregator_init(Aggregator *agg, const Agg_policy *policy, uint16_t position);
+
+// queue the next sample of the stream (the oldest one is dropped if the queue is full)
+void aggregator_push(Aggregator *agg, uint16_t sample, uint64_t time_us);
+
+uint32_t aggregator_count(const Aggregator *agg);
+
+/*
+ * payload bytes of the frame to build now (0: wait for more samples or energy)
+ * budget: payload bytes the supply affords (at least 2 + one sample to send anything)
+ */
+uint8_t aggregator_ready(const Aggregator *agg, uint64_t now_us, uint8_t budget);
+
+/*
+ * fill a payload of at most len bytes with the oldest queued samples and remove them from the queue,
+ * returns the used bytes (0 if no sample fits)
+ */
+uint8_t aggregator_pack(Aggregator *agg, uint8_t *payload, uint8_t len);
+
+#endif
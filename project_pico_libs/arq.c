@@ -0,0 +1,140 @@
+/**
+ * Selective-repeat ARQ
+ *
+ * See arq.h
+ *
+ */
+
+#include <string.h>
+#include "arq.h"
+
+void arq_rx_init(Arq_rx *rx){
+    memset(rx, 0, sizeof(Arq_rx));
+}
+
+bool arq_rx_update(Arq_rx *rx, uint8_t seq, bool ok){
+    Arq_ack *ack = &rx->ack;
+    if(!rx->started){
+        rx->started = true;
+        ack->last = seq;
+    }
+    int8_t ahead = (int8_t) (seq - ack->last);
+    if(ahead > 0){
+        ack->acked = (ahead < 32) ? ack->acked << ahead : 0;
+        ack->nacked = (ahead < 32) ? ack->nacked << ahead : 0;
+        ack->last = seq;
+    }
+    uint8_t i = ack->last - seq;
+    if(i >= 32){
+        rx->duplicates += ok; // older than the bitmaps: ignored
+        return false;
+    }
+    uint32_t bit = 1u << i;
+    if(!ok){
+        rx->corrupted++;
+        ack->nacked |= (ack->acked & bit) ? 0 : bit;
+        return false;
+    }
+    if(ack->acked & bit){
+        rx->duplicates++;
+        return false;
+    }
+    ack->acked |= bit;
+    ack->nacked &= ~bit;
+    rx->unique++;
+    return true;
+}
+
+void arq_rx_ack(const Arq_rx *rx, Arq_ack *ack){
+    *ack = rx->ack;
+}
+
+void arq_tx_init(Arq_tx *tx){
+    memset(tx, 0, sizeof(Arq_tx));
+}
+
+bool arq_tx_full(const Arq_tx *tx){
+    return tx->used == ARQ_WINDOW;
+}
+
+static struct arq_slot *find(Arq_tx *tx, uint8_t seq){
+    for(uint8_t s = 0; s < ARQ_WINDOW; s++){
+        if(tx->slots[s].frame != NULL && tx->slots[s].seq == seq){
+            return &tx->slots[s];
+        }
+    }
+    return NULL;
+}
+
+bool arq_tx_add(Arq_tx *tx, void *frame, uint8_t seq, uint64_t deadline_us){
+    if(arq_tx_full(tx) || find(tx, seq) != NULL){
+        return false;
+    }
+    struct arq_slot *slot = tx->slots;
+    while(slot->frame != NULL){
+        slot++; // there is a free one
+    }
+    *slot = (struct arq_slot) {.frame = frame, .seq = seq, .transmissions = 1, .deadline_us = deadline_us};
+    tx->used++;
+    tx->sent++;
+    return true;
+}
+
+// waiting for a retransmission at now_us
+static bool due(const struct arq_slot *slot, uint64_t now_us){
+    return slot->frame != NULL && !slot->acked && (slot->nacked || now_us >= slot->deadline_us);
+}
+
+void *arq_tx_due(const Arq_tx *tx, uint64_t now_us, uint8_t *seq){
+    const struct arq_slot *first = NULL;
+    for(uint8_t s = 0; s < ARQ_WINDOW; s++){
+        const struct arq_slot *slot = &tx->slots[s];
+        if(due(slot, now_us) && slot->transmissions < ARQ_MAX_TX && (first == NULL || slot->deadline_us < first->deadline_us)){
+            first = slot;
+        }
+    }
+    if(first == NULL){
+        return NULL;
+    }
+    *seq = first->seq;
+    return first->frame;
+}
+
+void arq_tx_resent(Arq_tx *tx, uint8_t seq, uint64_t deadline_us){
+    struct arq_slot *slot = find(tx, seq);
+    if(slot != NULL){
+        slot->transmissions++;
+        slot->nacked = false;
+        slot->deadline_us = deadline_us;
+        tx->retransmissions++;
+    }
+}
+
+void arq_tx_feedback(Arq_tx *tx, const Arq_ack *ack){
+    for(uint8_t s = 0; s < ARQ_WINDOW; s++){
+        struct arq_slot *slot = &tx->slots[s];
+        uint8_t i = ack->last - slot->seq;
+        if(slot->frame == NULL || i >= 32){
+            continue; // not covered by the bitmaps (yet)
+        }
+        slot->acked |= (ack->acked >> i) & 1;
+        slot->nacked |= (ack->nacked >> i) & 1;
+    }
+}
+
+void *arq_tx_release(Arq_tx *tx, uint64_t now_us, bool *delivered){
+    for(uint8_t s = 0; s < ARQ_WINDOW; s++){
+        struct arq_slot *slot = &tx->slots[s];
+        if(slot->frame == NULL || !(slot->acked || (due(slot, now_us) && slot->transmissions >= ARQ_MAX_TX))){
+            continue;
+        }
+        void *frame = slot->frame;
+        *delivered = slot->acked;
+        tx->delivered += slot->acked;
+        tx->given_up += !slot->acked;
+        slot->frame = NULL;
+        tx->used--;
+        return frame;
+    }
+    return NULL;
+}
@@ -0,0 +1,86 @@
+/**
+ * Selective-repeat ARQ
+ *
+ * Sender and receiver side of a sliding-window selective repeat around the 8-bit seq of the header:
+ * - the receiver marks every received seq in two bitmaps relative to the highest seq so far (Arq_ack):
+ *   received without errors (ACK) or corrupted (NACK), missing seqs are in neither
+ * - the sender keeps up to ARQ_WINDOW sent frames until they are acknowledged. A frame is retransmitted
+ *   once it is NACKed or its deadline (airtime and reception, set by the caller) passes without an ACK,
+ *   and given up after ARQ_MAX_TX transmissions.
+ * The receiver counts every frame only once (unique), retransmitted frames which arrive again are duplicates.
+ *
+ * The frames are opaque to the module (e.g. buffers of the packet pool), the caller sends and frees them.
+ */
+
+#ifndef ARQ_LIB
+#define ARQ_LIB
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ARQ_WINDOW      8 // frames waiting for an ACK (at most 32, the length of the bitmaps)
+#define ARQ_MAX_TX      4 // transmissions of a frame before it is given up
+
+// receiver feedback
+struct arq_ack {
+    uint8_t last;           // highest seq received
+    uint32_t acked;         // bit i: seq last-i received without errors
+    uint32_t nacked;        // bit i: seq last-i only received corrupted
+};
+typedef struct arq_ack Arq_ack;
+
+struct arq_rx {
+    bool started;
+    Arq_ack ack;
+    uint32_t unique;        // frames delivered (first reception without errors)
+    uint32_t duplicates;    // received again without errors
+    uint32_t corrupted;
+};
+typedef struct arq_rx Arq_rx;
+
+struct arq_slot {
+    void *frame;            // NULL: free
+    uint8_t seq;
+    uint8_t transmissions;
+    bool acked;
+    bool nacked;            // retransmit without waiting for the deadline
+    uint64_t deadline_us;   // retransmit if not acknowledged until
+};
+
+struct arq_tx {
+    struct arq_slot slots[ARQ_WINDOW];
+    uint8_t used;
+    uint32_t sent;          // first transmissions
+    uint32_t retransmissions;
+    uint32_t delivered;
+    uint32_t given_up;
+};
+typedef struct arq_tx Arq_tx;
+
+void arq_rx_init(Arq_rx *rx);
+
+// a frame with seq was received (ok: without errors), returns true if it was delivered for the first time
+bool arq_rx_update(Arq_rx *rx, uint8_t seq, bool ok);
+
+// feedback for the sender
+void arq_rx_ack(const Arq_rx *rx, Arq_ack *ack);
+
+void arq_tx_init(Arq_tx *tx);
+
+bool arq_tx_full(const Arq_tx *tx);
+
+// keep a frame after its first transmission, false if the window is full or seq is in the window already
+bool arq_tx_add(Arq_tx *tx, void *frame, uint8_t seq, uint64_t deadline_us);
+
+// frame to retransmit at now_us (NACK or deadline passed, lowest deadline first), NULL if none
+void *arq_tx_due(const Arq_tx *tx, uint64_t now_us, uint8_t *seq);
+
+// the due frame with seq was transmitted again
+void arq_tx_resent(Arq_tx *tx, uint8_t seq, uint64_t deadline_us);
+
+void arq_tx_feedback(Arq_tx *tx, const Arq_ack *ack);
+
+// a frame which left the window (acknowledged or given up), NULL if none. The caller owns the frame again.
+void *arq_tx_release(Arq_tx *tx, uint64_t now_us, bool *delivered);
+
+#endif
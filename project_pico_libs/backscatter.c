@@ -7,7 +7,7 @@
 
 #include "backscatter.h"
 
-// repeat the instruction until the desired delay has past
+// repeat the instruction until the desired delay has past, returns the new program length
 int16_t repeat(uint16_t* instructionBuffer, int16_t delay, uint32_t asm_instr, uint8_t *length, uint16_t max_delay){
     while(delay > 0){
         uint8_t delay_part = min(max_delay, delay) - 1;
@@ -15,6 +15,7 @@ int16_t repeat(uint16_t* instructionBuffer, int16_t delay, uint32_t asm_instr, u
         delay = delay - (delay_part + 1);
         (*length)++;
     }
+    return *length;
 }
 
 // how many instructions are needed to create this delay?
@@ -93,6 +94,29 @@ bool generatePIOprogram(uint16_t d0,uint16_t d1, uint32_t baud, uint16_t* instru
     return true;
 }
 
+// closest baud-rate which is achievable with the state-machine clock
+uint32_t backscatter_baudrate(uint32_t baud){
+    if(((uint32_t) (CLKFREQ*pow(10,6))) % baud != 0){
+        return round(((uint32_t) (CLKFREQ*pow(10,6))) / round(((double) CLKFREQ*pow(10,6)) / ((double) baud)));
+    }
+    return baud;
+}
+
+// loop repetitions per symbol for the clock divider d (first two words of the TX FIFO)
+uint32_t backscatter_repetitions(uint16_t d, uint32_t baud){
+    return ((CLKFREQ*1000000/baud - 4) / d) - 1; // -1 is requried since JMP 0-- is still true
+}
+
+// modulation parameters of d0/d1/baud (baud has to be achievable, see backscatter_baudrate)
+void backscatter_settings(uint16_t d0, uint16_t d1, uint32_t baud, struct backscatter_config *config){
+    uint32_t fcenter    = (CLKFREQ*1000000/d0 + CLKFREQ*1000000/d1)/2;
+    uint32_t fdeviation = abs(round((((double) CLKFREQ*1000000)/((double) d1)) - ((double) fcenter)));
+    config->baudrate    = baud;
+    config->center_offset = round(fcenter);
+    config->deviation   = round(fdeviation);
+    config->minRxBw     = round((baud + 2*fdeviation));
+}
+
 /* 
     - based on d0/d1/baud, the modulation parameters will be computed and returned in the struct backscatter_config 
     - pin2 is ignored if twoAntennas==false
@@ -107,8 +131,8 @@ void backscatter_program_init(PIO pio, uint sm, uint pin1, uint pin2, uint16_t d
         printf("WARNING: the clock divider d1 has to be an even integer. The state-machine may not function correctly");
     }
     // correct baud-rate
-    if(((uint32_t) (CLKFREQ*pow(10,6))) % baud != 0){
-        uint32_t baud_new = round(((uint32_t) (CLKFREQ*pow(10,6))) / round(((double) CLKFREQ*pow(10,6)) / ((double) baud)));
+    if(backscatter_baudrate(baud) != baud){
+        uint32_t baud_new = backscatter_baudrate(baud);
         printf("WARNING: a baudrate of %d Baud is not achievable with a %d MHz clock.\nTherefore, the closest achievable baud-rate %d Baud will be used.\n", baud, CLKFREQ, baud_new);
         baud = baud_new;
     }
@@ -142,18 +166,13 @@ void backscatter_program_init(PIO pio, uint sm, uint pin1, uint pin2, uint16_t d
     sm_config_set_out_shift(&c, false, true, 32);  // OUT shifts to left (MSB first), autopull after every 32 bit
     pio_sm_init(pio, sm, offset, &c);
     pio_sm_set_enabled(pio, sm, true);
-    uint32_t reps0 = ((CLKFREQ*1000000/baud - 4) / d0) - 1;
-    uint32_t reps1 = ((CLKFREQ*1000000/baud - 4) / d1) - 1;
-    pio_sm_put_blocking(pio, sm, reps0); // -1 is requried since JMP 0-- is still true
-    pio_sm_put_blocking(pio, sm, reps1); // -1 is required since JMP 0-- is still true
+    pio_sm_put_blocking(pio, sm, backscatter_repetitions(d0, baud));
+    pio_sm_put_blocking(pio, sm, backscatter_repetitions(d1, baud));
 
     // compute configuration parameters
-    uint32_t fcenter    = (CLKFREQ*1000000/d0 + CLKFREQ*1000000/d1)/2;
-    uint32_t fdeviation = abs(round((((double) CLKFREQ*1000000)/((double) d1)) - ((double) fcenter)));
-    config->baudrate    = baud;
-    config->center_offset = round(fcenter);
-    config->deviation   = round(fdeviation);
-    config->minRxBw     = round((baud + 2*fdeviation));
+    backscatter_settings(d0, d1, baud, config);
+    config->program_length = backscatter_program.length;
+    uint32_t fdeviation = config->deviation;
     
     if (fdeviation > 380000){
         printf("WARNING: the deviation is too large for the CC2500\n");
@@ -168,6 +187,29 @@ void backscatter_program_init(PIO pio, uint sm, uint pin1, uint pin2, uint16_t d
     printf("Computed baseband settings: \n- baudrate: %d\n- Center offset: %d\n- deviation: %d\n- RX Bandwidth: %d\n", config->baudrate, config->center_offset, config->deviation, config->minRxBw);
 }
 
+bool backscatter_program_update(PIO pio, uint sm, uint16_t d0, uint16_t d1, uint32_t baud, struct backscatter_config *config, uint16_t *instructionBuffer, bool twoAntennas){
+    baud = backscatter_baudrate(baud);
+    struct pio_program backscatter_program;
+    if(!generatePIOprogram(d0, d1, baud, instructionBuffer, &backscatter_program, twoAntennas)){
+        return false;
+    }
+    // replace the program at offset 0 and start it from the beginning
+    pio_sm_set_enabled(pio, sm, false);
+    struct pio_program loaded = {instructionBuffer, config->program_length, 0};
+    pio_remove_program(pio, &loaded, 0);
+    pio_add_program_at_offset(pio, &backscatter_program, 0);
+    pio_sm_set_wrap(pio, sm, 0, backscatter_program.length-1);
+    pio_sm_clear_fifos(pio, sm);
+    pio_sm_restart(pio, sm);
+    pio_sm_exec(pio, sm, ASM_JMP | 0);
+    pio_sm_set_enabled(pio, sm, true);
+    pio_sm_put_blocking(pio, sm, backscatter_repetitions(d0, baud));
+    pio_sm_put_blocking(pio, sm, backscatter_repetitions(d1, baud));
+    backscatter_settings(d0, d1, baud, config);
+    config->program_length = backscatter_program.length;
+    return true;
+}
+
 void backscatter_send(PIO pio, uint sm, uint32_t *message, uint32_t len) {
     for(uint32_t i = 0; i < len; i++){
         pio_sm_put_blocking(pio, sm, message[i]); // set pin back to low
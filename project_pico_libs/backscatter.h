@@ -40,6 +40,7 @@ struct backscatter_config {
   uint32_t center_offset;
   uint32_t deviation;
   uint32_t minRxBw;
+  uint8_t program_length; // instructions loaded at offset 0 (set by backscatter_program_init/update)
 };
 #endif
 
@@ -53,9 +54,24 @@ uint8_t instructionCount(uint16_t delay, uint16_t max_delay);
 // repeat the instruction until the desired delay has past
 int16_t repeat(uint16_t* instructionBuffer, int16_t delay, uint32_t asm_instr, uint8_t *length, uint16_t max_delay);
 
+// closest baud-rate which is achievable with the state-machine clock
+uint32_t backscatter_baudrate(uint32_t baud);
+
+// loop repetitions per symbol for the clock divider d (first two words of the TX FIFO)
+uint32_t backscatter_repetitions(uint16_t d, uint32_t baud);
+
+// modulation parameters of d0/d1/baud (baud has to be achievable, see backscatter_baudrate)
+void backscatter_settings(uint16_t d0, uint16_t d1, uint32_t baud, struct backscatter_config *config);
+
 bool generatePIOprogram(uint16_t d0,uint16_t d1, uint32_t baud, uint16_t* instructionBuffer, struct pio_program *backscatter_program, bool twoAntennas);
 
 /* based on d0/d1/baud, the modulation parameters will be computed and returned in the struct backscatter_config */
 void backscatter_program_init(PIO pio, uint sm, uint pin1, uint pin2, uint16_t d0, uint16_t d1, uint32_t baud, struct backscatter_config *config, uint16_t *instructionBuffer, bool twoAntennas);
 
+/*
+ * switch the running state machine of backscatter_program_init to d0/d1/baud without printing (between two packets:
+ * the TX FIFO has to be empty), returns false if the program does not fit (the previous one keeps running)
+ */
+bool backscatter_program_update(PIO pio, uint sm, uint16_t d0, uint16_t d1, uint32_t baud, struct backscatter_config *config, uint16_t *instructionBuffer, bool twoAntennas);
+
 void backscatter_send(PIO pio, uint sm, uint32_t *message, uint32_t len);
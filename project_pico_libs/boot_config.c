@@ -0,0 +1,60 @@
+/**
+ * Last-known-good configuration for a fast boot
+ *
+ * See boot_config.h
+ *
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "packet_generation.h"
+#include "boot_config.h"
+
+void boot_config_seal(Boot_config *config, uint32_t sequence){
+    config->magic = BOOT_CONFIG_MAGIC;
+    config->sequence = sequence;
+    config->reserved = 0;
+    config->crc = crc16_update(0xFFFF, (const uint8_t *) config, offsetof(Boot_config, crc));
+}
+
+bool boot_config_valid(const Boot_config *config){
+    return config->magic == BOOT_CONFIG_MAGIC && config->crc == crc16_update(0xFFFF, (const uint8_t *) config, offsetof(Boot_config, crc));
+}
+
+bool boot_config_equal(const Boot_config *a, const Boot_config *b){
+    return a->baud == b->baud && a->carrier_hz == b->carrier_hz && a->d0 == b->d0 && a->d1 == b->d1 && a->profile == b->profile;
+}
+
+int8_t boot_config_latest(const uint8_t *sector, Boot_config *config){
+    int8_t latest = -1;
+    Boot_config record;
+    for(uint8_t r = 0; r < BOOT_CONFIG_RECORDS; r++){
+        memcpy(&record, &sector[r * BOOT_CONFIG_RECORD_SIZE], sizeof(Boot_config)); // unaligned
+        if(boot_config_valid(&record) && (latest < 0 || (int32_t) (record.sequence - config->sequence) > 0)){
+            *config = record;
+            latest = r;
+        }
+    }
+    return latest;
+}
+
+// all bytes of a record are 0xFF
+static bool erased(const uint8_t *record){
+    for(uint16_t i = 0; i < BOOT_CONFIG_RECORD_SIZE; i++){
+        if(record[i] != 0xFF){
+            return false;
+        }
+    }
+    return true;
+}
+
+int8_t boot_config_next(const uint8_t *sector){
+    Boot_config latest;
+    // a torn record after the newest one is skipped
+    for(int8_t r = boot_config_latest(sector, &latest) + 1; r < BOOT_CONFIG_RECORDS; r++){
+        if(erased(&sector[r * BOOT_CONFIG_RECORD_SIZE])){
+            return r;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,51 @@
+/**
+ * Last-known-good configuration for a fast boot
+ *
+ * The baseband (clock dividers, baud-rate), the carrier frequency and the rate profile which worked last are kept
+ * in a reserved flash sector (see boot_flash.h). A headless tag which browns out and restarts transmits with them
+ * right away instead of relearning them, the receiver settings follow from the baseband (see backscatter.h).
+ * Layout of the sector: BOOT_CONFIG_RECORDS records of BOOT_CONFIG_RECORD_SIZE bytes (one flash page each), written
+ * in turn with an increasing sequence number into erased pages; the sector is erased once all pages are used.
+ * The newest record with a valid CRC is loaded: a power loss while programming leaves the previous record,
+ * one while erasing leaves none (the defaults apply).
+ *
+ */
+
+#ifndef BOOT_CONFIG_LIB
+#define BOOT_CONFIG_LIB
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define BOOT_CONFIG_MAGIC        0xB007CF61
+#define BOOT_CONFIG_RECORD_SIZE         256 // bytes per record (flash page)
+#define BOOT_CONFIG_RECORDS              16 // records per sector (4 KB)
+
+struct boot_config {
+    uint32_t magic;
+    uint32_t sequence;         // of the record, the newest one is loaded
+    uint32_t baud;
+    uint32_t carrier_hz;
+    uint16_t d0;               // baseband clock dividers
+    uint16_t d1;
+    uint8_t profile;           // rate profile (see rate_control.h)
+    uint8_t reserved;
+    uint16_t crc;              // CRC-16 over the fields above
+};
+typedef struct boot_config Boot_config;
+
+// set magic, sequence number and CRC of a record
+void boot_config_seal(Boot_config *config, uint32_t sequence);
+
+bool boot_config_valid(const Boot_config *config);
+
+// same settings (baseband, carrier and profile)
+bool boot_config_equal(const Boot_config *a, const Boot_config *b);
+
+// newest valid record of a sector (memory-mapped), returns its index (-1: none)
+int8_t boot_config_latest(const uint8_t *sector, Boot_config *config);
+
+// erased record after the newest valid one to program the next configuration into, -1: the sector has to be erased
+int8_t boot_config_next(const uint8_t *sector);
+
+#endif
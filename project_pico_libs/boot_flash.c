@@ -0,0 +1,53 @@
+/**
+ * Last-known-good configuration in the flash
+ *
+ * See boot_flash.h
+ *
+ */
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/flash.h"
+#include "hardware/flash.h"
+#include "boot_flash.h"
+
+struct boot_write {
+    int8_t record;             // -1: erase the sector first
+    uint8_t page[BOOT_CONFIG_RECORD_SIZE];
+};
+
+static const uint8_t *boot_sector(){
+    return (const uint8_t *) (XIP_BASE + BOOT_FLASH_OFFSET);
+}
+
+bool boot_flash_load(Boot_config *config){
+    return boot_config_latest(boot_sector(), config) >= 0;
+}
+
+// runs while the other core is stopped and the interrupts are disabled (flash_safe_execute())
+static void boot_flash_write(void *param){
+    struct boot_write *write = param;
+    if(write->record < 0){
+        flash_range_erase(BOOT_FLASH_OFFSET, FLASH_SECTOR_SIZE);
+        write->record = 0;
+    }
+    flash_range_program(BOOT_FLASH_OFFSET + write->record * BOOT_CONFIG_RECORD_SIZE, write->page, BOOT_CONFIG_RECORD_SIZE);
+}
+
+bool boot_flash_store(const Boot_config *config){
+    Boot_config latest;
+    bool found = boot_flash_load(&latest);
+    if(found && boot_config_equal(&latest, config)){
+        return true;
+    }
+    static struct boot_write write;
+    Boot_config record = *config;
+    boot_config_seal(&record, found ? latest.sequence + 1 : 0);
+    write.record = boot_config_next(boot_sector());
+    memset(write.page, 0xFF, sizeof(write.page)); // the rest of the page stays erased
+    memcpy(write.page, &record, sizeof(record));
+    if(flash_safe_execute(boot_flash_write, &write, BOOT_FLASH_TIMEOUT_MS) != PICO_OK){
+        return false;
+    }
+    return boot_flash_load(&latest) && latest.sequence == record.sequence;
+}
@@ -0,0 +1,29 @@
+/**
+ * Last-known-good configuration in the flash (records see boot_config.h)
+ *
+ * The last flash sector is reserved for the records (BOOT_FLASH_OFFSET), the program has to end before it.
+ * A write stalls both cores with the interrupts disabled (flash_safe_execute(): about 1 ms per record, and 50 ms
+ * for the erase once every BOOT_CONFIG_RECORDS records). If core 1 runs, it has to call flash_safe_execute_core_init().
+ *
+ */
+
+#ifndef BOOT_FLASH_LIB
+#define BOOT_FLASH_LIB
+
+#include "pico/stdlib.h"
+#include "hardware/flash.h"
+#include "boot_config.h"
+
+#define BOOT_FLASH_OFFSET     (PICO_FLASH_SIZE_BYTES - FLASH_SECTOR_SIZE)
+#define BOOT_FLASH_TIMEOUT_MS 100 // for the other core to stop
+
+// newest valid record, false if there is none (the defaults apply)
+bool boot_flash_load(Boot_config *config);
+
+/*
+ * keep the settings of config as the newest record, the flash is only written if they changed
+ * returns false if the flash could not be written
+ */
+bool boot_flash_store(const Boot_config *config);
+
+#endif
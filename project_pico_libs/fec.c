@@ -0,0 +1,91 @@
+/**
+ * Forward error correction: extended Hamming(8,4) with bit interleaving
+ *
+ * See fec.h
+ *
+ */
+
+#include <string.h>
+#include "fec.h"
+
+#define FEC_CORRECTED     0x10 // decode table: one bit error corrected
+#define FEC_UNCORRECTABLE 0x20 // decode table: two (or more) bit errors
+
+/*
+ * codeword of a nibble: data bits d3..d0, parity bits (d0^d1^d3) (d1^d2^d3) (d0^d1^d2) and the overall parity,
+ * the minimal distance is 4
+ */
+static const uint8_t encode_table[16] = {
+    0x00, 0x1b, 0x2e, 0x35, 0x47, 0x5c, 0x69, 0x72, 0x8d, 0x96, 0xa3, 0xb8, 0xca, 0xd1, 0xe4, 0xff
+};
+
+// received codeword -> nibble (low bits) and FEC_CORRECTED/FEC_UNCORRECTABLE
+static const uint8_t decode_table[256] = {
+    0x00, 0x10, 0x10, 0x20, 0x10, 0x20, 0x20, 0x14, 0x10, 0x20, 0x20, 0x11, 0x20, 0x18, 0x12, 0x20,
+    0x10, 0x21, 0x21, 0x11, 0x21, 0x13, 0x19, 0x21, 0x21, 0x11, 0x11, 0x01, 0x15, 0x21, 0x21, 0x11,
+    0x10, 0x22, 0x22, 0x1a, 0x22, 0x13, 0x12, 0x22, 0x22, 0x16, 0x12, 0x22, 0x12, 0x22, 0x02, 0x12,
+    0x23, 0x13, 0x17, 0x23, 0x13, 0x03, 0x23, 0x13, 0x1b, 0x23, 0x23, 0x11, 0x23, 0x13, 0x12, 0x23,
+    0x10, 0x24, 0x24, 0x14, 0x24, 0x14, 0x14, 0x04, 0x24, 0x16, 0x1c, 0x24, 0x15, 0x24, 0x24, 0x14,
+    0x25, 0x1d, 0x17, 0x25, 0x15, 0x25, 0x25, 0x14, 0x15, 0x25, 0x25, 0x11, 0x05, 0x15, 0x15, 0x25,
+    0x26, 0x16, 0x17, 0x26, 0x1e, 0x26, 0x26, 0x14, 0x16, 0x06, 0x26, 0x16, 0x26, 0x16, 0x12, 0x26,
+    0x17, 0x27, 0x07, 0x17, 0x27, 0x13, 0x17, 0x27, 0x27, 0x16, 0x17, 0x27, 0x15, 0x27, 0x27, 0x1f,
+    0x10, 0x28, 0x28, 0x1a, 0x28, 0x18, 0x19, 0x28, 0x28, 0x18, 0x1c, 0x28, 0x18, 0x08, 0x28, 0x18,
+    0x29, 0x1d, 0x19, 0x29, 0x19, 0x29, 0x09, 0x19, 0x1b, 0x29, 0x29, 0x11, 0x29, 0x18, 0x19, 0x29,
+    0x2a, 0x1a, 0x1a, 0x0a, 0x1e, 0x2a, 0x2a, 0x1a, 0x1b, 0x2a, 0x2a, 0x1a, 0x2a, 0x18, 0x12, 0x2a,
+    0x1b, 0x2b, 0x2b, 0x1a, 0x2b, 0x13, 0x19, 0x2b, 0x0b, 0x1b, 0x1b, 0x2b, 0x1b, 0x2b, 0x2b, 0x1f,
+    0x2c, 0x1d, 0x1c, 0x2c, 0x1e, 0x2c, 0x2c, 0x14, 0x1c, 0x2c, 0x0c, 0x1c, 0x2c, 0x18, 0x1c, 0x2c,
+    0x1d, 0x0d, 0x2d, 0x1d, 0x2d, 0x1d, 0x19, 0x2d, 0x2d, 0x1d, 0x1c, 0x2d, 0x15, 0x2d, 0x2d, 0x1f,
+    0x1e, 0x2e, 0x2e, 0x1a, 0x0e, 0x1e, 0x1e, 0x2e, 0x2e, 0x16, 0x1c, 0x2e, 0x1e, 0x2e, 0x2e, 0x1f,
+    0x2f, 0x1d, 0x17, 0x2f, 0x1e, 0x2f, 0x2f, 0x1f, 0x1b, 0x2f, 0x2f, 0x1f, 0x2f, 0x1f, 0x1f, 0x0f,
+};
+
+bool fec_encode(const uint8_t *data, uint8_t len, uint8_t *out){
+    if(len > FEC_MAX_LEN){
+        return false;
+    }
+    uint8_t n = FEC_LEN(len);
+    uint8_t codewords[FEC_LEN(FEC_MAX_LEN)];
+    for(uint8_t i = 0; i < len; i++){
+        codewords[2*i]   = encode_table[data[i] >> 4];
+        codewords[2*i+1] = encode_table[data[i] & 0x0F];
+    }
+    memset(out, 0, n);
+    uint16_t k = 0; // position in the interleaved bit stream (MSB first)
+    for(uint8_t b = 0; b < 8; b++){
+        for(uint8_t i = 0; i < n; i++, k++){
+            out[k >> 3] |= ((codewords[i] >> (7 - b)) & 1) << (7 - (k & 7));
+        }
+    }
+    return true;
+}
+
+int16_t fec_decode(const uint8_t *in, uint8_t len, uint8_t *data, Fec_stats *stats){
+    if(len > FEC_MAX_LEN){
+        return -1;
+    }
+    uint8_t n = FEC_LEN(len);
+    uint8_t codewords[FEC_LEN(FEC_MAX_LEN)];
+    memset(codewords, 0, n);
+    uint16_t k = 0;
+    for(uint8_t b = 0; b < 8; b++){
+        for(uint8_t i = 0; i < n; i++, k++){
+            codewords[i] |= ((in[k >> 3] >> (7 - (k & 7))) & 1) << (7 - b);
+        }
+    }
+    int16_t corrected = 0;
+    bool uncorrectable = false;
+    for(uint8_t i = 0; i < len; i++){
+        uint8_t high = decode_table[codewords[2*i]];
+        uint8_t low = decode_table[codewords[2*i+1]];
+        data[i] = ((high & 0x0F) << 4) | (low & 0x0F);
+        corrected += ((high & FEC_CORRECTED) != 0) + ((low & FEC_CORRECTED) != 0);
+        uncorrectable |= ((high | low) & FEC_UNCORRECTABLE) != 0;
+    }
+    if(stats != NULL){
+        stats->frames++;
+        stats->corrected_bits += corrected;
+        stats->recovered += (corrected > 0 && !uncorrectable);
+        stats->uncorrectable += uncorrectable;
+    }
+    return uncorrectable ? -1 : corrected;
+}
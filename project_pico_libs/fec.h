@@ -0,0 +1,40 @@
+/**
+ * Forward error correction: extended Hamming(8,4) with bit interleaving
+ *
+ * Every nibble is encoded into one codeword byte (SECDED: one bit error per codeword is corrected, two are
+ * detected). The codewords of a block are bit interleaved: first the MSBs of all codewords, then the next
+ * bits, ... Hence, a burst of up to 2*len bit errors hits every codeword at most once and is corrected.
+ * Encoding and decoding use lookup tables (16 and 256 bytes).
+ *
+ * The block doubles in size (rate 1/2).
+ *
+ */
+
+#ifndef FEC_LIB
+#define FEC_LIB
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FEC_LEN(len)  (2 * (len)) // encoded length of len bytes
+#define FEC_MAX_LEN     30        // bytes per block (the encoded block, the length byte and a seq fit into the 62 bytes read from the RX FIFO)
+
+struct fec_stats {
+    uint32_t frames;          // decoded
+    uint32_t corrected_bits;
+    uint32_t recovered;       // frames with corrected bits and without uncorrectable codewords
+    uint32_t uncorrectable;   // frames with at least one uncorrectable codeword
+};
+typedef struct fec_stats Fec_stats;
+
+// encode len bytes of data into FEC_LEN(len) bytes of out (not in place), false if len exceeds FEC_MAX_LEN
+bool fec_encode(const uint8_t *data, uint8_t len, uint8_t *out);
+
+/*
+ * decode FEC_LEN(len) bytes of in into len bytes of data (not in place), stats: NULL or updated
+ * returns the number of corrected bits, -1 if a codeword was uncorrectable (its data bits are taken as received)
+ * or len exceeds FEC_MAX_LEN
+ */
+int16_t fec_decode(const uint8_t *in, uint8_t len, uint8_t *data, Fec_stats *stats);
+
+#endif
@@ -0,0 +1,102 @@
+/**
+ * Persistent circular packet queue in the FRAM of the MSP430
+ *
+ * See fram_queue.h
+ *
+ */
+
+#include <stddef.h>
+#include <string.h>
+#include "packet_generation.h"
+#include "fram_queue.h"
+
+static uint16_t state_crc(const struct fram_queue_state *s){
+    return crc16_update(0xFFFF, (const uint8_t *) s, offsetof(struct fram_queue_state, crc));
+}
+
+static uint16_t record_crc(const Fram_record *r){
+    uint16_t crc = crc16_update(0xFFFF, (const uint8_t *) &r->seq, sizeof(r->seq));
+    crc = crc16_update(crc, &r->len, 1);
+    return crc16_update(crc, r->data, r->len);
+}
+
+static bool state_valid(const struct fram_queue_state *s){
+    return s->crc == state_crc(s) && (uint16_t) (s->tail - s->head) <= FRAM_QUEUE_SLOTS;
+}
+
+// valid state copy with the newest generation, NULL if there is none
+static const struct fram_queue_state *current_state(const Fram_queue *q){
+    bool valid0 = state_valid(&q->state[0]);
+    bool valid1 = state_valid(&q->state[1]);
+    if(valid0 && valid1){
+        return ((int16_t) (q->state[1].generation - q->state[0].generation) > 0) ? &q->state[1] : &q->state[0];
+    }
+    return valid0 ? &q->state[0] : (valid1 ? &q->state[1] : NULL);
+}
+
+// write the new state into the older copy
+static void commit(Fram_queue *q, uint16_t head, uint16_t tail){
+    const struct fram_queue_state *current = current_state(q);
+    struct fram_queue_state *next = (current == &q->state[0]) ? &q->state[1] : &q->state[0];
+    next->generation = (current != NULL) ? current->generation + 1 : 0;
+    next->head = head;
+    next->tail = tail;
+    next->crc = state_crc(next);
+}
+
+void fram_queue_mount(Fram_queue *q){
+    if(current_state(q) == NULL){
+        commit(q, 0, 0);
+    }
+}
+
+uint16_t fram_queue_depth(const Fram_queue *q){
+    const struct fram_queue_state *s = current_state(q);
+    return s->tail - s->head;
+}
+
+uint16_t fram_queue_head(const Fram_queue *q){
+    return current_state(q)->head;
+}
+
+bool fram_queue_push(Fram_queue *q, const uint8_t *const *data, const uint8_t *lengths, uint8_t count){
+    const struct fram_queue_state *s = current_state(q);
+    if((uint16_t) (s->tail - s->head) + count > FRAM_QUEUE_SLOTS){
+        return false;
+    }
+    for(uint8_t i = 0; i < count; i++){
+        if(lengths[i] > FRAM_RECORD_DATA){
+            return false;
+        }
+    }
+    // write the records behind the tail, they become visible with the commit
+    uint16_t tail = s->tail;
+    for(uint8_t i = 0; i < count; i++){
+        Fram_record *r = &q->records[(uint16_t) (tail + i) % FRAM_QUEUE_SLOTS];
+        r->seq = tail + i;
+        r->len = lengths[i];
+        memcpy(r->data, data[i], lengths[i]);
+        r->crc = record_crc(r);
+    }
+    commit(q, s->head, tail + count);
+    return true;
+}
+
+const Fram_record *fram_queue_peek(const Fram_queue *q, uint16_t i){
+    const struct fram_queue_state *s = current_state(q);
+    if(i >= (uint16_t) (s->tail - s->head)){
+        return NULL;
+    }
+    uint16_t position = s->head + i;
+    const Fram_record *r = &q->records[position % FRAM_QUEUE_SLOTS];
+    if(r->seq != position || r->len > FRAM_RECORD_DATA || r->crc != record_crc(r)){
+        return NULL;
+    }
+    return r;
+}
+
+void fram_queue_pop(Fram_queue *q, uint16_t count){
+    const struct fram_queue_state *s = current_state(q);
+    uint16_t depth = s->tail - s->head;
+    commit(q, s->head + ((count < depth) ? count : depth), s->tail);
+}
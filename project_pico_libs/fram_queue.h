@@ -0,0 +1,66 @@
+/**
+ * Persistent circular packet queue in the FRAM of the MSP430
+ *
+ * Layout of the queue as seen by the MSP430 firmware (and the host stand-in), the Pico only sees
+ * the sequence numbers and the depth through the backup protocol (msp430_backup.h):
+ * - records: FRAM_QUEUE_SLOTS fixed slots of [seq | len | data | CRC-16 over seq, len and data]
+ * - state:   head and tail (free-running 16-bit positions, depth = tail - head), stored twice with a
+ *            generation counter and a CRC; a commit writes the older copy, such that a power loss
+ *            during the write leaves the previous state valid
+ * The record at position p lives in slot p % FRAM_QUEUE_SLOTS and has the sequence number p.
+ * Pushed records are written first and only become visible with the state commit (log-structured):
+ * a batch push is all or nothing, a pop commit drops the oldest records.
+ *
+ */
+
+#ifndef FRAM_QUEUE_LIB
+#define FRAM_QUEUE_LIB
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define FRAM_QUEUE_SLOTS   256 // records (a power of two, at most 32768), about 18 KB of FRAM
+#define FRAM_RECORD_DATA    64 // bytes per record (packet buffer of the Pico)
+
+struct fram_record {
+    uint16_t seq;
+    uint8_t len;
+    uint8_t data[FRAM_RECORD_DATA];
+    uint16_t crc;
+};
+typedef struct fram_record Fram_record;
+
+struct fram_queue_state {
+    uint16_t generation;
+    uint16_t head;
+    uint16_t tail;
+    uint16_t crc;
+};
+
+struct fram_queue {
+    struct fram_queue_state state[2];
+    Fram_record records[FRAM_QUEUE_SLOTS];
+};
+typedef struct fram_queue Fram_queue; // placed in a persistent FRAM section by the MSP430 firmware
+
+// after a reset: the queue is formatted (empty) if neither state copy is valid
+void fram_queue_mount(Fram_queue *q);
+
+// stored records
+uint16_t fram_queue_depth(const Fram_queue *q);
+
+// sequence number of the oldest record (the next pushed record if the queue is empty)
+uint16_t fram_queue_head(const Fram_queue *q);
+
+/*
+ * append count records (all or nothing), returns false if they do not fit
+ */
+bool fram_queue_push(Fram_queue *q, const uint8_t *const *data, const uint8_t *lengths, uint8_t count);
+
+// i-th oldest record, NULL if it is corrupted (its CRC or sequence number does not match)
+const Fram_record *fram_queue_peek(const Fram_queue *q, uint16_t i);
+
+// drop the count oldest records
+void fram_queue_pop(Fram_queue *q, uint16_t count);
+
+#endif
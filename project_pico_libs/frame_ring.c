@@ -0,0 +1,49 @@
+/**
+ * Single-producer/single-consumer frame ring
+ *
+ * See frame_ring.h
+ *
+ */
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "frame_ring.h"
+
+void frame_ring_init(Frame_ring *ring){
+    memset(ring->frames, 0, sizeof(ring->frames));
+    ring->head = 0;
+    ring->tail = 0;
+    ring->full = 0;
+}
+
+Frame *frame_ring_reserve(Frame_ring *ring){
+    if(ring->head - ring->tail >= FRAME_RING_LENGTH){
+        ring->full++;
+        return NULL;
+    }
+    __dmb(); // the consumer has to be done with the slot before it is overwritten
+    return &ring->frames[ring->head & (FRAME_RING_LENGTH-1)];
+}
+
+void frame_ring_publish(Frame_ring *ring){
+    __dmb(); // frame has to be visible to the other core before the head moves
+    ring->head++;
+}
+
+Frame *frame_ring_peek(Frame_ring *ring){
+    if(ring->tail == ring->head){
+        return NULL;
+    }
+    __dmb(); // read the frame only after observing the head
+    return &ring->frames[ring->tail & (FRAME_RING_LENGTH-1)];
+}
+
+void frame_ring_release(Frame_ring *ring){
+    __dmb(); // done reading the frame before the producer may reuse it
+    ring->tail++;
+}
+
+uint32_t frame_ring_count(Frame_ring *ring){
+    return ring->head - ring->tail;
+}
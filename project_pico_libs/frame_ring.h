@@ -0,0 +1,53 @@
+/**
+ * Single-producer/single-consumer frame ring
+ *
+ * Passes ready-to-send frames (32-bit words for the PIO TX FIFO) from one core to the other through shared
+ * memory, without locks: only the producer writes the head and only the consumer writes the tail.
+ * A frame only carries a packet buffer of the pool (packet_pool.h): ownership of the buffer moves from the
+ * producer to the consumer, the packet itself is never copied.
+ *
+ * - exactly one producer and one consumer per ring (e.g. core 1 builds frames, core 0 transmits)
+ * - neither side ever blocks: reserve returns NULL if the ring is full, peek returns NULL if it is empty
+ *
+ */
+
+#ifndef FRAME_RING_LIB
+#define FRAME_RING_LIB
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "packet_pool.h"
+
+#define FRAME_RING_LENGTH        8 // number of frames, has to be a power of two
+
+struct frame {
+    uint8_t seq;
+    uint8_t words;      // number of valid words in packet
+    bool recovered;     // restored from the MSP430 backup instead of generated
+    uint64_t time_us;   // time the frame was built
+    Packet_buf *packet; // owned by the consumer after frame_ring_peek()
+};
+typedef struct frame Frame;
+
+struct frame_ring {
+    Frame frames[FRAME_RING_LENGTH];
+    volatile uint32_t head; // frames published (producer)
+    volatile uint32_t tail; // frames released (consumer)
+    volatile uint32_t full; // reserve attempts on a full ring (producer)
+};
+typedef struct frame_ring Frame_ring;
+
+void frame_ring_init(Frame_ring *ring);
+
+// producer: next free frame or NULL if the ring is full, the frame is handed over by frame_ring_publish()
+Frame *frame_ring_reserve(Frame_ring *ring);
+void frame_ring_publish(Frame_ring *ring);
+
+// consumer: oldest published frame or NULL if the ring is empty, the frame is freed by frame_ring_release()
+Frame *frame_ring_peek(Frame_ring *ring);
+void frame_ring_release(Frame_ring *ring);
+
+// number of published frames which have not been released yet
+uint32_t frame_ring_count(Frame_ring *ring);
+
+#endif
@@ -0,0 +1,13 @@
+/**
+ * Host stand-in for the Pico SDK: hardware/clocks.h
+ */
+
+#ifndef HOST_HARDWARE_CLOCKS
+#define HOST_HARDWARE_CLOCKS
+
+#include <stdint.h>
+
+enum clock_index { clk_gpout0 = 0, clk_ref = 4, clk_sys = 5, clk_peri = 6, clk_usb = 7, clk_adc = 8, clk_rtc = 9 };
+static inline uint32_t clock_get_hz(enum clock_index clk_index) { (void) clk_index; return 125000000; }
+
+#endif
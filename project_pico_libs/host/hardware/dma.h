@@ -0,0 +1,148 @@
+/**
+ * Host stand-in for the Pico SDK: hardware/dma.h
+ * Only transfers between memory and SPI (8 bit) or a PIO FIFO are supported: the channels started together with
+ * dma_start_channel_mask() (or a triggered channel) are executed immediately through host_spi_exchange() or
+ * the PIO hooks (all TX channels first, then the RX channels).
+ */
+
+#ifndef HOST_HARDWARE_DMA
+#define HOST_HARDWARE_DMA
+
+#include "pico/stdlib.h"
+#include "hardware/spi.h"
+#include "hardware/pio.h"
+
+#define NUM_DMA_CHANNELS 12
+#define HOST_DREQ_SPI0_TX 16
+#define HOST_DREQ_PIO_END  16 // DREQ_PIO0_TX0 ... DREQ_PIO1_RX3
+
+enum dma_channel_transfer_size { DMA_SIZE_8 = 0, DMA_SIZE_16 = 1, DMA_SIZE_32 = 2 };
+
+typedef struct {
+    uint dreq;
+    bool read_increment;
+    bool write_increment;
+    enum dma_channel_transfer_size size;
+} dma_channel_config;
+
+typedef struct {
+    dma_channel_config config;
+    volatile void *write_addr;
+    const volatile void *read_addr;
+    uint count;
+} host_dma_channel_t;
+
+static __attribute__((unused)) host_dma_channel_t host_dma_channels[NUM_DMA_CHANNELS];
+static __attribute__((unused)) uint32_t host_dma_claimed = 0;
+
+static inline int dma_claim_unused_channel(bool required) {
+    (void) required;
+    for (int ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+        if (!(host_dma_claimed & (1u << ch))) {
+            host_dma_claimed |= 1u << ch;
+            return ch;
+        }
+    }
+    return -1;
+}
+static inline void dma_channel_unclaim(uint channel) { host_dma_claimed &= ~(1u << channel); }
+static inline dma_channel_config dma_channel_get_default_config(uint channel) {
+    (void) channel;
+    dma_channel_config c = {0x3f, true, false, DMA_SIZE_32};
+    return c;
+}
+static inline void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) { c->size = size; }
+static inline void channel_config_set_read_increment(dma_channel_config *c, bool incr) { c->read_increment = incr; }
+static inline void channel_config_set_write_increment(dma_channel_config *c, bool incr) { c->write_increment = incr; }
+static inline void channel_config_set_dreq(dma_channel_config *c, uint dreq) { c->dreq = dreq; }
+
+static inline uint32_t host_dma_read(const host_dma_channel_t *c, uint i) {
+    uint index = c->config.read_increment ? i : 0;
+    switch (c->config.size) {
+        case DMA_SIZE_8:  return ((const volatile uint8_t *) c->read_addr)[index];
+        case DMA_SIZE_16: return ((const volatile uint16_t *) c->read_addr)[index];
+        default:          return ((const volatile uint32_t *) c->read_addr)[index];
+    }
+}
+static inline void host_dma_write(host_dma_channel_t *c, uint i, uint32_t value) {
+    uint index = c->config.write_increment ? i : 0;
+    switch (c->config.size) {
+        case DMA_SIZE_8:  ((volatile uint8_t *) c->write_addr)[index] = value; break;
+        case DMA_SIZE_16: ((volatile uint16_t *) c->write_addr)[index] = value; break;
+        default:          ((volatile uint32_t *) c->write_addr)[index] = value; break;
+    }
+}
+
+/* run the PIO TX channels, then the PIO RX channels (the hooks answer immediately) */
+static inline void host_dma_run_pio(uint32_t mask) {
+    for (int pass = 0; pass < 2; pass++) {
+        for (uint ch = 0; ch < NUM_DMA_CHANNELS; ch++) {
+            host_dma_channel_t *c = &host_dma_channels[ch];
+            bool is_tx = !(c->config.dreq & 4);
+            if (!(mask & (1u << ch)) || c->config.dreq >= HOST_DREQ_PIO_END || is_tx != (pass == 0)) {
+                continue;
+            }
+            PIO pio = (c->config.dreq < 8) ? pio0 : pio1;
+            uint sm = c->config.dreq & 3;
+            for (uint i = 0; i < c->count; i++) {
+                if (is_tx) {
+                    if (host_pio_tx_hook) host_pio_tx_hook(pio, sm, host_dma_read(c, i));
+                } else {
+                    host_dma_write(c, i, host_pio_rx_hook ? host_pio_rx_hook(pio, sm) : 0);
+                }
+            }
+            if (is_tx && host_pio_ctrl_hook) {
+                host_pio_ctrl_hook(pio, sm, HOST_PIO_DMA_TX_DONE, 0);
+            }
+        }
+    }
+}
+
+/* run the SPI TX channel (and the RX channel of the same SPI, if started together) and the PIO channels */
+static inline void host_dma_run(uint32_t mask) {
+    host_dma_run_pio(mask);
+    for (uint tx = 0; tx < NUM_DMA_CHANNELS; tx++) {
+        host_dma_channel_t *t = &host_dma_channels[tx];
+        if (!(mask & (1u << tx)) || t->config.dreq < HOST_DREQ_SPI0_TX || t->config.dreq > HOST_DREQ_SPI0_TX + 3 || (t->config.dreq & 1)) {
+            continue;
+        }
+        spi_inst_t *spi = (t->config.dreq == HOST_DREQ_SPI0_TX) ? spi0 : spi1;
+        host_dma_channel_t *r = NULL;
+        for (uint rx = 0; rx < NUM_DMA_CHANNELS; rx++) {
+            if ((mask & (1u << rx)) && host_dma_channels[rx].config.dreq == t->config.dreq + 1) {
+                r = &host_dma_channels[rx];
+            }
+        }
+        for (uint i = 0; i < t->count; i++) {
+            uint8_t in = host_spi_exchange(spi, host_dma_read(t, i));
+            if (r != NULL && i < r->count) {
+                host_dma_write(r, i, in);
+            }
+        }
+    }
+}
+
+static inline void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr, const volatile void *read_addr, uint transfer_count, bool trigger) {
+    host_dma_channels[channel] = (host_dma_channel_t) {*config, write_addr, read_addr, transfer_count};
+    if (trigger) {
+        host_dma_run(1u << channel);
+    }
+}
+static inline void dma_channel_set_read_addr(uint channel, const volatile void *read_addr, bool trigger) {
+    host_dma_channels[channel].read_addr = read_addr;
+    if (trigger) host_dma_run(1u << channel);
+}
+static inline void dma_channel_set_write_addr(uint channel, volatile void *write_addr, bool trigger) {
+    host_dma_channels[channel].write_addr = write_addr;
+    if (trigger) host_dma_run(1u << channel);
+}
+static inline void dma_channel_set_trans_count(uint channel, uint32_t trans_count, bool trigger) {
+    host_dma_channels[channel].count = trans_count;
+    if (trigger) host_dma_run(1u << channel);
+}
+static inline void dma_start_channel_mask(uint32_t chan_mask) { host_dma_run(chan_mask); }
+static inline bool dma_channel_is_busy(uint channel) { (void) channel; return false; }
+static inline void dma_channel_wait_for_finish_blocking(uint channel) { (void) channel; }
+static inline void dma_channel_abort(uint channel) { (void) channel; }
+
+#endif
@@ -0,0 +1,29 @@
+/**
+ * Host stand-in for the Pico SDK: hardware/flash.h
+ * The flash is an array (host_flash, mapped at XIP_BASE): erasing sets the bytes to 0xFF, programming can only
+ * clear bits (as the NOR flash)
+ */
+
+#ifndef HOST_HARDWARE_FLASH
+#define HOST_HARDWARE_FLASH
+
+#include <string.h>
+#include "pico/stdlib.h"
+
+#define FLASH_PAGE_SIZE        256
+#define FLASH_SECTOR_SIZE     4096
+#ifndef PICO_FLASH_SIZE_BYTES
+#define PICO_FLASH_SIZE_BYTES (64 * 1024) // enough for the libraries
+#endif
+
+__attribute__((weak)) uint8_t host_flash[PICO_FLASH_SIZE_BYTES];
+#define XIP_BASE ((uintptr_t) host_flash)
+
+static inline void flash_range_erase(uint32_t offset, size_t count) { memset(&host_flash[offset], 0xFF, count); }
+static inline void flash_range_program(uint32_t offset, const uint8_t *data, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        host_flash[offset + i] &= data[i];
+    }
+}
+
+#endif
@@ -0,0 +1,39 @@
+/**
+ * Host stand-in for the Pico SDK: hardware/irq.h
+ * There are no interrupts on the host: a simulated peripheral calls host_irq_raise(), which runs the handler immediately.
+ */
+
+#ifndef HOST_HARDWARE_IRQ
+#define HOST_HARDWARE_IRQ
+
+#include "pico/stdlib.h"
+
+/* same numbering as the RP2040 */
+#define PIO0_IRQ_0  7
+#define PIO0_IRQ_1  8
+#define PIO1_IRQ_0  9
+#define PIO1_IRQ_1 10
+#define DMA_IRQ_0  11
+#define DMA_IRQ_1  12
+#define UART0_IRQ  20
+#define UART1_IRQ  21
+#define ADC_IRQ_FIFO 22
+#define HOST_NUM_IRQS 32
+
+typedef void (*irq_handler_t)(void);
+__attribute__((weak)) irq_handler_t host_irq_handlers[HOST_NUM_IRQS];
+__attribute__((weak)) uint32_t host_irq_enabled = 0;
+
+static inline void irq_set_exclusive_handler(uint num, irq_handler_t handler) { host_irq_handlers[num] = handler; }
+static inline void irq_set_enabled(uint num, bool enabled) {
+    if (enabled) host_irq_enabled |= 1u << num;
+    else host_irq_enabled &= ~(1u << num);
+}
+static inline bool irq_is_enabled(uint num) { return host_irq_enabled & (1u << num); }
+static inline void host_irq_raise(uint num) {
+    if ((host_irq_enabled & (1u << num)) && host_irq_handlers[num]) {
+        host_irq_handlers[num]();
+    }
+}
+
+#endif
@@ -0,0 +1,159 @@
+/**
+ * Host stand-in for the Pico SDK: hardware/pio.h
+ * The programs are loaded into the instruction memory and the state-machine configuration is kept in the registers
+ * (same layout as the RP2040), such that a PIO emulator can run them.
+ * The words written to the TX FIFO of a state machine can be observed with a hook (e.g. a PIO emulator),
+ * the words read from the RX FIFO are provided by another hook (also used by the DMA stand-in).
+ * Restarts, FIFO clears and executed instructions are passed to a third hook.
+ */
+
+#ifndef HOST_HARDWARE_PIO
+#define HOST_HARDWARE_PIO
+
+#include "pico/stdlib.h"
+
+typedef struct {
+    uint32_t clkdiv;
+    uint32_t execctrl;
+    uint32_t shiftctrl;
+    uint32_t addr;
+    uint32_t instr;
+    uint32_t pinctrl;
+} pio_sm_hw_t;
+
+typedef struct pio_hw {
+    int index;
+    volatile uint32_t txf[4];
+    volatile uint32_t rxf[4];
+    uint16_t instr_mem[32];
+    uint32_t instr_used; // instruction memory in use (one bit per instruction)
+    pio_sm_hw_t sm[4];
+} pio_hw_t;
+typedef pio_hw_t *PIO;
+__attribute__((weak)) pio_hw_t host_pio_instances[2] = {{.index = 0}, {.index = 1}};
+__attribute__((weak)) uint32_t host_pio_sm_claimed[2] = {0, 0};
+#define pio0 (&host_pio_instances[0])
+#define pio1 (&host_pio_instances[1])
+
+typedef struct pio_program {
+    const uint16_t *instructions;
+    uint8_t length;
+    int8_t origin;
+} pio_program_t;
+
+typedef struct {
+    uint32_t clkdiv;
+    uint32_t execctrl;
+    uint32_t shiftctrl;
+    uint32_t pinctrl;
+} pio_sm_config;
+
+enum pio_fifo_join { PIO_FIFO_JOIN_NONE = 0, PIO_FIFO_JOIN_TX = 1, PIO_FIFO_JOIN_RX = 2 };
+enum pio_interrupt_source { pis_interrupt0 = 8, pis_interrupt1 = 9, pis_interrupt2 = 10, pis_interrupt3 = 11 };
+
+/* called for every word put into a TX FIFO, NULL by default */
+typedef void (*host_pio_tx_hook_t)(PIO pio, uint sm, uint32_t data);
+__attribute__((weak)) host_pio_tx_hook_t host_pio_tx_hook = NULL;
+/* called for every word taken from an RX FIFO, NULL by default (zeros are read) */
+typedef uint32_t (*host_pio_rx_hook_t)(PIO pio, uint sm);
+__attribute__((weak)) host_pio_rx_hook_t host_pio_rx_hook = NULL;
+/*
+ * called for pio_sm_restart(), pio_sm_clear_fifos(), pio_sm_exec() (instr) and by the DMA stand-in after the last word
+ * of a TX transfer (the words before are written as fast as the FIFO accepts them), NULL by default
+ */
+enum host_pio_ctrl { HOST_PIO_RESTART, HOST_PIO_CLEAR_FIFOS, HOST_PIO_EXEC, HOST_PIO_DMA_TX_DONE };
+typedef void (*host_pio_ctrl_hook_t)(PIO pio, uint sm, enum host_pio_ctrl ctrl, uint instr);
+__attribute__((weak)) host_pio_ctrl_hook_t host_pio_ctrl_hook = NULL;
+
+static inline uint32_t host_pio_program_mask(const pio_program_t *program, uint offset) {
+    return (program->length < 32 ? (1u << program->length) - 1 : 0xFFFFFFFF) << offset;
+}
+static inline int host_pio_find_offset(PIO pio, const pio_program_t *program) {
+    if (program->origin >= 0) {
+        return (pio->instr_used & host_pio_program_mask(program, program->origin)) ? -1 : program->origin;
+    }
+    for (int offset = 32 - program->length; offset >= 0; offset--) { // from the top as the SDK
+        if (!(pio->instr_used & host_pio_program_mask(program, offset))) {
+            return offset;
+        }
+    }
+    return -1;
+}
+
+static inline void pio_sm_set_enabled(PIO pio, uint sm, bool enabled) { (void) pio; (void) sm; (void) enabled; }
+static inline void pio_add_program_at_offset(PIO pio, const pio_program_t *program, uint offset) {
+    for (uint i = 0; i < program->length && offset + i < 32; i++) {
+        uint16_t instr = program->instructions[i];
+        pio->instr_mem[offset + i] = (instr & 0xE000) ? instr : instr + offset; // the SDK relocates the JMPs
+    }
+    pio->instr_used |= host_pio_program_mask(program, offset);
+}
+static inline bool pio_can_add_program(PIO pio, const pio_program_t *program) { return host_pio_find_offset(pio, program) >= 0; }
+/* the SDK panics if there is no space, here the program overwrites offset 0 */
+static inline uint pio_add_program(PIO pio, const pio_program_t *program) {
+    int offset = host_pio_find_offset(pio, program);
+    pio_add_program_at_offset(pio, program, offset >= 0 ? offset : 0);
+    return offset >= 0 ? offset : 0;
+}
+static inline void pio_remove_program(PIO pio, const pio_program_t *program, uint loaded_offset) { pio->instr_used &= ~host_pio_program_mask(program, loaded_offset); }
+static inline void pio_sm_set_wrap(PIO pio, uint sm, uint wrap_target, uint wrap) {
+    pio->sm[sm].execctrl = (pio->sm[sm].execctrl & ~0x1FF80u) | (wrap_target << 7) | (wrap << 12);
+}
+static inline int pio_claim_unused_sm(PIO pio, bool required) {
+    (void) required;
+    for (int sm = 0; sm < 4; sm++) {
+        if (!(host_pio_sm_claimed[pio->index] & (1u << sm))) {
+            host_pio_sm_claimed[pio->index] |= 1u << sm;
+            return sm;
+        }
+    }
+    return -1;
+}
+static inline void pio_gpio_init(PIO pio, uint pin) { (void) pio; (void) pin; }
+static inline int pio_sm_set_consecutive_pindirs(PIO pio, uint sm, uint pin_base, uint pin_count, bool is_out) { (void) pio; (void) sm; (void) pin_base; (void) pin_count; (void) is_out; return 0; }
+static inline void pio_sm_set_pins_with_mask(PIO pio, uint sm, uint32_t pin_values, uint32_t pin_mask) { (void) pio; (void) sm; (void) pin_values; (void) pin_mask; }
+static inline void pio_sm_set_pindirs_with_mask(PIO pio, uint sm, uint32_t pin_dirs, uint32_t pin_mask) { (void) pio; (void) sm; (void) pin_dirs; (void) pin_mask; }
+static inline pio_sm_config pio_get_default_sm_config(void) { pio_sm_config c = {0, 0, 0, 0}; return c; }
+static inline void sm_config_set_wrap(pio_sm_config *c, uint wrap_target, uint wrap) { c->execctrl = (c->execctrl & ~0x1FF80u) | (wrap_target << 7) | (wrap << 12); }
+static inline void sm_config_set_set_pins(pio_sm_config *c, uint set_base, uint set_count) { c->pinctrl = (c->pinctrl & ~0x1C0003E0u) | (set_base << 5) | (set_count << 26); }
+static inline void sm_config_set_out_pins(pio_sm_config *c, uint out_base, uint out_count) { c->pinctrl = (c->pinctrl & ~0x03F0001Fu) | out_base | (out_count << 20); }
+static inline void sm_config_set_in_pins(pio_sm_config *c, uint in_base) { c->pinctrl = (c->pinctrl & ~0x000F8000u) | (in_base << 15); }
+static inline void sm_config_set_sideset(pio_sm_config *c, uint bit_count, bool optional, bool pindirs) {
+    c->pinctrl = (c->pinctrl & ~0xE0000000u) | (bit_count << 29);
+    c->execctrl = (c->execctrl & ~0x60000000u) | ((uint32_t) optional << 30) | ((uint32_t) pindirs << 29);
+}
+static inline void sm_config_set_sideset_pins(pio_sm_config *c, uint sideset_base) { c->pinctrl = (c->pinctrl & ~0x00007C00u) | (sideset_base << 10); }
+static inline void sm_config_set_fifo_join(pio_sm_config *c, enum pio_fifo_join join) { c->shiftctrl = (c->shiftctrl & ~0xC0000000u) | ((uint32_t) join << 30); }
+static inline void sm_config_set_out_shift(pio_sm_config *c, bool shift_right, bool autopull, uint pull_threshold) {
+    c->shiftctrl = (c->shiftctrl & ~0x3E0A0000u) | ((uint32_t) shift_right << 19) | ((uint32_t) autopull << 17) | ((pull_threshold & 0x1F) << 25);
+}
+static inline void sm_config_set_in_shift(pio_sm_config *c, bool shift_right, bool autopush, uint push_threshold) {
+    c->shiftctrl = (c->shiftctrl & ~0x01F50000u) | ((uint32_t) shift_right << 18) | ((uint32_t) autopush << 16) | ((push_threshold & 0x1F) << 20);
+}
+static inline void sm_config_set_clkdiv(pio_sm_config *c, float div) { c->clkdiv = (uint32_t) (div * 256); }
+static inline int pio_sm_init(PIO pio, uint sm, uint initial_pc, const pio_sm_config *config) {
+    pio->sm[sm].clkdiv = config->clkdiv;
+    pio->sm[sm].execctrl = config->execctrl;
+    pio->sm[sm].shiftctrl = config->shiftctrl;
+    pio->sm[sm].pinctrl = config->pinctrl;
+    pio->sm[sm].addr = initial_pc;
+    return 0;
+}
+static inline void pio_sm_restart(PIO pio, uint sm) { if (host_pio_ctrl_hook) host_pio_ctrl_hook(pio, sm, HOST_PIO_RESTART, 0); }
+static inline void pio_sm_clear_fifos(PIO pio, uint sm) { if (host_pio_ctrl_hook) host_pio_ctrl_hook(pio, sm, HOST_PIO_CLEAR_FIFOS, 0); }
+static inline void pio_sm_exec(PIO pio, uint sm, uint instr) {
+    pio->sm[sm].instr = instr;
+    if (host_pio_ctrl_hook) host_pio_ctrl_hook(pio, sm, HOST_PIO_EXEC, instr);
+}
+static inline void pio_set_irq0_source_enabled(PIO pio, enum pio_interrupt_source source, bool enabled) { (void) pio; (void) source; (void) enabled; }
+static inline void pio_interrupt_clear(PIO pio, uint pio_interrupt_num) { (void) pio; (void) pio_interrupt_num; }
+/* same numbering as DREQ_PIO0_TX0 ... DREQ_PIO1_RX3 of the RP2040 */
+static inline uint pio_get_dreq(PIO pio, uint sm, bool is_tx) { return 8 * pio->index + (is_tx ? 0 : 4) + sm; }
+static inline void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data) {
+    if (host_pio_tx_hook) {
+        host_pio_tx_hook(pio, sm, data);
+    }
+}
+static inline uint32_t pio_sm_get_blocking(PIO pio, uint sm) { return host_pio_rx_hook ? host_pio_rx_hook(pio, sm) : 0; }
+
+#endif
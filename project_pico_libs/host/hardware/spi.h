@@ -0,0 +1,49 @@
+/**
+ * Host stand-in for the Pico SDK: hardware/spi.h
+ * Every byte is exchanged with host_spi_hook (e.g. a simulated SPI slave), without hook writes are discarded
+ * and reads return zeros.
+ */
+
+#ifndef HOST_HARDWARE_SPI
+#define HOST_HARDWARE_SPI
+
+#include <string.h>
+#include "pico/stdlib.h"
+
+typedef struct { volatile uint32_t dr; } spi_hw_t;
+typedef struct spi_inst { int index; spi_hw_t hw; } spi_inst_t;
+__attribute__((weak)) spi_inst_t host_spi_instances[2] = {{0, {0}}, {1, {0}}};
+#define spi0 (&host_spi_instances[0])
+#define spi1 (&host_spi_instances[1])
+
+typedef enum { SPI_CPHA_0 = 0, SPI_CPHA_1 = 1 } spi_cpha_t;
+typedef enum { SPI_CPOL_0 = 0, SPI_CPOL_1 = 1 } spi_cpol_t;
+typedef enum { SPI_LSB_FIRST = 0, SPI_MSB_FIRST = 1 } spi_order_t;
+
+/* full-duplex exchange of one byte (MOSI -> returned MISO), NULL by default */
+typedef uint8_t (*host_spi_hook_t)(spi_inst_t *spi, uint8_t tx);
+__attribute__((weak)) host_spi_hook_t host_spi_hook = NULL;
+
+static inline uint8_t host_spi_exchange(spi_inst_t *spi, uint8_t tx) { return host_spi_hook ? host_spi_hook(spi, tx) : 0; }
+static inline spi_hw_t *spi_get_hw(spi_inst_t *spi) { return &spi->hw; }
+static inline uint spi_get_index(spi_inst_t *spi) { return spi->index; }
+/* same numbering as DREQ_SPI0_TX ... DREQ_SPI1_RX of the RP2040 */
+static inline uint spi_get_dreq(spi_inst_t *spi, bool is_tx) { return 16 + 2 * spi->index + (is_tx ? 0 : 1); }
+
+static inline uint spi_init(spi_inst_t *spi, uint baudrate) { (void) spi; return baudrate; }
+static inline void spi_set_format(spi_inst_t *spi, uint data_bits, spi_cpol_t cpol, spi_cpha_t cpha, spi_order_t order) { (void) spi; (void) data_bits; (void) cpol; (void) cpha; (void) order; }
+static inline bool spi_is_writable(spi_inst_t *spi) { (void) spi; return true; }
+static inline int spi_write_blocking(spi_inst_t *spi, const uint8_t *src, size_t len) {
+    for (size_t i = 0; i < len; i++) host_spi_exchange(spi, src[i]);
+    return (int) len;
+}
+static inline int spi_read_blocking(spi_inst_t *spi, uint8_t repeated_tx_data, uint8_t *dst, size_t len) {
+    for (size_t i = 0; i < len; i++) dst[i] = host_spi_exchange(spi, repeated_tx_data);
+    return (int) len;
+}
+static inline int spi_write_read_blocking(spi_inst_t *spi, const uint8_t *src, uint8_t *dst, size_t len) {
+    for (size_t i = 0; i < len; i++) dst[i] = host_spi_exchange(spi, src[i]);
+    return (int) len;
+}
+
+#endif
@@ -0,0 +1,37 @@
+/**
+ * Host stand-in for the Pico SDK: hardware/sync.h
+ */
+
+#ifndef HOST_HARDWARE_SYNC
+#define HOST_HARDWARE_SYNC
+
+#include "pico/stdlib.h"
+
+static inline void __dmb(void) { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+static inline void __wfi(void) {}
+static inline void __wfe(void) {}
+static inline void __sev(void) {}
+/* there are no interrupts on the host */
+static inline uint32_t save_and_disable_interrupts(void) { return 0; }
+static inline void restore_interrupts(uint32_t status) { (void) status; }
+
+/* hardware spin locks (busy waiting on an atomic flag) */
+typedef volatile uint32_t spin_lock_t;
+#define HOST_SPIN_LOCKS 32
+static spin_lock_t host_spin_locks[HOST_SPIN_LOCKS];
+static uint32_t host_spin_locks_claimed = 0;
+static inline int spin_lock_claim_unused(bool required) {
+    (void) required;
+    return host_spin_locks_claimed < HOST_SPIN_LOCKS ? (int) host_spin_locks_claimed++ : -1;
+}
+static inline spin_lock_t *spin_lock_instance(uint lock_num) { return &host_spin_locks[lock_num]; }
+static inline uint32_t spin_lock_blocking(spin_lock_t *lock) {
+    while (__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE)) {}
+    return 0;
+}
+static inline void spin_unlock(spin_lock_t *lock, uint32_t saved_irq) {
+    (void) saved_irq;
+    __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+#endif
@@ -0,0 +1,344 @@
+/**
+ * Host stand-in for the MSP430 side of the backup protocol
+ *
+ * See msp430_standin.h
+ *
+ */
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "hardware/irq.h"
+#include "packet_generation.h"
+#include "packet_pool.h"
+#include "fram_queue.h"
+#include "msp430_pio.h"
+#include "msp430_backup.h"
+#include "msp430_standin.h"
+#include "pio_emulator.h"
+
+#define STANDIN_TX_FIFO 4 // words (TX FIFO of the RP2040)
+
+static PIO standin_pio;
+static uint standin_ack, standin_ind;
+static bool ack = false, ind = false;
+static bool backup = false; // MODE at the start of the transaction
+static bool corrupt_next = false;
+static bool responding = true;
+
+// the PIO engine runs on the emulator, loaded from the instruction memory and the registers of its state machine
+static Pio_emulator engine;
+static bool engine_loaded = false;
+static uint engine_sm;
+static uint32_t engine_pins = 0;            // levels after the last instruction
+static uint8_t mosi_byte = 0, miso_byte = 0, bit_count = 0;
+
+// received bytes (MISO), read by the RX DMA
+static uint8_t rx_fifo[MSP430_PIO_MAX_BYTES];
+static uint16_t rx_head = 0, rx_count = 0;
+
+// FRAM: persistent queue, kept over msp430_standin_power_loss()
+static Fram_queue fram;
+static bool drop_next_commit = false;
+
+// frame of the current transaction
+static uint8_t frame[MSP430_RESTORE_HEADER_LEN + MSP430_MAX_SECTION + 2];
+static uint16_t frame_pos = 0, frame_len = 0;
+static uint16_t frame_consumed = 0; // restore: records popped by the commit (including skipped corrupted ones)
+
+// restore: build the frame with up to max_count packets once the first byte has been received
+static void standin_prepare_restore(uint8_t max_count){
+    uint16_t depth = fram_queue_depth(&fram);
+    uint16_t section = 0;
+    uint8_t n = 0;
+    uint16_t i = 0;
+    for(; i < depth && n < max_count; i++){
+        const Fram_record *r = fram_queue_peek(&fram, i);
+        if(r == NULL){
+            continue; // corrupted: skipped and popped
+        }
+        if(section + 3 + r->len > MSP430_MAX_SECTION){
+            break;
+        }
+        uint8_t *entry = &frame[MSP430_RESTORE_HEADER_LEN + section];
+        entry[0] = r->len;
+        entry[1] = r->seq & 0xFF;
+        entry[2] = r->seq >> 8;
+        memcpy(&entry[3], r->data, r->len);
+        section += 3 + r->len;
+        n++;
+    }
+    frame_consumed = i;
+    frame[1] = n;
+    frame[2] = section & 0xFF;
+    frame[3] = section >> 8;
+    frame[4] = (depth - i) & 0xFF;
+    frame[5] = (depth - i) >> 8;
+    uint16_t crc = crc16_update(0xFFFF, frame, MSP430_RESTORE_HEADER_LEN + section);
+    frame[MSP430_RESTORE_HEADER_LEN + section] = crc >> 8;
+    frame[MSP430_RESTORE_HEADER_LEN + section + 1] = crc & 0xFF;
+    frame_len = MSP430_RESTORE_HEADER_LEN + section + 2;
+    if(corrupt_next){
+        frame[frame_len / 2] ^= 0x10;
+        corrupt_next = false;
+    }
+}
+
+// backup: check the received frame and append the packets to the queue (all or nothing)
+static bool standin_store_backup(){
+    if(frame_pos < MSP430_HEADER_LEN + 2 || frame[0] != MSP430_MAGIC){
+        return false;
+    }
+    if(corrupt_next){
+        frame[frame_pos / 2] ^= 0x10;
+        corrupt_next = false;
+    }
+    uint16_t section = frame[2] | (frame[3] << 8);
+    if(frame_pos != MSP430_HEADER_LEN + section + 2){
+        return false;
+    }
+    uint16_t crc = crc16_update(0xFFFF, frame, MSP430_HEADER_LEN + section);
+    if(frame[MSP430_HEADER_LEN + section] != (crc >> 8) || frame[MSP430_HEADER_LEN + section + 1] != (crc & 0xFF)){
+        return false;
+    }
+    const uint8_t *data[255];
+    uint8_t lengths[255];
+    uint16_t offset = 0;
+    for(uint8_t i = 0; i < frame[1]; i++){
+        lengths[i] = frame[MSP430_HEADER_LEN + offset];
+        data[i] = &frame[MSP430_HEADER_LEN + offset + 1];
+        offset += 1 + lengths[i];
+        if(offset > section){
+            return false;
+        }
+    }
+    return offset == section && fram_queue_push(&fram, data, lengths, frame[1]);
+}
+
+// REQ edge with MODE = mode
+static void standin_req(bool req, bool mode){
+    if(req){ // start of a transaction
+        backup = mode;
+        frame_pos = 0;
+        frame_len = 0;
+        ack = true;
+    }else{   // end of a transaction
+        if(backup){
+            ind = standin_store_backup();
+        }else if(mode && !drop_next_commit){ // restore committed
+            fram_queue_pop(&fram, frame_consumed);
+        }
+        drop_next_commit = false;
+        ack = false;
+    }
+}
+
+static bool standin_gpio_get(uint gpio){
+    return (gpio == standin_ind) ? ind : false;
+}
+
+// next byte on MISO
+static uint8_t standin_out(){
+    if(!ack){
+        return 0xFF; // not selected
+    }
+    if(backup){
+        return 0;
+    }
+    if(frame_pos == 0){
+        return MSP430_MAGIC; // restore: sent before the requested count is known
+    }
+    return (frame_pos < frame_len) ? frame[frame_pos] : 0;
+}
+
+// byte received on MOSI
+static void standin_in(uint8_t rx){
+    if(!ack){
+        return;
+    }
+    if(backup){ // receive the frame
+        if(frame_pos < sizeof(frame)){
+            frame[frame_pos++] = rx;
+        }
+        return;
+    }
+    // restore: the first byte is the maximal count requested by the Pico
+    if(frame_pos == 0){
+        frame[0] = MSP430_MAGIC;
+        frame_pos++;
+        standin_prepare_restore(rx);
+    }else if(frame_pos < frame_len){
+        frame_pos++;
+    }
+}
+
+// input pins of the engine: ACK (WAIT) and MISO (IN)
+static bool standin_engine_in(void *context, uint8_t gpio){
+    (void) context;
+    if(gpio == standin_ack){
+        return ack;
+    }
+    if(gpio == engine.in_base){
+        if(bit_count == 0){
+            miso_byte = standin_out();
+        }
+        return (miso_byte >> (7 - bit_count)) & 1;
+    }
+    return false;
+}
+
+static void standin_load(PIO pio, uint sm){
+    const pio_sm_hw_t *regs = &pio->sm[sm];
+    uint8_t push_threshold = (regs->shiftctrl >> 20) & 0x1F;
+    pio_emulator_init(&engine, pio->instr_mem, 32, (regs->pinctrl >> 29) > 0);
+    pio_emulator_wrap(&engine, (regs->execctrl >> 7) & 0x1F, (regs->execctrl >> 12) & 0x1F);
+    pio_emulator_config(&engine, (regs->pinctrl >> 5) & 0x1F, (regs->pinctrl >> 26) & 0x07, regs->pinctrl & 0x1F, (regs->pinctrl >> 20) & 0x3F,
+        (regs->pinctrl >> 15) & 0x1F, (regs->pinctrl >> 10) & 0x1F, regs->shiftctrl & (1u << 17),
+        (regs->shiftctrl & (1u << 16)) ? (push_threshold ? push_threshold : 32) : 0);
+    engine.pc = regs->addr;
+    engine.gpio_get = standin_engine_in;
+    engine_pins = 0;
+    engine_sm = sm;
+    engine_loaded = true;
+}
+
+// the MSP430 reacts immediately to the pins of the engine: REQ (with MODE) and the rising edge of SCK (MOSI)
+static void standin_react(){
+    uint32_t changed = engine.gpio ^ engine_pins;
+    engine_pins = engine.gpio;
+    uint8_t req = engine.set_base + 1;
+    if(changed & (1u << req)){
+        bool level = engine_pins & (1u << req);
+        if(level ? responding : ack){
+            bit_count = 0;
+            standin_req(level, engine_pins & (1u << engine.set_base));
+        }
+    }
+    if((changed & engine_pins) & (1u << engine.sideset_base)){
+        mosi_byte = (mosi_byte << 1) | ((engine_pins >> engine.out_base) & 1);
+        if(++bit_count == 8){
+            standin_in(mosi_byte);
+            bit_count = 0;
+        }
+    }
+    uint32_t word;
+    while(pio_emulator_get(&engine, &word)){
+        if(rx_count < sizeof(rx_fifo)){
+            rx_fifo[(rx_head + rx_count++) % sizeof(rx_fifo)] = word;
+        }
+    }
+    if(engine.irq & 1){
+        engine.irq &= ~1;
+        host_irq_raise((standin_pio == pio0) ? PIO0_IRQ_0 : PIO1_IRQ_0);
+    }
+}
+
+/*
+ * one word of the TX FIFO of the PIO engine: as with the DMA on the target, the FIFO is kept full,
+ * i.e. the engine only runs while it is full (the rest runs after the last word of the transfer)
+ */
+static void standin_pio_tx(PIO pio, uint sm, uint32_t word){
+    if(pio != standin_pio){
+        return;
+    }
+    if(!engine_loaded){
+        standin_load(pio, sm);
+    }
+    if(sm != engine_sm){
+        return;
+    }
+    pio_emulator_put(&engine, word);
+    while(engine.fifo_len - engine.fifo_pos >= STANDIN_TX_FIFO && pio_emulator_step(&engine) > 0){
+        standin_react();
+    }
+}
+
+// the rest of the stream after the last word, until the engine stalls
+static void standin_run(){
+    while(pio_emulator_step(&engine) > 0){
+        standin_react();
+    }
+}
+
+// abort of the engine (msp430_pio_wait() timeout) and the end of the DMA transfer
+static void standin_pio_ctrl(PIO pio, uint sm, enum host_pio_ctrl ctrl, uint instr){
+    if(pio != standin_pio || !engine_loaded || sm != engine_sm){
+        return;
+    }
+    switch(ctrl){
+        case HOST_PIO_RESTART:
+            pio_emulator_restart(&engine);
+            break;
+        case HOST_PIO_CLEAR_FIFOS:
+            pio_emulator_clear_fifos(&engine);
+            rx_head = rx_count = 0;
+            break;
+        case HOST_PIO_EXEC:
+            pio_emulator_exec(&engine, instr);
+            standin_react();
+            break;
+        case HOST_PIO_DMA_TX_DONE:
+            standin_run();
+            break;
+    }
+}
+
+static uint32_t standin_pio_rx(PIO pio, uint sm){
+    (void) sm;
+    if(pio != standin_pio || rx_count == 0){
+        return 0;
+    }
+    uint8_t in = rx_fifo[rx_head];
+    rx_head = (rx_head + 1) % sizeof(rx_fifo);
+    rx_count--;
+    return in;
+}
+
+void msp430_standin_init(PIO pio, uint pin_ack, uint pin_ind){
+    standin_pio = pio;
+    standin_ack = pin_ack;
+    standin_ind = pin_ind;
+    ack = ind = backup = false;
+    corrupt_next = false;
+    responding = true;
+    engine_loaded = false;
+    bit_count = 0;
+    rx_head = rx_count = 0;
+    drop_next_commit = false;
+    memset(&fram, 0, sizeof(fram));
+    fram_queue_mount(&fram);
+    host_gpio_get_hook = standin_gpio_get;
+    host_pio_tx_hook = standin_pio_tx;
+    host_pio_rx_hook = standin_pio_rx;
+    host_pio_ctrl_hook = standin_pio_ctrl;
+}
+
+uint16_t msp430_standin_stored(){
+    return fram_queue_depth(&fram);
+}
+
+void msp430_standin_corrupt_next(){
+    corrupt_next = true;
+}
+
+void msp430_standin_drop_next_commit(){
+    drop_next_commit = true;
+}
+
+void msp430_standin_corrupt_record(uint16_t i){
+    Fram_record *r = (Fram_record *) fram_queue_peek(&fram, i);
+    if(r != NULL){
+        r->data[0] ^= 0x01;
+    }
+}
+
+void msp430_standin_power_loss(){
+    ack = ind = backup = false;
+    drop_next_commit = false;
+    bit_count = 0;
+    fram_queue_mount(&fram);
+}
+
+void msp430_standin_respond(bool enabled){
+    responding = enabled;
+}
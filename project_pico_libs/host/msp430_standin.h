@@ -0,0 +1,40 @@
+/**
+ * Host stand-in for the MSP430 side of the backup protocol (see msp430_backup.h)
+ *
+ * Simulates the MSP430 behind the PIO handshake engine (msp430_pio.h): the program loaded by msp430_pio_init() runs
+ * on the PIO emulator of the simulator (simulator/pio_emulator.h) for every word of the PIO TX hook, the MSP430
+ * answers REQ with ACK and exchanges the SPI bytes on the pins of the emulator. The received bytes are returned
+ * by the RX hook, the PIO interrupt is raised by the IRQ instruction and the abort is seen through the control hook.
+ * IND is read through the GPIO hook.
+ * The MSP430 reacts immediately, the FRAM holds the persistent queue of fram_queue.h.
+ *
+ */
+
+#ifndef HOST_MSP430_STANDIN
+#define HOST_MSP430_STANDIN
+
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+
+// installs the GPIO and PIO hooks for the engine on pio (before msp430_backup_init()), the FRAM is empty afterwards
+void msp430_standin_init(PIO pio, uint pin_ack, uint pin_ind);
+
+// number of packets stored in the FRAM
+uint16_t msp430_standin_stored();
+
+// the MSP430 restarts: only the FRAM is kept
+void msp430_standin_power_loss();
+
+// the next restore commit is lost (the packets stay in the queue)
+void msp430_standin_drop_next_commit();
+
+// flip one bit of the i-th oldest record in the FRAM
+void msp430_standin_corrupt_record(uint16_t i);
+
+// flip one bit of the next frame (received or sent), to test the CRC handling
+void msp430_standin_corrupt_next();
+
+// enabled = false: the MSP430 never raises ACK (e.g. its supply is down), to test the timeout handling
+void msp430_standin_respond(bool enabled);
+
+#endif
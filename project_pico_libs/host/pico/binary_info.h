@@ -0,0 +1,14 @@
+/**
+ * Host stand-in for the Pico SDK: pico/binary_info.h
+ */
+
+#ifndef HOST_PICO_BINARY_INFO
+#define HOST_PICO_BINARY_INFO
+
+#define bi_decl(...)
+#define bi_1pin_with_name(...)
+#define bi_3pins_with_func(...)
+#define bi_program_name(...)
+#define bi_program_description(...)
+
+#endif
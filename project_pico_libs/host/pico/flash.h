@@ -0,0 +1,21 @@
+/**
+ * Host stand-in for the Pico SDK: pico/flash.h (nothing runs from the flash, the function is called directly)
+ */
+
+#ifndef HOST_PICO_FLASH
+#define HOST_PICO_FLASH
+
+#include "pico/stdlib.h"
+
+#ifndef PICO_OK
+#define PICO_OK 0
+#endif
+
+static inline bool flash_safe_execute_core_init(void) { return true; }
+static inline int flash_safe_execute(void (*func)(void *), void *param, uint32_t enter_exit_timeout_ms) {
+    (void) enter_exit_timeout_ms;
+    func(param);
+    return PICO_OK;
+}
+
+#endif
@@ -0,0 +1,20 @@
+/**
+ * Host stand-in for the Pico SDK: pico/multicore.h (core 1 is a thread)
+ */
+
+#ifndef HOST_PICO_MULTICORE
+#define HOST_PICO_MULTICORE
+
+#include <pthread.h>
+
+static inline void *host_core1_entry(void *entry) {
+    ((void (*)(void)) entry)();
+    return NULL;
+}
+static inline void multicore_launch_core1(void (*entry)(void)) {
+    pthread_t core1;
+    pthread_create(&core1, NULL, host_core1_entry, (void *) entry);
+    pthread_detach(core1);
+}
+
+#endif
@@ -0,0 +1,73 @@
+/**
+ * Host stand-in for the Pico SDK: pico/stdlib.h
+ */
+
+#ifndef HOST_PICO_STDLIB
+#define HOST_PICO_STDLIB
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sched.h>
+
+#ifndef PICO_ON_DEVICE
+#define PICO_ON_DEVICE 0
+#endif
+
+typedef unsigned int uint;
+typedef uint64_t absolute_time_t;
+
+static inline absolute_time_t get_absolute_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t) ts.tv_sec) * 1000000 + ts.tv_nsec / 1000;
+}
+static inline uint64_t to_us_since_boot(absolute_time_t t) { return t; }
+static inline absolute_time_t from_us_since_boot(uint64_t us) { return us; }
+static inline uint64_t time_us_64(void) { return get_absolute_time(); }
+static inline uint32_t time_us_32(void) { return (uint32_t) get_absolute_time(); }
+static inline absolute_time_t delayed_by_ms(absolute_time_t t, uint32_t ms) { return t + 1000 * (uint64_t) ms; }
+static inline absolute_time_t delayed_by_us(absolute_time_t t, uint64_t us) { return t + us; }
+static inline absolute_time_t make_timeout_time_us(uint64_t us) { return get_absolute_time() + us; }
+static inline int64_t absolute_time_diff_us(absolute_time_t from, absolute_time_t to) { return (int64_t) (to - from); }
+
+/* sleeps return immediately, busy waits yield to the other "core" (see pico/multicore.h) */
+static inline void sleep_ms(uint32_t ms) { (void) ms; }
+static inline void sleep_us(uint64_t us) { (void) us; sched_yield(); }
+static inline void tight_loop_contents(void) { sched_yield(); }
+/* there are no events on the host: returns true once the timeout has been reached */
+static inline bool best_effort_wfe_or_timeout(absolute_time_t timeout_timestamp) { sched_yield(); return get_absolute_time() >= timeout_timestamp; }
+
+static inline bool stdio_init_all(void) { return true; }
+static inline bool stdio_usb_connected(void) { return true; }
+static inline int putchar_raw(int c) { return putchar(c); }
+#define PICO_ERROR_TIMEOUT (-1)
+static inline int getchar_timeout_us(uint32_t timeout_us) { (void) timeout_us; return PICO_ERROR_TIMEOUT; }
+
+/* GPIO */
+#define GPIO_OUT 1
+#define GPIO_IN  0
+#define GPIO_IRQ_LEVEL_LOW   0x1u
+#define GPIO_IRQ_LEVEL_HIGH  0x2u
+#define GPIO_IRQ_EDGE_FALL   0x4u
+#define GPIO_IRQ_EDGE_RISE   0x8u
+enum gpio_function { GPIO_FUNC_SPI = 1, GPIO_FUNC_UART = 2, GPIO_FUNC_PIO0 = 6, GPIO_FUNC_PIO1 = 7, GPIO_FUNC_NULL = 0x1f };
+typedef void (*gpio_irq_callback_t)(uint gpio, uint32_t event_mask);
+static inline void gpio_init(uint gpio) { (void) gpio; }
+static inline void gpio_set_dir(uint gpio, bool out) { (void) gpio; (void) out; }
+/* outputs can be observed and inputs driven with hooks (e.g. a simulated peripheral), NULL by default */
+typedef void (*host_gpio_put_hook_t)(uint gpio, bool value);
+typedef bool (*host_gpio_get_hook_t)(uint gpio);
+__attribute__((weak)) host_gpio_put_hook_t host_gpio_put_hook = NULL;
+__attribute__((weak)) host_gpio_get_hook_t host_gpio_get_hook = NULL;
+static inline void gpio_put(uint gpio, bool value) { if (host_gpio_put_hook) host_gpio_put_hook(gpio, value); }
+static inline bool gpio_get(uint gpio) { return host_gpio_get_hook ? host_gpio_get_hook(gpio) : false; }
+static inline void gpio_pull_down(uint gpio) { (void) gpio; }
+static inline void gpio_pull_up(uint gpio) { (void) gpio; }
+static inline void gpio_set_function(uint gpio, enum gpio_function fn) { (void) gpio; (void) fn; }
+static inline void gpio_set_irq_enabled_with_callback(uint gpio, uint32_t events, bool enabled, gpio_irq_callback_t callback) { (void) gpio; (void) events; (void) enabled; (void) callback; }
+
+#endif
@@ -0,0 +1,49 @@
+/**
+ * Host stand-in for the Pico SDK: pico/util/queue.h (not thread safe)
+ */
+
+#ifndef HOST_PICO_QUEUE
+#define HOST_PICO_QUEUE
+
+#include <string.h>
+#include "pico/stdlib.h"
+
+typedef struct {
+    uint8_t *data;
+    uint element_size;
+    uint element_count;
+    uint rptr;
+    uint wptr;
+} queue_t;
+
+static inline void queue_init(queue_t *q, uint element_size, uint element_count) {
+    q->data = calloc(element_count + 1, element_size);
+    q->element_size = element_size;
+    q->element_count = element_count;
+    q->rptr = 0;
+    q->wptr = 0;
+}
+static inline bool queue_try_add(queue_t *q, const void *data) {
+    uint next = (q->wptr + 1) % (q->element_count + 1);
+    if (next == q->rptr) {
+        return false;
+    }
+    memcpy(q->data + q->wptr * q->element_size, data, q->element_size);
+    q->wptr = next;
+    return true;
+}
+static inline bool queue_is_empty(queue_t *q) {
+    return q->rptr == q->wptr;
+}
+static inline bool queue_try_remove(queue_t *q, void *data) {
+    if (q->rptr == q->wptr) {
+        return false;
+    }
+    if (data) {
+        memcpy(data, q->data + q->rptr * q->element_size, q->element_size);
+    }
+    q->rptr = (q->rptr + 1) % (q->element_count + 1);
+    return true;
+}
+
+#endif
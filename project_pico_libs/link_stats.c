@@ -0,0 +1,143 @@
+/**
+ * Streaming link statistics
+ *
+ * See link_stats.h
+ *
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdio.h>
+#include "packet_generation.h"
+#include "link_stats.h"
+
+#define LINK_STATS_MAX_DATA 64
+
+static uint8_t popcount8(uint8_t x) {
+    x = x - ((x >> 1) & 0x55);
+    x = (x & 0x33) + ((x >> 2) & 0x33);
+    return (x + (x >> 4)) & 0x0F;
+}
+
+static void counters_add(Link_stats_counters *c, const struct link_stats_packet *p, int32_t sign) {
+    c->received      += sign;
+    c->crc_ok        += sign * (p->crc_ok ? 1 : 0);
+    c->lost          += sign * p->lost;
+    c->bit_errors    += sign * p->bit_errors;
+    c->bits          += sign * p->bits;
+    c->goodput_bytes += sign * p->goodput_bytes;
+}
+
+void link_stats_init(Link_stats *stats) {
+    memset(stats, 0, sizeof(Link_stats));
+}
+
+void link_stats_update(Link_stats *stats, const uint8_t *packet, uint8_t len, uint8_t payloadsize, bool overflowed, bool crc_ok, int32_t rssi, uint8_t lqi, uint64_t time_us) {
+    if (overflowed || len < 4) {
+        stats->overflowed++; // no usable seq number or file position
+        stats->last_usable = false;
+        return;
+    }
+    struct link_stats_packet p = {.time_us = time_us, .crc_ok = crc_ok, .rssi = (int8_t) rssi};
+
+    /* packet loss from sequence gaps */
+    uint8_t seq = packet[1];
+    if (stats->started) {
+        int8_t ahead = (int8_t) (seq - stats->last_seq);
+        p.lost = (ahead > 0) ? (uint8_t) (ahead - 1) : 0; // older seq: retransmission (see arq.h), counted as lost before
+        stats->last_seq = (ahead > 0) ? seq : stats->last_seq;
+    } else {
+        stats->started = true;
+        stats->first_us = time_us;
+        stats->last_seq = seq;
+    }
+    stats->last_us = time_us;
+
+    /* bit errors against the regenerated payload (as compute_ber() in stats/functions.py:
+     * errors are counted in the samples, the bits include the 2B file position) */
+    uint8_t data_len = min(min(len, 2 + payloadsize) - 4, LINK_STATS_MAX_DATA) & 0xFE;
+    uint8_t expected[LINK_STATS_MAX_DATA];
+    uint16_t position = (((uint16_t) packet[2]) << 8) | packet[3];
+    uint8_t sample_bytes = data_len;
+    if (stats->compressed) {
+        /* the stream is regenerated for the received length (frames may be shorter, see aggregator.h) */
+        data_len = min(min(len, 2 + payloadsize) - 4, LINK_STATS_MAX_DATA);
+        sample_bytes = 2 * expected_compressed(expected, data_len, position);
+    } else {
+        expected_data(expected, data_len, position);
+    }
+    for (uint8_t i = 0; i < data_len; i++) {
+        p.bit_errors += popcount8(packet[4+i] ^ expected[i]);
+    }
+    p.bits = 8 * (2 + data_len);
+    p.goodput_bytes = crc_ok ? sample_bytes : 0;
+
+    /* histograms */
+    int32_t rssi_bin = (rssi - LINK_STATS_RSSI_MIN) / LINK_STATS_RSSI_STEP;
+    stats->rssi_hist[max(0, min(rssi_bin, LINK_STATS_RSSI_BINS-1))]++;
+    stats->lqi_hist[min(lqi / LINK_STATS_LQI_STEP, LINK_STATS_LQI_BINS-1)]++;
+
+    /* sliding window: replace the oldest packet */
+    struct link_stats_packet *slot = &stats->packets[stats->next & (LINK_STATS_WINDOW-1)];
+    if (stats->next >= LINK_STATS_WINDOW) {
+        counters_add(&stats->window, slot, -1);
+        stats->rssi_sum -= slot->rssi;
+    }
+    *slot = p;
+    counters_add(&stats->window, slot, 1);
+    stats->rssi_sum += slot->rssi;
+    counters_add(&stats->total, slot, 1);
+    stats->next++;
+    stats->last_usable = true;
+}
+
+const struct link_stats_packet *link_stats_last(const Link_stats *stats) {
+    return stats->last_usable ? &stats->packets[(stats->next - 1) & (LINK_STATS_WINDOW-1)] : NULL;
+}
+
+static uint32_t ppm(uint32_t part, uint32_t total) {
+    return (total == 0) ? 0 : (uint32_t) ((((uint64_t) part) * 1000000) / total);
+}
+
+void link_stats_summary(const Link_stats *stats, Link_summary *summary) {
+    const Link_stats_counters *w = &stats->window;
+    const Link_stats_counters *t = &stats->total;
+    summary->received    = t->received;
+    summary->lost        = t->lost;
+    summary->crc_errors  = t->received - t->crc_ok;
+    summary->overflowed  = stats->overflowed;
+    summary->ber_ppm     = ppm(w->bit_errors, w->bits);
+    summary->per_ppm     = ppm(w->lost + w->received - w->crc_ok, w->received + w->lost);
+    summary->ber_total_ppm = ppm(t->bit_errors, t->bits);
+    summary->per_total_ppm = ppm(t->lost + t->received - t->crc_ok, t->received + t->lost);
+    summary->rssi_mean   = (w->received == 0) ? 0 : stats->rssi_sum / (int32_t) w->received;
+
+    /* goodput over the time span of the window */
+    summary->goodput_bps = 0;
+    if (w->received > 1) {
+        uint32_t oldest = (stats->next >= LINK_STATS_WINDOW) ? stats->next : 0;
+        uint64_t span_us = stats->last_us - stats->packets[oldest & (LINK_STATS_WINDOW-1)].time_us;
+        if (span_us > 0) {
+            summary->goodput_bps = (uint32_t) ((((uint64_t) w->goodput_bytes) * 8 * 1000000) / span_us);
+        }
+    }
+}
+
+void link_stats_print(const Link_stats *stats) {
+    Link_summary summary;
+    link_stats_summary(stats, &summary);
+    printf("stats: received %u | lost %u | CRC error %u | overflow %u\n", summary.received, summary.lost, summary.crc_errors, summary.overflowed);
+    printf("stats: window BER %u ppm | PER %u ppm | goodput %u bit/s | RSSI %d dBm\n", summary.ber_ppm, summary.per_ppm, summary.goodput_bps, summary.rssi_mean);
+    printf("stats: total  BER %u ppm | PER %u ppm\n", summary.ber_total_ppm, summary.per_total_ppm);
+    for (uint8_t i = 0; i < LINK_STATS_RSSI_BINS; i++) {
+        if (stats->rssi_hist[i] > 0) {
+            printf("stats: RSSI [%d, %d) dBm: %u\n", LINK_STATS_RSSI_MIN + i*LINK_STATS_RSSI_STEP, LINK_STATS_RSSI_MIN + (i+1)*LINK_STATS_RSSI_STEP, stats->rssi_hist[i]);
+        }
+    }
+    for (uint8_t i = 0; i < LINK_STATS_LQI_BINS; i++) {
+        if (stats->lqi_hist[i] > 0) {
+            printf("stats: LQI [%u, %u): %u\n", i*LINK_STATS_LQI_STEP, (i+1)*LINK_STATS_LQI_STEP, stats->lqi_hist[i]);
+        }
+    }
+}
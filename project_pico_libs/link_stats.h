@@ -0,0 +1,104 @@
+/**
+ * Streaming link statistics
+ *
+ * The receiver regenerates the expected payload from the embedded file position (pseudo sequence)
+ * using the same generator as the tag (see expected_data() in packet_generation.c) and keeps
+ * incremental counters instead of logging every packet:
+ *  - bit errors (BER) and packet errors (PER, including losses detected from sequence gaps)
+ *  - RSSI and LQI histograms
+ *  - goodput (payload bytes of packets passing the CRC)
+ * With compressed set, the payload is a compressed stream (see generate_compressed()): the bit errors are
+ * counted in the stream and the goodput is the size of the decoded samples.
+ * Window values are computed over the last LINK_STATS_WINDOW received packets.
+ *
+ * Received packet layout (RX FIFO): 1B length, 1B seq, 2B file position, samples
+ *
+ */
+
+#ifndef LINK_STATS_LIB
+#define LINK_STATS_LIB
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "packet_generation.h"
+
+#define LINK_STATS_WINDOW        64 // packets per sliding window, has to be a power of two
+#define LINK_STATS_RSSI_MIN    -110 // lower edge of the first RSSI bin [dBm]
+#define LINK_STATS_RSSI_STEP      4 // RSSI bin width [dB]
+#define LINK_STATS_RSSI_BINS     20
+#define LINK_STATS_LQI_STEP      16 // LQI bin width (LQI is 7 bit)
+#define LINK_STATS_LQI_BINS       8
+
+struct link_stats_packet {
+    uint64_t time_us;
+    uint16_t bit_errors;
+    uint16_t bits;
+    uint8_t lost;           // packets missing before this one (sequence gap)
+    uint8_t goodput_bytes;  // payload bytes if the CRC passed
+    int8_t rssi;
+    bool crc_ok;
+};
+
+struct link_stats_counters {
+    uint32_t received;
+    uint32_t crc_ok;
+    uint32_t lost;
+    uint32_t bit_errors;
+    uint32_t bits;
+    uint32_t goodput_bytes;
+};
+typedef struct link_stats_counters Link_stats_counters;
+
+struct link_stats {
+    bool started;
+    uint8_t last_seq;       // highest so far
+    uint32_t overflowed;
+    uint64_t first_us;
+    uint64_t last_us;
+    Link_stats_counters total;
+    Link_stats_counters window;
+    struct link_stats_packet packets[LINK_STATS_WINDOW];
+    uint32_t next;          // position of the next packet in the window
+    bool last_usable;       // the last update added a packet
+    bool compressed;        // payloads of generate_compressed(), set after link_stats_init()
+    uint32_t rssi_hist[LINK_STATS_RSSI_BINS];
+    uint32_t lqi_hist[LINK_STATS_LQI_BINS];
+    int32_t rssi_sum;       // over the window
+};
+typedef struct link_stats Link_stats;
+
+/* derived values (integer only, ppm = parts per million) */
+struct link_summary {
+    uint32_t received;
+    uint32_t lost;
+    uint32_t crc_errors;
+    uint32_t overflowed;
+    uint32_t ber_ppm;         // window
+    uint32_t per_ppm;         // window, (lost + CRC errors) / (received + lost)
+    uint32_t goodput_bps;     // window [bit/s]
+    int32_t rssi_mean;        // window [dBm]
+    uint32_t ber_total_ppm;
+    uint32_t per_total_ppm;
+};
+typedef struct link_summary Link_summary;
+
+void link_stats_init(Link_stats *stats);
+
+/*
+ * update the statistics with one received packet
+ * packet: RX FIFO content (starting with the length byte), len: number of valid bytes
+ * payloadsize: payload bytes after the seq number (including the 2B file position), the maximum if the frame
+ *              length varies (shorter frames are evaluated as received)
+ */
+void link_stats_update(Link_stats *stats, const uint8_t *packet, uint8_t len, uint8_t payloadsize, bool overflowed, bool crc_ok, int32_t rssi, uint8_t lqi, uint64_t time_us);
+
+void link_stats_summary(const Link_stats *stats, Link_summary *summary);
+
+// the packet of the last link_stats_update() (NULL if it was not usable)
+const struct link_stats_packet *link_stats_last(const Link_stats *stats);
+
+// print the summary and the non-empty histogram bins to stdout
+void link_stats_print(const Link_stats *stats);
+
+#endif
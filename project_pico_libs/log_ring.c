@@ -0,0 +1,161 @@
+/**
+ * Deferred logging ring
+ *
+ * Producers copy records into a fixed RAM ring, a single consumer formats and prints them.
+ * See log_ring.h
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "pico/flash.h"
+#include "hardware/sync.h"
+#include "receiver_CC2500.h"
+#include "packet_log.h"
+#include "log_ring.h"
+#include "trace.h"
+
+static Log_entry log_ring[LOG_RING_LENGTH];
+static volatile uint32_t log_head = 0;    // next slot to be written (producers)
+static volatile uint32_t log_tail = 0;    // next slot to be printed (consumer)
+static volatile uint32_t log_dropped = 0;
+static uint32_t log_dropped_reported = 0;
+static bool log_binary_packets = false;
+static spin_lock_t *log_lock = NULL;
+
+void log_ring_init(bool binary_packets){
+    if(log_lock == NULL){
+        log_lock = spin_lock_instance(spin_lock_claim_unused(true));
+    }
+    log_binary_packets = binary_packets;
+    log_head = 0;
+    log_tail = 0;
+    log_dropped = 0;
+    log_dropped_reported = 0;
+}
+
+/*
+ * reserve the next slot; the spin lock (with interrupts disabled) is held until log_ring_commit() such that
+ * neither an ISR on the same core nor a producer on the other core can interleave
+ * returns NULL if the ring is full
+ */
+static Log_entry *log_ring_reserve(uint32_t *irq_state){
+    *irq_state = spin_lock_blocking(log_lock);
+    if(log_head - log_tail >= LOG_RING_LENGTH){
+        log_dropped++;
+        spin_unlock(log_lock, *irq_state);
+        return NULL;
+    }
+    Log_entry *entry = &log_ring[log_head & (LOG_RING_LENGTH-1)];
+    entry->time_us = to_us_since_boot(get_absolute_time());
+    return entry;
+}
+
+static void log_ring_commit(uint32_t irq_state){
+    __dmb(); // record has to be visible to the other core before the head moves
+    log_head++;
+    spin_unlock(log_lock, irq_state);
+}
+
+bool log_ring_text(const char *fmt, const int32_t *args){
+    uint32_t irq_state;
+    Log_entry *entry = log_ring_reserve(&irq_state);
+    if(entry == NULL){
+        return false;
+    }
+    entry->type = log_entry_text;
+    entry->text.fmt = fmt;
+    memcpy(entry->text.args, args, sizeof(entry->text.args));
+    log_ring_commit(irq_state);
+    return true;
+}
+
+bool log_ring_packet(uint8_t *packet, Packet_status status, uint64_t time_us){
+    uint32_t irq_state;
+    Log_entry *entry = log_ring_reserve(&irq_state);
+    if(entry == NULL){
+        return false;
+    }
+    entry->type = log_entry_packet;
+    entry->time_us = time_us;
+    entry->packet.status = status;
+    if(!status.overflowed){
+        memcpy(entry->packet.data, packet, min(status.len, RX_BUFFER_SIZE));
+    }
+    log_ring_commit(irq_state);
+    return true;
+}
+
+bool log_ring_bytes(const char *label, const uint8_t *data, size_t len){
+    uint32_t irq_state;
+    Log_entry *entry = log_ring_reserve(&irq_state);
+    if(entry == NULL){
+        return false;
+    }
+    entry->type = log_entry_bytes;
+    entry->len = min(len, LOG_BYTES_LEN);
+    entry->bytes.label = label;
+    memcpy(entry->bytes.data, data, entry->len);
+    log_ring_commit(irq_state);
+    return true;
+}
+
+static void log_entry_print(Log_entry *entry){
+    switch(entry->type){
+        case log_entry_text:
+            printf(entry->text.fmt, entry->text.args[0], entry->text.args[1], entry->text.args[2], entry->text.args[3]);
+        break;
+        case log_entry_packet:
+            trace_begin(trace_print_packet, entry->packet.status.len);
+            if(log_binary_packets){
+                logPacket(entry->packet.data, entry->packet.status, entry->time_us);
+            }else{
+                printPacket(entry->packet.data, entry->packet.status, entry->time_us);
+            }
+            trace_end(trace_print_packet, entry->packet.status.len);
+        break;
+        case log_entry_bytes:
+            printf("%s", entry->bytes.label);
+            for(uint8_t i = 0; i < entry->len; i++){
+                printf("%02x ", entry->bytes.data[i]);
+            }
+            printf("\n");
+        break;
+    }
+}
+
+uint32_t log_ring_drain(uint32_t max_entries){
+    uint32_t printed = 0;
+    while(printed < max_entries && log_tail != log_head){
+        __dmb(); // read the record only after observing the head
+        log_entry_print(&log_ring[log_tail & (LOG_RING_LENGTH-1)]);
+        __dmb();
+        log_tail++;
+        printed++;
+    }
+    uint32_t dropped = log_dropped;
+    if(dropped != log_dropped_reported){
+        printf("log: %u records dropped (ring full)\n", dropped - log_dropped_reported);
+        log_dropped_reported = dropped;
+    }
+    return printed;
+}
+
+uint32_t log_ring_dropped(){
+    return log_dropped;
+}
+
+static void log_ring_core1_entry(){
+    flash_safe_execute_core_init(); // core 0 may write the flash (see boot_flash.h)
+    while(true){
+        if(log_ring_drain(LOG_RING_LENGTH) == 0){
+            sleep_us(100);
+        }
+    }
+}
+
+void log_ring_launch_core1(){
+    multicore_launch_core1(log_ring_core1_entry);
+}
@@ -0,0 +1,81 @@
+/**
+ * Deferred logging ring
+ *
+ * printf() over USB stdio blocks (up to the USB stdout timeout) whenever the host does not read fast
+ * enough. To keep the TX/RX timing independent of the host terminal, log records are only copied into a
+ * fixed RAM ring by the producers. Formatting and the USB transfer happen later in log_ring_drain(),
+ * which is either called by the second core (log_ring_launch_core1) or at idle time.
+ *
+ * - producers (threads and ISRs on both cores) write in constant time and only wait for each other
+ * - if the ring is full, the record is dropped and counted (see log_ring_dropped)
+ * - there must be a single consumer calling log_ring_drain()
+ *
+ */
+
+#ifndef LOG_RING_LIB
+#define LOG_RING_LIB
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "receiver_CC2500.h"
+
+#define LOG_RING_LENGTH         32 // number of records, has to be a power of two
+#define LOG_TEXT_ARGS            4 // maximal number of integer arguments per text record
+#define LOG_BYTES_LEN           48 // byte dumps are truncated to this length
+
+typedef enum _log_entry_type_t{
+    log_entry_text   = 0,
+    log_entry_packet = 1,
+    log_entry_bytes  = 2
+} log_entry_type_t;
+
+struct log_entry {
+    uint8_t type;
+    uint8_t len;
+    uint64_t time_us;
+    union {
+        struct {
+            const char *fmt;
+            int32_t args[LOG_TEXT_ARGS];
+        } text;
+        struct {
+            Packet_status status;
+            uint8_t data[RX_BUFFER_SIZE];
+        } packet;
+        struct {
+            const char *label;
+            uint8_t data[LOG_BYTES_LEN];
+        } bytes;
+    };
+};
+typedef struct log_entry Log_entry;
+
+/*
+ * binary_packets: drain packet records with logPacket() instead of printPacket()
+ */
+void log_ring_init(bool binary_packets);
+
+/*
+ * deferred printf with up to LOG_TEXT_ARGS integer arguments (%d, %u, %x, %c)
+ * fmt has to stay valid until drained, i.e. use string literals only
+ */
+#define log_printf(fmt, ...) log_ring_text(fmt, (const int32_t[LOG_TEXT_ARGS]){__VA_ARGS__})
+bool log_ring_text(const char *fmt, const int32_t *args);
+
+// deferred printPacket()/logPacket()
+bool log_ring_packet(uint8_t *packet, Packet_status status, uint64_t time_us);
+
+// deferred hex dump of up to LOG_BYTES_LEN bytes
+bool log_ring_bytes(const char *label, const uint8_t *data, size_t len);
+
+// format and print up to max_entries records, returns the number of printed records
+uint32_t log_ring_drain(uint32_t max_entries);
+
+// number of records dropped since boot-up because the ring was full
+uint32_t log_ring_dropped();
+
+// drain the ring continuously on the second core
+void log_ring_launch_core1();
+
+#endif
@@ -0,0 +1,172 @@
+/**
+ * Bulk backup/restore of packets on the MSP430 (FRAM) over SPI
+ *
+ * See msp430_backup.h
+ *
+ */
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "packet_generation.h"
+#include "msp430_pio.h"
+#include "msp430_backup.h"
+
+static uint32_t msp430_baudrate;
+static uint msp430_ind;
+static uint8_t msp430_frame[MSP430_RESTORE_HEADER_LEN + MSP430_MAX_SECTION + 2];
+static int16_t msp430_depth = -1;       // records in the queue, -1: unknown
+static bool msp430_delivered = false;   // msp430_next_seq is valid
+static uint16_t msp430_next_seq;        // sequence number after the last restored packet
+
+bool msp430_backup_init(PIO pio, uint32_t baudrate, uint pin_sck, uint pin_mosi, uint pin_miso, uint pin_req, uint pin_ack, uint pin_mode, uint pin_ind){
+    msp430_baudrate = baudrate;
+    msp430_ind = pin_ind;
+    msp430_depth = -1;
+    msp430_delivered = false;
+    return msp430_pio_init(pio, baudrate, pin_sck, pin_mosi, pin_miso, pin_mode, pin_req, pin_ack);
+}
+
+uint32_t msp430_transfer_time_us(uint16_t packet_bytes){
+    uint32_t bytes = MSP430_HEADER_LEN + packet_bytes + 2;
+    return MSP430_HANDSHAKE_US + (uint32_t) (((uint64_t) bytes * 8 * 1000000 + msp430_baudrate - 1) / msp430_baudrate);
+}
+
+// post the transfer to the PIO engine and sleep until it is done, false on timeout (REQ is released then)
+static bool msp430_transfer(bool start, bool mode, const uint8_t *tx, uint8_t *rx, uint16_t len, bool end, bool commit){
+    Msp430_transfer transfer = {start, mode, tx, rx, len, end, commit};
+    msp430_pio_post(&transfer);
+    uint32_t clocking_us = (uint32_t) (((uint64_t) len * 8 * 1000000 + msp430_baudrate - 1) / msp430_baudrate);
+    return msp430_pio_wait(((start || end) ? MSP430_ACK_TIMEOUT_US : 0) + clocking_us + MSP430_HANDSHAKE_US);
+}
+
+static void msp430_put_crc(uint8_t *frame, uint16_t len){
+    uint16_t crc = crc16_update(0xFFFF, frame, len);
+    frame[len] = crc >> 8;
+    frame[len+1] = crc & 0xFF;
+}
+
+static bool msp430_check_crc(const uint8_t *frame, uint16_t len){
+    uint16_t crc = crc16_update(0xFFFF, frame, len);
+    return frame[len] == (crc >> 8) && frame[len+1] == (crc & 0xFF);
+}
+
+int16_t msp430_backup(Packet_buf *const *packets, const uint8_t *lengths, uint8_t count, uint32_t budget_us){
+    // take the packets which fit into the frame, into the remaining energy and into the queue (if its depth is known)
+    uint16_t space = (msp430_depth >= 0) ? FRAM_QUEUE_SLOTS - msp430_depth : FRAM_QUEUE_SLOTS;
+    if(space == 0 && count > 0){
+        return MSP430_ERROR_FULL;
+    }
+    uint16_t section = 0;
+    uint8_t n = 0;
+    while(n < count && n < space && section + 1 + lengths[n] <= MSP430_MAX_SECTION && msp430_transfer_time_us(section + 1 + lengths[n]) <= budget_us){
+        uint8_t *entry = &msp430_frame[MSP430_HEADER_LEN + section];
+        entry[0] = lengths[n];
+        memcpy(&entry[1], packets[n]->bytes, lengths[n]);
+        section += 1 + lengths[n];
+        n++;
+    }
+    if(n == 0){
+        return 0;
+    }
+    msp430_frame[0] = MSP430_MAGIC;
+    msp430_frame[1] = n;
+    msp430_frame[2] = section & 0xFF;
+    msp430_frame[3] = section >> 8;
+    msp430_put_crc(msp430_frame, MSP430_HEADER_LEN + section);
+
+    if(!msp430_transfer(true, true, msp430_frame, NULL, MSP430_HEADER_LEN + section + 2, true, true)){
+        return MSP430_ERROR_TIMEOUT;
+    }
+    if(!gpio_get(msp430_ind)){
+        return MSP430_ERROR_CRC;
+    }
+    msp430_depth = (msp430_depth >= 0) ? msp430_depth + n : -1;
+    return n;
+}
+
+/*
+ * parse the packet section into buffers of the pool, already delivered packets are dropped
+ * returns the number of new packets or MSP430_ERROR_FRAME if the section is inconsistent with the header
+ */
+static int16_t msp430_unpack(const uint8_t *frame, Packet_buf **packets, uint8_t *lengths, uint16_t *seqs){
+    uint8_t count = frame[1];
+    uint16_t section = frame[2] | (frame[3] << 8);
+    uint16_t offset = 0;
+    uint8_t n = 0;
+    for(uint8_t i = 0; i < count; i++){
+        const uint8_t *entry = &frame[MSP430_RESTORE_HEADER_LEN + offset];
+        if(offset + 3 > section || entry[0] > PACKET_BUF_SIZE || offset + 3 + entry[0] > section){
+            return MSP430_ERROR_FRAME;
+        }
+        uint16_t seq = entry[1] | (entry[2] << 8);
+        if(!msp430_delivered || (int16_t) (seq - msp430_next_seq) >= 0){
+            lengths[n] = entry[0];
+            if(seqs != NULL){
+                seqs[n] = seq;
+            }
+            memcpy(packets[n]->bytes, &entry[3], entry[0]);
+            msp430_next_seq = seq + 1;
+            msp430_delivered = true;
+            n++;
+        }
+        offset += 3 + entry[0];
+    }
+    return (offset == section) ? n : MSP430_ERROR_FRAME;
+}
+
+/*
+ * one restore transaction with up to max_count packets (0: only the header), the buffers have to be reserved
+ * returns the number of new packets or an MSP430_ERROR_*
+ */
+static int16_t msp430_pop(Packet_buf **packets, uint8_t *lengths, uint16_t *seqs, uint8_t max_count){
+    uint8_t request[MSP430_RESTORE_HEADER_LEN] = {max_count, 0, 0, 0, 0, 0};
+    if(!msp430_transfer(true, false, request, msp430_frame, MSP430_RESTORE_HEADER_LEN, false, false)){
+        return MSP430_ERROR_TIMEOUT;
+    }
+    int16_t result;
+    uint16_t section = msp430_frame[2] | (msp430_frame[3] << 8);
+    int16_t remaining = msp430_frame[4] | (msp430_frame[5] << 8);
+    bool valid = msp430_frame[0] == MSP430_MAGIC && msp430_frame[1] <= max_count && section <= MSP430_MAX_SECTION && remaining <= FRAM_QUEUE_SLOTS;
+    if(!valid){
+        result = MSP430_ERROR_FRAME;
+    }else if(!msp430_transfer(false, false, NULL, &msp430_frame[MSP430_RESTORE_HEADER_LEN], section + 2, false, false)){
+        return MSP430_ERROR_TIMEOUT;
+    }else if(!msp430_check_crc(msp430_frame, MSP430_RESTORE_HEADER_LEN + section)){
+        result = MSP430_ERROR_CRC;
+    }else{
+        uint16_t next_seq = msp430_next_seq;
+        bool delivered = msp430_delivered;
+        result = msp430_unpack(msp430_frame, packets, lengths, seqs);
+        if(result < 0){ // nothing delivered
+            msp430_next_seq = next_seq;
+            msp430_delivered = delivered;
+        }
+    }
+    // commit: the MSP430 may drop the packets, without confirmation they are restored again (and dropped here)
+    if(msp430_transfer(false, false, NULL, NULL, 0, true, result >= 0) && result >= 0){
+        msp430_depth = remaining;
+    }
+    return result;
+}
+
+int16_t msp430_restore(Packet_buf **packets, uint8_t *lengths, uint16_t *seqs, uint8_t max_count){
+    // reserve the buffers first: the MSP430 must not send more packets than can be stored
+    uint8_t reserved = 0;
+    while(reserved < max_count && (packets[reserved] = packet_pool_alloc()) != NULL){
+        reserved++;
+    }
+    int16_t result = (reserved > 0) ? msp430_pop(packets, lengths, seqs, reserved) : 0;
+    for(uint8_t i = (result > 0) ? result : 0; i < reserved; i++){
+        packet_pool_free(packets[i]);
+    }
+    return result;
+}
+
+int16_t msp430_status(){
+    int16_t result = msp430_pop(NULL, NULL, NULL, 0);
+    return (result < 0) ? result : msp430_depth;
+}
+
+int16_t msp430_queue_depth(){
+    return msp430_depth;
+}
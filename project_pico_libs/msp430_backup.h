@@ -0,0 +1,74 @@
+/**
+ * Bulk backup/restore of packets on the MSP430 (FRAM) over SPI
+ *
+ * The MSP430 keeps the packets in a persistent queue (fram_queue.h), every packet gets a sequence number there.
+ * Many packets are moved per REQ/ACK handshake in one frame, transferred by DMA:
+ *   backup:  magic (1B) | count (1B) | length (2B) | count x [len (1B) | packet] | CRC-16 (2B, MSB first)
+ *   restore: magic (1B) | count (1B) | length (2B) | remaining (2B) | count x [len (1B) | seq (2B) | packet] | CRC-16
+ * length is the size of the packet section, the CRC (crc16_update, see packet_generation.h) covers header and packets,
+ * remaining is the depth of the queue after the commit, 16-bit fields are little endian.
+ *
+ * Backup (MODE high):  REQ rise -> ACK rise -> frame (Pico -> MSP430) -> REQ fall
+ *                      -> MSP430 checks the CRC, stores the packets, sets IND (CRC ok) -> ACK fall
+ * Restore (MODE low):  REQ rise -> ACK rise -> header, the Pico sends the maximal count as first byte
+ *                      -> packets and CRC (MSP430 -> Pico) -> MODE high: commit (CRC ok), low: keep the packets
+ *                      -> REQ fall -> ACK fall (the MSP430 pops the committed packets, also corrupted ones it skipped)
+ * A packet is restored again if the commit got lost: the Pico drops packets with an already delivered sequence number.
+ *
+ * The handshake and the SPI clocking are run by the PIO engine (msp430_pio.h), the CPU sleeps during a transaction.
+ * A missing ACK is detected after MSP430_ACK_TIMEOUT_US. IND has to be set up as input by the caller.
+ *
+ */
+
+#ifndef MSP430_BACKUP_LIB
+#define MSP430_BACKUP_LIB
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "packet_pool.h"
+#include "fram_queue.h"
+
+#define MSP430_MAGIC              0x5A
+#define MSP430_HEADER_LEN            4
+#define MSP430_RESTORE_HEADER_LEN    6
+#define MSP430_MAX_SECTION        1024 // bytes of the packet section per transaction (MSP430 RAM buffer)
+#define MSP430_ACK_TIMEOUT_US     5000 // MSP430 reaction to REQ (includes storing the frame in FRAM)
+#define MSP430_HANDSHAKE_US        100 // typical time of both handshakes (budget estimation)
+
+#define MSP430_ERROR_TIMEOUT        -1 // no ACK
+#define MSP430_ERROR_CRC            -2 // frame corrupted (backup: reported by the MSP430 via IND)
+#define MSP430_ERROR_FRAME          -3 // invalid header
+#define MSP430_ERROR_FULL           -4 // no space left in the queue
+
+/*
+ * starts the PIO engine on pio with the SPI clock baudrate [Hz] (pin_req has to follow pin_mode)
+ * returns false if the engine cannot be loaded
+ */
+bool msp430_backup_init(PIO pio, uint32_t baudrate, uint pin_sck, uint pin_mosi, uint pin_miso, uint pin_req, uint pin_ack, uint pin_mode, uint pin_ind);
+
+// estimated duration of one transaction with the given number of packet bytes [us]
+uint32_t msp430_transfer_time_us(uint16_t packet_bytes);
+
+/*
+ * store the first packets (lengths in bytes) which fit into one frame, into the time budget [us] and into the queue
+ * returns the number of stored packets or an MSP430_ERROR_*
+ */
+int16_t msp430_backup(Packet_buf *const *packets, const uint8_t *lengths, uint8_t count, uint32_t budget_us);
+
+/*
+ * restore up to max_count packets (oldest first) into buffers of the packet pool, which are owned by the caller
+ * seqs: sequence numbers of the packets (consecutive unless corrupted packets were skipped), can be NULL
+ * returns the number of restored packets or an MSP430_ERROR_* (the packets stay on the MSP430)
+ * 0 does not mean that the queue is empty (e.g. only duplicates), see msp430_queue_depth()
+ */
+int16_t msp430_restore(Packet_buf **packets, uint8_t *lengths, uint16_t *seqs, uint8_t max_count);
+
+// ask the MSP430 for the depth of its queue (e.g. after a reset), returns the depth or an MSP430_ERROR_*
+int16_t msp430_status();
+
+// depth of the queue after the last transaction, -1 if unknown (before msp430_status())
+int16_t msp430_queue_depth();
+
+#endif
@@ -0,0 +1,187 @@
+/**
+ * PIO handshake engine for the MSP430 link
+ *
+ * See msp430_pio.h
+ *
+ */
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "hardware/clocks.h"
+#include "msp430_pio.h"
+
+#define PIO_JMP       0x0000 // JMP
+#define PIO_JMP_NOTX  0x0020 // JMP !x
+#define PIO_JMP_XMM   0x0040 // JMP x--
+#define PIO_JMP_NOTY  0x0060 // JMP !y
+#define PIO_WAIT_GPIO 0x2000 // WAIT 0 gpio
+#define PIO_WAIT_1    0x0080 // polarity 1
+#define PIO_IN        0x4000
+#define PIO_OUT       0x6000
+#define PIO_PULL      0x8080
+#define PIO_IFEMPTY   0x0040
+#define PIO_BLOCK     0x0020
+#define PIO_IRQ       0xC000
+#define PIO_SET_PINS  0xE000
+#define PIO_PINS      0x0000
+#define PIO_X_REG     0x0001
+#define PIO_Y_REG     0x0002
+#define PIO_SIDE_0    0x1000 // optional side-set: enable | value
+#define PIO_SIDE_1    0x1800
+
+#define MSP430_PIO_STREAM_WORDS (5 + (MSP430_PIO_MAX_BYTES + 3) / 4)
+
+static PIO msp430_pio;
+static uint msp430_sm, msp430_offset;
+static uint msp430_dma_tx, msp430_dma_rx;
+static uint16_t msp430_program[MSP430_PIO_PROGRAM_LEN];
+static uint32_t msp430_stream[MSP430_PIO_STREAM_WORDS];
+static volatile bool msp430_done = false;
+
+static void msp430_pio_irq(){
+    pio_interrupt_clear(msp430_pio, 0);
+    msp430_done = true;
+    __sev(); // wake msp430_pio_wait()
+}
+
+static void generate_program(uint pin_ack){
+    uint16_t *p = msp430_program;
+    p[ 0] = PIO_PULL | PIO_BLOCK;                                     //  0: pull   block
+    p[ 1] = PIO_OUT | (PIO_Y_REG << 5);                               //  1: out    y, 32           start
+    p[ 2] = PIO_PULL | PIO_BLOCK;                                     //  2: pull   block
+    p[ 3] = PIO_OUT | (PIO_X_REG << 5);                               //  3: out    x, 32           mode
+    p[ 4] = PIO_JMP_NOTY | 10;                                        //  4: jmp    !y, 10
+    p[ 5] = PIO_JMP_NOTX | 8;                                         //  5: jmp    !x, 8
+    p[ 6] = PIO_SET_PINS | 3;                                         //  6: set    pins, 3         MODE=1, REQ=1
+    p[ 7] = PIO_JMP | 9;                                              //  7: jmp    9
+    p[ 8] = PIO_SET_PINS | 2;                                         //  8: set    pins, 2         MODE=0, REQ=1
+    p[ 9] = PIO_WAIT_GPIO | PIO_WAIT_1 | pin_ack;                     //  9: wait   1 gpio, ack
+    p[10] = PIO_PULL | PIO_BLOCK;                                     // 10: pull   block
+    p[11] = PIO_OUT | (PIO_X_REG << 5);                               // 11: out    x, 32           bits
+    p[12] = PIO_JMP_XMM | 14;                                         // 12: jmp    x--, 14
+    p[13] = PIO_JMP | 18;                                             // 13: jmp    18              no data
+    p[14] = PIO_PULL | PIO_IFEMPTY | PIO_BLOCK | PIO_SIDE_0;          // 14: pull   ifempty block   side 0
+    p[15] = PIO_OUT | (PIO_PINS << 5) | 1 | PIO_SIDE_0;               // 15: out    pins, 1         side 0
+    p[16] = PIO_IN | (PIO_PINS << 5) | 1 | PIO_SIDE_1;                // 16: in     pins, 1         side 1
+    p[17] = PIO_JMP_XMM | 14 | PIO_SIDE_1;                            // 17: jmp    x--, 14         side 1
+    p[18] = PIO_PULL | PIO_BLOCK | PIO_SIDE_0;                        // 18: pull   block           side 0, drops the rest of the last data word
+    p[19] = PIO_OUT | (PIO_Y_REG << 5);                               // 19: out    y, 32           end
+    p[20] = PIO_PULL | PIO_BLOCK;                                     // 20: pull   block
+    p[21] = PIO_OUT | (PIO_X_REG << 5);                               // 21: out    x, 32           commit
+    p[22] = PIO_JMP_NOTY | 28;                                        // 22: jmp    !y, 28
+    p[23] = PIO_JMP_NOTX | 26;                                        // 23: jmp    !x, 26
+    p[24] = PIO_SET_PINS | 1;                                         // 24: set    pins, 1         MODE=1, REQ=0
+    p[25] = PIO_JMP | 27;                                             // 25: jmp    27
+    p[26] = PIO_SET_PINS | 0;                                         // 26: set    pins, 0         MODE=0, REQ=0
+    p[27] = PIO_WAIT_GPIO | pin_ack;                                  // 27: wait   0 gpio, ack
+    p[28] = PIO_IRQ | 0;                                              // 28: irq    0
+}
+
+bool msp430_pio_init(PIO pio, uint32_t baudrate, uint pin_sck, uint pin_mosi, uint pin_miso, uint pin_mode, uint pin_req, uint pin_ack){
+    if(pin_req != pin_mode + 1){
+        printf("ERROR: REQ (%d) has to be the pin after MODE (%d) for the PIO handshake engine.\n", pin_req, pin_mode);
+        return false;
+    }
+    generate_program(pin_ack);
+    struct pio_program program = {msp430_program, MSP430_PIO_PROGRAM_LEN, -1};
+    if(!pio_can_add_program(pio, &program)){
+        printf("ERROR: The MSP430 handshake program does not fit into the PIO instruction memory.\n");
+        return false;
+    }
+    msp430_pio = pio;
+    msp430_sm = pio_claim_unused_sm(pio, true);
+    msp430_offset = pio_add_program(pio, &program);
+    msp430_dma_tx = dma_claim_unused_channel(true);
+    msp430_dma_rx = dma_claim_unused_channel(true);
+
+    // MODE, REQ, SCK and MOSI are outputs (low), ACK and MISO inputs
+    uint32_t outputs = (3u << pin_mode) | (1u << pin_sck) | (1u << pin_mosi);
+    pio_sm_set_pins_with_mask(pio, msp430_sm, 0, outputs);
+    pio_sm_set_pindirs_with_mask(pio, msp430_sm, outputs, outputs | (1u << pin_miso) | (1u << pin_ack));
+    pio_gpio_init(pio, pin_mode);
+    pio_gpio_init(pio, pin_req);
+    pio_gpio_init(pio, pin_sck);
+    pio_gpio_init(pio, pin_mosi);
+
+    pio_sm_config c = pio_get_default_sm_config();
+    sm_config_set_wrap(&c, msp430_offset, msp430_offset + MSP430_PIO_PROGRAM_LEN - 1);
+    sm_config_set_set_pins(&c, pin_mode, 2);
+    sm_config_set_out_pins(&c, pin_mosi, 1);
+    sm_config_set_in_pins(&c, pin_miso);
+    sm_config_set_sideset(&c, 2, true, false);
+    sm_config_set_sideset_pins(&c, pin_sck);
+    sm_config_set_out_shift(&c, false, false, 32); // OUT shifts to left (MSB first), the program pulls every word
+    sm_config_set_in_shift(&c, false, true, 8);    // IN shifts to left (MSB first), autopush after every byte
+    sm_config_set_clkdiv(&c, (float) clock_get_hz(clk_sys) / (4.0f * baudrate));
+    pio_sm_init(pio, msp430_sm, msp430_offset, &c);
+
+    uint irq = (pio == pio0) ? PIO0_IRQ_0 : PIO1_IRQ_0;
+    pio_set_irq0_source_enabled(pio, pis_interrupt0, true);
+    irq_set_exclusive_handler(irq, msp430_pio_irq);
+    irq_set_enabled(irq, true);
+    pio_sm_set_enabled(pio, msp430_sm, true);
+    return true;
+}
+
+void msp430_pio_post(const Msp430_transfer *transfer){
+    // descriptor and data words
+    uint16_t len = (transfer->len < MSP430_PIO_MAX_BYTES) ? transfer->len : MSP430_PIO_MAX_BYTES;
+    uint16_t data_words = (len + 3) / 4;
+    msp430_stream[0] = transfer->start;
+    msp430_stream[1] = transfer->mode;
+    msp430_stream[2] = 8 * (uint32_t) len;
+    uint32_t *data = &msp430_stream[3];
+    memset(data, 0, 4 * data_words);
+    for(uint16_t i = 0; transfer->tx != NULL && i < len; i++){
+        data[i/4] |= (uint32_t) transfer->tx[i] << (24 - 8 * (i % 4));
+    }
+    data[data_words] = transfer->end;
+    data[data_words + 1] = transfer->commit;
+
+    msp430_done = false;
+    static uint8_t discard;
+    dma_channel_config c = dma_channel_get_default_config(msp430_dma_rx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_8);
+    channel_config_set_dreq(&c, pio_get_dreq(msp430_pio, msp430_sm, false));
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, transfer->rx != NULL);
+    dma_channel_configure(msp430_dma_rx, &c, transfer->rx != NULL ? transfer->rx : &discard, &msp430_pio->rxf[msp430_sm], len, false);
+
+    c = dma_channel_get_default_config(msp430_dma_tx);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_dreq(&c, pio_get_dreq(msp430_pio, msp430_sm, true));
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    dma_channel_configure(msp430_dma_tx, &c, &msp430_pio->txf[msp430_sm], msp430_stream, 5 + data_words, false);
+
+    dma_start_channel_mask((len > 0 ? (1u << msp430_dma_rx) : 0) | (1u << msp430_dma_tx));
+}
+
+// stop the transfer, release REQ and MODE and restart the program
+static void msp430_pio_abort(){
+    pio_sm_set_enabled(msp430_pio, msp430_sm, false);
+    dma_channel_abort(msp430_dma_tx);
+    dma_channel_abort(msp430_dma_rx);
+    pio_sm_clear_fifos(msp430_pio, msp430_sm);
+    pio_sm_restart(msp430_pio, msp430_sm);
+    pio_sm_exec(msp430_pio, msp430_sm, PIO_SET_PINS | 0);
+    pio_sm_exec(msp430_pio, msp430_sm, PIO_JMP | msp430_offset);
+    pio_sm_set_enabled(msp430_pio, msp430_sm, true);
+}
+
+bool msp430_pio_wait(uint32_t timeout_us){
+    absolute_time_t deadline = make_timeout_time_us(timeout_us);
+    while(!msp430_done){
+        if(best_effort_wfe_or_timeout(deadline) && !msp430_done){
+            msp430_pio_abort();
+            return false;
+        }
+    }
+    // the last bytes may still be on their way from the RX FIFO
+    dma_channel_wait_for_finish_blocking(msp430_dma_rx);
+    return true;
+}
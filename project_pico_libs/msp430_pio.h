@@ -0,0 +1,55 @@
+/**
+ * PIO handshake engine for the MSP430 link
+ *
+ * One state machine runs the REQ/ACK/MODE handshake and clocks the SPI bytes (mode 0, MSB first, master),
+ * the CPU only posts a transfer descriptor and sleeps until the PIO interrupt (completion) or the timeout.
+ * The TX FIFO is fed by DMA with a stream of 32-bit words per transfer:
+ *   start | mode | bits | data (bytes packed MSB first, bits/32 rounded up words) | end | commit
+ *   start:  set MODE = mode, raise REQ and wait for ACK to rise (0: the handshake of the previous transfer continues)
+ *   bits:   number of bits clocked out (MOSI) and in (MISO), the received bytes are read from the RX FIFO by DMA
+ *   end:    set MODE = commit, release REQ and wait for ACK to fall (0: REQ stays raised for the next transfer)
+ * Afterwards the state machine raises its interrupt flag 0.
+ *
+ * MODE and REQ are driven by SET (pin_req = pin_mode + 1), SCK by side-set, ACK is waited for as GPIO.
+ * Every word is pulled explicitly (no autopull), the rest of the last data word is dropped by the pull of end.
+ * The state machine runs at 4 cycles per bit.
+ *
+ */
+
+#ifndef MSP430_PIO_LIB
+#define MSP430_PIO_LIB
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+
+#define MSP430_PIO_MAX_BYTES    1030 // bytes per transfer (the largest backup frame)
+#define MSP430_PIO_PROGRAM_LEN    29
+
+typedef struct {
+    bool start;         // raise REQ with MODE = mode and wait for ACK
+    bool mode;
+    const uint8_t *tx;  // NULL: send zeros
+    uint8_t *rx;        // NULL: discard the received bytes
+    uint16_t len;       // bytes, 0: only handshake
+    bool end;           // set MODE = commit, release REQ and wait until ACK falls
+    bool commit;
+} Msp430_transfer;
+
+/*
+ * load the program into a free state machine of pio, claims two DMA channels and the PIO interrupt 0
+ * returns false if the pins do not fit (pin_req has to follow pin_mode) or there is no space left
+ */
+bool msp430_pio_init(PIO pio, uint32_t baudrate, uint pin_sck, uint pin_mosi, uint pin_miso, uint pin_mode, uint pin_req, uint pin_ack);
+
+// start a transfer, the call returns immediately
+void msp430_pio_post(const Msp430_transfer *transfer);
+
+/*
+ * sleep until the posted transfer has completed, returns false after timeout_us [us]
+ * (the engine is reset in this case: REQ and MODE are low)
+ */
+bool msp430_pio_wait(uint32_t timeout_us);
+
+#endif
@@ -8,7 +8,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
-#include "pico/stdlib.h"
+#include <stdint.h>
+#include <stdbool.h>
 #include "packet_generation.h"
 
 #define DEFAULT_SEED 0xABCD
@@ -17,13 +18,28 @@ uint32_t seed = DEFAULT_SEED;
 uint8_t packet_hdr_2500[HEADER_LEN] = {0xaa, 0xaa, 0xaa, 0xaa, 0xd3, 0x91, 0xd3, 0x91, 0x00, 0x00};    // CC2500, the last two byte one for the payload length. and another is seq number
 uint8_t packet_hdr_1352[HEADER_LEN] = {0xaa, 0xaa, 0xaa, 0xaa, 0x93, 0x0b, 0x51, 0xde, 0x00, 0x00};    // CC1352P7, the last two byte one for the payload length. and another is seq number
 
+const Frame_format frame_format_cc2500 = {.preamble = 4, .sync = {0xd3, 0x91, 0xd3, 0x91}, .sync_len = 4, .length_mode = FRAME_LENGTH_VARIABLE};
+const Frame_format frame_format_cc1352 = {.preamble = 4, .sync = {0x93, 0x0b, 0x51, 0xde}, .sync_len = 4, .length_mode = FRAME_LENGTH_VARIABLE};
+
+/*
+ * frame format of the corresponding radio
+ * receiver: radio number (2500 or 1352)
+ */
+const Frame_format *frame_format(uint16_t receiver){
+    if(receiver == 2500){
+        return &frame_format_cc2500;
+    }else{
+        return &frame_format_cc1352;
+    }
+}
+
 /*
  * obtain the packet header template for the corresponding radio
  * buffer: array of size HEADER_LEN 
  * receiver: radio number (2500 or 1352)
  */
 uint8_t *packet_hdr_template(uint16_t receiver){
-    if(receiver == 2500){
+    if(frame_format(receiver) == &frame_format_cc2500){
         return packet_hdr_2500;
     }else{
         return packet_hdr_1352;
@@ -31,32 +47,88 @@ uint8_t *packet_hdr_template(uint16_t receiver){
 }
 
 /* 
- * generate of a uniform random number.
+ * one step of the linear congruential generator
  */
-uint32_t rnd() {
+static uint32_t lcg_next(uint32_t state) {
     const uint32_t A1 = 1664525;
     const uint32_t C1 = 1013904223;
     const uint32_t RAND_MAX1 = 0xFFFFFFFF;
-    seed = ((seed * A1 + C1) & RAND_MAX1);
+    return ((state * A1 + C1) & RAND_MAX1);
+}
+
+/* 
+ * generate of a uniform random number.
+ */
+uint32_t rnd() {
+    seed = lcg_next(seed);
     return seed;
 }
 
+/* 
+ * gaussian sample (Box-Muller) from two uniform random numbers
+ */
+static uint16_t gaussian_sample(uint32_t r1, uint32_t r2) {
+    double two_pi = 2.0 * M_PI;
+    double u1, u2;
+    u1 = ((double) r1)/ ((double) 0xFFFFFFFF);
+    u2 = ((double) r2)/((double) 0xFFFFFFFF);
+    double tmp = ((double) 0x7FF) * sqrt(-2.0 * log(u1));
+    return max(0.0,min(((double) 0x3FFFFF),tmp * cos(two_pi * u2) + ((double) 0x1FFF)));
+}
+
+/*
+ * next sample of a generator (state: seed, position: file position of the sample)
+ */
+static uint16_t next_sample(uint32_t *state, uint16_t *position) {
+    if (*position == 0) {
+        *state = DEFAULT_SEED; /* reset seed when exceeding uint16_t max */
+    }
+    *position = *position + 2;
+    uint32_t r1 = lcg_next(*state);
+    uint32_t r2 = lcg_next(r1);
+    *state = r2;
+    return gaussian_sample(r1, r2);
+}
+
 /* 
  * generate compressible payload sample
  * file_position provides the index of the next data byte (increments by 2 each time the function is called)
  */
 uint16_t file_position = 0;
 uint16_t generate_sample(){
-    if (file_position == 0) {
-        seed = DEFAULT_SEED; /* reset seed when exceeding uint16_t max */
+    return next_sample(&seed, &file_position);
+}
+
+/*
+ * seed of the generator before the sample at the given file position
+ * each sample consumes two random numbers, thus the seed is advanced by position steps (jump-ahead in O(log n))
+ */
+uint32_t rnd_seed_at(uint16_t position) {
+    uint32_t acc_mult = 1, acc_plus = 0;
+    uint32_t cur_mult = 1664525, cur_plus = 1013904223;
+    for (uint32_t n = position; n > 0; n >>= 1) {
+        if (n & 1) {
+            acc_mult = acc_mult * cur_mult;
+            acc_plus = acc_plus * cur_mult + cur_plus;
+        }
+        cur_plus = (cur_mult + 1) * cur_plus;
+        cur_mult = cur_mult * cur_mult;
+    }
+    return acc_mult * DEFAULT_SEED + acc_plus;
+}
+
+/*
+ * regenerate the samples which generate_data() sent starting at the given file position
+ * the TX generator state (seed, file_position) is not altered
+ * length: number of bytes (even)
+ */
+void expected_data(uint8_t *buffer, uint8_t length, uint16_t position) {
+    uint32_t state = rnd_seed_at(position);
+    for (uint8_t i=0; i+1 < length; i=i+2) {
+        uint16_t sample = next_sample(&state, &position);
+        buffer[i]   = (uint8_t) (sample >> 8);
+        buffer[i+1] = (uint8_t) (sample & 0x00FF);
     }
-    file_position = file_position + 2;
-    double two_pi = 2.0 * M_PI;
-    double u1, u2;
-    u1 = ((double) rnd())/ ((double) 0xFFFFFFFF);
-    u2 = ((double) rnd())/((double) 0xFFFFFFFF);
-    double tmp = ((double) 0x7FF) * sqrt(-2.0 * log(u1));
-    return max(0.0,min(((double) 0x3FFFFF),tmp * cos(two_pi * u2) + ((double) 0x1FFF)));
 }
 
 /*
@@ -82,6 +154,157 @@ void generate_data(uint8_t *buffer, uint8_t length, bool include_index) {
     }
 }
 
+/*
+ * adaptive Rice coder of the compressed payload: the samples are coded as zigzag residuals around SAMPLE_CENTER,
+ * the parameter k follows the mean residual of the packet so far (smallest k with n*2^k >= sum of the residuals)
+ * code: q = residual >> k ones, a zero and the k low bits; from q = RICE_QMAX on: RICE_QMAX ones, a zero and
+ * the raw sample. The stream is padded with ones, which never complete a code.
+ */
+struct rice_coder {
+    uint8_t *stream;
+    uint16_t bits;      // written/read
+    uint16_t capacity;  // bits of the stream
+    uint32_t sum;       // residuals so far (initially: 2^RICE_K0)
+    uint32_t count;
+};
+
+static void rice_init(struct rice_coder *c, const uint8_t *stream, uint8_t length) {
+    c->stream = (uint8_t *) stream;
+    c->bits = 0;
+    c->capacity = 8 * length;
+    c->sum = 1 << RICE_K0;
+    c->count = 1;
+}
+
+static uint8_t rice_k(const struct rice_coder *c) {
+    uint8_t k = 0;
+    while ((c->count << k) < c->sum && k < 16) {
+        k++;
+    }
+    return k;
+}
+
+// MSB first, the stream is filled with ones beforehand
+static void rice_write(struct rice_coder *c, uint32_t value, uint8_t len) {
+    for (uint8_t b = len; b > 0; b--, c->bits++) {
+        if (((value >> (b - 1)) & 1) == 0) {
+            c->stream[c->bits >> 3] &= ~(0x80 >> (c->bits & 7));
+        }
+    }
+}
+
+static bool rice_put(struct rice_coder *c, uint16_t sample) {
+    int32_t r = (int32_t) sample - SAMPLE_CENTER;
+    uint32_t u = (r >= 0) ? 2 * r : -2 * r - 1; // zigzag
+    uint8_t k = rice_k(c);
+    uint32_t q = u >> k;
+    uint16_t len = (q < RICE_QMAX) ? q + 1 + k : RICE_QMAX + 1 + 16;
+    if (c->bits + len > c->capacity) {
+        return false;
+    }
+    c->bits += min(q, RICE_QMAX); // ones
+    rice_write(c, 0, 1);
+    if (q < RICE_QMAX) {
+        rice_write(c, u, k);
+    } else {
+        rice_write(c, sample, 16);
+    }
+    c->sum += u;
+    c->count++;
+    return true;
+}
+
+static bool rice_read(struct rice_coder *c, uint8_t len, uint32_t *value) {
+    if (c->bits + len > c->capacity) {
+        return false;
+    }
+    *value = 0;
+    for (uint8_t b = 0; b < len; b++, c->bits++) {
+        *value = (*value << 1) | ((c->stream[c->bits >> 3] >> (7 - (c->bits & 7))) & 1);
+    }
+    return true;
+}
+
+static bool rice_get(struct rice_coder *c, uint16_t *sample) {
+    uint8_t k = rice_k(c);
+    uint32_t q = 0, bit = 1, value;
+    while (q <= RICE_QMAX && rice_read(c, 1, &bit) && bit == 1) {
+        q++;
+    }
+    if (bit != 0 || q > RICE_QMAX) {
+        return false; // end of the stream (padding) or invalid
+    }
+    if (q == RICE_QMAX) {
+        if (!rice_read(c, 16, &value)) {
+            return false;
+        }
+        *sample = value;
+    } else {
+        if (!rice_read(c, k, &value)) {
+            return false;
+        }
+        uint32_t u = (q << k) | value;
+        *sample = SAMPLE_CENTER + ((u & 1) ? -(int32_t) ((u + 1) / 2) : (int32_t) (u / 2));
+    }
+    int32_t r = (int32_t) *sample - SAMPLE_CENTER;
+    c->sum += (r >= 0) ? 2 * r : -2 * r - 1;
+    c->count++;
+    return true;
+}
+
+// as many samples of the generator as fit into the stream, the generator advances by the coded samples
+static uint8_t compress_generator(uint8_t *stream, uint8_t length, uint32_t *state, uint16_t *position) {
+    struct rice_coder c;
+    rice_init(&c, stream, length);
+    memset(stream, 0xFF, length);
+    uint8_t count = 0;
+    while (true) {
+        uint32_t next_state = *state;
+        uint16_t next_position = *position;
+        if (!rice_put(&c, next_sample(&next_state, &next_position))) {
+            return count; // the sample is sent in the next packet
+        }
+        *state = next_state;
+        *position = next_position;
+        count++;
+    }
+}
+
+uint8_t generate_compressed(uint8_t *buffer, uint8_t length) {
+    buffer[0] = (uint8_t) (file_position >> 8);
+    buffer[1] = (uint8_t) (file_position & 0x00FF);
+    return compress_generator(&buffer[2], length - 2, &seed, &file_position);
+}
+
+uint8_t expected_compressed(uint8_t *buffer, uint8_t length, uint16_t position) {
+    uint32_t state = rnd_seed_at(position);
+    return compress_generator(buffer, length, &state, &position);
+}
+
+uint8_t compress_samples(const uint16_t *samples, uint8_t count, uint8_t *stream, uint8_t length, uint8_t *used) {
+    struct rice_coder c;
+    rice_init(&c, stream, length);
+    memset(stream, 0xFF, length);
+    uint8_t coded = 0;
+    while (coded < count && rice_put(&c, samples[coded])) {
+        coded++;
+    }
+    if (used != NULL) {
+        *used = (c.bits + 7) / 8;
+    }
+    return coded;
+}
+
+uint8_t decompress_samples(const uint8_t *stream, uint8_t length, uint16_t *samples, uint8_t max) {
+    struct rice_coder c;
+    rice_init(&c, stream, length);
+    uint8_t count = 0;
+    while (count < max && rice_get(&c, &samples[count])) {
+        count++;
+    }
+    return count;
+}
+
 /* including a header to the packet:
  * - 8B header sequence
  * - 1B payload length
@@ -102,3 +325,134 @@ void add_header(uint8_t *packet, uint8_t seq, uint8_t *header_template) {
     packet[HEADER_LEN-1] = seq;
 }
 
+/*
+ * PN9 sequence (x^9 + x^5 + 1, all ones at the length byte) of the CC2500/CC1352 data whitening:
+ * each byte is the low byte of the register, which then advances by 8 steps (see design note DN509)
+ */
+const uint8_t pn9_table[PN9_TABLE_LEN] = {
+    0xff, 0xe1, 0x1d, 0x9a, 0xed, 0x85, 0x33, 0x24, 0xea, 0x7a, 0xd2, 0x39, 0x70, 0x97, 0x57, 0x0a,
+    0x54, 0x7d, 0x2d, 0xd8, 0x6d, 0x0d, 0xba, 0x8f, 0x67, 0x59, 0xc7, 0xa2, 0xbf, 0x34, 0xca, 0x18,
+    0x30, 0x53, 0x93, 0xdf, 0x92, 0xec, 0xa7, 0x15, 0x8a, 0xdc, 0xf4, 0x86, 0x55, 0x4e, 0x18, 0x21,
+    0x40, 0xc4, 0xc4, 0xd5, 0xc6, 0x91, 0x8a, 0xcd, 0xe7, 0xd1, 0x4e, 0x09, 0x32, 0x17, 0xdf, 0x83,
+};
+
+/*
+ * data whitening: XOR with the PN9 sequence from the length byte on (the CRC included), applying it twice
+ * restores the data
+ * data: starting with the length byte, len: at most PN9_TABLE_LEN bytes are whitened
+ */
+void whiten(uint8_t *data, uint8_t len) {
+    for (uint8_t i=0; i < min(len, PN9_TABLE_LEN); i++) {
+        data[i] ^= pn9_table[i];
+    }
+}
+
+/*
+ * casting for the 32-bit PIO fifo (MSB first)
+ * message: buffer of at least 4*words bytes
+ */
+void pack_words(const uint8_t *message, uint32_t *buffer, uint8_t words) {
+    for (uint8_t i=0; i < words; i++) {
+        buffer[i] = ((uint32_t) message[4*i+3]) | (((uint32_t) message[4*i+2]) << 8) | (((uint32_t) message[4*i+1]) << 16) | (((uint32_t)message[4*i]) << 24);
+    }
+}
+
+/*
+ * CRC-16 of the CC2500 packet engine (polynomial 0x8005, initial value 0xFFFF, MSB first)
+ * computed over the length byte and the payload, transmitted MSB first after the payload
+ * see design note DN502
+ */
+uint16_t crc16_cc2500(const uint8_t *data, uint8_t len) {
+    return crc16_update(0xFFFF, data, len);
+}
+
+uint16_t crc16_update(uint16_t crc, const uint8_t *data, uint16_t len) {
+    for (uint16_t i=0; i < len; i++) {
+        uint8_t byte = data[i];
+        for (uint8_t b=0; b < 8; b++) {
+            if (((crc & 0x8000) >> 8) ^ (byte & 0x80)) {
+                crc = (crc << 1) ^ 0x8005;
+            } else {
+                crc = crc << 1;
+            }
+            byte = byte << 1;
+        }
+    }
+    return crc;
+}
+
+uint8_t frame_header_len(const Frame_format *format) {
+    return format->preamble + format->sync_len + (format->length_mode == FRAME_LENGTH_VARIABLE) + 1;
+}
+
+uint8_t frame_length(const Frame_format *format, uint8_t payload_len) {
+    if (format->length_mode == FRAME_LENGTH_FIXED) {
+        if (1 + payload_len > format->fixed_len) {
+            return 0;
+        }
+        payload_len = format->fixed_len - 1;
+    }
+    return frame_header_len(format) + payload_len + (format->crc ? 2 : 0) + format->trailer_len;
+}
+
+uint8_t frame_header(const Frame_format *format, uint8_t *frame, uint8_t seq) {
+    uint8_t header_len = frame_header_len(format);
+    memset(frame, 0xaa, format->preamble);
+    memcpy(&frame[format->preamble], format->sync, format->sync_len);
+    frame[header_len-1] = seq;
+    return header_len;
+}
+
+uint8_t frame_finish(const Frame_format *format, uint8_t *frame, uint8_t payload_len) {
+    uint8_t len = frame_length(format, payload_len);
+    if (len == 0) {
+        return 0;
+    }
+    uint8_t start = format->preamble + format->sync_len; // length byte or seq
+    uint8_t end = frame_header_len(format) + payload_len;
+    if (format->length_mode == FRAME_LENGTH_VARIABLE) {
+        frame[start] = 1 + payload_len; // excluding the length byte and the CRC (cc2500 data sheet, p. 30)
+    } else {
+        memset(&frame[end], 0, start + format->fixed_len - end);
+        end = start + format->fixed_len;
+    }
+    if (format->crc) {
+        uint16_t crc = crc16_cc2500(&frame[start], end - start);
+        frame[end++] = crc >> 8;
+        frame[end++] = crc & 0xFF;
+    }
+    if (format->whitening) {
+        whiten(&frame[start], end - start); // the CRC included
+    }
+    memcpy(&frame[end], format->trailer, format->trailer_len);
+    return len;
+}
+
+// byte i of a frame packed by pack_words()
+static uint8_t packed_byte(const uint32_t *words, uint8_t i) {
+    return words[i / 4] >> (24 - 8 * (i % 4));
+}
+
+int8_t frame_parse(const Frame_format *const *formats, uint8_t count, const uint32_t *words, uint8_t *seq, uint8_t *len) {
+    for (uint8_t f = 0; f < count; f++) {
+        const Frame_format *format = formats[f];
+        bool match = true;
+        for (uint8_t i = 0; match && i < format->preamble + format->sync_len; i++) {
+            match = packed_byte(words, i) == ((i < format->preamble) ? 0xaa : format->sync[i - format->preamble]);
+        }
+        if (!match) {
+            continue;
+        }
+        uint8_t start = format->preamble + format->sync_len;
+        bool variable = format->length_mode == FRAME_LENGTH_VARIABLE;
+        if (seq != NULL) {
+            *seq = packed_byte(words, start + variable) ^ (format->whitening ? pn9_table[variable] : 0);
+        }
+        if (len != NULL) {
+            uint8_t length = variable ? packed_byte(words, start) ^ (format->whitening ? pn9_table[0] : 0) : format->fixed_len;
+            *len = start + variable + length + (format->crc ? 2 : 0) + format->trailer_len;
+        }
+        return f;
+    }
+    return -1;
+}
@@ -11,7 +11,8 @@
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
-#include "pico/stdlib.h"
+#include <stdint.h>
+#include <stdbool.h>
 #include "packet_generation.h"
 
 #define PAYLOADSIZE 14
@@ -26,6 +27,7 @@
 
 /*
  * obtain the packet header template for the corresponding radio
+ * (fixed HEADER_LEN layout of frame_format(receiver), the runtime frame builder uses the Frame_format)
  */
 uint8_t *packet_hdr_template(uint16_t receiver);
 
@@ -41,6 +43,18 @@ uint32_t rnd();
 extern uint16_t file_position;
 uint16_t generate_sample();
 
+/*
+ * seed of the generator before the sample at the given file position
+ */
+uint32_t rnd_seed_at(uint16_t position);
+
+/*
+ * regenerate the samples which generate_data() sent starting at the given file position
+ * (used by the receiver to compute bit errors, does not alter the TX generator state)
+ * length: number of bytes (even)
+ */
+void expected_data(uint8_t *buffer, uint8_t length, uint16_t position);
+
 /*
  * fill packet with 16-bit samples
  * include_index: shall the file index be included at the first two byte?
@@ -49,6 +63,32 @@ uint16_t generate_sample();
 void generate_data(uint8_t *buffer, uint8_t length, bool include_index);
 
 
+/*
+ * compressed payload: the samples are coded with an adaptive Rice code around SAMPLE_CENTER (see packet_generation.c),
+ * every packet decodes on its own (the coder starts again with RICE_K0 and the stream is padded with ones)
+ */
+#define SAMPLE_CENTER   0x1FFF // mean of the samples
+#define RICE_K0             11 // initial Rice parameter (the samples spread by 0x7FF)
+#define RICE_QMAX           16 // larger quotients are escaped: the raw sample follows
+
+/*
+ * fill a payload with the file position (2 bytes) and as many compressed samples as fit, returns the number
+ * of samples (the generator advances by them, as generate_data() with include_index)
+ */
+uint8_t generate_compressed(uint8_t *buffer, uint8_t length);
+
+/*
+ * regenerate the compressed stream of generate_compressed() after the file position (length bytes)
+ * returns the number of samples (the TX generator state is not altered)
+ */
+uint8_t expected_compressed(uint8_t *buffer, uint8_t length, uint16_t position);
+
+// code count samples into a stream of length bytes, returns the number of samples which fit (used: bytes with codes, may be NULL)
+uint8_t compress_samples(const uint16_t *samples, uint8_t count, uint8_t *stream, uint8_t length, uint8_t *used);
+
+// decode at most max samples of a compressed stream, returns the number of samples
+uint8_t decompress_samples(const uint8_t *stream, uint8_t length, uint16_t *samples, uint8_t max);
+
 /* including a header to the packet:
  * - 8B header sequence
  * - 1B payload length
@@ -59,4 +99,81 @@ void generate_data(uint8_t *buffer, uint8_t length, bool include_index);
  */
 void add_header(uint8_t *packet, uint8_t seq, uint8_t *header_template);
 
+/*
+ * CC2500/CC1352 compatible data whitening (PN9), the receiver de-whitens in hardware (PKTCTRL0.WHITE_DATA)
+ * data: starting with the length byte, len: bytes from there on (at most PN9_TABLE_LEN are whitened)
+ * applying it twice restores the data
+ */
+#define PN9_TABLE_LEN 64 // RX FIFO
+extern const uint8_t pn9_table[PN9_TABLE_LEN];
+void whiten(uint8_t *data, uint8_t len);
+
+/*
+ * frame format of a receiver, the frames are built from it at runtime (frame_header(), frame_finish()):
+ * - preamble bytes (0xAA) and the sync word
+ * - length byte (FRAME_LENGTH_VARIABLE: seq and payload) or none (FRAME_LENGTH_FIXED: the receiver expects fixed_len bytes)
+ * - seq and payload
+ * - optional CRC-16 (crc16_cc2500() from the length byte on, MSB first)
+ * - trailer bytes (not whitened, e.g. to keep the carrier modulated until the receiver has the last byte)
+ * with whitening, everything from the length byte to the CRC is whitened (whiten())
+ */
+#define FRAME_SYNC_MAX         4
+#define FRAME_TRAILER_MAX      4
+#define FRAME_LENGTH_VARIABLE  0 // CC2500 PKTCTRL0.LENGTH_CONFIG 1
+#define FRAME_LENGTH_FIXED     1 // CC2500 PKTCTRL0.LENGTH_CONFIG 0 with PKTLEN = fixed_len
+
+struct frame_format {
+    uint8_t preamble;                   // bytes
+    uint8_t sync[FRAME_SYNC_MAX];
+    uint8_t sync_len;
+    uint8_t length_mode;                // FRAME_LENGTH_*
+    uint8_t fixed_len;                  // FRAME_LENGTH_FIXED: seq and payload [bytes], shorter payloads are padded with zeros
+    bool crc;
+    bool whitening;
+    uint8_t trailer[FRAME_TRAILER_MAX];
+    uint8_t trailer_len;
+};
+typedef struct frame_format Frame_format;
+
+extern const Frame_format frame_format_cc2500; // sync word 0xD391 twice (30/32 sync mode), variable length
+extern const Frame_format frame_format_cc1352; // sync word 0x930B51DE, variable length
+
+// frame format of the corresponding radio (2500 or 1352)
+const Frame_format *frame_format(uint16_t receiver);
+
+// bytes before the payload: preamble, sync word, length byte and seq
+uint8_t frame_header_len(const Frame_format *format);
+
+// bytes of a frame with payload_len bytes of payload (0 if it does not fit the fixed length)
+uint8_t frame_length(const Frame_format *format, uint8_t payload_len);
+
+// write preamble, sync word and seq, the payload follows at frame[frame_header_len()], returns the header length
+uint8_t frame_header(const Frame_format *format, uint8_t *frame, uint8_t seq);
+
+/*
+ * complete a frame after its payload_len bytes of payload: length byte, padding, CRC, whitening and trailer
+ * returns the frame length [bytes] (0 if the payload does not fit the fixed length)
+ */
+uint8_t frame_finish(const Frame_format *format, uint8_t *frame, uint8_t payload_len);
+
+/*
+ * identify a frame packed by pack_words() by its preamble and sync word among count formats
+ * returns the index of the format (-1: none matches), seq and len: its seq and frame length [bytes] (may be NULL)
+ */
+int8_t frame_parse(const Frame_format *const *formats, uint8_t count, const uint32_t *words, uint8_t *seq, uint8_t *len);
+
+/*
+ * casting for the 32-bit PIO fifo (MSB first)
+ * message: buffer of at least 4*words bytes, may be the same memory as buffer (in place)
+ */
+void pack_words(const uint8_t *message, uint32_t *buffer, uint8_t words);
+
+/*
+ * CRC-16 as computed by the CC2500 packet engine over the length byte and the payload
+ */
+uint16_t crc16_cc2500(const uint8_t *data, uint8_t len);
+
+// same CRC continued over further data (start with crc = 0xFFFF), e.g. for longer frames
+uint16_t crc16_update(uint16_t crc, const uint8_t *data, uint16_t len);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,77 @@
+/**
+ * Compact binary packet log
+ *
+ * Each received packet is written as one COBS encoded record enclosed by 0x00 delimiters.
+ * See packet_log.h for the record layout.
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "receiver_CC2500.h"
+#include "packet_log.h"
+
+/*
+ * COBS encode len bytes of src into dst (dst must hold len + len/254 + 1 bytes)
+ * returns the number of bytes written to dst (without delimiter)
+ */
+uint16_t cobs_encode(const uint8_t *src, uint16_t len, uint8_t *dst){
+    uint16_t code_index = 0; // position of the current code byte
+    uint16_t out = 1;
+    uint8_t code = 1;
+    for(uint16_t i = 0; i < len; i++){
+        if(src[i] == 0x00){
+            dst[code_index] = code;
+            code_index = out++;
+            code = 1;
+        }else{
+            dst[out++] = src[i];
+            code++;
+            if(code == 0xFF){ // maximal block length reached
+                dst[code_index] = code;
+                code_index = out++;
+                code = 1;
+            }
+        }
+    }
+    dst[code_index] = code;
+    return out;
+}
+
+/*
+ * serialize a received packet into a delimited COBS frame
+ * frame: buffer of at least PACKET_LOG_MAX_FRAME_LEN bytes
+ * returns the number of bytes of the frame
+ */
+uint16_t encodePacketLog(uint8_t *frame, uint8_t *packet, Packet_status status, uint64_t time_us){
+    uint8_t record[PACKET_LOG_MAX_RECORD_LEN];
+    uint8_t len = status.overflowed ? 0 : min(status.len, RX_BUFFER_SIZE);
+
+    record[0] = PACKET_LOG_TYPE_PACKET;
+    for(uint8_t i = 0; i < 8; i++){
+        record[1+i] = (uint8_t) (time_us >> (8*i));
+    }
+    record[9]  = (status.overflowed ? PACKET_LOG_FLAG_OVERFLOW : 0) | ((!status.overflowed && status.CRCcheck) ? PACKET_LOG_FLAG_CRC_OK : 0);
+    record[10] = status.overflowed ? 0 : (uint8_t) ((int8_t) status.RSSI);
+    record[11] = status.overflowed ? 0 : status.LinkQualityIndicator;
+    record[12] = len;
+    memcpy(&record[PACKET_LOG_HEADER_LEN], packet, len);
+
+    /* leading delimiter separates the record from preceding text output */
+    frame[0] = 0x00;
+    uint16_t frame_len = 1 + cobs_encode(record, PACKET_LOG_HEADER_LEN + len, &frame[1]);
+    frame[frame_len++] = 0x00;
+    return frame_len;
+}
+
+/*
+ * binary counterpart of printPacket(): write the frame to stdout (without CRLF translation)
+ */
+void logPacket(uint8_t *packet, Packet_status status, uint64_t time_us){
+    uint8_t frame[PACKET_LOG_MAX_FRAME_LEN];
+    uint16_t frame_len = encodePacketLog(frame, packet, status, time_us);
+    for(uint16_t i = 0; i < frame_len; i++){
+        putchar_raw(frame[i]);
+    }
+}
@@ -0,0 +1,57 @@
+/**
+ * Compact binary packet log
+ *
+ * Instead of formatting every received packet as text (see printPacket()), a packet can be
+ * logged as a binary record. Records are COBS encoded and enclosed by 0x00 delimiters, such that
+ * they can be mixed with the regular text output on the same USB serial port.
+ *
+ * Record layout (little-endian, before COBS encoding):
+ *  - 1B record type (PACKET_LOG_TYPE_PACKET)
+ *  - 8B timestamp since boot-up [us]
+ *  - 1B status flags (PACKET_LOG_FLAG_*)
+ *  - 1B RSSI [dBm] (int8)
+ *  - 1B link quality indicator
+ *  - 1B payload length
+ *  - payload (up to RX_BUFFER_SIZE bytes)
+ *
+ * The host-side decoder is read_binary_log() in stats/functions.py.
+ *
+ */
+
+#ifndef PACKET_LOG_LIB
+#define PACKET_LOG_LIB
+
+#include <stdio.h>
+#include <string.h>
+#include "pico/stdlib.h"
+#include "receiver_CC2500.h"
+
+#define PACKET_LOG_TYPE_PACKET       0x01
+
+#define PACKET_LOG_FLAG_OVERFLOW     0x01
+#define PACKET_LOG_FLAG_CRC_OK       0x02
+
+#define PACKET_LOG_HEADER_LEN          13 // type + timestamp + flags + RSSI + LQI + length
+#define PACKET_LOG_MAX_RECORD_LEN      (PACKET_LOG_HEADER_LEN + RX_BUFFER_SIZE)
+// COBS adds one byte per 254 bytes, plus two 0x00 delimiters
+#define PACKET_LOG_MAX_FRAME_LEN       (PACKET_LOG_MAX_RECORD_LEN + PACKET_LOG_MAX_RECORD_LEN/254 + 1 + 2)
+
+/*
+ * COBS encode len bytes of src into dst (dst must hold len + len/254 + 1 bytes)
+ * returns the number of bytes written to dst (without delimiter)
+ */
+uint16_t cobs_encode(const uint8_t *src, uint16_t len, uint8_t *dst);
+
+/*
+ * serialize a received packet into a delimited COBS frame
+ * frame: buffer of at least PACKET_LOG_MAX_FRAME_LEN bytes
+ * returns the number of bytes of the frame
+ */
+uint16_t encodePacketLog(uint8_t *frame, uint8_t *packet, Packet_status status, uint64_t time_us);
+
+/*
+ * binary counterpart of printPacket(): write the frame to stdout (without CRLF translation)
+ */
+void logPacket(uint8_t *packet, Packet_status status, uint64_t time_us);
+
+#endif
@@ -0,0 +1,82 @@
+/**
+ * Fixed-capacity packet pool
+ *
+ * See packet_pool.h
+ *
+ */
+
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+#include "packet_pool.h"
+
+#define POOL_END 0xFF // end of the free list
+
+static Packet_buf pool[PACKET_POOL_SLOTS];
+static uint8_t pool_next[PACKET_POOL_SLOTS]; // free list
+static bool pool_allocated[PACKET_POOL_SLOTS];
+static uint8_t pool_free_head = POOL_END;
+static uint8_t pool_in_use = 0;
+static uint8_t pool_high_water = 0;
+static uint32_t pool_failures = 0;
+static spin_lock_t *pool_lock = NULL;
+
+void packet_pool_init(){
+    if(pool_lock == NULL){
+        pool_lock = spin_lock_instance(spin_lock_claim_unused(true));
+    }
+    uint32_t irq_state = spin_lock_blocking(pool_lock);
+    for(uint8_t i = 0; i < PACKET_POOL_SLOTS; i++){
+        pool_next[i] = (i + 1 < PACKET_POOL_SLOTS) ? i + 1 : POOL_END;
+        pool_allocated[i] = false;
+    }
+    pool_free_head = 0;
+    pool_in_use = 0;
+    pool_high_water = 0;
+    pool_failures = 0;
+    spin_unlock(pool_lock, irq_state);
+}
+
+Packet_buf *packet_pool_alloc(){
+    uint32_t irq_state = spin_lock_blocking(pool_lock);
+    uint8_t slot = pool_free_head;
+    if(slot == POOL_END){
+        pool_failures++;
+        spin_unlock(pool_lock, irq_state);
+        return NULL;
+    }
+    pool_free_head = pool_next[slot];
+    pool_allocated[slot] = true;
+    pool_in_use++;
+    if(pool_in_use > pool_high_water){
+        pool_high_water = pool_in_use;
+    }
+    spin_unlock(pool_lock, irq_state);
+    return &pool[slot];
+}
+
+bool packet_pool_free(Packet_buf *buf){
+    uintptr_t offset = (uintptr_t) buf - (uintptr_t) &pool[0]; // wraps for buffers before the pool
+    if(offset >= sizeof(pool) || offset % sizeof(Packet_buf) != 0){ // outside the pool or not the start of a slot
+        return false;
+    }
+    uint8_t slot = offset / sizeof(Packet_buf);
+    uint32_t irq_state = spin_lock_blocking(pool_lock);
+    if(!pool_allocated[slot]){ // double free
+        spin_unlock(pool_lock, irq_state);
+        return false;
+    }
+    pool_allocated[slot] = false;
+    pool_next[slot] = pool_free_head;
+    pool_free_head = slot;
+    pool_in_use--;
+    spin_unlock(pool_lock, irq_state);
+    return true;
+}
+
+void packet_pool_summary(Packet_pool_stats *stats){
+    uint32_t irq_state = spin_lock_blocking(pool_lock);
+    stats->in_use = pool_in_use;
+    stats->high_water = pool_high_water;
+    stats->failures = pool_failures;
+    spin_unlock(pool_lock, irq_state);
+}
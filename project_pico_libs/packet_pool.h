@@ -0,0 +1,47 @@
+/**
+ * Fixed-capacity packet pool
+ *
+ * All TX and RX packet buffers come from one static pool of equally sized, word-aligned slots (no heap).
+ * A buffer is owned by exactly one stage at a time (builder -> TX/backup, MSP430 recovery -> TX, RX -> log)
+ * and handed over by passing the pointer; the last owner returns it with packet_pool_free().
+ *
+ * - alloc and free are O(1) (free list) and take a hardware spin lock with interrupts disabled:
+ *   usable from ISRs and from both cores
+ * - the number of buffers in use, the high-water mark and failed allocations are reported for tuning
+ *
+ */
+
+#ifndef PACKET_POOL_LIB
+#define PACKET_POOL_LIB
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PACKET_POOL_SLOTS       17 // number of buffers (at most 255): frame ring (8) + ARQ window (8) + RX in pipeline mode
+#define PACKET_BUF_SIZE         64 // bytes per buffer (CC2500 FIFO), has to be a multiple of 4
+
+// one slot: bytes while the packet is built/received, words for the 32-bit PIO fifo
+union packet_buf {
+    uint32_t words[PACKET_BUF_SIZE/4];
+    uint8_t bytes[PACKET_BUF_SIZE];
+};
+typedef union packet_buf Packet_buf;
+
+struct packet_pool_stats {
+    uint8_t in_use;
+    uint8_t high_water;   // maximum of in_use since packet_pool_init()
+    uint32_t failures;    // allocations which found the pool empty
+};
+typedef struct packet_pool_stats Packet_pool_stats;
+
+void packet_pool_init();
+
+// returns NULL if all buffers are in use
+Packet_buf *packet_pool_alloc();
+
+// returns false (and ignores the call) for NULL, pointers which are not the start of a slot and buffers which are already free
+bool packet_pool_free(Packet_buf *buf);
+
+void packet_pool_summary(Packet_pool_stats *stats);
+
+#endif
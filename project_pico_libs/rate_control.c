@@ -0,0 +1,106 @@
+/**
+ * Rate adaptation (Minstrel-like)
+ *
+ * See rate_control.h
+ *
+ */
+
+#include <string.h>
+#include "rate_control.h"
+
+void rate_control_init(Rate_control *rc, const uint32_t *bitrates, uint8_t count, uint8_t start){
+    memset(rc, 0, sizeof(Rate_control));
+    rc->count = (count < RATE_MAX_PROFILES) ? count : RATE_MAX_PROFILES;
+    for(uint8_t p = 0; p < rc->count; p++){
+        rc->profiles[p].bitrate = bitrates[p];
+    }
+    rc->best = (start < rc->count) ? start : 0;
+    rc->random = 0x2545F491;
+}
+
+uint32_t rate_control_goodput(const Rate_control *rc, uint8_t profile){
+    const Rate_stats *s = &rc->profiles[profile];
+    if(!s->measured || s->prob_ppm < RATE_MIN_PROB_PPM){
+        return 0;
+    }
+    return ((uint64_t) s->bitrate * s->prob_ppm) / 1000000;
+}
+
+// fold the interval into the averages and choose the best profile
+static void update(Rate_control *rc){
+    for(uint8_t p = 0; p < rc->count; p++){
+        Rate_stats *s = &rc->profiles[p];
+        if(s->attempts == 0){
+            continue;
+        }
+        uint32_t prob = ((uint32_t) s->successes * 1000000) / s->attempts;
+        if(s->measured){
+            s->prob_ppm = (int32_t) s->prob_ppm + ((int32_t) prob - (int32_t) s->prob_ppm) / (1 << RATE_EWMA_SHIFT);
+        }else{
+            s->prob_ppm = prob;
+            s->measured = true;
+        }
+        s->attempts = 0;
+        s->successes = 0;
+    }
+    uint8_t best = rc->best;
+    for(uint8_t p = 0; p < rc->count; p++){
+        if(rate_control_goodput(rc, p) > rate_control_goodput(rc, best)){
+            best = p;
+        }
+    }
+    if(rate_control_goodput(rc, best) == 0){
+        // nothing gets through: fall back to the slowest (most robust) profile
+        for(uint8_t p = 0; p < rc->count; p++){
+            best = (rc->profiles[p].bitrate < rc->profiles[best].bitrate) ? p : best;
+        }
+    }
+    rc->best = best;
+    rc->results = 0;
+}
+
+// a profile which could beat the best one (unmeasured first), the best one if there is none
+static uint8_t sample_profile(Rate_control *rc){
+    uint32_t goodput = rate_control_goodput(rc, rc->best);
+    uint8_t candidates[RATE_MAX_PROFILES];
+    uint8_t count = 0;
+    for(uint8_t p = 0; p < rc->count; p++){
+        if(p != rc->best && !rc->profiles[p].measured){
+            candidates[count++] = p;
+        }
+    }
+    for(uint8_t p = 0; count == 0 && p < rc->count; p++){
+        if(p != rc->best && rc->profiles[p].bitrate > goodput){
+            candidates[count++] = p;
+        }
+    }
+    if(count == 0){
+        return rc->best;
+    }
+    rc->random ^= rc->random << 13;
+    rc->random ^= rc->random >> 17;
+    rc->random ^= rc->random << 5;
+    return candidates[rc->random % count];
+}
+
+uint8_t rate_control_next(Rate_control *rc){
+    rc->packets++;
+    if(rc->packets % RATE_SAMPLE_PERIOD == 0){
+        return sample_profile(rc);
+    }
+    return rc->best;
+}
+
+void rate_control_feedback(Rate_control *rc, uint8_t profile, bool delivered){
+    if(profile >= rc->count){
+        return;
+    }
+    Rate_stats *s = &rc->profiles[profile];
+    s->attempts++;
+    s->successes += delivered;
+    s->total_attempts++;
+    s->total_successes += delivered;
+    if(++rc->results >= RATE_UPDATE_PACKETS){
+        update(rc);
+    }
+}
@@ -0,0 +1,63 @@
+/**
+ * Rate adaptation (Minstrel-like)
+ *
+ * Chooses one of up to RATE_MAX_PROFILES baseband profiles (e.g. clock dividers and baud-rate) for every packet,
+ * based on whether the packets sent with each profile were delivered:
+ * - every RATE_UPDATE_PACKETS results, the delivery ratio of each used profile enters an exponentially
+ *   weighted moving average (1/2^RATE_EWMA_SHIFT weight of the new interval)
+ * - the profile with the highest expected goodput (bit-rate * delivery probability) is used
+ * - every RATE_SAMPLE_PERIOD-th packet probes another profile which could be better: one whose bit-rate
+ *   exceeds the expected goodput of the best one (unmeasured profiles first)
+ * Profiles with a delivery probability below RATE_MIN_PROB_PPM are never chosen as best.
+ *
+ * The module only keeps statistics and decides, the caller applies the profile at a packet boundary.
+ */
+
+#ifndef RATE_CONTROL_LIB
+#define RATE_CONTROL_LIB
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RATE_MAX_PROFILES        8
+#define RATE_UPDATE_PACKETS     10
+#define RATE_EWMA_SHIFT          2
+#define RATE_SAMPLE_PERIOD      10
+#define RATE_MIN_PROB_PPM   100000
+
+struct rate_stats {
+    uint32_t bitrate;          // nominal [bit/s]
+    uint16_t attempts;         // current interval
+    uint16_t successes;
+    uint32_t prob_ppm;         // delivery probability (EWMA)
+    bool measured;             // prob_ppm is valid
+    uint32_t total_attempts;
+    uint32_t total_successes;
+};
+typedef struct rate_stats Rate_stats;
+
+struct rate_control {
+    Rate_stats profiles[RATE_MAX_PROFILES];
+    uint8_t count;
+    uint8_t best;
+    uint8_t results;           // since the last update
+    uint32_t packets;          // chosen so far
+    uint32_t random;           // sampling (xorshift)
+};
+typedef struct rate_control Rate_control;
+
+/*
+ * bitrates: nominal bit-rate of each profile, start: profile used until the first statistics
+ */
+void rate_control_init(Rate_control *rc, const uint32_t *bitrates, uint8_t count, uint8_t start);
+
+// profile for the next packet
+uint8_t rate_control_next(Rate_control *rc);
+
+// result of a packet sent with profile
+void rate_control_feedback(Rate_control *rc, uint8_t profile, bool delivered);
+
+// expected goodput of a profile [bit/s] (0 if unmeasured)
+uint32_t rate_control_goodput(const Rate_control *rc, uint8_t profile);
+
+#endif
@@ -23,6 +23,7 @@
 #include "hardware/spi.h"
 #include "receiver_CC2500.h"
 #include "carrier_CC2500.h"
+#include "trace.h"
 
 queue_t event_queue;
 
@@ -141,6 +142,7 @@ void print_registers_rx() {
 void receiver_isr(uint gpio, uint32_t events)
 {
     event_t evt;
+    trace_instant(trace_gdo0_irq, events);
     switch(gpio){
         case RX_GDO0_PIN:
             switch(events){
@@ -252,17 +254,64 @@ event_t get_event(void)
     return no_evt;
 }
 
-void set_datarate_rx(uint32_t r_data)
+bool event_pending(void)
+{
+    return !queue_is_empty(&event_queue);
+}
+
+/*
+ * register values for the data rate [baud] (DRATE_E, DRATE_M), returns the resulting data rate
+ * see datasheet, section 12
+ */
+uint32_t datarate_registers(uint32_t r_data, uint8_t *drate_e, uint8_t *drate_m)
+{
+    *drate_e = floor(log2(((double) r_data * (1 << 20)) / ((double) F_XOSC)));
+    *drate_m = floor(((double) r_data * (1 << 28)) / ((double) F_XOSC * (1 << *drate_e)) - 256.0);
+    return floor(((256.0+*drate_m)*(1 << *drate_e) * (double) F_XOSC) / ((double) (1 << 28)));
+}
+
+/*
+ * register values for the filter bandwidth [Hz] (CHANBW_E, CHANBW_M), returns the resulting bandwidth
+ * see datasheet, section 13
+ */
+uint32_t filter_bandwidth_registers(uint32_t bw, uint8_t *chanbw_e, uint8_t *chanbw_m)
+{
+    *chanbw_e = floor(log2(((double) F_XOSC)/((double) (1 << 5) * bw)/log2(2.0)));
+    *chanbw_m = floor(((double) F_XOSC)/((double) 8.0 * bw * (1 << *chanbw_e)) - 4.0);
+    return floor(((double) F_XOSC) / ((double) 8.0*(4.0+*chanbw_m)*(1 << *chanbw_e)));
+}
+
+/*
+ * register values for the FSK frequency deviation [Hz] (DEVIATION_E, DEVIATION_M), returns the resulting deviation
+ * see datasheet, section 16
+ */
+uint32_t frequency_deviation_registers(uint32_t f_dev, uint8_t *deviation_e, uint8_t *deviation_m)
+{
+    *deviation_e = floor(log2(((double) f_dev) * (1 << 14) / ((double) F_XOSC)));
+    *deviation_m = floor((((double) f_dev) * (1 << 17)) / ((double) (1 << *deviation_e) * F_XOSC) - 8.0);
+    return floor(((double) F_XOSC) * (8.0 + (double) *deviation_m + 1.0)*(1 << *deviation_e) / ((double) (1 << 17)));
+}
+
+/*
+ * register values for the carrier frequency [Hz] (FREQ, CHANNR, CHANSPC_E, CHANSPC_M), returns the resulting frequency
+ * see datasheet, section 21
+ * approach: chose start frequency as close as possible to f_carrier, correct with channel
+ */
+uint32_t frequency_registers(uint32_t f_carrier, uint32_t *freq, uint8_t *channel, uint8_t *channspc_e, uint8_t *channspc_m)
+{
+    *freq = floor(f_carrier *((double) (1 << 16)) / ((double) F_XOSC));
+    *channel = 0;
+    *channspc_e = 0;
+    *channspc_m = floor(((((double) f_carrier) * (1 << 16)) / ((double) F_XOSC) - *freq - (1 << 6)) * (1 << 2));
+    return floor(((double) F_XOSC) * (*freq + (double) *channel*(256+*channspc_m)/((double) (1 << 2))) / ((double) (1 << 16)));
+}
+
+uint32_t set_datarate_rx_quiet(uint32_t r_data)
 {
     write_strobe_rx(SIDLE); // ensure IDLE mode with command strobe: SIDLE
     
-    // see datasheet, section 12
-    uint8_t drate_e = floor(log2(((double) r_data * (1 << 20)) / ((double) F_XOSC)));
-    uint8_t drate_m = floor(((double) r_data * (1 << 28)) / ((double) F_XOSC * (1 << drate_e)) - 256.0);
-    
-    // print new value
-    uint32_t r_data_calculated = floor(((256.0+drate_m)*(1 << drate_e) * (double) F_XOSC) / ((double) (1 << 28)));
-    printf("set rx r_data: [%u %u] %u\n", drate_e, drate_m, r_data_calculated);
+    uint8_t drate_e, drate_m;
+    uint32_t r_data_calculated = datarate_registers(r_data, &drate_e, &drate_m);
     
     // MDMCFG4, MDMCFG3
     RF_setting mdmcfg3 = read_register_rx(0x10);
@@ -271,44 +320,98 @@ void set_datarate_rx(uint32_t r_data)
         {.address = 0x11, .value = drate_m}
     };
     write_registers_rx(set,2);
+    return r_data_calculated;
 }
 
-void set_filter_bandwidth_rx(uint32_t bw)
+void set_datarate_rx(uint32_t r_data)
 {
-    write_strobe_rx(SIDLE); // ensure IDLE mode with command strobe: SIDLE
+    uint8_t drate_e, drate_m;
+    uint32_t r_data_calculated = set_datarate_rx_quiet(r_data);
+    datarate_registers(r_data, &drate_e, &drate_m);
 
-    // see datasheet, section 13
-    uint8_t chanbw_e = floor(log2(((double) F_XOSC)/((double) (1 << 5) * bw)/log2(2.0)));
-    uint8_t chanbw_m = floor(((double) F_XOSC)/((double) 8.0 * bw * (1 << chanbw_e)) - 4.0);
-    
     // print new value
-    uint32_t bw_calculated = floor(((double) F_XOSC) / ((double) 8.0*(4.0+chanbw_m)*(1 << chanbw_e)));
-    printf("set rx bw: [%u %u] %u\n", chanbw_e, chanbw_m, bw_calculated);
+    printf("set rx r_data: [%u %u] %u\n", drate_e, drate_m, r_data_calculated);
+}
+
+uint32_t set_filter_bandwidth_rx_quiet(uint32_t bw)
+{
+    write_strobe_rx(SIDLE); // ensure IDLE mode with command strobe: SIDLE
+
+    uint8_t chanbw_e, chanbw_m;
+    uint32_t bw_calculated = filter_bandwidth_registers(bw, &chanbw_e, &chanbw_m);
     
     // MDMCFG3
     RF_setting mdmcfg3 = read_register_rx(0x10);
     RF_setting set = (RF_setting){.address = 0x10, .value = ((chanbw_e & 0x03) << 6) + ((chanbw_m & 0x03) << 4) + (mdmcfg3.value & 0x0f)};
     write_register_rx(set);
+    return bw_calculated;
 }
 
-void set_frequency_deviation_rx(uint32_t f_dev)
+void set_filter_bandwidth_rx(uint32_t bw)
+{
+    uint8_t chanbw_e, chanbw_m;
+    uint32_t bw_calculated = set_filter_bandwidth_rx_quiet(bw);
+    filter_bandwidth_registers(bw, &chanbw_e, &chanbw_m);
+
+    // print new value
+    printf("set rx bw: [%u %u] %u\n", chanbw_e, chanbw_m, bw_calculated);
+}
+
+uint32_t set_frequency_deviation_rx_quiet(uint32_t f_dev)
 {
     write_strobe_rx(SIDLE); // ensure IDLE mode with command strobe: SIDLE
 
-    // see datasheet, section 16
-    uint8_t deviation_e = floor(log2(((double) f_dev) * (1 << 14) / ((double) F_XOSC)));
-    uint8_t deviation_m = floor((((double) f_dev) * (1 << 17)) / ((double) (1 << deviation_e) * F_XOSC) - 8.0);
+    uint8_t deviation_e, deviation_m;
+    uint32_t f_dev_calculated = frequency_deviation_registers(f_dev, &deviation_e, &deviation_m);
+
+    // DEVIATN
+    RF_setting set = {.address = 0x15, .value = ((deviation_e & 0x07) << 4) + (deviation_m & 0x07)};
+    write_register_rx(set);
+    return f_dev_calculated;
+}
+
+void set_frequency_deviation_rx(uint32_t f_dev)
+{
+    uint8_t deviation_e, deviation_m;
+    uint32_t f_dev_calculated = set_frequency_deviation_rx_quiet(f_dev);
+    frequency_deviation_registers(f_dev, &deviation_e, &deviation_m);
 
     // new value
-    uint32_t f_dev_calculated = floor(((double) F_XOSC) * (8.0 + (double) deviation_m + 1.0)*(1 << deviation_e) / ((double) (1 << 17)));
     printf("set rx f_dev: [%u %u] %u\n", deviation_e, deviation_m, f_dev_calculated);
+}
 
-    // DEVIATN
-    RF_setting set = {.address = 0x15, .value = ((deviation_e & 0x07) << 4) + (deviation_m & 0x07)};
+void set_whitening_rx(bool whitening)
+{
+    write_strobe_rx(SIDLE); // ensure IDLE mode with command strobe: SIDLE
+
+    // PKTCTRL0: WHITE_DATA (de-whitening of the PN9 whitened packets, see whiten())
+    RF_setting pktctrl0 = read_register_rx(0x08);
+    RF_setting set = {.address = 0x08, .value = (pktctrl0.value & 0xbf) | (whitening ? 0x40 : 0x00)};
     write_register_rx(set);
 }
 
-void set_frecuency_rx(uint32_t f_carrier)
+bool set_frame_format_rx(const Frame_format *format)
+{
+    bool twice = format->sync_len == 4 && format->sync[0] == format->sync[2] && format->sync[1] == format->sync[3];
+    if (format->length_mode != FRAME_LENGTH_VARIABLE || (format->sync_len != 2 && !twice)) {
+        printf("rx: frame format not supported (sync word %u bytes, length mode %u)\n", format->sync_len, format->length_mode);
+        return false;
+    }
+    write_strobe_rx(SIDLE); // ensure IDLE mode with command strobe: SIDLE
+
+    // SYNC1, SYNC0
+    write_register_rx((RF_setting){.address = 0x04, .value = format->sync[0]});
+    write_register_rx((RF_setting){.address = 0x05, .value = format->sync[1]});
+
+    // MDMCFG2: SYNC_MODE 30/32 bits (sync word sent twice) or 16/16 bits
+    RF_setting mdmcfg2 = read_register_rx(0x12);
+    write_register_rx((RF_setting){.address = 0x12, .value = (mdmcfg2.value & 0xf8) | (twice ? 0x03 : 0x02)});
+
+    set_whitening_rx(format->whitening);
+    return true;
+}
+
+uint32_t set_frecuency_rx_quiet(uint32_t f_carrier)
 {
 // Test read_register_rx
 //    RF_setting a = {.address = 0x13, .value = 0xab};
@@ -317,17 +420,10 @@ void set_frecuency_rx(uint32_t f_carrier)
 //    printf("debug return %02x\n", b.value);
     
     write_strobe_rx(SIDLE); // ensure IDLE mode with command strobe: SIDLE
-    // see datasheet, section 21
-    // approach: chose start frequency as close as possible to f_carrier, correct with channel
-    uint32_t freq = floor(f_carrier *((double) (1 << 16)) / ((double) F_XOSC));
-    uint8_t channel = 0;
-    uint8_t channspc_e = 0;
-    uint8_t channspc_m = floor(((((double) f_carrier) * (1 << 16)) / ((double) F_XOSC) - freq - (1 << 6)) * (1 << 2));
+    uint32_t freq;
+    uint8_t channel, channspc_e, channspc_m;
+    uint32_t f_carrier_calculated = frequency_registers(f_carrier, &freq, &channel, &channspc_e, &channspc_m);
 
-    // print new value
-    uint32_t f_carrier_calculated = floor(((double) F_XOSC) * (freq + (double) channel*(256+channspc_m)/((double) (1 << 2))) / ((double) (1 << 16)));
-    printf("set rx f_carrier [%u %u %u %u] %u\n", freq, channel, channspc_e, channspc_m, f_carrier_calculated);
-    
     // CHANNR, FREQ2, FREQ1, FREQ0, MDMCFG1, MDMCFG1
     RF_setting mdmcfg1 = read_register_rx(0x13);
     RF_setting set[6] = {
@@ -340,4 +436,16 @@ void set_frecuency_rx(uint32_t f_carrier)
     };
     //printf("debug %02x %02x %02x %02x %02x %02x\n", set[0].value, set[1].value, set[2].value, set[3].value, set[4].value, set[5].value);
     write_registers_rx(set,6);
+    return f_carrier_calculated;
+}
+
+void set_frecuency_rx(uint32_t f_carrier)
+{
+    uint32_t freq;
+    uint8_t channel, channspc_e, channspc_m;
+    uint32_t f_carrier_calculated = set_frecuency_rx_quiet(f_carrier);
+    frequency_registers(f_carrier, &freq, &channel, &channspc_e, &channspc_m);
+
+    // print new value
+    printf("set rx f_carrier [%u %u %u %u] %u\n", freq, channel, channspc_e, channspc_m, f_carrier_calculated);
 }
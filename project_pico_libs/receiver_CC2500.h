@@ -23,6 +23,7 @@
 #include "pico/util/queue.h"
 #include "pico/binary_info.h"
 #include "hardware/spi.h"
+#include "packet_generation.h"
 
 #define RADIO_SPI             spi0
 #define RADIO_MISO              16
@@ -135,6 +136,21 @@ void printPacket(uint8_t *packet, Packet_status status, uint64_t time_us);
 
 event_t get_event(void);
 
+// true if get_event() has an event (does not remove it)
+bool event_pending(void);
+
+// register values for the data rate [baud], returns the resulting data rate
+uint32_t datarate_registers(uint32_t r_data, uint8_t *drate_e, uint8_t *drate_m);
+
+// register values for the filter bandwidth [Hz], returns the resulting bandwidth
+uint32_t filter_bandwidth_registers(uint32_t bw, uint8_t *chanbw_e, uint8_t *chanbw_m);
+
+// register values for the FSK frequency deviation [Hz], returns the resulting deviation
+uint32_t frequency_deviation_registers(uint32_t f_dev, uint8_t *deviation_e, uint8_t *deviation_m);
+
+// register values for the carrier frequency [Hz], returns the resulting frequency
+uint32_t frequency_registers(uint32_t f_carrier, uint32_t *freq, uint8_t *channel, uint8_t *channspc_e, uint8_t *channspc_m);
+
 //set datarate [baud]
 void set_datarate_rx(uint32_t r_data);
 
@@ -147,4 +163,21 @@ void set_frequency_deviation_rx(uint32_t f_dev);
 //set carrier frequency [Hz]
 void set_frecuency_rx(uint32_t f_carrier);
 
+// set_*_rx() without printing (e.g. on the TX path, see log_ring.h), return the resulting value
+uint32_t set_datarate_rx_quiet(uint32_t r_data);
+uint32_t set_filter_bandwidth_rx_quiet(uint32_t bw);
+uint32_t set_frequency_deviation_rx_quiet(uint32_t f_dev);
+uint32_t set_frecuency_rx_quiet(uint32_t f_carrier);
+
+//enable the hardware de-whitening (PN9, see whiten() in packet_generation.h)
+void set_whitening_rx(bool whitening);
+
+/*
+ * receive the frames of a Frame_format (packet_generation.h): sync word, sync mode and de-whitening
+ * requires a 16-bit sync word (sent once or twice) and the variable length mode (readPacket() returns the length byte first),
+ * the CRC is checked in any case (CRC_EN): frames without it count as CRC error
+ * returns false if the format can not be received
+ */
+bool set_frame_format_rx(const Frame_format *format);
+
 #endif
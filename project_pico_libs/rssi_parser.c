@@ -0,0 +1,79 @@
+/**
+ * Incremental RSSI line parser with moving average
+ *
+ * See rssi_parser.h
+ *
+ */
+
+#include "rssi_parser.h"
+
+static void start_line(Rssi_parser *p, bool synced){
+    p->value = 0;
+    p->negative = false;
+    p->digits = 0;
+    p->done = false;
+    p->synced = synced;
+}
+
+void rssi_parser_init(Rssi_parser *p){
+    start_line(p, false);
+    p->sum = 0;
+    p->count = 0;
+    p->next = 0;
+    p->lines = 0;
+    p->errors = 0;
+}
+
+void rssi_parser_resync(Rssi_parser *p){
+    start_line(p, false);
+}
+
+// add a value to the moving average
+static void push_value(Rssi_parser *p, int16_t value){
+    if(p->count == RSSI_AVERAGE_LEN){
+        p->sum -= p->window[p->next];
+    }else{
+        p->count++;
+    }
+    p->window[p->next] = value;
+    p->sum += value;
+    p->next = (p->next + 1) % RSSI_AVERAGE_LEN;
+    p->lines++;
+}
+
+bool rssi_parser_feed(Rssi_parser *p, uint8_t c){
+    if(c == RSSI_END_MARK){
+        bool valid = p->synced && p->digits > 0;
+        if(valid){
+            push_value(p, p->negative ? -p->value : p->value);
+        }else if(p->synced){
+            p->errors++;
+        }
+        start_line(p, true);
+        return valid;
+    }
+    if(!p->synced || p->done){
+        return false;
+    }
+    if(c >= '0' && c <= '9'){
+        if(p->digits < 4){ // larger values are clipped
+            p->value = 10 * p->value + (c - '0');
+            p->digits++;
+        }
+    }else if(p->digits == 0 && !p->negative && (c == ' ' || c == '\t' || c == '+')){
+        // leading blanks
+    }else if(p->digits == 0 && !p->negative && c == '-'){
+        p->negative = true;
+    }else{
+        p->done = true; // trailing text (or garbage) ends the number
+    }
+    return false;
+}
+
+int16_t rssi_parser_average(const Rssi_parser *p){
+    if(p->count == 0){
+        return RSSI_NONE;
+    }
+    int32_t sum = p->sum + ((p->sum < 0) ? -p->count / 2 : p->count / 2); // rounded
+    return sum / p->count;
+}
@@ -0,0 +1,47 @@
+/**
+ * Incremental RSSI line parser with moving average
+ *
+ * The CC2640R2 reports its RSSI as text lines ("-47\n", leading blanks and trailing text after the number
+ * are ignored like sscanf("%d") did). The parser takes one byte at a time, no line is buffered.
+ * After init or lost bytes it drops everything up to the next end of line (the line may be partial).
+ * Every parsed value enters a moving average over RSSI_AVERAGE_LEN values.
+ *
+ */
+
+#ifndef RSSI_PARSER_LIB
+#define RSSI_PARSER_LIB
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define RSSI_AVERAGE_LEN      8
+#define RSSI_END_MARK      '\n'
+#define RSSI_NONE        INT16_MIN // no value (yet)
+
+struct rssi_parser {
+    int32_t value;                    // line being parsed
+    bool negative;
+    uint8_t digits;
+    bool synced;                      // at the start of a line (or within a line that started there)
+    bool done;                        // the number of this line has ended
+    int16_t window[RSSI_AVERAGE_LEN];
+    int32_t sum;
+    uint8_t count;                    // values in the window
+    uint8_t next;
+    uint32_t lines;                   // values parsed
+    uint32_t errors;                  // lines without a number
+};
+typedef struct rssi_parser Rssi_parser;
+
+void rssi_parser_init(Rssi_parser *p);
+
+// bytes were lost: drop the current line
+void rssi_parser_resync(Rssi_parser *p);
+
+// returns true if c completed a line with a value
+bool rssi_parser_feed(Rssi_parser *p, uint8_t c);
+
+// moving average [dBm], RSSI_NONE if no value has been parsed
+int16_t rssi_parser_average(const Rssi_parser *p);
+
+#endif
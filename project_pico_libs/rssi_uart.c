@@ -0,0 +1,93 @@
+/**
+ * Interrupt-driven RSSI ingestion from the CC2640R2 (UART)
+ *
+ * See rssi_uart.h
+ *
+ */
+
+#include "pico/stdlib.h"
+#include "hardware/uart.h"
+#include "hardware/irq.h"
+#include "hardware/sync.h"
+#include "rssi_uart.h"
+
+#define RSSI_LOST 0xFF // stored in the last free slot of the ring: bytes are lost from here on
+
+static uart_inst_t *rssi_uart;
+static uint8_t rssi_ring[RSSI_RING_LEN];
+static volatile uint32_t rssi_head = 0;      // bytes written (interrupt)
+static volatile uint32_t rssi_tail = 0;      // bytes parsed (reader)
+static volatile uint32_t rssi_overflows = 0; // bytes dropped on a full ring (interrupt)
+static Rssi_parser rssi_parser;
+static uint64_t rssi_time_us = 0;            // last value
+static spin_lock_t *rssi_lock = NULL;        // parser, tail and rssi_time_us (readers on both cores)
+
+static void rssi_uart_irq(){
+    while(uart_is_readable(rssi_uart)){
+        uint8_t c = uart_getc(rssi_uart);
+        uint32_t used = rssi_head - rssi_tail;
+        if(used >= RSSI_RING_LEN - 1){
+            rssi_overflows++;
+            if(used == RSSI_RING_LEN){
+                continue; // the gap is marked already
+            }
+            c = RSSI_LOST;
+        }
+        rssi_ring[rssi_head % RSSI_RING_LEN] = c;
+        __dmb(); // byte has to be visible before the head moves
+        rssi_head++;
+    }
+}
+
+void rssi_uart_init(uart_inst_t *uart, uint baudrate, uint pin_rx){
+    rssi_uart = uart;
+    if(rssi_lock == NULL){
+        rssi_lock = spin_lock_instance(spin_lock_claim_unused(true));
+    }
+    rssi_parser_init(&rssi_parser);
+    uart_init(uart, baudrate);
+    gpio_set_function(pin_rx, UART_FUNCSEL_NUM(uart, pin_rx));
+    uart_set_hw_flow(uart, false, false);
+    uart_set_format(uart, 8, 1, UART_PARITY_NONE);
+    uart_set_fifo_enabled(uart, true);
+    uint irq = (uart == uart0) ? UART0_IRQ : UART1_IRQ;
+    irq_set_exclusive_handler(irq, rssi_uart_irq);
+    irq_set_enabled(irq, true);
+    uart_set_irq_enables(uart, true, false);
+}
+
+// parse the bytes received since the last call (rssi_lock held)
+static void rssi_uart_update(){
+    uint32_t head = rssi_head;
+    __dmb(); // read the bytes only after observing the head
+    while(rssi_tail != head){
+        uint8_t c = rssi_ring[rssi_tail % RSSI_RING_LEN];
+        if(c == RSSI_LOST){
+            rssi_parser_resync(&rssi_parser); // the current line misses bytes
+        }else if(rssi_parser_feed(&rssi_parser, c)){
+            rssi_time_us = time_us_64();
+        }
+        __dmb(); // done reading before the interrupt may reuse the slot
+        rssi_tail++;
+    }
+}
+
+int16_t rssi_current(uint32_t max_age_us){
+    uint32_t irq_state = spin_lock_blocking(rssi_lock);
+    rssi_uart_update();
+    int16_t rssi = RSSI_NONE;
+    if(rssi_time_us != 0 && time_us_64() - rssi_time_us <= max_age_us){
+        rssi = rssi_parser_average(&rssi_parser);
+    }
+    spin_unlock(rssi_lock, irq_state);
+    return rssi;
+}
+
+void rssi_uart_counters(uint32_t *lines, uint32_t *errors, uint32_t *overflows){
+    uint32_t irq_state = spin_lock_blocking(rssi_lock);
+    rssi_uart_update();
+    *lines = rssi_parser.lines;
+    *errors = rssi_parser.errors;
+    *overflows = rssi_overflows;
+    spin_unlock(rssi_lock, irq_state);
+}
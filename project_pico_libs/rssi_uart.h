@@ -0,0 +1,32 @@
+/**
+ * Interrupt-driven RSSI ingestion from the CC2640R2 (UART)
+ *
+ * The UART RX interrupt copies the received bytes into a ring (RSSI_RING_LEN bytes), the lines are parsed
+ * from the ring whenever the RSSI is asked for (rssi_parser.h). Reading the RSSI never waits for a line:
+ * it is the moving average of the last values, or RSSI_NONE if there is no recent one.
+ * The interrupt may run on the other core than the reader (single producer, single consumer).
+ * Both cores may read: the parsing is guarded by a spin lock.
+ *
+ */
+
+#ifndef RSSI_UART_LIB
+#define RSSI_UART_LIB
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+#include "hardware/uart.h"
+#include "rssi_parser.h"
+
+#define RSSI_RING_LEN   256 // bytes, a power of two
+
+// set up uart at baudrate on pin_rx (RX only) and enable its RX interrupt on the calling core
+void rssi_uart_init(uart_inst_t *uart, uint baudrate, uint pin_rx);
+
+// moving average of the RSSI [dBm], RSSI_NONE if no value was received within max_age_us
+int16_t rssi_current(uint32_t max_age_us);
+
+// received values, lines without a value and bytes lost on a full ring
+void rssi_uart_counters(uint32_t *lines, uint32_t *errors, uint32_t *overflows);
+
+#endif
@@ -0,0 +1,71 @@
+/**
+ * Event-driven, energy-aware task scheduler
+ *
+ * See scheduler.h
+ *
+ */
+
+#include <stddef.h>
+#include "scheduler.h"
+
+void sched_init(Scheduler *s, Sched_task *tasks, uint8_t count, uint32_t poll_us, uint32_t idle_us,
+                uint64_t (*clock_us)(void), uint16_t (*supply_mv)(void), void (*sleep_until)(uint64_t time_us)){
+    s->tasks = tasks;
+    s->count = (count < SCHED_MAX_TASKS) ? count : SCHED_MAX_TASKS;
+    s->poll_us = poll_us;
+    s->idle_us = idle_us;
+    s->clock_us = clock_us;
+    s->supply_mv = supply_mv;
+    s->sleep_until = sleep_until;
+    s->now_us = clock_us();
+    s->supply = 0;
+    s->sleeps = 0;
+    s->energy_waits = 0;
+    for(uint8_t i = 0; i < s->count; i++){
+        tasks[i].next_us = s->now_us;
+        tasks[i].runs = 0;
+    }
+}
+
+uint64_t sched_next(Scheduler *s, Sched_task **task){
+    s->now_us = s->clock_us();
+    s->supply = s->supply_mv();
+    uint64_t wake_us = s->now_us + s->idle_us;
+    bool energy_wait = false;
+    *task = NULL;
+    for(uint8_t i = 0; i < s->count; i++){
+        Sched_task *t = &s->tasks[i];
+        if(s->now_us < t->next_us){
+            wake_us = (t->next_us < wake_us) ? t->next_us : wake_us;
+            continue;
+        }
+        if(t->ready != NULL && !t->ready(s)){
+            continue; // an interrupt or another task makes it ready
+        }
+        if(s->supply < t->min_mv){
+            energy_wait = true;
+            continue; // a task of lower priority may still fit into the energy budget
+        }
+        *task = t;
+        return s->now_us;
+    }
+    if(energy_wait && s->now_us + s->poll_us < wake_us){
+        wake_us = s->now_us + s->poll_us;
+    }
+    s->energy_waits += energy_wait;
+    return wake_us;
+}
+
+Sched_task *sched_step(Scheduler *s){
+    Sched_task *t;
+    uint64_t wake_us = sched_next(s, &t);
+    if(t == NULL){
+        s->sleeps++;
+        s->sleep_until(wake_us);
+        return NULL;
+    }
+    t->runs++;
+    uint32_t delay_us = t->run(s);
+    t->next_us = s->clock_us() + delay_us;
+    return t;
+}
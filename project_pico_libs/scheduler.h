@@ -0,0 +1,63 @@
+/**
+ * Event-driven, energy-aware task scheduler
+ *
+ * The tasks are kept in priority order. A step runs the first task whose preconditions hold:
+ * - time:   the delay the task asked for after its last run has passed
+ * - energy: the supply voltage is at least min_mv
+ * - ready:  the task specific condition (e.g. a packet was received, a frame is waiting, the link is good)
+ * If no task can run, the scheduler sleeps until the next task becomes due, a task waiting for energy
+ * re-checks the supply every poll_us, any interrupt ends the sleep early. Thus, the tasks run as fast as
+ * the harvested energy allows instead of after fixed delays.
+ *
+ * The policy only sees the time, the supply and the sleep through the hooks of the scheduler:
+ * on the Pico they are the timer, the ADC and a WFE sleep with an alarm, on the host a simulated clock
+ * and energy model (see tests/test_scheduler.c).
+ *
+ */
+
+#ifndef SCHEDULER_LIB
+#define SCHEDULER_LIB
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SCHED_MAX_TASKS    8
+
+typedef struct scheduler Scheduler;
+
+struct sched_task {
+    const char *name;
+    uint16_t min_mv;                    // supply needed to start the task [mV], 0: none
+    bool (*ready)(const Scheduler *s);  // further precondition, NULL: always ready
+    uint32_t (*run)(Scheduler *s);      // returns the time until the task may run again [us]
+    uint64_t next_us;                   // earliest start
+    uint32_t runs;
+};
+typedef struct sched_task Sched_task;
+
+struct scheduler {
+    Sched_task *tasks;                  // highest priority first
+    uint8_t count;
+    uint32_t poll_us;                   // supply re-check while a task waits for energy
+    uint32_t idle_us;                   // longest sleep
+    uint64_t (*clock_us)(void);
+    uint16_t (*supply_mv)(void);
+    void (*sleep_until)(uint64_t time_us); // may return early (interrupt)
+    uint64_t now_us;                    // time of the current step
+    uint16_t supply;                    // supply of the current step [mV]
+    uint32_t sleeps;
+    uint32_t energy_waits;              // sleeps with a task waiting for energy
+};
+
+void sched_init(Scheduler *s, Sched_task *tasks, uint8_t count, uint32_t poll_us, uint32_t idle_us,
+                uint64_t (*clock_us)(void), uint16_t (*supply_mv)(void), void (*sleep_until)(uint64_t time_us));
+
+// wake-up time of the next step, task: the task which can run now (NULL: sleep until the returned time)
+uint64_t sched_next(Scheduler *s, Sched_task **task);
+
+/*
+ * run the next task or sleep until it may become ready, returns the task which ran (NULL: slept)
+ */
+Sched_task *sched_step(Scheduler *s);
+
+#endif
@@ -0,0 +1,73 @@
+/**
+ * Supply voltage filter with trend prediction
+ *
+ * See supply_filter.h
+ *
+ */
+
+#include "supply_filter.h"
+
+void supply_filter_init(Supply_filter *f, uint32_t sample_us){
+    f->sample_us = sample_us;
+    f->mv_q8 = 0;
+    f->block_q8 = 0;
+    f->block_samples = 0;
+    f->slope_uv_per_s = 0;
+    f->blocks = 0;
+    f->primed = false;
+}
+
+// close the current block: slope since its start
+static void close_block(Supply_filter *f){
+    int64_t block_us = (int64_t) f->block_samples * f->sample_us;
+    int32_t slope = ((int64_t) (f->mv_q8 - f->block_q8) * 1000 * 1000000) / (256 * block_us);
+    if(f->blocks == 0){
+        f->slope_uv_per_s = slope;
+    }else{
+        f->slope_uv_per_s += (slope - f->slope_uv_per_s) / (1 << SUPPLY_SLOPE_SHIFT);
+    }
+    f->blocks++;
+    f->block_q8 = f->mv_q8;
+    f->block_samples = 0;
+}
+
+void supply_filter_add(Supply_filter *f, uint16_t raw){
+    int32_t mv_q8 = ((int32_t) (raw & 0x0FFF) * 3300) >> 4; // raw * 3300 mV * 256 / 4096
+    if(!f->primed){
+        f->mv_q8 = mv_q8;
+        f->block_q8 = mv_q8;
+        f->block_samples = 0;
+        f->primed = true;
+        return;
+    }
+    f->mv_q8 += (mv_q8 - f->mv_q8) / (1 << SUPPLY_FILTER_SHIFT);
+    if(++f->block_samples >= SUPPLY_SLOPE_SAMPLES){
+        close_block(f);
+    }
+}
+
+void supply_filter_skip(Supply_filter *f, uint32_t samples){
+    if(samples > 0){
+        f->primed = false; // restart the average and the block with the next sample, the slope is kept
+    }
+}
+
+uint16_t supply_filter_mv(const Supply_filter *f){
+    return (f->mv_q8 + 128) >> 8;
+}
+
+int32_t supply_filter_slope(const Supply_filter *f){
+    return f->slope_uv_per_s;
+}
+
+uint32_t supply_filter_time_to(const Supply_filter *f, uint16_t threshold_mv){
+    int64_t diff_uv = ((int64_t) threshold_mv * 256 - f->mv_q8) * 1000 / 256;
+    if(diff_uv == 0 || (f->slope_uv_per_s < 0 && diff_uv > 0) || (f->slope_uv_per_s > 0 && diff_uv < 0)){
+        return 0; // there already or past it in the direction of the trend
+    }
+    if(f->slope_uv_per_s == 0){
+        return SUPPLY_NEVER;
+    }
+    int64_t time_us = diff_uv * 1000000 / f->slope_uv_per_s;
+    return (time_us < SUPPLY_NEVER) ? time_us : SUPPLY_NEVER - 1;
+}
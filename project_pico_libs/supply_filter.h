@@ -0,0 +1,55 @@
+/**
+ * Supply voltage filter with trend prediction
+ *
+ * Fed with the raw 12-bit ADC samples of the supply (3.3 V reference, constant sample rate):
+ * - voltage: exponential moving average over 2^SUPPLY_FILTER_SHIFT samples (Q8 mV)
+ * - slope:   change of the filtered voltage per block of SUPPLY_SLOPE_SAMPLES samples, averaged over
+ *            2^SUPPLY_SLOPE_SHIFT blocks (uV/s)
+ * The time until the supply reaches a threshold is extrapolated linearly from both.
+ * Integer arithmetic only (no float on the sample path).
+ *
+ */
+
+#ifndef SUPPLY_FILTER_LIB
+#define SUPPLY_FILTER_LIB
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SUPPLY_FILTER_SHIFT       4
+#define SUPPLY_SLOPE_SAMPLES     64
+#define SUPPLY_SLOPE_SHIFT        2
+#define SUPPLY_NEVER     UINT32_MAX // the threshold is not reached with the current trend
+
+struct supply_filter {
+    uint32_t sample_us;       // sample period
+    int32_t mv_q8;            // filtered voltage [mV/256]
+    int32_t block_q8;         // filtered voltage at the start of the block
+    uint32_t block_samples;   // samples of the current block
+    int32_t slope_uv_per_s;
+    uint32_t blocks;
+    bool primed;              // a sample has been seen (since the last gap)
+};
+typedef struct supply_filter Supply_filter;
+
+void supply_filter_init(Supply_filter *f, uint32_t sample_us);
+
+// add one raw ADC sample
+void supply_filter_add(Supply_filter *f, uint16_t raw);
+
+// samples which were lost (e.g. overwritten in a ring): the average restarts with the next sample
+void supply_filter_skip(Supply_filter *f, uint32_t samples);
+
+// filtered voltage [mV]
+uint16_t supply_filter_mv(const Supply_filter *f);
+
+// trend [uV/s]
+int32_t supply_filter_slope(const Supply_filter *f);
+
+/*
+ * time until the filtered voltage reaches threshold_mv along the trend [us], 0 if it is there already or past it
+ * (e.g. below it and falling), SUPPLY_NEVER without a trend
+ */
+uint32_t supply_filter_time_to(const Supply_filter *f, uint16_t threshold_mv);
+
+#endif
@@ -0,0 +1,93 @@
+/**
+ * Background supply monitor
+ *
+ * See supply_monitor.h
+ *
+ */
+
+#include "pico/stdlib.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/sync.h"
+#include "supply_monitor.h"
+
+#define SUPPLY_DMA_COUNT 0xFFFFFFFFu // transfers per start (about 49 days at 1 kHz), restarted when done
+
+static uint16_t supply_ring[SUPPLY_RING_SAMPLES] __attribute__((aligned(2 * SUPPLY_RING_SAMPLES)));
+static Supply_filter supply_filter;
+static uint supply_dma;
+static uint32_t supply_consumed; // samples folded into the filter (since the DMA start)
+static spin_lock_t *supply_lock = NULL; // filter and supply_consumed (readers on both cores)
+
+static void supply_dma_start(){
+    dma_channel_config c = dma_channel_get_default_config(supply_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+    channel_config_set_read_increment(&c, false);
+    channel_config_set_write_increment(&c, true);
+    channel_config_set_ring(&c, true, __builtin_ctz(2 * SUPPLY_RING_SAMPLES)); // wrap the write address
+    channel_config_set_dreq(&c, DREQ_ADC);
+    supply_consumed = 0;
+    dma_channel_configure(supply_dma, &c, supply_ring, &adc_hw->fifo, SUPPLY_DMA_COUNT, true);
+}
+
+bool supply_monitor_init(uint adc_input, uint32_t sample_hz){
+    if(adc_input > 3 || sample_hz == 0 || sample_hz > 500000){
+        printf("ERROR: supply monitor: ADC input %d at %d Hz is not supported.\n", adc_input, sample_hz);
+        return false;
+    }
+    if(supply_lock == NULL){
+        supply_lock = spin_lock_instance(spin_lock_claim_unused(true));
+    }
+    supply_filter_init(&supply_filter, 1000000 / sample_hz);
+    adc_init();
+    adc_gpio_init(26 + adc_input);
+    adc_select_input(adc_input);
+    adc_set_round_robin(1u << adc_input);
+    adc_fifo_setup(true, true, 1, false, false); // FIFO with DREQ at one sample, no error bit, 12 bit
+    adc_set_clkdiv(48000000.0f / sample_hz - 1); // 48 MHz ADC clock, one conversion takes 96 cycles
+    supply_dma = dma_claim_unused_channel(true);
+    supply_dma_start();
+    adc_run(true);
+    return true;
+}
+
+// fold the samples written by the DMA since the last call into the filter (supply_lock held)
+static void supply_monitor_update(){
+    uint32_t written = SUPPLY_DMA_COUNT - dma_hw->ch[supply_dma].transfer_count;
+    uint32_t fresh = written - supply_consumed;
+    if(fresh > SUPPLY_RING_SAMPLES - 8){ // the oldest ones have been overwritten (or are about to be)
+        supply_filter_skip(&supply_filter, fresh - (SUPPLY_RING_SAMPLES - 8));
+        supply_consumed = written - (SUPPLY_RING_SAMPLES - 8);
+    }
+    while(supply_consumed != written){
+        supply_filter_add(&supply_filter, supply_ring[supply_consumed % SUPPLY_RING_SAMPLES]);
+        supply_consumed++;
+    }
+    if(!dma_channel_is_busy(supply_dma)){
+        supply_dma_start();
+    }
+}
+
+uint16_t supply_mv(void){
+    uint32_t irq_state = spin_lock_blocking(supply_lock);
+    supply_monitor_update();
+    uint16_t mv = supply_filter_mv(&supply_filter);
+    spin_unlock(supply_lock, irq_state);
+    return mv;
+}
+
+int32_t supply_slope(void){
+    uint32_t irq_state = spin_lock_blocking(supply_lock);
+    supply_monitor_update();
+    int32_t slope = supply_filter_slope(&supply_filter) / 1000;
+    spin_unlock(supply_lock, irq_state);
+    return slope;
+}
+
+uint32_t supply_predict_time_to(uint16_t threshold_mv){
+    uint32_t irq_state = spin_lock_blocking(supply_lock);
+    supply_monitor_update();
+    uint32_t time_us = supply_filter_time_to(&supply_filter, threshold_mv);
+    spin_unlock(supply_lock, irq_state);
+    return time_us;
+}
@@ -0,0 +1,37 @@
+/**
+ * Background supply monitor
+ *
+ * The ADC samples the supply free-running (round-robin over the supply input only) at a fixed rate,
+ * a DMA channel writes the samples into a ring in RAM. No interrupt and no blocking adc_read():
+ * the samples written since the last call are folded into a filter (supply_filter.h) whenever the
+ * voltage, its trend or a prediction is asked for.
+ * Both cores may read: the filter update is guarded by a spin lock.
+ *
+ */
+
+#ifndef SUPPLY_MONITOR_LIB
+#define SUPPLY_MONITOR_LIB
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pico/stdlib.h"
+#include "supply_filter.h"
+
+#define SUPPLY_RING_SAMPLES   1024 // 2 KB, about 1 s at 1 kHz (a power of two)
+
+/*
+ * start sampling ADC input adc_input (0..3: GPIO 26..29) at sample_hz, claims a DMA channel
+ * returns false if the input or the rate is not supported
+ */
+bool supply_monitor_init(uint adc_input, uint32_t sample_hz);
+
+// filtered supply voltage [mV]
+uint16_t supply_mv(void);
+
+// trend of the supply [mV/s]
+int32_t supply_slope(void);
+
+// time until the supply reaches threshold_mv along the trend [us], 0: reached or past it, SUPPLY_NEVER: no trend
+uint32_t supply_predict_time_to(uint16_t threshold_mv);
+
+#endif
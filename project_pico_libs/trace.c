@@ -0,0 +1,89 @@
+/**
+ * Per-stage latency trace
+ *
+ * See trace.h
+ *
+ */
+
+#include "trace.h"
+
+#if TRACE_ENABLED
+
+#include <stdio.h>
+#include "pico/stdlib.h"
+#include "hardware/sync.h"
+
+static const char *trace_stage_names[TRACE_STAGES] = {
+    "build_frame",
+    "backscatter_send",
+    "airtime",
+    "gdo0_irq",
+    "readPacket",
+    "printPacket",
+    "RX_start_listen",
+    "link_stats",
+};
+
+static Trace_event trace_ring[TRACE_LENGTH];
+static uint32_t trace_head = 0; // total number of recorded events
+static volatile bool trace_paused = false;
+static spin_lock_t *trace_lock = NULL;
+
+void trace_init(){
+    if(trace_lock == NULL){
+        trace_lock = spin_lock_instance(spin_lock_claim_unused(true));
+    }
+    uint32_t irq_state = spin_lock_blocking(trace_lock);
+    trace_head = 0;
+    trace_paused = false;
+    spin_unlock(trace_lock, irq_state);
+}
+
+void trace_record(trace_stage_t stage, char phase, uint16_t arg){
+    if(trace_paused){
+        return; // without the lock while a dump is printed
+    }
+    uint32_t irq_state = spin_lock_blocking(trace_lock);
+    if(trace_paused){ // a dump started meanwhile
+        spin_unlock(trace_lock, irq_state);
+        return;
+    }
+    Trace_event *event = &trace_ring[trace_head & (TRACE_LENGTH-1)];
+    event->time_us = time_us_64();
+    event->stage = stage;
+    event->phase = phase;
+    event->arg = arg;
+    trace_head++;
+    spin_unlock(trace_lock, irq_state);
+}
+
+void trace_dump(){
+    // a recording in progress on the other core completes first, later ones see the pause
+    uint32_t irq_state = spin_lock_blocking(trace_lock);
+    trace_paused = true;
+    spin_unlock(trace_lock, irq_state);
+
+    uint32_t count = (trace_head < TRACE_LENGTH) ? trace_head : TRACE_LENGTH;
+    printf("trace: dump %u events, %u overwritten\n", count, trace_head - count);
+    for(uint8_t i = 0; i < TRACE_STAGES; i++){
+        printf("trace: stage %u %s\n", i, trace_stage_names[i]);
+    }
+    for(uint32_t i = trace_head - count; i != trace_head; i++){
+        Trace_event *event = &trace_ring[i & (TRACE_LENGTH-1)];
+        printf("trace: %llu %u %c %u\n", (unsigned long long) event->time_us, event->stage, event->phase, event->arg);
+    }
+    printf("trace: end\n");
+
+    irq_state = spin_lock_blocking(trace_lock);
+    trace_head = 0;
+    trace_paused = false;
+    spin_unlock(trace_lock, irq_state);
+}
+
+void trace_poll(){
+    if(getchar_timeout_us(0) == TRACE_DUMP_CHAR){
+        trace_dump();
+    }
+}
+
+#endif
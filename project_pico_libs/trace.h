@@ -0,0 +1,80 @@
+/**
+ * Per-stage latency trace
+ *
+ * Tracepoints record begin/end/instant events (64-bit timestamp [us], stage, small argument) into a fixed
+ * RAM ring. The ring keeps the latest TRACE_LENGTH events (older ones are overwritten) and is printed on
+ * request with trace_dump(), e.g. after receiving TRACE_DUMP_CHAR over stdio (see trace_poll).
+ * stats/trace_to_chrome.py converts a dump into the Chrome trace format (chrome://tracing, ui.perfetto.dev).
+ *
+ * - recording takes a hardware spin lock with interrupts disabled: usable from both cores and from ISRs
+ * - with TRACE_ENABLED 0 (default) all tracepoints compile to nothing and trace.c is empty
+ *
+ * Dump format (text):
+ *   trace: dump <events> events, <overwritten> overwritten
+ *   trace: stage <id> <name>
+ *   trace: <time_us> <id> <B|E|i> <arg>
+ *   trace: end
+ *
+ */
+
+#ifndef TRACE_LIB
+#define TRACE_LIB
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0
+#endif
+
+#define TRACE_LENGTH           256 // number of events, has to be a power of two
+#define TRACE_DUMP_CHAR        't' // character on stdin requesting a dump
+
+#define TRACE_BEGIN            'B'
+#define TRACE_END              'E'
+#define TRACE_INSTANT          'i'
+
+typedef enum _trace_stage_t{
+    trace_build_frame      = 0,
+    trace_backscatter_send = 1,
+    trace_airtime          = 2,
+    trace_gdo0_irq         = 3,
+    trace_read_packet      = 4,
+    trace_print_packet     = 5,
+    trace_rx_start_listen  = 6,
+    trace_link_stats       = 7,
+    TRACE_STAGES
+} trace_stage_t;
+
+struct trace_event {
+    uint64_t time_us;
+    uint8_t stage;
+    char phase;
+    uint16_t arg;
+};
+typedef struct trace_event Trace_event;
+
+#if TRACE_ENABLED
+#define trace_begin(stage, arg)   trace_record(stage, TRACE_BEGIN, arg)
+#define trace_end(stage, arg)     trace_record(stage, TRACE_END, arg)
+#define trace_instant(stage, arg) trace_record(stage, TRACE_INSTANT, arg)
+
+void trace_init();
+
+void trace_record(trace_stage_t stage, char phase, uint16_t arg);
+
+// print the ring to stdout (recording is paused meanwhile)
+void trace_dump();
+
+// dump the ring if TRACE_DUMP_CHAR was received over stdio (non-blocking)
+void trace_poll();
+#else
+#define trace_begin(stage, arg)   ((void) 0)
+#define trace_end(stage, arg)     ((void) 0)
+#define trace_instant(stage, arg) ((void) 0)
+#define trace_init()              ((void) 0)
+#define trace_dump()              ((void) 0)
+#define trace_poll()              ((void) 0)
+#endif
+
+#endif
@@ -27,8 +27,14 @@
 #include "pico/binary_info.h"
 #include "hardware/spi.h"
 #include "receiver_CC2500.h"
+#include "packet_log.h"
+#include "packet_generation.h"
+#include "link_stats.h"
 
 #define CARRIER_FEQ     2450000000
+#define LOG_BINARY           false // log received packets as COBS framed binary records (see packet_log.h) instead of text
+#define LOG_PACKETS           true // log every received packet (disable for long runs and rely on the link statistics)
+#define STATS_INTERVAL_US 10000000 // print link statistics every 10s
 
 /* 
  * The following macros are defined in the generated PIO header file 
@@ -61,6 +67,9 @@ void main() {
     event_t evt = no_evt;
     Packet_status status;
     uint8_t buffer[RX_BUFFER_SIZE];
+    static Link_stats link_stats;
+    uint64_t last_report_us = 0;
+    link_stats_init(&link_stats);
     setupReceiver();
     set_frecuency_rx(CARRIER_FEQ + PIO_CENTER_OFFSET);
     set_frequency_deviation_rx(PIO_DEVIATION);
@@ -79,12 +88,21 @@ void main() {
                 // finished receiving
                 uint64_t time_us = to_us_since_boot(get_absolute_time());
                 status = readPacket(buffer);
-                printPacket(buffer,status,time_us);
                 RX_start_listen();
+                link_stats_update(&link_stats, buffer, status.len, PAYLOADSIZE, status.overflowed, status.CRCcheck, status.RSSI, status.LinkQualityIndicator, time_us);
+                if(LOG_PACKETS && LOG_BINARY){
+                    logPacket(buffer,status,time_us);
+                }else if(LOG_PACKETS){
+                    printPacket(buffer,status,time_us);
+                }
             break;
             case no_evt:
             break;
         }
+        if(to_us_since_boot(get_absolute_time()) - last_report_us >= STATS_INTERVAL_US){
+            link_stats_print(&link_stats);
+            last_report_us = to_us_since_boot(get_absolute_time());
+        }
         sleep_us(10);
     }
     RX_stop_listen(); // never reached
@@ -0,0 +1,219 @@
+/**
+ * CC2500 2-FSK receiver model
+ *
+ * See cc2500_model.h and the CC2500 datasheet (sections 12, 13, 15, 16)
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "packet_generation.h"
+#include "cc2500_model.h"
+
+#define REG_SYNC1     0x04
+#define REG_SYNC0     0x05
+#define REG_PKTLEN    0x06
+#define REG_PKTCTRL0  0x08
+#define REG_MDMCFG2   0x12
+
+static uint8_t register_value(const RF_setting *settings, uint8_t len, uint8_t address, uint8_t reset_value){
+    for(uint8_t i = 0; i < len; i++){
+        if(settings[i].address == address){
+            return settings[i].value;
+        }
+    }
+    return reset_value;
+}
+
+void cc2500_model_init(Cc2500_model *model, const RF_setting *settings, uint8_t len, double fs,
+    uint8_t drate_e, uint8_t drate_m, uint8_t chanbw_e, uint8_t chanbw_m, uint8_t deviation_e, uint8_t deviation_m){
+    // datasheet formulas
+    model->data_rate = (256.0 + drate_m) * pow(2, drate_e) * F_XOSC / pow(2, 28);
+    model->bandwidth = F_XOSC / (8.0 * (4.0 + chanbw_m) * pow(2, chanbw_e));
+    model->deviation = F_XOSC / pow(2, 17) * (8.0 + deviation_m) * pow(2, deviation_e);
+
+    model->sync_word = (register_value(settings, len, REG_SYNC1, 0xD3) << 8) | register_value(settings, len, REG_SYNC0, 0x91);
+    model->sync_mode = register_value(settings, len, REG_MDMCFG2, 0x02) & 0x07;
+    uint8_t pktctrl0 = register_value(settings, len, REG_PKTCTRL0, 0x45);
+    model->crc_enabled = pktctrl0 & 0x04;
+    model->variable_length = (pktctrl0 & 0x03) == 0x01;
+    model->packet_length = register_value(settings, len, REG_PKTLEN, 0xFF);
+    model->whitening = pktctrl0 & 0x40;
+
+    // channel filter: windowed sinc (Hamming), cutoff at half the bandwidth
+    model->fs = fs;
+    model->power_offset = 0;
+    double cutoff = model->bandwidth / 2.0 / fs;
+    uint16_t taps = 2 * (uint16_t) ceil(1.0 / cutoff) + 1;
+    model->taps = min(taps, CC2500_MODEL_MAX_TAPS);
+    double sum = 0;
+    for(uint16_t k = 0; k < model->taps; k++){
+        double t = k - (model->taps - 1) / 2.0;
+        double sinc = (t == 0) ? 2.0 * cutoff : sin(2.0 * M_PI * cutoff * t) / (M_PI * t);
+        double window = 0.54 - 0.46 * cos(2.0 * M_PI * k / (model->taps - 1));
+        model->filter[k] = sinc * window;
+        sum += model->filter[k];
+    }
+    for(uint16_t k = 0; k < model->taps; k++){
+        model->filter[k] /= sum;
+    }
+}
+
+void cc2500_model_filter(const Cc2500_model *model, const float complex *x, float complex *out, uint32_t n){
+    for(uint32_t i = 0; i < n; i++){
+        float complex acc = 0;
+        for(uint16_t k = 0; k < model->taps && k <= i; k++){
+            acc += model->filter[k] * x[i-k];
+        }
+        out[i] = acc;
+    }
+}
+
+static uint8_t popcount32(uint32_t x){
+    x = x - ((x >> 1) & 0x55555555);
+    x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+    return (((x + (x >> 4)) & 0x0F0F0F0F) * 0x01010101) >> 24;
+}
+
+/* sync word qualifier: number of tolerated bit errors and number of compared bits */
+static bool sync_match(uint8_t sync_mode, uint32_t bits, uint16_t sync_word){
+    uint32_t sync32 = ((uint32_t) sync_word << 16) | sync_word;
+    switch(sync_mode & 0x03){
+        case 1:  return popcount32((bits ^ sync_word) & 0xFFFF) <= 1; // 15/16
+        case 2:  return ((bits ^ sync_word) & 0xFFFF) == 0;           // 16/16
+        case 3:  return popcount32(bits ^ sync32) <= 2;               // 30/32
+        default: return true;                                         // no preamble/sync
+    }
+}
+
+/* soft symbol: frequency integrated over the symbol window starting at position t [samples] */
+static double symbol(const double *cumulative, uint32_t n, double t, double sps){
+    uint32_t start = (uint32_t) lround(t);
+    uint32_t end = (uint32_t) lround(t + sps);
+    if(end >= n){
+        return 0; // beyond the captured samples: no signal
+    }
+    return cumulative[end] - cumulative[start];
+}
+
+bool cc2500_model_receive(const Cc2500_model *model, const float complex *x, uint32_t n, float complex *work, uint8_t *buffer, Packet_status *status){
+    // channel filter and RSSI
+    cc2500_model_filter(model, x, work, n);
+
+    // frequency discriminator, normalized to the deviation, as prefix sum
+    double *cumulative = malloc((n + 1) * sizeof(double));
+    double scale = model->fs / (2.0 * M_PI * model->deviation);
+    cumulative[0] = 0;
+    cumulative[1] = 0;
+    for(uint32_t i = 1; i < n; i++){
+        cumulative[i+1] = cumulative[i] + cargf(work[i] * conjf(work[i-1])) * scale;
+    }
+
+    // bit synchronization and sync word search for every sampling phase
+    double sps = model->fs / model->data_rate;
+    uint32_t symbols = (uint32_t) (n / sps);
+    int64_t detected[CC2500_MODEL_PHASES]; // last symbol of the sync word
+    double eye[CC2500_MODEL_PHASES];
+    double earliest = -1;
+    for(uint8_t p = 0; p < CC2500_MODEL_PHASES; p++){
+        double phase = p * sps / CC2500_MODEL_PHASES;
+        uint32_t bits = 0;
+        detected[p] = -1;
+        for(uint32_t s = 0; s + 1 < symbols; s++){
+            bits = (bits << 1) | (symbol(cumulative, n, phase + s * sps, sps) > 0);
+            if(s >= 31 && sync_match(model->sync_mode, bits, model->sync_word)){
+                detected[p] = s;
+                eye[p] = 0;
+                for(uint8_t b = 0; b < 32; b++){
+                    eye[p] += fabs(symbol(cumulative, n, phase + (s - b) * sps, sps));
+                }
+                double time = phase + (s + 1) * sps;
+                if(earliest < 0 || time < earliest){
+                    earliest = time;
+                }
+                break;
+            }
+        }
+    }
+    // the bit synchronization locks within a symbol: best eye opening among the phases detecting the sync word first
+    int64_t best_end = -1;
+    double best_phase = 0, best_eye = 0;
+    for(uint8_t p = 0; p < CC2500_MODEL_PHASES; p++){
+        double phase = p * sps / CC2500_MODEL_PHASES;
+        if(detected[p] >= 0 && phase + (detected[p] + 1) * sps < earliest + sps && eye[p] > best_eye){
+            best_end = detected[p];
+            best_phase = phase;
+            best_eye = eye[p];
+        }
+    }
+    if(best_end < 0){
+        free(cumulative);
+        return false;
+    }
+
+    // packet engine: length byte, payload, CRC
+    uint32_t s = best_end + 1;
+    uint8_t fifo[256 + 3];
+    double soft_sum = 0, soft_sq = 0;
+    uint32_t soft_n = 0;
+    uint16_t length = model->variable_length ? 0 : model->packet_length;
+    uint16_t total = 0; // length byte + payload + CRC
+    uint16_t pn9 = 0x1FF; // whitening sequence (x^9 + x^5 + 1)
+    for(uint16_t byte_index = 0; ; byte_index++){
+        uint8_t value = 0;
+        for(uint8_t b = 0; b < 8; b++, s++){
+            double soft = symbol(cumulative, n, best_phase + s * sps, sps);
+            value = (value << 1) | (soft > 0);
+            if(soft_n < 64){
+                soft_sum += fabs(soft);
+                soft_sq += soft * soft;
+                soft_n++;
+            }
+        }
+        if(model->whitening){
+            value ^= pn9 & 0xFF;
+            for(uint8_t b = 0; b < 8; b++){
+                pn9 = (pn9 >> 1) | (((pn9 ^ (pn9 >> 5)) & 1) << 8);
+            }
+        }
+        fifo[byte_index] = value;
+        if(byte_index == 0 && model->variable_length){
+            length = value;
+        }
+        total = (model->variable_length ? 1 : 0) + length + (model->crc_enabled ? 2 : 0);
+        if(byte_index + 1 >= total){
+            break;
+        }
+    }
+
+    // signal strength over the packet
+    uint32_t start = (uint32_t) (best_phase + (best_end - 31) * sps);
+    uint32_t end = min((uint32_t) (best_phase + s * sps), n);
+    double power = 0;
+    for(uint32_t i = start; i < end; i++){
+        power += crealf(work[i] * conjf(work[i]));
+    }
+    power /= max(end - start, 1);
+    free(cumulative);
+
+    uint16_t data_len = total - (model->crc_enabled ? 2 : 0); // length byte + payload
+    status->overflowed = data_len + 2 > CC2500_FIFO_SIZE;
+    status->len = data_len;
+    status->RSSI = (int32_t) round(10.0 * log10(power) + model->power_offset);
+    if(model->crc_enabled){
+        uint16_t crc = crc16_cc2500(fifo, data_len);
+        status->CRCcheck = (fifo[data_len] == (crc >> 8)) && (fifo[data_len+1] == (crc & 0xFF));
+    }else{
+        status->CRCcheck = false;
+    }
+    // LQI: spread of the soft decisions (0: perfect)
+    double mean = soft_sum / soft_n;
+    double spread = sqrt(max(soft_sq / soft_n - mean * mean, 0.0)) / max(mean, 1e-9);
+    status->LinkQualityIndicator = min((uint32_t) (spread * 127.0), 127);
+    if(!status->overflowed){
+        memcpy(buffer, fifo, min(data_len, RX_BUFFER_SIZE));
+    }
+    return true;
+}
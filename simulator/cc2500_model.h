@@ -0,0 +1,64 @@
+/**
+ * CC2500 2-FSK receiver model
+ *
+ * Demodulates the complex baseband (centered at the receiver frequency) like the packet engine of the CC2500:
+ * - channel filter: low-pass FIR with the bandwidth of CHANBW_E/CHANBW_M
+ * - frequency discriminator normalized by the deviation of DEVIATION_E/DEVIATION_M
+ * - bit synchronization: integrate and dump at the data rate of DRATE_E/DRATE_M, the sampling phase is
+ *   chosen at the sync word (earliest detection, then largest eye opening)
+ * - sync word (SYNC1/SYNC0) with the qualifier mode of MDMCFG2 (16/16, 30/32 bits)
+ * - variable/fixed packet length, CRC-16 and data whitening (PKTCTRL0), RX FIFO of 64 bytes with appended status bytes
+ * The register values are taken from a RF_setting table (e.g. cc2500_receiver) and the *_registers() functions.
+ *
+ * Not modelled: AGC, frequency offset compensation, carrier sense, preamble quality threshold.
+ *
+ */
+
+#ifndef CC2500_MODEL_LIB
+#define CC2500_MODEL_LIB
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <complex.h>
+#include "receiver_CC2500.h"
+
+#define CC2500_MODEL_MAX_TAPS    65
+#define CC2500_MODEL_PHASES       8 // sampling phases tried per symbol
+#define CC2500_FIFO_SIZE         64
+
+struct cc2500_model {
+    /* from the registers */
+    double data_rate;         // [baud]
+    double bandwidth;         // [Hz]
+    double deviation;         // [Hz]
+    uint16_t sync_word;
+    uint8_t sync_mode;        // MDMCFG2[2:0]
+    bool crc_enabled;
+    bool variable_length;
+    bool whitening;           // PN9 de-whitening of the bytes after the sync word
+    uint8_t packet_length;    // PKTLEN (fixed length mode)
+    /* simulation */
+    double fs;                // sample rate of the baseband [Hz]
+    double power_offset;      // dBm = 10*log10(power) + power_offset
+    uint16_t taps;
+    float filter[CC2500_MODEL_MAX_TAPS];
+};
+typedef struct cc2500_model Cc2500_model;
+
+/*
+ * settings/len: register table written by setupReceiver() (cc2500_receiver)
+ * drate/chanbw/deviation: exponent and mantissa as computed by set_datarate_rx(), set_filter_bandwidth_rx(), set_frequency_deviation_rx()
+ */
+void cc2500_model_init(Cc2500_model *model, const RF_setting *settings, uint8_t len, double fs,
+    uint8_t drate_e, uint8_t drate_m, uint8_t chanbw_e, uint8_t chanbw_m, uint8_t deviation_e, uint8_t deviation_m);
+
+/*
+ * receive one packet from the baseband samples x (work: buffer of n complex samples)
+ * returns false if no sync word was detected, otherwise buffer/status are filled like readPacket()
+ */
+bool cc2500_model_receive(const Cc2500_model *model, const float complex *x, uint32_t n, float complex *work, uint8_t *buffer, Packet_status *status);
+
+// low-pass filter x with the channel filter (out may not alias x)
+void cc2500_model_filter(const Cc2500_model *model, const float complex *x, float complex *out, uint32_t n);
+
+#endif
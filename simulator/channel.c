@@ -0,0 +1,130 @@
+/**
+ * Backscatter channel
+ *
+ * See channel.h
+ *
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include "channel.h"
+
+void channel_mixer_init(Channel_mixer *mixer, double lo_offset, uint16_t decimation){
+    mixer->decimation = decimation;
+    mixer->length = 3*decimation - 2;
+    mixer->kernel = malloc(mixer->length * sizeof(double complex));
+    // CIC kernel: three boxcars of length decimation convolved, normalized to unity DC gain
+    double *box2 = calloc(2*decimation - 1, sizeof(double));
+    for(uint16_t i = 0; i < decimation; i++){
+        for(uint16_t j = 0; j < decimation; j++){
+            box2[i+j] += 1.0;
+        }
+    }
+    double norm = pow(decimation, 3);
+    double w = -2.0 * M_PI * lo_offset / CHANNEL_PIO_CLOCK;
+    for(uint16_t k = 0; k < mixer->length; k++){
+        double h = 0;
+        for(uint16_t j = 0; j < decimation; j++){
+            if(k >= j && k - j < 2*decimation - 1){
+                h += box2[k-j];
+            }
+        }
+        // x[n-k] * e^(jw(n-k)) = e^(jwn) * (x[n-k] * e^(-jwk))
+        mixer->kernel[k] = (h / norm) * cexp(-I * w * k);
+    }
+    mixer->output_step = cexp(I * w * decimation);
+    free(box2);
+}
+
+void channel_mixer_free(Channel_mixer *mixer){
+    free(mixer->kernel);
+    mixer->kernel = NULL;
+}
+
+uint32_t channel_baseband(const Channel_mixer *mixer, const uint8_t *levels, uint32_t cycles, double amplitude, float complex *out){
+    uint32_t outputs = cycles / mixer->decimation;
+    double complex rotation = amplitude;
+    for(uint32_t m = 0; m < outputs; m++){
+        int64_t n = (int64_t) (m+1) * mixer->decimation - 1; // newest input sample
+        double complex acc = 0;
+        for(uint16_t k = 0; k < mixer->length && n - k >= 0; k++){
+            if(levels[n-k]){
+                acc += mixer->kernel[k];
+            }else{
+                acc -= mixer->kernel[k];
+            }
+        }
+        out[m] = (float complex) (rotation * acc);
+        rotation *= mixer->output_step;
+        if((m & 0xFF) == 0){
+            rotation *= amplitude / cabs(rotation); // avoid drift of the magnitude
+        }
+    }
+    return outputs;
+}
+
+static uint32_t rotl(uint32_t x, int k){
+    return (x << k) | (x >> (32 - k));
+}
+
+static uint32_t rng_next(Channel_rng *rng){
+    uint32_t *s = rng->s;
+    uint32_t result = s[0] + s[3];
+    uint32_t t = s[1] << 9;
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = rotl(s[3], 11);
+    return result;
+}
+
+void channel_rng_seed(Channel_rng *rng, uint64_t seed){
+    // splitmix64 to fill the state
+    for(uint8_t i = 0; i < 4; i++){
+        seed += 0x9E3779B97F4A7C15ULL;
+        uint64_t z = seed;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        rng->s[i] = (uint32_t) (z ^ (z >> 31));
+    }
+    rng->has_spare = 0;
+}
+
+// standard normal sample (Marsaglia polar method)
+double channel_gaussian(Channel_rng *rng){
+    if(rng->has_spare){
+        rng->has_spare = 0;
+        return rng->spare;
+    }
+    double u, v, s;
+    do{
+        u = rng_next(rng) * (2.0 / 4294967296.0) - 1.0;
+        v = rng_next(rng) * (2.0 / 4294967296.0) - 1.0;
+        s = u*u + v*v;
+    }while(s >= 1.0 || s == 0.0);
+    s = sqrt(-2.0 * log(s) / s);
+    rng->spare = v * s;
+    rng->has_spare = 1;
+    return u * s;
+}
+
+void channel_awgn(Channel_rng *rng, const float complex *in, float complex *out, uint32_t n, double variance){
+    double sigma = sqrt(variance / 2.0); // per real dimension
+    for(uint32_t i = 0; i < n; i++){
+        double re = channel_gaussian(rng) * sigma;
+        double im = channel_gaussian(rng) * sigma;
+        out[i] = in[i] + (float) re + I * (float) im;
+    }
+}
+
+double channel_snr_from_distance(double tx_power, double gain, double f_carrier, double d1, double d2, double tag_loss, double bandwidth, double noise_figure){
+    double lambda = 299792458.0 / f_carrier;
+    // free space loss of both hops (bistatic radar equation)
+    double loss1 = 20.0 * log10(4.0 * M_PI * d1 / lambda);
+    double loss2 = 20.0 * log10(4.0 * M_PI * d2 / lambda);
+    double rx_power = tx_power + 3.0 * gain - loss1 - loss2 - tag_loss;
+    double noise_power = -174.0 + 10.0 * log10(bandwidth) + noise_figure;
+    return rx_power - noise_power;
+}
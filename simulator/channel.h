@@ -0,0 +1,59 @@
+/**
+ * Backscatter channel
+ *
+ * - the pin levels of the PIO (125 MHz) switch the antenna impedance, i.e. the carrier is multiplied by a
+ *   +-1 square wave. channel_baseband() mixes this waveform to the complex baseband of the receiver
+ *   (LO offset = receiver frequency - carrier frequency) and decimates it with a 3rd order CIC filter
+ * - channel_awgn() adds complex white gaussian noise
+ * - channel_snr_from_distance() derives the SNR in the receiver bandwidth from the backscatter link budget
+ *
+ */
+
+#ifndef CHANNEL_LIB
+#define CHANNEL_LIB
+
+#include <stdint.h>
+#include <complex.h>
+
+#define CHANNEL_PIO_CLOCK  125000000.0 // PIO cycles per second
+
+/* decimation kernel: 3rd order CIC with the LO rotation folded in */
+struct channel_mixer {
+    uint16_t decimation;
+    uint16_t length;              // 3*decimation - 2
+    double complex *kernel;
+    double complex output_step;   // LO rotation per output sample
+};
+typedef struct channel_mixer Channel_mixer;
+
+/* per thread random number generator (xoshiro128+) */
+struct channel_rng {
+    uint32_t s[4];
+    double spare;
+    int has_spare;
+};
+typedef struct channel_rng Channel_rng;
+
+void channel_mixer_init(Channel_mixer *mixer, double lo_offset, uint16_t decimation);
+void channel_mixer_free(Channel_mixer *mixer);
+
+/*
+ * mix and decimate the pin levels, the signal is scaled by amplitude (path loss)
+ * returns the number of output samples (cycles / decimation)
+ */
+uint32_t channel_baseband(const Channel_mixer *mixer, const uint8_t *levels, uint32_t cycles, double amplitude, float complex *out);
+
+void channel_rng_seed(Channel_rng *rng, uint64_t seed);
+double channel_gaussian(Channel_rng *rng);
+
+// add complex AWGN with the given variance per complex sample
+void channel_awgn(Channel_rng *rng, const float complex *in, float complex *out, uint32_t n, double variance);
+
+/*
+ * SNR [dB] of the backscattered signal in the receiver bandwidth
+ * tx_power: carrier power [dBm], gain: antenna gain of each of the three antennas [dBi],
+ * d1: carrier to tag [m], d2: tag to receiver [m], tag_loss: modulation/reflection loss of the tag [dB]
+ */
+double channel_snr_from_distance(double tx_power, double gain, double f_carrier, double d1, double d2, double tag_loss, double bandwidth, double noise_figure);
+
+#endif
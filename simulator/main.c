@@ -0,0 +1,486 @@
+/**
+ * End-to-end link simulator
+ *
+ * tag:      packets as built by the firmware (frame_header/frame_finish, expected_data, pack_words) are fed into
+ *           the program of generatePIOprogram() running on the PIO emulator
+ * channel:  the square-wave backscatter is mixed to the receiver frequency, decimated and AWGN is added
+ *           (SNR in the receiver bandwidth, either swept directly or derived from the link distances)
+ * receiver: CC2500 model configured with cc2500_receiver and the register values of set_*_rx()
+ *
+ * Every combination of configuration (d0, d1, baud) and SNR is simulated with the same packets and
+ * noise seeds, independent of the number of threads. The results are printed as CSV:
+ *   d0,d1,baud,snr_db,distance_m,packets,detected,crc_ok,error_free,bit_errors,bits,ber,per,payload,goodput_bps
+ * A range of payload sizes (--payload from:to:step) is simulated one after the other, the goodput counts the
+ * samples of the error-free packets over the airtime of all packets and a gap per frame (--frame-gap).
+ * With --fec, seq and payload are encoded as in carrier-receiver-baseband (FEC_ENABLED) and the errors are
+ * counted after decoding.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <time.h>
+#include "pico/stdlib.h"
+#include "backscatter.h"
+#include "packet_generation.h"
+#include "receiver_CC2500.h"
+#include "pio_emulator.h"
+#include "channel.h"
+#include "cc2500_model.h"
+#include "fec.h"
+
+#define CARRIER_FEQ      2450000000
+#define MAX_CONFIGS              16
+#define MAX_POINTS               64
+#define BLOCK_PACKETS            16 // packets per work item
+#define LEAD_SYMBOLS             16 // idle PIO before the packet
+#define TAIL_SYMBOLS             32 // idle PIO after the packet (covers a missing CRC)
+#define NOISE_FIGURE           10.0 // receiver noise figure [dB] (RSSI and distance mode)
+
+struct sim_config {
+    uint16_t d0, d1;
+    uint32_t baud;
+    bool valid;
+    struct backscatter_config backscatter;
+    uint16_t instructions[32];
+    struct pio_program program;
+    double lo_offset;              // receiver frequency - carrier frequency [Hz]
+    Channel_mixer mixer;
+    Cc2500_model model;
+    uint32_t cycles_per_symbol;
+};
+
+struct sim_result {
+    uint32_t packets;
+    uint32_t detected;
+    uint32_t crc_ok;
+    uint32_t error_free;
+    uint64_t bit_errors;
+    uint64_t bits;
+};
+
+/* settings */
+static struct sim_config configs[MAX_CONFIGS];
+static uint8_t config_count = 0;
+static double snr_db[MAX_POINTS];
+static double distance[MAX_POINTS];   // tag to receiver [m], 0 in SNR mode
+static uint8_t point_count = 0;
+static uint32_t packets = 1000;
+static uint8_t payloadsize = PAYLOADSIZE;  // of the current run
+static double payloads[MAX_POINTS];
+static uint8_t payload_count = 0;
+static double frame_gap_us = 4000.0;       // carrier start and margin of send_frame() in carrier-receiver-baseband
+static bool append_crc = false;
+static uint8_t preamble = 4;               // bytes
+static bool fec = false;
+static bool whitening = false;
+static bool two_antennas = true;
+static uint64_t seed = 1;
+static double tx_power = 0.0, antenna_gain = 0.0, carrier_distance = 1.0, tag_loss = 10.0;
+
+/* work distribution */
+static struct sim_result results[MAX_CONFIGS][MAX_POINTS];
+static pthread_mutex_t results_lock = PTHREAD_MUTEX_INITIALIZER;
+static uint32_t next_item = 0;
+static uint32_t blocks_per_config;
+static Frame_format format;                // frame_format(2500) with the settings above
+
+/*
+ * build the frame of packet i like the TX loop, returns the frame length [bytes]
+ * plain: length byte, seq and payload as compared after the reception (decoded with --fec)
+ */
+static uint8_t build_frame(uint32_t i, uint8_t *frame, uint8_t *plain){
+    uint16_t position = (i * (payloadsize - 2)) & 0xFFFF;
+    uint8_t offset = frame_header(&format, frame, i & 0xFF);
+    frame[offset]   = position >> 8;
+    frame[offset+1] = position & 0xFF;
+    expected_data(&frame[offset+2], payloadsize - 2, position);
+    plain[0] = 1 + payloadsize;
+    memcpy(&plain[1], &frame[offset-1], payloadsize + 1);
+    uint8_t len = payloadsize;
+    if(fec){
+        // the seq stays readable, the encoded block repeats it
+        fec_encode(&plain[1], 1 + payloadsize, &frame[offset]);
+        len = FEC_LEN(1 + payloadsize);
+    }
+    return frame_finish(&format, frame, len); // length byte, CRC and whitening
+}
+
+static uint8_t popcount8(uint8_t x){
+    x = x - ((x >> 1) & 0x55);
+    x = (x & 0x33) + ((x >> 2) & 0x33);
+    return (x + (x >> 4)) & 0x0F;
+}
+
+static void simulate_block(uint8_t c, uint32_t block, uint8_t *levels, uint32_t max_cycles, float complex *clean, float complex *noisy, float complex *work){
+    struct sim_config *config = &configs[c];
+    struct sim_result local[MAX_POINTS];
+    memset(local, 0, sizeof(local));
+    uint8_t frame[256];
+    uint8_t plain[256];
+    uint32_t words[64];
+    uint8_t rx_buffer[RX_BUFFER_SIZE];
+    Channel_rng rng;
+
+    for(uint32_t i = block * BLOCK_PACKETS; i < min((block + 1) * BLOCK_PACKETS, packets); i++){
+        /* tag */
+        uint8_t len = build_frame(i, frame, plain);
+        uint8_t word_count = (len + 3) / 4;
+        memset(&frame[len], 0, 4 * word_count - len);
+        pack_words(frame, words, word_count);
+        Pio_emulator pio;
+        pio_emulator_init(&pio, config->program.instructions, config->program.length, two_antennas);
+        pio_emulator_put(&pio, backscatter_repetitions(config->d0, config->baud));
+        pio_emulator_put(&pio, backscatter_repetitions(config->d1, config->baud));
+        for(uint8_t w = 0; w < word_count; w++){
+            pio_emulator_put(&pio, words[w]);
+        }
+        uint32_t lead = LEAD_SYMBOLS * config->cycles_per_symbol;
+        memset(levels, 0, lead);
+        uint32_t cycles = lead + pio_emulator_run(&pio, &levels[lead], max_cycles - lead - TAIL_SYMBOLS * config->cycles_per_symbol);
+        uint32_t packet_end = cycles;
+        memset(&levels[cycles], pio_emulator_level(&pio), TAIL_SYMBOLS * config->cycles_per_symbol);
+        cycles += TAIL_SYMBOLS * config->cycles_per_symbol;
+
+        /* channel (noise free) and signal power during the packet after the channel filter */
+        uint32_t n = channel_baseband(&config->mixer, levels, cycles, 1.0, clean);
+        cc2500_model_filter(&config->model, clean, work, n);
+        uint32_t first = lead / config->mixer.decimation, last = packet_end / config->mixer.decimation;
+        double signal_power = 0;
+        for(uint32_t k = first; k < last; k++){
+            signal_power += crealf(work[k] * conjf(work[k]));
+        }
+        signal_power /= max(last - first, 1);
+
+        /* receiver at every SNR */
+        for(uint8_t p = 0; p < point_count; p++){
+            channel_rng_seed(&rng, seed ^ ((uint64_t) c << 56) ^ ((uint64_t) p << 40) ^ i);
+            double snr = pow(10.0, snr_db[p] / 10.0);
+            double noise_power = signal_power / snr; // in the receiver bandwidth
+            double variance = noise_power * config->model.fs / config->model.bandwidth;
+            channel_awgn(&rng, clean, noisy, n, variance);
+
+            Cc2500_model model = config->model;
+            double noise_floor = -174.0 + 10.0 * log10(model.bandwidth) + NOISE_FIGURE;
+            model.power_offset = noise_floor - 10.0 * log10(noise_power);
+            Packet_status status;
+            local[p].packets++;
+            if(!cc2500_model_receive(&model, noisy, n, work, rx_buffer, &status)){
+                continue;
+            }
+            local[p].detected++;
+            local[p].crc_ok += status.CRCcheck;
+            if(status.overflowed){
+                continue;
+            }
+            if(fec && status.len == 2 + FEC_LEN(1 + payloadsize)){
+                uint8_t decoded[FEC_MAX_LEN];
+                fec_decode(&rx_buffer[2], 1 + payloadsize, decoded, NULL);
+                rx_buffer[0] = 1 + payloadsize;
+                memcpy(&rx_buffer[1], decoded, 1 + payloadsize);
+                status.len = 2 + payloadsize;
+            }
+            // compare length byte, seq and payload
+            const uint8_t *sent = plain;
+            uint8_t sent_len = payloadsize + 2;
+            uint8_t compared = min(min(status.len, sent_len), RX_BUFFER_SIZE);
+            uint32_t errors = 0;
+            for(uint8_t b = 0; b < compared; b++){
+                errors += popcount8(sent[b] ^ rx_buffer[b]);
+            }
+            local[p].bit_errors += errors;
+            local[p].bits += 8 * compared;
+            local[p].error_free += (errors == 0 && status.len == sent_len);
+        }
+    }
+
+    pthread_mutex_lock(&results_lock);
+    for(uint8_t p = 0; p < point_count; p++){
+        results[c][p].packets    += local[p].packets;
+        results[c][p].detected   += local[p].detected;
+        results[c][p].crc_ok     += local[p].crc_ok;
+        results[c][p].error_free += local[p].error_free;
+        results[c][p].bit_errors += local[p].bit_errors;
+        results[c][p].bits       += local[p].bits;
+    }
+    pthread_mutex_unlock(&results_lock);
+}
+
+static void *worker(void *arg){
+    // buffers for the largest configuration
+    uint32_t max_cycles = 0, max_samples = 0;
+    for(uint8_t c = 0; c < config_count; c++){
+        if(!configs[c].valid){
+            continue; // no program and no receiver model
+        }
+        uint32_t cycles = (LEAD_SYMBOLS + TAIL_SYMBOLS + 8 * 260) * configs[c].cycles_per_symbol;
+        max_cycles = max(max_cycles, cycles);
+        max_samples = max(max_samples, cycles / configs[c].mixer.decimation + 1);
+    }
+    uint8_t *levels = malloc(max_cycles);
+    float complex *clean = malloc(max_samples * sizeof(float complex));
+    float complex *noisy = malloc(max_samples * sizeof(float complex));
+    float complex *work = malloc(max_samples * sizeof(float complex));
+
+    uint32_t items = config_count * blocks_per_config;
+    while(true){
+        uint32_t item = __atomic_fetch_add(&next_item, 1, __ATOMIC_RELAXED);
+        if(item >= items){
+            break;
+        }
+        uint8_t c = item / blocks_per_config;
+        if(configs[c].valid){
+            uint32_t cycles = (LEAD_SYMBOLS + TAIL_SYMBOLS + 8 * 260) * configs[c].cycles_per_symbol;
+            simulate_block(c, item % blocks_per_config, levels, cycles, clean, noisy, work);
+        }
+    }
+    free(levels);
+    free(clean);
+    free(noisy);
+    free(work);
+    return NULL;
+}
+
+static bool setup_config(struct sim_config *config){
+    config->baud = backscatter_baudrate(config->baud);
+    backscatter_settings(config->d0, config->d1, config->baud, &config->backscatter);
+    if(!generatePIOprogram(config->d0, config->d1, config->baud, config->instructions, &config->program, two_antennas)){
+        fprintf(stderr, "d0 %u d1 %u baud %u: skipped, no PIO program for these clock dividers\n", config->d0, config->d1, config->baud);
+        return false;
+    }
+    config->cycles_per_symbol = (uint32_t) CHANNEL_PIO_CLOCK / config->baud;
+
+    // receiver registers as set by set_*_rx() in carrier-receiver-baseband
+    uint8_t drate_e, drate_m, chanbw_e, chanbw_m, deviation_e, deviation_m, channel, channspc_e, channspc_m;
+    uint32_t freq;
+    datarate_registers(config->backscatter.baudrate, &drate_e, &drate_m);
+    filter_bandwidth_registers(config->backscatter.minRxBw, &chanbw_e, &chanbw_m);
+    frequency_deviation_registers(config->backscatter.deviation, &deviation_e, &deviation_m);
+    // only the register widths are written (MDMCFG4, DEVIATN), out of range values wrap around like on the chip
+    chanbw_e &= 0x03;
+    chanbw_m &= 0x03;
+    deviation_e &= 0x07;
+    deviation_m &= 0x07;
+    double f_rx = frequency_registers(CARRIER_FEQ + config->backscatter.center_offset, &freq, &channel, &channspc_e, &channspc_m);
+    double f_tx = frequency_registers(CARRIER_FEQ, &freq, &channel, &channspc_e, &channspc_m); // set_frecuency_tx() uses the same approach
+    config->lo_offset = f_rx - f_tx;
+
+    // baseband sample rate: about four times the receiver bandwidth
+    double bandwidth = F_XOSC / (8.0 * (4.0 + chanbw_m) * pow(2, chanbw_e));
+    uint16_t decimation = max(1, (uint16_t) floor(CHANNEL_PIO_CLOCK / (4.0 * bandwidth)));
+    channel_mixer_init(&config->mixer, config->lo_offset, decimation);
+    cc2500_model_init(&config->model, cc2500_receiver, 20, CHANNEL_PIO_CLOCK / decimation,
+        drate_e, drate_m, chanbw_e, chanbw_m, deviation_e, deviation_m);
+    config->model.whitening = whitening; // set_frame_format_rx()
+    fprintf(stderr, "d0 %u d1 %u baud %u: offset %u deviation %u | rx rate %.0f bw %.0f deviation %.0f lo %.0f | fs %.0f\n",
+        config->d0, config->d1, config->baud, config->backscatter.center_offset, config->backscatter.deviation,
+        config->model.data_rate, config->model.bandwidth, config->model.deviation, config->lo_offset, config->model.fs);
+    return true;
+}
+
+/* from:to:step */
+static uint8_t parse_range(const char *arg, double *values){
+    double from, to, step = 1;
+    int fields = sscanf(arg, "%lf:%lf:%lf", &from, &to, &step);
+    if(fields == 1){
+        to = from;
+    }
+    uint8_t count = 0;
+    for(double v = from; v <= to + 1e-9 && count < MAX_POINTS && step > 0; v += step){
+        values[count++] = v;
+    }
+    return count;
+}
+
+static void usage(const char *name){
+    fprintf(stderr, "usage: %s [options]\n"
+        "  --config d0,d1,baud      baseband configuration (repeatable, default 20,18,100000)\n"
+        "  --snr from:to:step       SNR in the receiver bandwidth [dB] (default 0:20:2)\n"
+        "  --distance from:to:step  tag to receiver distance [m] instead of the SNR\n"
+        "  --carrier-distance m     carrier to tag distance [m] (default 1)\n"
+        "  --tx-power dBm           carrier power (default 0)\n"
+        "  --gain dBi               antenna gain (default 0)\n"
+        "  --tag-loss dB            modulation and reflection loss of the tag (default 10)\n"
+        "  --packets n              packets per point (default 1000)\n"
+        "  --payload from:to:step   payload bytes incl. the 2B file position (default %u)\n"
+        "  --frame-gap us           time between two frames for the goodput (default 4000)\n"
+        "  --crc                    append the CC2500 CRC-16 at the tag\n"
+        "  --preamble n             preamble bytes (default 4)\n"
+        "  --fec                    encode seq and payload (Hamming(8,4), interleaved, see fec.h)\n"
+        "  --whitening              PN9 data whitening at the tag and the receiver\n"
+        "  --one-antenna            single antenna state-machine\n"
+        "  --threads n              worker threads (default: number of CPUs)\n"
+        "  --seed n                 noise seed (default 1)\n", name, PAYLOADSIZE);
+}
+
+int main(int argc, char **argv){
+    static struct option options[] = {
+        {"config", required_argument, 0, 'c'},
+        {"snr", required_argument, 0, 's'},
+        {"distance", required_argument, 0, 'd'},
+        {"carrier-distance", required_argument, 0, 'D'},
+        {"tx-power", required_argument, 0, 'P'},
+        {"gain", required_argument, 0, 'g'},
+        {"tag-loss", required_argument, 0, 'l'},
+        {"packets", required_argument, 0, 'n'},
+        {"payload", required_argument, 0, 'p'},
+        {"frame-gap", required_argument, 0, 'G'},
+        {"crc", no_argument, 0, 'C'},
+        {"preamble", required_argument, 0, 'r'},
+        {"fec", no_argument, 0, 'F'},
+        {"whitening", no_argument, 0, 'W'},
+        {"one-antenna", no_argument, 0, '1'},
+        {"threads", required_argument, 0, 't'},
+        {"seed", required_argument, 0, 'S'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *snr_arg = "0:20:2";
+    const char *distance_arg = NULL;
+    const char *payload_arg = NULL;
+    int opt;
+    while((opt = getopt_long(argc, argv, "", options, NULL)) != -1){
+        switch(opt){
+            case 'c': {
+                unsigned d0, d1, baud;
+                if(config_count < MAX_CONFIGS && sscanf(optarg, "%u,%u,%u", &d0, &d1, &baud) == 3){
+                    configs[config_count].d0 = d0;
+                    configs[config_count].d1 = d1;
+                    configs[config_count].baud = baud;
+                    config_count++;
+                }else{
+                    fprintf(stderr, "invalid configuration: %s\n", optarg);
+                    return 1;
+                }
+            } break;
+            case 's': snr_arg = optarg; break;
+            case 'd': distance_arg = optarg; break;
+            case 'D': carrier_distance = atof(optarg); break;
+            case 'P': tx_power = atof(optarg); break;
+            case 'g': antenna_gain = atof(optarg); break;
+            case 'l': tag_loss = atof(optarg); break;
+            case 'n': packets = atoi(optarg); break;
+            case 'p': payload_arg = optarg; break;
+            case 'G': frame_gap_us = atof(optarg); break;
+            case 'C': append_crc = true; break;
+            case 'r': preamble = atoi(optarg); break;
+            case 'F': fec = true; break;
+            case 'W': whitening = true; break;
+            case '1': two_antennas = false; break;
+            case 't': threads = atoi(optarg); break;
+            case 'S': seed = strtoull(optarg, NULL, 0); break;
+            default: usage(argv[0]); return 1;
+        }
+    }
+    if(config_count == 0){
+        configs[0].d0 = 20;
+        configs[0].d1 = 18;
+        configs[0].baud = 100000;
+        config_count = 1;
+    }
+    if(payload_arg){
+        payload_count = parse_range(payload_arg, payloads);
+    }else{
+        payloads[0] = PAYLOADSIZE;
+        payload_count = 1;
+    }
+    if(preamble > 16){
+        fprintf(stderr, "the preamble has to be at most 16 bytes\n");
+        return 1;
+    }
+    format = *frame_format(2500);
+    format.preamble = preamble;
+    format.crc = append_crc;
+    format.whitening = whitening;
+    for(uint8_t k = 0; k < payload_count; k++){
+        uint32_t payload = payloads[k];
+        if(payload < 2 || payload % 2 != 0 || payload > RX_BUFFER_SIZE - 4){
+            fprintf(stderr, "the payload has to be even and between 2 and %u bytes\n", RX_BUFFER_SIZE - 4);
+            return 1;
+        }
+        if(fec && 1 + payload > FEC_MAX_LEN){
+            fprintf(stderr, "with --fec, the payload has to be at most %u bytes\n", FEC_MAX_LEN - 1);
+            return 1;
+        }
+    }
+    point_count = parse_range(distance_arg ? distance_arg : snr_arg, distance_arg ? distance : snr_db);
+    if(point_count == 0 || threads < 1){
+        usage(argv[0]);
+        return 1;
+    }
+
+    uint8_t valid_configs = 0;
+    for(uint8_t c = 0; c < config_count; c++){
+        configs[c].valid = setup_config(&configs[c]);
+        if(!configs[c].valid){
+            fprintf(stderr, "skipping d0 %u d1 %u baud %u\n", configs[c].d0, configs[c].d1, configs[c].baud);
+        }
+        valid_configs += configs[c].valid;
+    }
+    if(valid_configs == 0){
+        fprintf(stderr, "no valid configuration\n");
+        return 1;
+    }
+    if(distance_arg){
+        // the SNR depends on the receiver bandwidth of the first valid configuration
+        for(uint8_t c = 0; c < config_count; c++){
+            if(configs[c].valid){
+                for(uint8_t p = 0; p < point_count; p++){
+                    snr_db[p] = channel_snr_from_distance(tx_power, antenna_gain, CARRIER_FEQ, carrier_distance, distance[p], tag_loss, configs[c].model.bandwidth, NOISE_FIGURE);
+                }
+                break;
+            }
+        }
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    blocks_per_config = (packets + BLOCK_PACKETS - 1) / BLOCK_PACKETS;
+    pthread_t *pool = malloc(threads * sizeof(pthread_t));
+    printf("d0,d1,baud,snr_db,distance_m,packets,detected,crc_ok,error_free,bit_errors,bits,ber,per,payload,goodput_bps\n");
+    for(uint8_t k = 0; k < payload_count; k++){
+        payloadsize = payloads[k];
+        memset(results, 0, sizeof(results));
+        next_item = 0;
+        for(long t = 0; t < threads; t++){
+            pthread_create(&pool[t], NULL, worker, NULL);
+        }
+        for(long t = 0; t < threads; t++){
+            pthread_join(pool[t], NULL);
+        }
+
+        // frame as sent by build_frame(): header, (encoded) seq and payload, CRC
+        uint32_t bytes = frame_length(&format, fec ? FEC_LEN(1 + payloadsize) : payloadsize);
+        for(uint8_t c = 0; c < config_count; c++){
+            if(!configs[c].valid){
+                continue;
+            }
+            double frame_us = 8e6 * bytes / configs[c].baud + frame_gap_us;
+            for(uint8_t p = 0; p < point_count; p++){
+                struct sim_result *r = &results[c][p];
+                double ber = r->bits ? ((double) r->bit_errors) / r->bits : NAN;
+                double per = r->packets ? 1.0 - ((double) r->error_free) / r->packets : NAN;
+                double goodput = r->packets ? (8e6 * (payloadsize - 2) * r->error_free) / (frame_us * r->packets) : NAN;
+                printf("%u,%u,%u,%.2f,%.2f,%u,%u,%u,%u,%llu,%llu,%.3e,%.4f,%u,%.0f\n", configs[c].d0, configs[c].d1, configs[c].baud, snr_db[p], distance[p],
+                    r->packets, r->detected, r->crc_ok, r->error_free, (unsigned long long) r->bit_errors, (unsigned long long) r->bits, ber, per,
+                    payloadsize, goodput);
+            }
+        }
+    }
+    free(pool);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    for(uint8_t c = 0; c < config_count; c++){
+        if(configs[c].valid){
+            channel_mixer_free(&configs[c].mixer);
+        }
+    }
+    fprintf(stderr, "%u packets x %u points x %u configurations x %u payloads in %.2f s (%ld threads)\n", packets, point_count, config_count, payload_count,
+        (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9, threads);
+    return 0;
+}
@@ -0,0 +1,333 @@
+/**
+ * PIO state-machine emulator
+ *
+ * See pio_emulator.h and the RP2040 datasheet, section 3.4 (instruction encoding)
+ *
+ */
+
+#include <stdio.h>
+#include "pio_emulator.h"
+
+#define OPCODE(instr)  ((instr) >> 13)
+#define OP_JMP   0
+#define OP_WAIT  1
+#define OP_IN    2
+#define OP_OUT   3
+#define OP_PUSH  4 // PUSH and PULL
+#define OP_MOV   5
+#define OP_IRQ   6
+#define OP_SET   7
+
+#define DEST_PINS 0
+#define DEST_X    1
+#define DEST_Y    2
+#define DEST_NULL 3
+#define DEST_PC   5
+#define DEST_ISR  6
+#define DEST_OSR  7 // MOV only
+#define SRC_PINS  0
+#define SRC_X     1
+#define SRC_Y     2
+#define SRC_NULL  3
+#define SRC_ISR   6
+#define SRC_OSR   7
+
+#define WAIT_GPIO 0
+#define WAIT_PIN  1
+
+void pio_emulator_init(Pio_emulator *pio, const uint16_t *program, uint8_t length, bool sideset){
+    pio->program = program;
+    pio->length = length;
+    pio->sideset = sideset;
+    pio->wrap_bottom = 0;
+    pio->wrap_top = length - 1;
+    pio->gpio = 0;
+    pio->gpio_get = NULL;
+    pio->context = NULL;
+    pio->pc = 0;
+    pio_emulator_config(pio, 0, 1, 0, 1, 0, 1, true, 0);
+    pio_emulator_restart(pio);
+    pio_emulator_clear_fifos(pio);
+}
+
+void pio_emulator_config(Pio_emulator *pio, uint8_t set_base, uint8_t set_count, uint8_t out_base, uint8_t out_count, uint8_t in_base,
+    uint8_t sideset_base, bool autopull, uint8_t push_threshold){
+    pio->set_base = set_base;
+    pio->set_count = set_count;
+    pio->out_base = out_base;
+    pio->out_count = out_count;
+    pio->in_base = in_base;
+    pio->sideset_base = sideset_base;
+    pio->autopull = autopull;
+    pio->push_threshold = push_threshold;
+}
+
+void pio_emulator_wrap(Pio_emulator *pio, uint8_t bottom, uint8_t top){
+    pio->wrap_bottom = bottom;
+    pio->wrap_top = top;
+}
+
+bool pio_emulator_put(Pio_emulator *pio, uint32_t word){
+    if(pio->fifo_pos == pio->fifo_len){ // empty: restart at the beginning
+        pio->fifo_pos = 0;
+        pio->fifo_len = 0;
+    }
+    if(pio->fifo_len == PIO_EMULATOR_FIFO){
+        return false;
+    }
+    pio->fifo[pio->fifo_len++] = word;
+    return true;
+}
+
+bool pio_emulator_get(Pio_emulator *pio, uint32_t *word){
+    if(pio->rx_len == 0){
+        return false;
+    }
+    *word = pio->rx_fifo[0];
+    pio->rx_len--;
+    for(uint8_t i = 0; i < pio->rx_len; i++){
+        pio->rx_fifo[i] = pio->rx_fifo[i + 1];
+    }
+    return true;
+}
+
+// as the hardware, the pc is kept
+void pio_emulator_restart(Pio_emulator *pio){
+    pio->x = 0;
+    pio->y = 0;
+    pio->isr = 0;
+    pio->osr = 0;
+    pio->osr_count = 32;
+    pio->isr_count = 0;
+    pio->irq = 0;
+}
+
+void pio_emulator_clear_fifos(Pio_emulator *pio){
+    pio->fifo_len = 0;
+    pio->fifo_pos = 0;
+    pio->rx_len = 0;
+}
+
+uint8_t pio_emulator_level(const Pio_emulator *pio){
+    return (pio->gpio >> pio->set_base) & 1;
+}
+
+static bool gpio_in(Pio_emulator *pio, uint8_t gpio){
+    return (pio->gpio_get != NULL) ? pio->gpio_get(pio->context, gpio) : false;
+}
+
+static void write_pins(Pio_emulator *pio, uint8_t base, uint8_t count, uint32_t value){
+    for(uint8_t i = 0; i < count; i++){
+        uint8_t gpio = (base + i) % 32;
+        pio->gpio = (pio->gpio & ~(1u << gpio)) | (((value >> i) & 1) << gpio);
+    }
+}
+
+static bool pull(Pio_emulator *pio){
+    if(pio->fifo_pos == pio->fifo_len){
+        return false;
+    }
+    pio->osr = pio->fifo[pio->fifo_pos++];
+    pio->osr_count = 0;
+    return true;
+}
+
+static bool push(Pio_emulator *pio){
+    if(pio->rx_len == PIO_EMULATOR_RX_FIFO){
+        return false;
+    }
+    pio->rx_fifo[pio->rx_len++] = pio->isr;
+    pio->isr = 0;
+    pio->isr_count = 0;
+    return true;
+}
+
+static uint32_t mov_source(Pio_emulator *pio, uint8_t src){
+    switch(src){
+        case SRC_PINS: {
+            uint32_t value = 0;
+            for(uint8_t i = 0; i < 32; i++){
+                value |= (uint32_t) gpio_in(pio, (pio->in_base + i) % 32) << i;
+            }
+            return value;
+        }
+        case SRC_X:   return pio->x;
+        case SRC_Y:   return pio->y;
+        case SRC_ISR: return pio->isr;
+        case SRC_OSR: return pio->osr;
+        default:      return 0;
+    }
+}
+
+// destination of OUT and MOV (pins: OUT pins)
+static void write_dest(Pio_emulator *pio, uint8_t dest, uint32_t value, uint8_t *next_pc){
+    switch(dest){
+        case DEST_PINS: write_pins(pio, pio->out_base, pio->out_count, value); break;
+        case DEST_X:    pio->x = value;                                       break;
+        case DEST_Y:    pio->y = value;                                       break;
+        case DEST_PC:   *next_pc = value & 0x1F;                              break;
+        case DEST_ISR:  pio->isr = value; pio->isr_count = 0;                 break;
+        default:                                                              break;
+    }
+}
+
+// executes instr, returns false if it stalls (the state does not change then)
+static bool execute(Pio_emulator *pio, uint16_t instr, uint8_t *next_pc){
+    uint8_t arg = instr & 0xFF;
+    switch(OPCODE(instr)){
+        case OP_JMP: {
+            bool jump;
+            switch(arg >> 5){
+                case 0:  jump = true;                 break;
+                case 1:  jump = (pio->x == 0);        break;
+                case 2:  jump = (pio->x-- != 0);      break;
+                case 3:  jump = (pio->y == 0);        break;
+                case 4:  jump = (pio->y-- != 0);      break;
+                case 5:  jump = (pio->x != pio->y);   break;
+                default: jump = false;                break;
+            }
+            if(jump){
+                *next_pc = arg & 0x1F;
+            }
+        } break;
+        case OP_WAIT: {
+            uint8_t index = arg & 0x1F;
+            uint8_t source = (arg >> 5) & 0x03;
+            if(source != WAIT_GPIO && source != WAIT_PIN){
+                printf("pio_emulator: unsupported instruction 0x%04x at %u\n", instr, pio->pc);
+                return false;
+            }
+            uint8_t gpio = (source == WAIT_GPIO) ? index : (pio->in_base + index) % 32;
+            if(gpio_in(pio, gpio) != (arg >> 7)){
+                return false;
+            }
+        } break;
+        case OP_IN: {
+            uint8_t bits = (arg & 0x1F) ? (arg & 0x1F) : 32;
+            if(pio->push_threshold > 0 && pio->isr_count + bits >= pio->push_threshold && pio->rx_len == PIO_EMULATOR_RX_FIFO){
+                return false; // autopush: RX FIFO full
+            }
+            uint32_t value = 0;
+            if((arg >> 5) == SRC_PINS){
+                for(uint8_t i = 0; i < bits; i++){
+                    value |= (uint32_t) gpio_in(pio, (pio->in_base + i) % 32) << i;
+                }
+            }else{
+                value = mov_source(pio, arg >> 5);
+            }
+            uint32_t mask = (bits == 32) ? 0xFFFFFFFF : ((1u << bits) - 1);
+            pio->isr = (bits == 32) ? value : ((pio->isr << bits) | (value & mask));
+            pio->isr_count = (pio->isr_count + bits < 32) ? pio->isr_count + bits : 32;
+            if(pio->push_threshold > 0 && pio->isr_count >= pio->push_threshold){
+                push(pio);
+            }
+        } break;
+        case OP_OUT: {
+            uint8_t bits = (arg & 0x1F) ? (arg & 0x1F) : 32;
+            if(pio->autopull && pio->osr_count >= 32 && !pull(pio)){
+                return false; // stall: no more data
+            }
+            uint32_t value = (bits == 32) ? pio->osr : (pio->osr >> (32 - bits));
+            pio->osr = (bits == 32) ? 0 : (pio->osr << bits);
+            pio->osr_count = (pio->osr_count + bits < 32) ? pio->osr_count + bits : 32;
+            write_dest(pio, arg >> 5, value, next_pc);
+        } break;
+        case OP_PUSH: {
+            bool if_flag = arg & 0x40, block = arg & 0x20;
+            if(arg & 0x80){ // PULL (ifempty)
+                if(if_flag && pio->osr_count < 32){
+                    break;
+                }
+                if(!pull(pio)){
+                    if(block){
+                        return false;
+                    }
+                    pio->osr = pio->x;
+                    pio->osr_count = 0;
+                }
+            }else{          // PUSH (iffull)
+                if(if_flag && pio->isr_count < pio->push_threshold){
+                    break;
+                }
+                if(!push(pio) && block){
+                    return false;
+                }
+            }
+        } break;
+        case OP_MOV: {
+            uint32_t value = mov_source(pio, arg & 0x07);
+            if(((arg >> 3) & 0x03) == 1){ // invert
+                value = ~value;
+            }
+            if((arg >> 5) == DEST_OSR){
+                pio->osr = value;
+                pio->osr_count = 0;
+            }else{
+                write_dest(pio, arg >> 5, value, next_pc);
+            }
+        } break;
+        case OP_IRQ: {
+            uint8_t flag = 1u << (arg & 0x07);
+            if(arg & 0x40){
+                pio->irq &= ~flag;
+            }else{
+                pio->irq |= flag;
+            }
+        } break;
+        case OP_SET:
+            switch(arg >> 5){
+                case DEST_PINS: write_pins(pio, pio->set_base, pio->set_count, arg & 0x1F); break;
+                case DEST_X:    pio->x = arg & 0x1F;                                        break;
+                case DEST_Y:    pio->y = arg & 0x1F;                                        break;
+                default:                                                                    break;
+            }
+        break;
+        default:
+            printf("pio_emulator: unsupported instruction 0x%04x at %u\n", instr, pio->pc);
+            return false;
+    }
+    if(pio->sideset && (instr & 0x1000)){
+        write_pins(pio, pio->sideset_base, 1, (instr >> 11) & 1);
+    }
+    if(pio->autopull && pio->osr_count >= 32){
+        pull(pio); // as the hardware, the OSR is refilled as soon as it is empty
+    }
+    return true;
+}
+
+static uint8_t delay_cycles(const Pio_emulator *pio, uint16_t instr){
+    return 1 + (pio->sideset ? ((instr >> 8) & 0x07) : ((instr >> 8) & 0x1F));
+}
+
+uint8_t pio_emulator_step(Pio_emulator *pio){
+    uint16_t instr = pio->program[pio->pc];
+    uint8_t next_pc = (pio->pc == pio->wrap_top) ? pio->wrap_bottom : pio->pc + 1;
+    if(!execute(pio, instr, &next_pc)){
+        return 0;
+    }
+    pio->pc = next_pc;
+    return delay_cycles(pio, instr);
+}
+
+uint8_t pio_emulator_exec(Pio_emulator *pio, uint16_t instr){
+    uint8_t next_pc = pio->pc;
+    if(!execute(pio, instr, &next_pc)){
+        return 0;
+    }
+    pio->pc = next_pc;
+    return delay_cycles(pio, instr);
+}
+
+uint32_t pio_emulator_run(Pio_emulator *pio, uint8_t *levels, uint32_t max_cycles){
+    uint32_t cycles = 0;
+    while(cycles < max_cycles){
+        uint8_t n = pio_emulator_step(pio);
+        if(n == 0){
+            return cycles; // stall: no more data
+        }
+        for(uint8_t i = 0; i < n && cycles < max_cycles; i++){
+            levels[cycles++] = pio_emulator_level(pio);
+        }
+    }
+    return cycles;
+}
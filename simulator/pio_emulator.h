@@ -0,0 +1,88 @@
+/**
+ * PIO state-machine emulator
+ *
+ * Executes a PIO program instruction by instruction (clock divider 1) on the GPIO levels of one state machine.
+ * Supported instructions: JMP (always, !X, X--, !Y, Y--, X!=Y), WAIT (gpio, pin), IN (pins, shift left, autopush),
+ * OUT (shift left, autopull: refilled right after the OSR got empty), PUSH/PULL (iffull/ifempty, block), MOV (X, Y, ISR, OSR, pins, invert), IRQ (set, clear)
+ * and SET (pins), with optional side-set (2 bits including the enable bit, see backscatter_program_init and msp430_pio_init).
+ * A stalled instruction has no effect (also no side-set) until it can complete.
+ * The pin groups follow the SDK (sm_config_set_set_pins, ..._out_pins, ..._in_pins, ..._sideset_pins).
+ *
+ * pio_emulator_run() runs the backscatter program and records the level of the SET pin,
+ * pio_emulator_step() executes one instruction such that a simulated peripheral can react to the pins
+ * (e.g. the MSP430 stand-in in project_pico_libs/host).
+ *
+ */
+
+#ifndef PIO_EMULATOR_LIB
+#define PIO_EMULATOR_LIB
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PIO_EMULATOR_FIFO     64 // TX words
+#define PIO_EMULATOR_RX_FIFO   4 // RX words (as the hardware without FIFO join)
+
+struct pio_emulator {
+    const uint16_t *program;
+    uint8_t length;
+    bool sideset;               // optional side-set (second antenna, SCK)
+    uint8_t pc;
+    uint8_t wrap_bottom, wrap_top;
+    uint32_t x, y, isr, osr;
+    uint8_t osr_count;          // bits shifted out of the OSR (32: empty)
+    uint8_t isr_count;          // bits shifted into the ISR
+    uint32_t gpio;              // output levels of the SET, OUT and side-set pins
+    uint8_t set_base, set_count, out_base, out_count, in_base, sideset_base;
+    bool autopull;              // refill the OSR after 32 bits
+    uint8_t push_threshold;     // autopush after this many bits, 0: no autopush
+    uint8_t irq;                // IRQ flags (bit 0: IRQ 0)
+    bool (*gpio_get)(void *context, uint8_t gpio); // input levels (IN, WAIT), NULL: low
+    void *context;
+    uint32_t fifo[PIO_EMULATOR_FIFO];
+    uint8_t fifo_len;           // the TX FIFO holds fifo_len - fifo_pos words
+    uint8_t fifo_pos;
+    uint32_t rx_fifo[PIO_EMULATOR_RX_FIFO];
+    uint8_t rx_len;
+};
+typedef struct pio_emulator Pio_emulator;
+
+/*
+ * backscatter defaults: SET pin 0 (also OUT), side-set pin 1, autopull after 32 bits, no autopush, no inputs
+ * pio_emulator_config() changes the pins and the shifting afterwards
+ */
+void pio_emulator_init(Pio_emulator *pio, const uint16_t *program, uint8_t length, bool sideset);
+
+void pio_emulator_config(Pio_emulator *pio, uint8_t set_base, uint8_t set_count, uint8_t out_base, uint8_t out_count, uint8_t in_base,
+    uint8_t sideset_base, bool autopull, uint8_t push_threshold);
+
+// sm_config_set_wrap() counterpart (default: the whole program)
+void pio_emulator_wrap(Pio_emulator *pio, uint8_t bottom, uint8_t top);
+
+// pio_sm_put_blocking() counterpart, returns false if the FIFO is full
+bool pio_emulator_put(Pio_emulator *pio, uint32_t word);
+
+// pio_sm_get() counterpart, returns false if the RX FIFO is empty
+bool pio_emulator_get(Pio_emulator *pio, uint32_t *word);
+
+// pio_sm_restart() and pio_sm_clear_fifos() counterparts
+void pio_emulator_restart(Pio_emulator *pio);
+void pio_emulator_clear_fifos(Pio_emulator *pio);
+
+/*
+ * execute the instruction at pc (pio_emulator_exec: instr instead, like pio_sm_exec()),
+ * returns the cycles taken (1 + delay) or 0 if the state machine stalls (empty TX FIFO, full RX FIFO, WAIT)
+ */
+uint8_t pio_emulator_step(Pio_emulator *pio);
+uint8_t pio_emulator_exec(Pio_emulator *pio, uint16_t instr);
+
+// level of the (first) SET pin
+uint8_t pio_emulator_level(const Pio_emulator *pio);
+
+/*
+ * run until the state-machine stalls or max_cycles have passed
+ * levels: level of the SET pin during each cycle (0/1), returns the number of cycles
+ */
+uint32_t pio_emulator_run(Pio_emulator *pio, uint8_t *levels, uint32_t max_cycles);
+
+#endif
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+#
+# Checks of the log decoders and the bit error rate in functions.py on a synthetic binary log.
+# Usage: python3 check_functions.py (exits with 1 if a check fails)
+
+import os
+import sys
+import tempfile
+import numpy as np
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from functions import *
+
+PACKETS = 10
+SAMPLE_BYTES = 12
+
+# COBS encoder of project_pico_libs/packet_log.c
+def cobs_encode(data):
+    out = bytearray([0])
+    code_index, code = 0, 1
+    for b in data:
+        if b == 0:
+            out[code_index] = code
+            code_index, code = len(out), 1
+            out.append(0)
+        else:
+            out.append(b)
+            code += 1
+            if code == 0xFF:
+                out[code_index] = code
+                code_index, code = len(out), 1
+                out.append(0)
+    out[code_index] = code
+    return bytes(out)
+
+# record of encodePacketLog(): packet = length, seq, pseudo sequence and samples
+def packet_record(seq, position, flipped_bits=0, time_us=0):
+    samples = bytearray(expected_payload([position], SAMPLE_BYTES)[0])
+    for b in range(flipped_bits):
+        samples[b] ^= 0x01
+    packet = bytes([3 + SAMPLE_BYTES, seq, position >> 8, position & 0xFF]) + bytes(samples)
+    record = bytes([LOG_TYPE_PACKET]) + time_us.to_bytes(8, "little") + bytes([LOG_FLAG_CRC_OK, 0xc4, 0x20, len(packet)]) + packet
+    return b"\x00" + cobs_encode(record) + b"\x00"
+
+def main():
+    failures = 0
+    stream = bytearray(b"text output before the records\r\n")
+    for p in range(PACKETS):
+        stream += packet_record(p, SAMPLE_BYTES * p, flipped_bits=3 if p == 5 else 0, time_us=1000 * p)
+    with tempfile.NamedTemporaryFile(suffix=".bin", delete=False) as f:
+        f.write(stream)
+    try:
+        log = read_binary_log(f.name)
+    finally:
+        os.remove(f.name)
+    bits = PACKETS * 8 * (2 + SAMPLE_BYTES) # the pseudo sequence counts as well
+    expected = 3 / bits
+    failures += len(log["len"]) != PACKETS or list(packet_seqs(log)) != list(range(PACKETS))
+    failures += not bool(np.isclose(compute_ber(log, PACKET_LEN=SAMPLE_BYTES), expected))
+    failures += not bool(np.isclose(compute_ber(binary_log_to_dataframe(log), PACKET_LEN=SAMPLE_BYTES), expected))
+    errors, total = packet_bit_errors(log, PACKET_LEN=SAMPLE_BYTES)
+    failures += list(errors) != [3 if p == 5 else 0 for p in range(PACKETS)] or total.sum() != bits
+    # seq wrap, seq 3 lost and retransmitted later, seq 7 lost for good: only the second window misses a packet
+    seqs = [250, 251, 252, 253, 254, 255, 0, 1, 2, 4, 5, 6, 3, 8, 9]
+    ber, per = window_error_rates(seqs, np.zeros(len(seqs)), np.ones(len(seqs)), window=8)
+    failures += not np.allclose(per, [0, 1/8])
+    # a retransmitted seq counts once: delivered if any copy passed the CRC
+    ber, per = window_error_rates([0, 1, 2, 1], np.zeros(4), np.ones(4), window=4, crc=[True, False, True, True])
+    failures += not np.allclose(per, [0])
+    ber, per = window_error_rates([0, 1, 2, 1], np.zeros(4), np.ones(4), window=4, crc=[True, False, True, False])
+    failures += not np.allclose(per, [1/3])
+    print(f"check_functions: {failures} failed")
+    return 1 if failures else 0
+
+if __name__ == "__main__":
+    sys.exit(main())
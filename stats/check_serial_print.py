@@ -0,0 +1,90 @@
+#!/usr/bin/env python3
+#
+# Checks of the capture loop of serial-print.py over a pseudo terminal: log rotation in text mode,
+# the unchanged stream and the record index in binary mode.
+# Usage: python3 check_serial_print.py (exits with 1 if a check fails, needs pyserial)
+
+import importlib.util
+import os
+import sys
+import tempfile
+import threading
+import time
+import pty
+import tty
+
+spec = importlib.util.spec_from_file_location("serial_print", os.path.join(os.path.dirname(os.path.abspath(__file__)), "serial-print.py"))
+serial_print = importlib.util.module_from_spec(spec)
+spec.loader.exec_module(serial_print)
+
+MAX_BYTES = 200
+CAPTURE_S = 2.0
+
+# run capture() on the slave side of a pty for CAPTURE_S while data is written to the master side
+def run_capture(data, logfile, binary):
+    master, slave = pty.openpty()
+    tty.setraw(slave) # no echo, no newline translation
+    thread = threading.Thread(target=serial_print.capture, args=(os.ttyname(slave),),
+        kwargs=dict(logfile=logfile, max_bytes=MAX_BYTES, binary=binary, echo=False, duration=CAPTURE_S))
+    thread.start()
+    time.sleep(0.3) # port opened
+    for i in range(0, len(data), 37): # arbitrary chunks, lines and records are split across reads
+        os.write(master, data[i:i+37])
+        time.sleep(0.01)
+    thread.join()
+    os.close(master)
+    os.close(slave)
+
+def log_files(logfile, extension):
+    files, index = [], 0
+    while True:
+        name = f'{logfile}{"" if index == 0 else f"_{index:03}"}{extension}'
+        if not os.path.exists(name):
+            return files
+        with open(name, 'rb') as f:
+            files.append(f.read())
+        index += 1
+
+def check_text(directory):
+    failures = 0
+    lines = [f'{i:05} | 0f 00 {i % 256:02x} | -69 CRC ok'.encode() for i in range(40)]
+    logfile = os.path.join(directory, 'text')
+    run_capture(b''.join(line + b'\r\n' for line in lines), logfile, False)
+    files = log_files(logfile, '.txt')
+    failures += len(files) < 2 # rotated
+    failures += any(len(f) > MAX_BYTES for f in files)
+    stamped = b''.join(files).split(b'\n')[:-1]
+    failures += len(stamped) != len(lines)
+    for line, expected in zip(stamped, lines):
+        failures += not line.startswith(b'[') or line.split(b'] ', 1)[-1] != expected
+    return failures
+
+def check_binary(directory):
+    failures = 0
+    records = [b'\x00' + bytes([i + 1] * (3 + i % 20)) + b'\x00' for i in range(30)]
+    stream = b'text before the records\r\n' + b''.join(records)
+    logfile = os.path.join(directory, 'binary')
+    run_capture(stream, logfile, True)
+    files = log_files(logfile, '.bin')
+    failures += len(files) < 2 # rotated
+    failures += any(len(f) > MAX_BYTES for f in files)
+    failures += b''.join(files) != stream # stored unchanged
+    # every index entry points at the start of its record
+    entries = [line.split() for line in b''.join(log_files(logfile, '.idx')).decode().splitlines()]
+    failures += len(entries) != stream.count(b'\x00')
+    previous = 0
+    for file_index, offset, t_ns in entries:
+        file_index, offset, t_ns = int(file_index), int(offset), int(t_ns)
+        failures += file_index >= len(files) or offset > len(files[file_index]) or t_ns < previous
+        failures += offset > 0 and files[file_index][offset - 1] != 0 # the previous record ended here
+        previous = t_ns
+    return failures
+
+def main():
+    with tempfile.TemporaryDirectory() as directory:
+        failures = check_text(directory) + check_binary(directory)
+    print(f"check_serial_print: {failures} failed")
+    return 1 if failures else 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -10,42 +10,148 @@ import matplotlib.pyplot as plt
 import numpy as np
 from functools import cache
 import pandas as pd
-from numpy import NaN
+NaN = np.nan # numpy.NaN is gone since numpy 2.0
 from pylab import rcParams
 rcParams["figure.figsize"] = 16, 4
 import math
+import os
 
-# read the log file
-def readfile(filename):
-    types = {
-        "time_rx": str,
-        "frame": str,
-        "rssi": str,
-    }
-    df = pd.read_csv(
-        StringIO(" ".join(l for l in open(filename))),
-        skiprows=0,
+# typed columns of a text log (see read_log), also the layout of the memory-mappable cache file
+LOG_MAX_LEN = 64 # RX_BUFFER_SIZE of the receiver
+LOG_COLUMNS = np.dtype([("time_us", "<i8"), ("host_us", "<i8"), ("seq", "u1"), ("len", "u1"), ("rssi", "i1"), ("crc", "?"), ("overflow", "?"), ("frame", "u1", (LOG_MAX_LEN,))])
+
+# parse one chunk of text log lines "HH:MM:SS.mmm | xx xx ... | RSSI CRC pass/error" with vectorized string operations
+def parse_log_chunk(chunk):
+    chunk = chunk.dropna()
+    # optional host timestamp "[seconds] " added by serial-print.py
+    time_rx = chunk.time_rx.str.strip().str.extract(r"^(?:\[(\d+\.\d+)\] )?(\d+):(\d+):(\d+)\.(\d+)$")
+    chunk = chunk[time_rx[1].notna()] # skip other text output
+    time_rx = time_rx[time_rx[1].notna()]
+    columns = np.zeros(len(chunk), dtype=LOG_COLUMNS)
+    if len(chunk) == 0:
+        return columns
+    columns["time_us"] = ((time_rx[1].astype(np.int64)*60 + time_rx[2].astype(np.int64))*60 + time_rx[3].astype(np.int64))*1000000 \
+        + time_rx[4].str.slice(0, 6).str.ljust(6, "0").astype(np.int64)
+    columns["host_us"] = np.round(time_rx[0].astype(float).fillna(0).to_numpy() * 1e6)
+    frame = chunk.frame.str.strip()
+    columns["overflow"] = frame.str.startswith("packet overflow").to_numpy()
+    columns["crc"] = chunk.rssi.str.contains("CRC pass").to_numpy()
+    columns["rssi"] = pd.to_numeric(chunk.rssi.str.strip().str.split(" ", n=1).str[0], errors="coerce").fillna(0).astype(np.int8).to_numpy()
+    # hex frame -> byte matrix (one bytes.fromhex call per chunk)
+    hexstr = frame.where(~columns["overflow"], "").str.replace(" ", "", regex=False)
+    hexstr = hexstr.where(hexstr.str.len() % 2 == 0, hexstr.str.slice(0, -1)).str.slice(0, 2*LOG_MAX_LEN)
+    lengths = (hexstr.str.len() // 2).to_numpy()
+    data = np.frombuffer(bytes.fromhex("".join(hexstr)), dtype=np.uint8)
+    rows = np.repeat(np.arange(len(chunk)), lengths)
+    cols = np.arange(len(data)) - np.repeat(np.cumsum(lengths) - lengths, lengths)
+    columns["frame"][rows, cols] = data
+    columns["len"] = lengths
+    columns["seq"] = columns["frame"][:, 1]
+    return columns
+
+# read a text log in chunks into typed numpy columns (structured array, see LOG_COLUMNS)
+# host_us is the host monotonic time of serial-print.py (0 if not available)
+# frame holds the received bytes starting with the length field (zero padded, see len)
+# cache: store the columns next to the log file (.npy) and memory-map it on the next call
+def read_log(filename, chunksize=100000, cache=False):
+    cachefile = filename + ".npy"
+    if cache and os.path.exists(cachefile) and os.path.getmtime(cachefile) >= os.path.getmtime(filename):
+        return np.load(cachefile, mmap_mode="r")
+    reader = pd.read_csv(
+        filename,
         header=None,
-        dtype=types,
+        dtype=str,
         delimiter="|",
-        on_bad_lines='warn',
-        names = ["time_rx", "frame", "rssi"]
+        on_bad_lines="skip",
+        names=["time_rx", "frame", "rssi"],
+        usecols=[0, 1, 2],
+        chunksize=chunksize,
+        encoding_errors="replace",
     )
-    df.dropna(inplace=True)
-    # covert to time data type
-    df.time_rx = df.time_rx.str.rstrip().str.lstrip()
-    df.time_rx = pd.to_datetime(df.time_rx, format='%H:%M:%S.%f')
-    for i in range(len(df)):
-        df.iloc[i,0] = df.iloc[i,0].strftime("%H:%M:%S.%f")
-    # parse the payload to seq and payload
-    df.frame = df.frame.str.rstrip().str.lstrip()
-    df = df[df.frame.str.contains("packet overflow") == False]
-    df['seq'] = df.frame.apply(lambda x: int(x[3:5], base=16))
-    df['payload'] = df.frame.apply(lambda x: x[6:])
-    # parse the rssi data
-    df.rssi = df.rssi.str.lstrip().str.split(" ", expand=True).iloc[:,0]
-    df.rssi = df.rssi.astype('int')
-    df = df.drop(columns=['frame'])
+    columns = np.concatenate([parse_log_chunk(chunk) for chunk in reader] + [np.zeros(0, dtype=LOG_COLUMNS)])
+    if cache:
+        np.save(cachefile, columns)
+        return np.load(cachefile, mmap_mode="r")
+    return columns
+
+HEX_BYTES = np.array([f"{b:02x}" for b in range(256)])
+
+# read the log file
+def readfile(filename, cache=False):
+    columns = read_log(filename, cache=cache)
+    columns = columns[~columns["overflow"] & (columns["len"] >= 2)]
+    payload = HEX_BYTES[columns["frame"][:, 2:]]
+    df = pd.DataFrame({
+        "time_rx": pd.Timestamp(1900, 1, 1) + pd.to_timedelta(columns["time_us"], unit="us"),
+        "rssi": columns["rssi"].astype("int"),
+        "seq": columns["seq"].astype("int"),
+        "payload": [" ".join(p[:n-2]) for p, n in zip(payload, columns["len"])],
+    })
+    df.reset_index(inplace=True)
+    return df
+
+# decode a COBS (consistent overhead byte stuffing) frame without its 0x00 delimiter
+def cobs_decode(frame):
+    out = bytearray()
+    i = 0
+    while i < len(frame):
+        code = frame[i]
+        if code == 0 or i + code > len(frame):
+            raise ValueError("invalid COBS frame")
+        out += frame[i+1:i+code]
+        i += code
+        if code < 0xFF and i < len(frame):
+            out.append(0)
+    return bytes(out)
+
+# binary packet log record (see project_pico_libs/packet_log.h)
+LOG_TYPE_PACKET = 0x01
+LOG_FLAG_OVERFLOW = 0x01
+LOG_FLAG_CRC_OK = 0x02
+LOG_HEADER = np.dtype([("type", "u1"), ("time_us", "<u8"), ("flags", "u1"), ("rssi", "i1"), ("lqi", "u1"), ("len", "u1")])
+
+# read a binary packet log, return a dict of columnar numpy arrays
+# text output between the records is ignored
+def read_binary_log(filename, record_type=LOG_TYPE_PACKET):
+    with open(filename, "rb") as f:
+        chunks = f.read().split(b"\x00")
+    headers = bytearray()
+    payloads = []
+    for chunk in chunks:
+        if len(chunk) == 0:
+            continue
+        try:
+            record = cobs_decode(chunk)
+        except ValueError:
+            continue # text output
+        if len(record) < LOG_HEADER.itemsize or record[0] != record_type or record[LOG_HEADER.itemsize-1] != len(record) - LOG_HEADER.itemsize:
+            continue # text output or truncated record
+        headers += record[:LOG_HEADER.itemsize]
+        payloads.append(record[LOG_HEADER.itemsize:])
+    header = np.frombuffer(bytes(headers), dtype=LOG_HEADER)
+    payload = np.zeros((len(payloads), max([len(p) for p in payloads], default=0)), dtype=np.uint8)
+    for i, p in enumerate(payloads):
+        payload[i, :len(p)] = np.frombuffer(p, dtype=np.uint8)
+    return {
+        "time_us": header["time_us"].copy(),
+        "overflow": (header["flags"] & LOG_FLAG_OVERFLOW) != 0,
+        "crc": (header["flags"] & LOG_FLAG_CRC_OK) != 0,
+        "rssi": header["rssi"].copy(),
+        "lqi": header["lqi"].copy(),
+        "len": header["len"].copy(),
+        "payload": payload, # zero padded to the longest packet, see len
+    }
+
+# convert a binary packet log into the same dataframe as readfile()
+def binary_log_to_dataframe(log):
+    valid = ~log["overflow"] & (log["len"] >= 2)
+    t = log["time_us"][valid]
+    df = pd.DataFrame({
+        "time_rx": pd.to_datetime(t, unit="us"),
+        "rssi": log["rssi"][valid].astype("int"),
+        "seq": log["payload"][valid, 1].astype("int"),
+        "payload": [" ".join(f"{b:02x}" for b in p[2:n]) for p, n in zip(log["payload"][valid], log["len"][valid])],
+    })
     df.reset_index(inplace=True)
     return df
 
@@ -55,6 +161,56 @@ def parse_payload(payload_string):
     return list(tmp)
 
 
+# adaptive Rice code of the compressed payloads (see generate_compressed() in packet_generation.h)
+SAMPLE_CENTER = 0x1FFF
+RICE_K0 = 11
+RICE_QMAX = 16
+
+# decode the samples of one compressed stream (bytes after the pseudo sequence), stops at the padding (all ones)
+def decompress_samples(stream):
+    bits = np.unpackbits(np.asarray(stream, dtype=np.uint8))
+    pos, total, count, samples = 0, 1 << RICE_K0, 1, []
+    while True:
+        k = 0
+        while (count << k) < total and k < 16:
+            k += 1
+        q = 0
+        while q <= RICE_QMAX and pos < len(bits) and bits[pos] == 1:
+            q += 1
+            pos += 1
+        if q > RICE_QMAX or pos >= len(bits):
+            return samples
+        pos += 1 # terminating zero
+        width = 16 if q == RICE_QMAX else k
+        if pos + width > len(bits):
+            return samples
+        value = 0
+        for b in bits[pos:pos+width]:
+            value = (value << 1) | int(b)
+        pos += width
+        if q == RICE_QMAX:
+            sample = value
+        else:
+            u = (q << k) | value
+            sample = SAMPLE_CENTER - (u + 1) // 2 if u & 1 else SAMPLE_CENTER + u // 2
+        r = sample - SAMPLE_CENTER
+        total += 2 * r if r >= 0 else -2 * r - 1
+        count += 1
+        samples.append(sample)
+
+# replace the compressed payloads of a dataframe of readfile()/binary_log_to_dataframe() by the pseudo sequence
+# and the decoded samples, such that the analysis works as for uncompressed logs
+# (a bit error corrupts the rest of the packet's samples)
+def decompress_log(df):
+    def decode(payload_string):
+        payload = parse_payload(payload_string)
+        samples = decompress_samples(payload[2:])
+        data = payload[:2] + [b for s in samples for b in (s >> 8, s & 0xFF)]
+        return " ".join(HEX_BYTES[data])
+    df = df.copy()
+    df["payload"] = df.payload.map(decode)
+    return df
+
 def popcount(n):
     return bin(n).count("1")
 
@@ -91,57 +247,125 @@ def data(seed):
     tmp = 0x7FF * np.float64(math.sqrt(np.float64(-2.0 * np.float64(math.log(u1)))))
     return np.trunc(max([0,min([0x3FFFFF,np.float64(np.float64(tmp * np.float64(math.cos(np.float64(two_pi * u2)))) + 0x1FFF)])])), seed
 
-# generate the transmitted file for comparison
-TOTAL_NUM_16RND = 512*40 # generate a 40MB file, in case transmit too many data (larger than required 2MB)
-def generate_data(NUM_16RND, TOTAL_NUM_16RND):
-    LOW_BYTE = (1 << 8) - 1
-    length = int(np.ceil(TOTAL_NUM_16RND/NUM_16RND))
-    index = [NUM_16RND*i*2 for i in range(length)]
-    df = pd.DataFrame(index=index, columns=['data'])
-    initial_seed = 0xabcd # initial seed
-    pseudo_seq = 0 # (16-bit)
-    seed  = initial_seed
-    for i in index:
-        payload_data = []
-        for j in range(NUM_16RND):
-            if pseudo_seq > 0xffff:
-                pseudo_seq = 0
-                seed = initial_seed
-            pseudo_seq = pseudo_seq + 2
-            number, seed = data(seed)
-            payload_data.append((int(number) >> 8) - 0)
-            payload_data.append(int(number) & LOW_BYTE)
-        df.loc[i, "data"] = payload_data
-    return df
+# the transmitted stream repeats whenever the 16-bit file position wraps around (seed reset, see generate_sample())
+EXPECTED_STREAM_LEN = 0x10000
+
+# seeds of the random number generator after 0..n-1 steps, vectorized by repeated doubling (jump-ahead)
+def rnd_sequence(seed, n):
+    A1 = 1664525
+    C1 = 1013904223
+    seeds = np.array([seed], dtype=np.uint64)
+    mult, plus = A1, C1 # jump by len(seeds) steps
+    while len(seeds) < n:
+        seeds = np.concatenate([seeds, (seeds * np.uint64(mult) + np.uint64(plus)) & np.uint64(0xFFFFFFFF)])
+        mult, plus = (mult * mult) & 0xFFFFFFFF, (plus * (mult + 1)) & 0xFFFFFFFF
+    return seeds[:n]
+
+# generate the transmitted file for comparison: one cycle of the stream, indexed by the file position (pseudo sequence)
+@cache
+def expected_stream():
+    seeds = rnd_sequence(0xabcd, EXPECTED_STREAM_LEN + 1).astype(np.float64)
+    u1 = seeds[1::2] / 0xFFFFFFFF
+    u2 = seeds[2::2] / 0xFFFFFFFF
+    tmp = 0x7FF * np.sqrt(-2.0 * np.log(u1))
+    samples = np.trunc(np.clip(tmp * np.cos(2.0 * np.pi * u2) + 0x1FFF, 0, 0x3FFFFF)).astype(np.uint16)
+    stream = np.empty(EXPECTED_STREAM_LEN, dtype=np.uint8)
+    stream[0::2] = samples >> 8
+    stream[1::2] = samples & 0xFF
+    return stream
+
+# expected payload bytes for each pseudo sequence (matrix of len(pseudo_seq) x PACKET_LEN)
+def expected_payload(pseudo_seq, PACKET_LEN):
+    index = (np.asarray(pseudo_seq, dtype=np.int64)[:, None] + np.arange(PACKET_LEN)) % EXPECTED_STREAM_LEN
+    return expected_stream()[index]
 
-file_content = None
 def payload_for_peudo_seq(pseudo_seq,PACKET_LEN):
-    global file_content
-    if type(file_content) == type(None): # generate data
-        file_content = generate_data(int(PACKET_LEN/2), TOTAL_NUM_16RND)
-    if pseudo_seq in file_content.index:
-        return file_content.loc[pseudo_seq, 'data']
-    else:
-        return file_content.loc[0, 'data'] # TODO: pseudo sequence not within the first expected range
+    return list(expected_payload([pseudo_seq], PACKET_LEN)[0])
+
+POPCOUNT8 = np.array([bin(i).count("1") for i in range(256)], dtype=np.uint8)
+
+# seq of every packet of a dataframe of readfile() or the columns of read_log()/read_binary_log()
+def packet_seqs(df):
+    if isinstance(df, dict): # read_binary_log(): payload starts with length and seq
+        return df["payload"][:, 1] if df["payload"].shape[1] > 1 else np.zeros(len(df["len"]), dtype=np.uint8)
+    return np.asarray(df["seq"])
+
+# received payload (pseudo sequence + samples) as byte matrix and the number of bytes per packet
+# accepts the dataframe of readfile() or the columns of read_log()/read_binary_log()
+def payload_matrix(df):
+    if isinstance(df, pd.DataFrame):
+        hexstr = df.payload.str.replace(" ", "", regex=False)
+        lengths = (hexstr.str.len() // 2).to_numpy()
+        data = np.frombuffer(bytes.fromhex("".join(hexstr)), dtype=np.uint8)
+        matrix = np.zeros((len(df), max(lengths.max(initial=0), 2)), dtype=np.uint8)
+        rows = np.repeat(np.arange(len(df)), lengths)
+        cols = np.arange(len(data)) - np.repeat(np.cumsum(lengths) - lengths, lengths)
+        matrix[rows, cols] = data
+        return matrix, lengths
+    if isinstance(df, dict): # read_binary_log(): payload starts with length and seq
+        return df["payload"][:, 2:], np.maximum(df["len"].astype(np.int64) - 2, 0)
+    # read_log(): frame starts with length and seq
+    return np.asarray(df["frame"])[:, 2:], np.maximum(df["len"].astype(np.int64) - 2, 0)
+
+# bit errors and number of bits for every packet (errors in the samples, bits include the 2B pseudo sequence)
+def packet_bit_errors(df, PACKET_LEN=32):
+    payload, lengths = payload_matrix(df)
+    pseudo_seq = (payload[:, 0].astype(np.int64) << 8) + payload[:, 1]
+    received = np.zeros((len(payload), PACKET_LEN), dtype=np.uint8)
+    width = min(PACKET_LEN, payload.shape[1] - 2)
+    received[:, :width] = payload[:, 2:2+width]
+    valid = np.arange(PACKET_LEN) < (lengths[:, None] - 2)
+    errors = (POPCOUNT8[received ^ expected_payload(pseudo_seq, PACKET_LEN)] * valid).sum(axis=1)
+    return errors, 8*np.maximum(lengths, 2)
 
 def compute_ber_packet(df_row, PACKET_LEN=32):
-    payload = parse_payload(df_row.payload)
-    pseudoseq = int(((payload[0]<<8) - 0) + payload[1])
-    expected_data = payload_for_peudo_seq(pseudoseq,PACKET_LEN)
-    # compute the bit errors
-    return (compute_bit_errors(payload[2:], expected_data, PACKET_LEN=PACKET_LEN), 8*(2+len(payload[2:]))) # 2+ for pseudo sequence
+    errors, total = packet_bit_errors(pd.DataFrame({"payload": [df_row.payload]}), PACKET_LEN)
+    return (int(errors[0]), int(total[0]))
 
 # main function to compute the BER for each frame, return both the error statistics dataframe and in total BER for the received data
 def compute_ber(df, PACKET_LEN=32):
-    # seq number initialization
-    print(f"The total number of packets transmitted by the tag is {df.seq[len(df)-1]+1}.")
-    if len(df) > 0:
-        errors,total = zip(*[compute_ber_packet(row,PACKET_LEN) for (_,row) in df.iterrows()])
-        return sum(errors)/sum(total)
+    seq = packet_seqs(df)
+    if len(seq) > 0:
+        # seq number initialization
+        print(f"The total number of packets transmitted by the tag is {seq[-1]+1}.")
+        errors, total = packet_bit_errors(df, PACKET_LEN)
+        return errors.sum()/total.sum()
     else:
         print("Warning, the log-file seems empty.")
         return 0.5
 
+# unwrap the 8-bit seq numbers as link_stats.c: a seq up to 128 behind the highest one is a retransmission (ARQ), not a wrap
+def unwrap_seqs(seq):
+    seq = np.asarray(seq, dtype=np.int64)
+    unwrapped = np.empty_like(seq)
+    highest = None
+    for i, s in enumerate(seq):
+        ahead = 0 if highest is None else (int(s) - highest) % 256
+        ahead = ahead - 256 if ahead >= 128 else ahead
+        unwrapped[i] = s if highest is None else highest + ahead
+        highest = unwrapped[i] if highest is None else max(highest, unwrapped[i])
+    return unwrapped
+
+# BER and PER over consecutive windows of `window` transmitted packets (seq numbers are unwrapped)
+# crc: optional boolean array, packets failing the CRC count as packet errors
+# a retransmitted seq counts once (received if any copy passed the CRC), the bit errors of all copies count
+def window_error_rates(seq, errors, total, window=100, crc=None):
+    unwrapped = unwrap_seqs(seq)
+    if len(unwrapped) > 0:
+        unwrapped -= unwrapped.min()
+    bins = unwrapped // window
+    nbins = bins.max() + 1 if len(bins) > 0 else 0
+    unique, inverse = np.unique(unwrapped, return_inverse=True)
+    good_seq = np.zeros(len(unique))
+    np.maximum.at(good_seq, inverse, 1 if crc is None else np.asarray(crc, dtype=float))
+    good = np.bincount(unique // window, weights=good_seq, minlength=nbins)
+    sent = np.full(nbins, window)
+    if nbins > 0:
+        sent[-1] = unwrapped.max() % window + 1 # last window is incomplete
+    ber = np.bincount(bins, weights=errors, minlength=nbins) / np.maximum(np.bincount(bins, weights=total, minlength=nbins), 1)
+    per = 1 - good / sent
+    return ber, per
+
 # plot radar chart
 def radar_plot(metrics):
     categories = ['Time', 'Reliability', 'Distance']
@@ -0,0 +1,186 @@
+import serial
+import argparse
+import queue
+import sys
+import threading
+import time
+from os import name
+from datetime import datetime
+
+# capture the output of the Pico:
+# - a background thread reads the serial port with large buffers
+# - every completed line (text mode) or binary record (--binary, 0x00 delimited, see project_pico_libs/packet_log.h)
+#   is stamped with the host monotonic time
+# - the log is written buffered and rotated after --max-bytes
+# without --port, the available ports are listed and the port is asked for interactively
+# --trace-every requests a latency trace dump (see project_pico_libs/trace.h) periodically
+
+READ_SIZE = 1 << 16
+WRITE_BUFFER = 1 << 20
+TRACE_DUMP_CHAR = b't'
+
+# read the serial port in a background thread, put (host monotonic time [ns], data) into a queue
+class SerialReader(threading.Thread):
+    def __init__(self, ser, chunks):
+        super().__init__(daemon=True)
+        self.ser = ser
+        self.chunks = chunks
+        self.running = True
+
+    def run(self):
+        while self.running:
+            try:
+                data = self.ser.read(max(1, min(self.ser.in_waiting, READ_SIZE)))
+            except serial.SerialException:
+                break
+            if data:
+                self.chunks.put((time.monotonic_ns(), data))
+        self.chunks.put(None) # port closed
+
+# buffered log file, a new file is started (at a line/record boundary) when max_bytes is exceeded
+class RotatingLog:
+    def __init__(self, basename, extension, max_bytes):
+        self.basename = basename
+        self.extension = extension
+        self.max_bytes = max_bytes
+        self.index = 0
+        self.file = None
+        self.open()
+
+    def open(self):
+        suffix = '' if self.index == 0 else f'_{self.index:03}'
+        self.filename = f'{self.basename}{suffix}{self.extension}'
+        self.file = open(self.filename, 'ab', buffering=WRITE_BUFFER)
+        self.written = 0
+
+    # rotate if length bytes do not fit anymore, returns (file index, offset) where they will be written
+    def reserve(self, length):
+        if self.max_bytes > 0 and self.written > 0 and self.written + length > self.max_bytes:
+            self.file.close()
+            self.index += 1
+            self.open()
+        return self.index, self.written
+
+    def write(self, data):
+        self.reserve(len(data))
+        self.file.write(data)
+        self.written += len(data)
+
+    def flush(self):
+        self.file.flush()
+
+    def close(self):
+        self.file.close()
+
+# text mode: prefix every line with the host time, e.g. "[12.345678] 00:00:05.069 | 0f 00 ... | -69 CRC error"
+def handle_lines(pending, t_ns, log, echo):
+    *lines, pending = pending.split(b'\n')
+    for line in lines:
+        stamped = f'[{t_ns/1e9:.6f}] '.encode() + line.rstrip(b'\r') + b'\n'
+        if log:
+            log.write(stamped)
+        if echo:
+            sys.stdout.write(stamped.decode('utf-8', errors='replace'))
+    return pending
+
+# binary mode: store the stream unchanged, the host time of each record is written to <log>.idx as "file_index offset time_ns"
+def handle_records(pending, t_ns, log, index, echo):
+    *records, pending = pending.split(b'\x00')
+    for record in records:
+        data = record + b'\x00'
+        if log:
+            file_index, offset = log.reserve(len(data))
+            index.write(f'{file_index} {offset} {t_ns}\n'.encode())
+            log.write(data)
+        if echo and b'\n' in record:
+            try: # text output in between the records
+                text = record.decode('utf-8')
+                if all(c.isprintable() or c.isspace() for c in text):
+                    sys.stdout.write(text)
+            except UnicodeDecodeError:
+                pass
+    return pending
+
+def capture(port, baudrate=115200, logfile=None, max_bytes=0, binary=False, echo=True, duration=None, trace_every=None):
+    chunks = queue.Queue()
+    with serial.Serial(port, baudrate, timeout=0.1) as ser:
+        reader = SerialReader(ser, chunks)
+        reader.start()
+        log, index = None, None
+        if logfile:
+            log = RotatingLog(logfile, '.bin' if binary else '.txt', max_bytes)
+            if binary:
+                index = RotatingLog(logfile, '.idx', 0)
+        pending = b''
+        deadline = None if duration is None else time.monotonic() + duration
+        next_trace = None if trace_every is None else time.monotonic() + trace_every
+        try:
+            while deadline is None or time.monotonic() < deadline:
+                if next_trace is not None and time.monotonic() >= next_trace:
+                    ser.write(TRACE_DUMP_CHAR)
+                    next_trace += trace_every
+                try:
+                    item = chunks.get(timeout=0.5)
+                except queue.Empty:
+                    if log:
+                        log.flush()
+                    continue
+                if item is None:
+                    break
+                t_ns, data = item
+                if binary:
+                    pending = handle_records(pending + data, t_ns, log, index, echo)
+                else:
+                    pending = handle_lines(pending + data, t_ns, log, echo)
+        except KeyboardInterrupt:
+            pass
+        finally:
+            if pending and log: # incomplete last line/record
+                log.write(pending)
+            reader.running = False
+            reader.join(timeout=1)
+            for f in (log, index):
+                if f:
+                    f.close()
+
+def ask_port():
+    # print available ports
+    if name == 'nt':  # sys.platform == 'win32':
+        from serial.tools.list_ports_windows import comports
+    elif name == 'posix':
+        from serial.tools.list_ports_posix import comports
+    else:
+        print('Sorry, your platform is not supported.')
+        return None
+
+    # ask which to use
+    if len(comports()) == 0:
+        print('Sorry, no serial ports are available.')
+        return None
+    print('The available serial ports are:')
+    for p in comports():
+        print(f'- {p}')
+    port = input('\nWhich port would you like to use? ')
+    if (port in [str(p).split(' ')[0] for p in comports()]):
+        return port
+    print('Sorry, the provided ports was not part of the list.')
+    return None
+
+if __name__ == '__main__':
+    time_now = datetime.now()
+    parser = argparse.ArgumentParser(description='Capture the serial output of the Pico.')
+    parser.add_argument('--port', help='serial port (asked interactively if omitted)')
+    parser.add_argument('--baudrate', type=int, default=115200)
+    parser.add_argument('--log', default=f'./received_{time_now.year:04}-{time_now.month:02}-{time_now.day:02}_{time_now.hour:02}-{time_now.minute:02}-{time_now.second:02}', help='log file name without extension')
+    parser.add_argument('--no-log', action='store_true', help='only print the output')
+    parser.add_argument('--max-bytes', type=int, default=64 << 20, help='start a new log file after this size (0: never)')
+    parser.add_argument('--binary', action='store_true', help='the firmware logs binary records (LOG_BINARY)')
+    parser.add_argument('--quiet', action='store_true', help='do not print the output')
+    parser.add_argument('--duration', type=float, help='stop after this many seconds')
+    parser.add_argument('--trace-every', type=float, help='request a latency trace dump every this many seconds')
+    args = parser.parse_args()
+
+    port = args.port if args.port else ask_port()
+    if port:
+        print(f'Starting to read from {port}...')
+        capture(port, args.baudrate, None if args.no_log else args.log, args.max_bytes, args.binary, not args.quiet, args.duration, args.trace_every)
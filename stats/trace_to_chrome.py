@@ -0,0 +1,69 @@
+import argparse
+import json
+import re
+
+# convert a latency trace dump (see project_pico_libs/trace.h) into the Chrome trace format
+# open the output with chrome://tracing or https://ui.perfetto.dev
+# the input is a text log of the serial output (optionally with the host time prefix of serial-print.py)
+# every stage is shown as one track, GDO0 interrupts are instant events
+
+TRACE_LINE = re.compile(r'^(?:\[[0-9.]+\] )?trace: (.*)$')
+
+# returns a list of dumps, each a dict with the stage names and the events (time_us, stage, phase, arg)
+def read_trace(filename):
+    dumps = []
+    dump = None
+    with open(filename, 'r', errors='replace') as f:
+        for line in f:
+            match = TRACE_LINE.match(line.rstrip('\r\n'))
+            if not match:
+                continue
+            fields = match.group(1).split(' ')
+            if fields[0] == 'dump':
+                dump = {'stages': {}, 'events': [], 'overwritten': int(fields[3])}
+            elif dump is None:
+                continue # incomplete dump at the start of the log
+            elif fields[0] == 'stage':
+                dump['stages'][int(fields[1])] = fields[2]
+            elif fields[0] == 'end':
+                dumps.append(dump)
+                dump = None
+            elif len(fields) == 4:
+                dump['events'].append((int(fields[0]), int(fields[1]), fields[2], int(fields[3])))
+    return dumps
+
+def to_chrome_trace(dump, pid=0):
+    events = []
+    for stage, name in dump['stages'].items():
+        events.append({'name': 'thread_name', 'ph': 'M', 'pid': pid, 'tid': stage, 'args': {'name': name}})
+        events.append({'name': 'thread_sort_index', 'ph': 'M', 'pid': pid, 'tid': stage, 'args': {'sort_index': stage}})
+    open_stages = set()
+    for time_us, stage, phase, arg in dump['events']:
+        # drop end events whose begin was overwritten in the ring
+        if phase == 'B':
+            open_stages.add(stage)
+        elif phase == 'E':
+            if stage not in open_stages:
+                continue
+            open_stages.discard(stage)
+        event = {'name': dump['stages'].get(stage, str(stage)), 'ph': phase, 'ts': time_us, 'pid': pid, 'tid': stage, 'args': {'arg': arg}}
+        if phase == 'i':
+            event['s'] = 't'
+        events.append(event)
+    return {'traceEvents': events, 'displayTimeUnit': 'ms'}
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Convert a latency trace dump into Chrome trace JSON.')
+    parser.add_argument('log', help='text log containing "trace:" lines')
+    parser.add_argument('-o', '--output', default='trace.json')
+    parser.add_argument('--dump', type=int, default=-1, help='index of the dump in the log (default: last)')
+    args = parser.parse_args()
+
+    dumps = read_trace(args.log)
+    if not dumps:
+        print('No complete trace dump found.')
+    else:
+        dump = dumps[args.dump]
+        with open(args.output, 'w') as f:
+            json.dump(to_chrome_trace(dump), f)
+        print(f'{len(dump["events"])} events ({dump["overwritten"]} overwritten) written to {args.output}')
@@ -0,0 +1,95 @@
+/**
+ * Unit tests of project_pico_libs (host only)
+ *
+ * Runs the tests of the modules given on the command line (all without arguments), e.g. "tests arq fec".
+ * Every failed check is printed, the program exits with 1 if a check failed or a module is unknown.
+ * ctest runs each module as a test of its own (see CMakeLists.txt).
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include "tests.h"
+
+static uint32_t failures = 0;
+
+void test_fail_if(bool failed, const char *condition, const char *file, int line){
+    if(failed){
+        printf("%s:%d: failed: %s\n", file, line, condition);
+        failures++;
+    }
+}
+
+static FILE *capture_file = NULL;
+static int capture_saved = -1;
+
+void test_capture_begin(){
+    capture_file = tmpfile();
+    fflush(stdout);
+    capture_saved = dup(fileno(stdout));
+    dup2(fileno(capture_file), fileno(stdout));
+}
+
+FILE *test_capture_end(){
+    fflush(stdout);
+    dup2(capture_saved, fileno(stdout));
+    close(capture_saved);
+    rewind(capture_file);
+    return capture_file;
+}
+
+struct test {
+    const char *name;
+    void (*run)();
+};
+
+static const struct test tests[] = {
+    {"scheduler",          test_scheduler},
+    {"supply_filter",      test_supply_filter},
+    {"rssi_parser",        test_rssi_parser},
+    {"rate_control",       test_rate_control},
+    {"arq",                test_arq},
+    {"fec",                test_fec},
+    {"packet_generation",  test_packet_generation},
+    {"aggregator",         test_aggregator},
+    {"frame_ring",         test_frame_ring},
+    {"msp430_backup",      test_msp430_backup},
+    {"boot_config",        test_boot_config},
+    {"link_stats",         test_link_stats},
+    {"packet_pool",        test_packet_pool},
+    {"trace",              test_trace},
+    {"log_ring",           test_log_ring},
+};
+
+static bool selected(const char *name, int argc, char **argv){
+    for(int a = 1; a < argc; a++){
+        if(strcmp(argv[a], name) == 0){
+            return true;
+        }
+    }
+    return argc == 1;
+}
+
+int main(int argc, char **argv){
+    uint8_t count = sizeof(tests) / sizeof(tests[0]);
+    int ran = 0;
+    for(uint8_t t = 0; t < count; t++){
+        if(!selected(tests[t].name, argc, argv)){
+            continue;
+        }
+        uint32_t before = failures;
+        tests[t].run();
+        printf("%s: %u failed\n", tests[t].name, failures - before);
+        ran++;
+    }
+    if(argc > 1 && ran != argc - 1){
+        printf("ERROR: unknown test, the tests are:");
+        for(uint8_t t = 0; t < count; t++){
+            printf(" %s", tests[t].name);
+        }
+        printf("\n");
+        return 1;
+    }
+    return failures != 0;
+}
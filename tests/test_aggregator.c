@@ -0,0 +1,66 @@
+/**
+ * Frame aggregation (see aggregator.h): samples every period_us through the policy, every frame has to carry the
+ * generated samples in order (raw or as the stream regenerated by the receiver), full frames unless the latency
+ * bound or the energy budget forces a shorter one, no sample waits longer than the bound (plus one period)
+ *
+ */
+
+#include <string.h>
+#include "packet_generation.h"
+#include "aggregator.h"
+#include "tests.h"
+
+#define AGG_PAYLOAD (64 - HEADER_LEN) // a buffer of the packet pool
+static Aggregator aggregator;
+static uint8_t aggregator_payload[AGG_PAYLOAD];
+
+// returns the number of frames, budget: payload bytes the supply affords
+static uint32_t run_aggregator(bool compressed, uint32_t period_us, uint32_t latency_us, uint8_t budget, uint32_t samples){
+    Agg_policy policy = {.target_payload = AGG_PAYLOAD, .max_latency_us = latency_us, .compressed = compressed};
+    aggregator_init(&aggregator, &policy, file_position);
+    uint32_t frames = 0, received = 0;
+    uint64_t now_us = 0, queued_us[AGG_QUEUE_LEN];
+    for(uint32_t n = 0; n < samples; n++, now_us += period_us){
+        queued_us[n % AGG_QUEUE_LEN] = now_us;
+        aggregator_push(&aggregator, generate_sample(), now_us);
+        uint8_t len = aggregator_ready(&aggregator, now_us, budget);
+        if(len == 0){
+            continue;
+        }
+        uint8_t used = aggregator_pack(&aggregator, aggregator_payload, len);
+        uint16_t position = (aggregator_payload[0] << 8) | aggregator_payload[1];
+        uint8_t expected[AGG_PAYLOAD];
+        uint8_t count = (used - 2) / 2;
+        if(compressed){
+            uint16_t decoded[AGG_PAYLOAD * 4];
+            count = decompress_samples(&aggregator_payload[2], used - 2, decoded, sizeof(decoded) / 2);
+            FAIL_IF(expected_compressed(expected, used - 2, position) != count || memcmp(expected, &aggregator_payload[2], used - 2) != 0);
+        }else{
+            expected_data(expected, used - 2, position);
+            FAIL_IF(memcmp(expected, &aggregator_payload[2], used - 2) != 0);
+        }
+        FAIL_IF(used > len || count == 0 || position != (uint16_t) (aggregator.position + 2 * received));
+        FAIL_IF(now_us - queued_us[received % AGG_QUEUE_LEN] > latency_us + period_us);
+        FAIL_IF(used < len - (compressed ? 3 : 1) && now_us - queued_us[received % AGG_QUEUE_LEN] < latency_us); // short before the bound
+        received += count;
+        frames++;
+    }
+    FAIL_IF(aggregator.frames != frames || aggregator.packed != received || received + aggregator_count(&aggregator) + aggregator.dropped != samples);
+    return frames;
+}
+
+void test_aggregator(){
+    // fast sensor: only full frames
+    for(uint8_t compressed = 0; compressed < 2; compressed++){
+        uint32_t frames = run_aggregator(compressed, 40000, 2000000, AGG_PAYLOAD, 2600);
+        FAIL_IF(aggregator.latency_frames != 0 || frames < (compressed ? 2600 / 31 : 2600 / 26) || aggregator.dropped != 0);
+    }
+    // slow sensor: the latency bound sends 11 samples per frame
+    run_aggregator(false, 200000, 2000000, AGG_PAYLOAD, 1100);
+    FAIL_IF(aggregator.frames != 100 || aggregator.latency_frames != 100);
+    // low energy: full frames wait, the latency bound sends what the budget affords
+    run_aggregator(false, 40000, 2000000, 22, 1000);
+    FAIL_IF(aggregator.frames == 0 || aggregator.packed != 10 * aggregator.frames || aggregator.latency_frames != aggregator.frames);
+    run_aggregator(true, 40000, 2000000, 0, 100);
+    FAIL_IF(aggregator.frames != 0 || aggregator.dropped != 100 - AGG_QUEUE_LEN);
+}
@@ -0,0 +1,61 @@
+/**
+ * Selective-repeat ARQ (see arq.h) over a lossy channel: 20% of the transmissions are lost, 10% corrupted,
+ * one transmission per ms, the deadline is 3 ms and the receiver feedback follows every received frame.
+ * Every frame has to leave the window exactly once, acknowledged if and only if the receiver delivered it once,
+ * and only a few frames may be given up after ARQ_MAX_TX transmissions.
+ *
+ */
+
+#include <stddef.h>
+#include "arq.h"
+#include "tests.h"
+
+#define ARQ_FRAMES 1000
+static Arq_tx arq_tx;
+static Arq_rx arq_rx;
+static uint8_t arq_frames[ARQ_FRAMES];    // receptions delivered by the receiver
+static uint8_t arq_released[ARQ_FRAMES];
+static uint32_t arq_random = 7;
+
+static void arq_transmit(uint8_t *frame, uint8_t seq){
+    arq_random = arq_random * 1664525 + 1013904223;
+    uint32_t channel = (arq_random >> 8) % 100;
+    if(channel < 20){
+        return; // lost
+    }
+    *frame += arq_rx_update(&arq_rx, seq, channel >= 30);
+    Arq_ack ack;
+    arq_rx_ack(&arq_rx, &ack);
+    arq_tx_feedback(&arq_tx, &ack);
+}
+
+void test_arq(){
+    arq_tx_init(&arq_tx);
+    arq_rx_init(&arq_rx);
+    uint32_t next = 0, released = 0, given_up = 0;
+    for(uint64_t now_us = 1000; released < ARQ_FRAMES; now_us += 1000){
+        uint8_t seq;
+        uint8_t *frame = arq_tx_due(&arq_tx, now_us, &seq);
+        if(frame != NULL){
+            arq_transmit(frame, seq);
+            arq_tx_resent(&arq_tx, seq, now_us + 3000);
+        }else if(next < ARQ_FRAMES && !arq_tx_full(&arq_tx)){
+            FAIL_IF(!arq_tx_add(&arq_tx, &arq_frames[next], next, now_us + 3000));
+            arq_transmit(&arq_frames[next], next); // the seq wraps
+            next++;
+        }
+        bool delivered;
+        while((frame = arq_tx_release(&arq_tx, now_us, &delivered)) != NULL){
+            uint32_t f = frame - arq_frames;
+            FAIL_IF(arq_released[f]++ != 0 || delivered != (arq_frames[f] == 1));
+            given_up += !delivered;
+            released++;
+        }
+        if(now_us > 60000000){
+            FAIL_IF(released < ARQ_FRAMES); // stuck
+            break;
+        }
+    }
+    FAIL_IF(arq_rx.unique != ARQ_FRAMES - given_up || arq_rx.duplicates != 0 || given_up > ARQ_FRAMES / 100);
+    FAIL_IF(arq_tx.given_up != given_up || arq_tx.retransmissions < ARQ_FRAMES / 5 || arq_tx.used != 0);
+}
@@ -0,0 +1,55 @@
+/**
+ * Last-known-good configuration in the flash (see boot_config.h and boot_flash.h, host: a RAM array): a sector which
+ * was never erased, unchanged settings (no write), the sector wrapping after BOOT_CONFIG_RECORDS records, torn records
+ * (power loss while programming: the previous record is loaded) and an interrupted erase
+ *
+ */
+
+#include <string.h>
+#include "hardware/flash.h"
+#include "boot_config.h"
+#include "boot_flash.h"
+#include "tests.h"
+
+static Boot_config boot_settings(uint32_t i){
+    return (Boot_config) {.baud = 50000 + 1000 * (i % 100), .carrier_hz = 2450000000, .d0 = 40, .d1 = 36, .profile = i % 3};
+}
+
+static bool boot_loads(uint32_t i, uint32_t sequence){
+    Boot_config config, expected = boot_settings(i);
+    return boot_flash_load(&config) && boot_config_equal(&config, &expected) && config.sequence == sequence;
+}
+
+void test_boot_config(){
+    const uint32_t stores = 2 * BOOT_CONFIG_RECORDS + 4; // wraps twice
+    uint8_t *sector = &host_flash[BOOT_FLASH_OFFSET];
+    Boot_config config = boot_settings(0);
+    memset(sector, 0, FLASH_SECTOR_SIZE); // never erased
+    FAIL_IF(boot_flash_load(&config) || boot_config_next(sector) != -1);
+    FAIL_IF(!boot_flash_store(&config) || !boot_loads(0, 0) || boot_config_next(sector) != 1);
+    FAIL_IF(!boot_flash_store(&config) || !boot_loads(0, 0)); // unchanged: not written
+    for(uint32_t i = 1; i < stores; i++){
+        config = boot_settings(i);
+        FAIL_IF(!boot_flash_store(&config) || !boot_loads(i, i));
+    }
+    // torn record: programming stopped after the first bytes
+    int8_t latest = boot_config_latest(sector, &config);
+    int8_t next = boot_config_next(sector);
+    FAIL_IF(latest != (stores - 1) % BOOT_CONFIG_RECORDS || next != latest + 1);
+    config = boot_settings(100);
+    boot_config_seal(&config, stores);
+    memcpy(&sector[next * BOOT_CONFIG_RECORD_SIZE], &config, 8);
+    FAIL_IF(boot_config_latest(sector, &config) != latest || !boot_loads(stores - 1, stores - 1));
+    FAIL_IF(boot_config_next(sector) != next + 1); // skipped
+    config = boot_settings(7);
+    FAIL_IF(!boot_flash_store(&config) || !boot_loads(7, stores));
+    // a bit error in the newest record
+    sector[(next + 1) * BOOT_CONFIG_RECORD_SIZE + 8] ^= 0x01;
+    FAIL_IF(!boot_loads(stores - 1, stores - 1));
+    // interrupted erase: defaults until the next store
+    memset(sector, 0xFF, FLASH_SECTOR_SIZE / 2);
+    memset(&sector[FLASH_SECTOR_SIZE / 2], 0x5A, FLASH_SECTOR_SIZE / 2);
+    FAIL_IF(boot_flash_load(&config) || boot_config_next(sector) != 0);
+    config = boot_settings(9);
+    FAIL_IF(!boot_flash_store(&config) || !boot_loads(9, 0));
+}
@@ -0,0 +1,64 @@
+/**
+ * FEC (see fec.h) of a frame (seq and payload) with injected errors: every single bit error and every burst
+ * as long as the number of codewords is corrected, two errors in one codeword are detected, and at a BER of 1%
+ * at least 80% of the frames are decoded without errors (about 9% arrive without bit errors)
+ *
+ */
+
+#include <string.h>
+#include "packet_generation.h"
+#include "fec.h"
+#include "tests.h"
+
+static uint8_t fec_data[1 + PAYLOADSIZE];
+static uint8_t fec_block[FEC_LEN(1 + PAYLOADSIZE)];
+static uint32_t fec_random = 3;
+
+static uint32_t fec_rnd(){
+    fec_random = fec_random * 1664525 + 1013904223;
+    return fec_random >> 8;
+}
+
+static bool fec_roundtrip(const uint8_t *block, int16_t corrected){
+    uint8_t decoded[sizeof(fec_data)];
+    return fec_decode(block, sizeof(fec_data), decoded, NULL) == corrected && (corrected < 0 || memcmp(decoded, fec_data, sizeof(fec_data)) == 0);
+}
+
+void test_fec(){
+    uint8_t block[sizeof(fec_block)];
+    const uint16_t bits = 8 * sizeof(fec_block), codewords = sizeof(fec_block);
+    for(uint8_t i = 0; i < sizeof(fec_data); i++){
+        fec_data[i] = fec_rnd();
+    }
+    FAIL_IF(!fec_encode(fec_data, sizeof(fec_data), fec_block) || fec_encode(fec_data, FEC_MAX_LEN + 1, block));
+    FAIL_IF(!fec_roundtrip(fec_block, 0));
+    for(uint16_t k = 0; k < bits; k++){
+        memcpy(block, fec_block, sizeof(block));
+        block[k >> 3] ^= 0x80 >> (k & 7);
+        FAIL_IF(!fec_roundtrip(block, 1));
+    }
+    for(uint16_t start = 0; start + codewords <= bits; start++){
+        memcpy(block, fec_block, sizeof(block));
+        for(uint16_t k = start; k < start + codewords; k++){
+            block[k >> 3] ^= 0x80 >> (k & 7);
+        }
+        FAIL_IF(!fec_roundtrip(block, codewords));
+    }
+    memcpy(block, fec_block, sizeof(block));
+    block[0] ^= 0x80; // first two bits of the first codeword
+    block[codewords >> 3] ^= 0x80 >> (codewords & 7);
+    FAIL_IF(!fec_roundtrip(block, -1));
+
+    Fec_stats stats = {0};
+    uint32_t error_free = 0;
+    for(uint16_t f = 0; f < 1000; f++){
+        memcpy(block, fec_block, sizeof(block));
+        for(uint16_t k = 0; k < bits; k++){
+            block[k >> 3] ^= (fec_rnd() % 100 == 0) ? 0x80 >> (k & 7) : 0;
+        }
+        uint8_t decoded[sizeof(fec_data)];
+        fec_decode(block, sizeof(fec_data), decoded, &stats);
+        error_free += memcmp(decoded, fec_data, sizeof(fec_data)) == 0;
+    }
+    FAIL_IF(error_free < 800 || stats.frames != 1000 || stats.recovered < 700 || stats.corrected_bits < 1000);
+}
@@ -0,0 +1,56 @@
+/**
+ * Frame ring under contention (see frame_ring.h): core 1 (a thread on the host) publishes numbered frames as fast as
+ * possible, core 0 consumes them and checks that none was lost, duplicated or torn.
+ * The packets are passed as buffers of the packet pool, i.e. the pool is shared between the cores as well.
+ *
+ */
+
+#include "pico/stdlib.h"
+#include "pico/multicore.h"
+#include "packet_pool.h"
+#include "frame_ring.h"
+#include "tests.h"
+
+#define RING_FRAMES 200000
+static Frame_ring frames;
+
+static void frame_ring_producer(){
+    for(uint32_t n = 0; n < RING_FRAMES;){
+        Frame *frame = frame_ring_reserve(&frames);
+        Packet_buf *packet = (frame != NULL) ? packet_pool_alloc() : NULL;
+        if(packet == NULL){
+            tight_loop_contents();
+            continue;
+        }
+        frame->words = 1 + n % (PACKET_BUF_SIZE/4);
+        for(uint8_t w = 0; w < frame->words; w++){
+            packet->words[w] = n ^ (w << 24);
+        }
+        frame->packet = packet;
+        frame->seq = n;
+        frame_ring_publish(&frames);
+        n++;
+    }
+}
+
+void test_frame_ring(){
+    packet_pool_init();
+    frame_ring_init(&frames);
+    multicore_launch_core1(frame_ring_producer);
+    for(uint32_t expected = 0; expected < RING_FRAMES; expected++){
+        Frame *frame;
+        while((frame = frame_ring_peek(&frames)) == NULL){
+            tight_loop_contents();
+        }
+        bool valid = frame->seq == (uint8_t) expected && frame->words == 1 + expected % (PACKET_BUF_SIZE/4);
+        for(uint8_t w = 0; valid && w < frame->words; w++){
+            valid = frame->packet->words[w] == (expected ^ (w << 24));
+        }
+        FAIL_IF(!valid);
+        FAIL_IF(!packet_pool_free(frame->packet));
+        frame_ring_release(&frames);
+    }
+    Packet_pool_stats pool;
+    packet_pool_summary(&pool);
+    FAIL_IF(frame_ring_peek(&frames) != NULL || pool.in_use != 0);
+}
@@ -0,0 +1,82 @@
+/**
+ * Streaming link statistics (see link_stats.h): losses across the seq wrap, duplicated and retransmitted
+ * seqs, the bit errors against the regenerated payload and the sliding window, which forgets the oldest packet
+ *
+ */
+
+#include <string.h>
+#include "link_stats.h"
+#include "tests.h"
+
+#define LINK_LEN (2 + PAYLOADSIZE) // length byte, seq and the payload
+#define LINK_BITS (8 * (PAYLOADSIZE & 0xFE)) // counted bits per packet (file position and samples)
+
+static Link_stats link;
+
+// receive the packet seq at file position seq with the given number of flipped sample bits
+static void link_receive(uint8_t seq, uint8_t flipped, bool crc_ok, uint64_t time_us){
+    uint8_t packet[LINK_LEN];
+    packet[0] = LINK_LEN - 1;
+    packet[1] = seq;
+    packet[2] = 0;
+    packet[3] = seq;
+    expected_data(&packet[4], LINK_LEN - 4, seq);
+    for(uint8_t i = 0; i < flipped; i++){
+        packet[4 + i / 8] ^= 1u << (i % 8);
+    }
+    link_stats_update(&link, packet, LINK_LEN, PAYLOADSIZE, false, crc_ok, -60, 0x20, time_us);
+}
+
+void test_link_stats(){
+    link_stats_init(&link);
+    uint64_t time_us = 0;
+
+    /* losses across the wrap: 250..255, (0 lost), 1, 2, (3 lost), 4 */
+    for(uint16_t seq = 250; seq < 256; seq++){
+        link_receive(seq, 0, true, time_us += 1000);
+    }
+    link_receive(1, 0, true, time_us += 1000);
+    FAIL_IF(link_stats_last(&link)->lost != 1 || link.total.lost != 1);
+    link_receive(2, 0, true, time_us += 1000);
+    link_receive(4, 0, true, time_us += 1000);
+    FAIL_IF(link_stats_last(&link)->lost != 1 || link.total.lost != 2 || link.last_seq != 4);
+
+    /* a retransmission of 3 and a duplicate of 4 are received packets, not losses */
+    link_receive(3, 0, true, time_us += 1000);
+    FAIL_IF(link_stats_last(&link)->lost != 0);
+    link_receive(4, 0, true, time_us += 1000);
+    FAIL_IF(link_stats_last(&link)->lost != 0 || link.total.lost != 2 || link.last_seq != 4 || link.total.received != 11);
+    link_receive(5, 0, true, time_us += 1000);
+    FAIL_IF(link_stats_last(&link)->lost != 0);
+
+    /* bit errors: the counted bits include the file position, a packet failing the CRC adds no goodput */
+    link_receive(6, 3, false, time_us += 1000);
+    link_receive(7, 5, true, time_us += 1000);
+    Link_summary summary;
+    link_stats_summary(&link, &summary);
+    FAIL_IF(link.total.bit_errors != 8 || link.total.bits != 14 * LINK_BITS || link.window.bit_errors != 8);
+    FAIL_IF(summary.ber_total_ppm != 8 * 1000000 / (14 * LINK_BITS) || summary.crc_errors != 1);
+    FAIL_IF(link.total.goodput_bytes != 13 * (LINK_BITS / 8 - 2));
+    FAIL_IF(summary.per_total_ppm != 3 * 1000000 / 16); // 2 lost and 1 CRC error in 16 packets
+
+    /* packets without a seq or file position are only counted as overflowed */
+    uint8_t short_packet[3] = {2, 8, 0};
+    link_stats_update(&link, short_packet, sizeof(short_packet), PAYLOADSIZE, false, true, -60, 0x20, time_us);
+    FAIL_IF(link_stats_last(&link) != NULL || link.overflowed != 1 || link.total.received != 14);
+
+    /* the window forgets the oldest packets, the totals keep them */
+    for(uint8_t seq = 8; seq < 8 + LINK_STATS_WINDOW; seq++){
+        link_receive(seq, 0, true, time_us += 1000);
+    }
+    link_stats_summary(&link, &summary);
+    FAIL_IF(link.window.received != LINK_STATS_WINDOW || link.window.lost != 0 || link.window.bit_errors != 0);
+    FAIL_IF(summary.ber_ppm != 0 || summary.per_ppm != 0 || summary.rssi_mean != -60);
+    FAIL_IF(summary.goodput_bps != (uint64_t) LINK_STATS_WINDOW * (LINK_BITS - 16) * 1000000 / ((LINK_STATS_WINDOW - 1) * 1000));
+    FAIL_IF(link.total.bit_errors != 8 || link.total.lost != 2 || summary.received != 14 + LINK_STATS_WINDOW);
+
+    /* a new window after link_stats_init(): the first seq is no gap */
+    link_stats_init(&link);
+    link_receive(100, 0, true, 1000);
+    link_stats_summary(&link, &summary);
+    FAIL_IF(summary.received != 1 || summary.lost != 0 || summary.overflowed != 0 || link.window.received != 1);
+}
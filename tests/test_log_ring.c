@@ -0,0 +1,73 @@
+/**
+ * Deferred logging ring (see log_ring.h): records are printed in the order they were written, also across
+ * the end of the ring, a full ring drops and counts records and the drops are reported once
+ *
+ */
+
+#include <string.h>
+#include "log_ring.h"
+#include "tests.h"
+
+static char log_line[256];
+
+// the next printed line has to be expected
+static void log_expect(FILE *out, const char *expected){
+    FAIL_IF(fgets(log_line, sizeof(log_line), out) == NULL || strcmp(log_line, expected) != 0);
+}
+
+// the next printed line has to be the text record i
+static void log_expect_text(FILE *out, int32_t i){
+    char expected[32];
+    snprintf(expected, sizeof(expected), "log %d %x\n", i, 16 + i);
+    log_expect(out, expected);
+}
+
+void test_log_ring(){
+    log_ring_init(false);
+
+    /* full ring: the records after LOG_RING_LENGTH are dropped */
+    for(int32_t i = 0; i < LOG_RING_LENGTH; i++){
+        FAIL_IF(!log_printf("log %d %x\n", i, 16 + i));
+    }
+    FAIL_IF(log_printf("log dropped\n") || log_ring_bytes("bytes: ", (const uint8_t *) "ab", 2));
+    FAIL_IF(log_ring_dropped() != 2);
+
+    /* partial drain, the drops are reported after the printed records */
+    test_capture_begin();
+    FAIL_IF(log_ring_drain(10) != 10);
+    FILE *out = test_capture_end();
+    for(int32_t i = 0; i < 10; i++){
+        log_expect_text(out, i);
+    }
+    log_expect(out, "log: 2 records dropped (ring full)\n");
+    FAIL_IF(fgets(log_line, sizeof(log_line), out) != NULL);
+    fclose(out);
+
+    /* the freed slots are written again across the end of the ring, the drain keeps the order */
+    uint8_t data[LOG_BYTES_LEN + 4];
+    for(uint8_t i = 0; i < sizeof(data); i++){
+        data[i] = i;
+    }
+    FAIL_IF(!log_ring_bytes("bytes: ", data, 3));
+    for(int32_t i = LOG_RING_LENGTH; i < LOG_RING_LENGTH + 8; i++){
+        FAIL_IF(!log_printf("log %d %x\n", i, 16 + i));
+    }
+    FAIL_IF(!log_ring_bytes("long: ", data, sizeof(data))); // truncated
+    FAIL_IF(log_printf("log full\n") || log_ring_dropped() != 3);
+    test_capture_begin();
+    FAIL_IF(log_ring_drain(2 * LOG_RING_LENGTH) != LOG_RING_LENGTH);
+    FAIL_IF(log_ring_drain(LOG_RING_LENGTH) != 0);
+    out = test_capture_end();
+    for(int32_t i = 10; i < LOG_RING_LENGTH; i++){
+        log_expect_text(out, i);
+    }
+    log_expect(out, "bytes: 00 01 02 \n");
+    for(int32_t i = LOG_RING_LENGTH; i < LOG_RING_LENGTH + 8; i++){
+        log_expect_text(out, i);
+    }
+    FAIL_IF(fgets(log_line, sizeof(log_line), out) == NULL || strncmp(log_line, "long: 00 01 ", 12) != 0);
+    FAIL_IF(strlen(log_line) != strlen("long: ") + 3 * LOG_BYTES_LEN + 1);
+    log_expect(out, "log: 1 records dropped (ring full)\n"); // reported once
+    FAIL_IF(fgets(log_line, sizeof(log_line), out) != NULL);
+    fclose(out);
+}
@@ -0,0 +1,178 @@
+/**
+ * MSP430 backup protocol (see msp430_backup.h) against the host stand-in of the MSP430 (msp430_standin.h):
+ * batches of packets backed up and restored in one transaction each, corrupted frames in both directions,
+ * frames of every length modulo 4, the timeout without ACK and the persistent queue (MSP430 reset, lost commit,
+ * corrupted record). The PIO program of msp430_pio.c runs on the emulator of the simulator.
+ * The MSP430 pins are arbitrary here.
+ *
+ */
+
+#include <stdint.h>
+#include "pico/stdlib.h"
+#include "hardware/pio.h"
+#include "packet_pool.h"
+#include "msp430_backup.h"
+#include "msp430_standin.h"
+#include "tests.h"
+
+#define BACKUP_BATCH  8
+#define BACKUP_LEN   24
+
+static void fill_backup_packet(Packet_buf *packet, uint32_t n){
+    for(uint8_t b = 0; b < BACKUP_LEN; b++){
+        packet->bytes[b] = n + b;
+    }
+}
+
+static bool check_backup_packet(const Packet_buf *packet, uint8_t len, uint32_t n){
+    bool valid = len == BACKUP_LEN;
+    for(uint8_t b = 0; valid && b < BACKUP_LEN; b++){
+        valid = packet->bytes[b] == (uint8_t) (n + b);
+    }
+    return valid;
+}
+
+// BACKUP_BATCH packets backed up in one transaction and restored in one transaction
+static void test_batches(){
+    Packet_buf *packets[BACKUP_BATCH];
+    uint8_t lengths[BACKUP_BATCH];
+    for(uint32_t i = 0; i < 100; i++){
+        for(uint8_t p = 0; p < BACKUP_BATCH; p++){
+            packets[p] = packet_pool_alloc();
+            fill_backup_packet(packets[p], i + p);
+            lengths[p] = BACKUP_LEN;
+        }
+        FAIL_IF(msp430_backup(packets, lengths, BACKUP_BATCH, UINT32_MAX) != BACKUP_BATCH);
+        for(uint8_t p = 0; p < BACKUP_BATCH; p++){
+            packet_pool_free(packets[p]);
+        }
+        int16_t restored = msp430_restore(packets, lengths, NULL, BACKUP_BATCH);
+        FAIL_IF(restored != BACKUP_BATCH);
+        for(int16_t p = 0; p < restored; p++){
+            FAIL_IF(!check_backup_packet(packets[p], lengths[p], i + p));
+            packet_pool_free(packets[p]);
+        }
+    }
+}
+
+// corrupted frames must be rejected in both directions without losing packets
+static void test_crc(){
+    Packet_buf *packets[BACKUP_BATCH];
+    uint8_t lengths[1] = {BACKUP_LEN};
+    packets[0] = packet_pool_alloc();
+    fill_backup_packet(packets[0], 7);
+    msp430_standin_corrupt_next();
+    FAIL_IF(msp430_backup(packets, lengths, 1, UINT32_MAX) != MSP430_ERROR_CRC);
+    FAIL_IF(msp430_standin_stored() != 0);
+    FAIL_IF(msp430_backup(packets, lengths, 1, UINT32_MAX) != 1);
+    packet_pool_free(packets[0]);
+    msp430_standin_corrupt_next();
+    FAIL_IF(msp430_restore(packets, lengths, NULL, BACKUP_BATCH) >= 0);
+    FAIL_IF(msp430_standin_stored() != 1); // kept for the next attempt
+    FAIL_IF(msp430_restore(packets, lengths, NULL, BACKUP_BATCH) != 1 || !check_backup_packet(packets[0], lengths[0], 7));
+    packet_pool_free(packets[0]);
+    FAIL_IF(msp430_restore(packets, lengths, NULL, BACKUP_BATCH) != 0);
+}
+
+// without ACK, both directions give up after the timeout and the engine is usable again
+static void test_timeout(){
+    Packet_buf *packets[BACKUP_BATCH];
+    uint8_t lengths[1] = {BACKUP_LEN};
+    packets[0] = packet_pool_alloc();
+    fill_backup_packet(packets[0], 9);
+    msp430_standin_respond(false);
+    FAIL_IF(msp430_backup(packets, lengths, 1, UINT32_MAX) != MSP430_ERROR_TIMEOUT);
+    packet_pool_free(packets[0]);
+    FAIL_IF(msp430_restore(packets, lengths, NULL, BACKUP_BATCH) != MSP430_ERROR_TIMEOUT);
+    Packet_pool_stats pool;
+    packet_pool_summary(&pool);
+    FAIL_IF(pool.in_use != 0); // the reserved buffers have been returned
+    msp430_standin_respond(true);
+    packets[0] = packet_pool_alloc();
+    fill_backup_packet(packets[0], 9);
+    FAIL_IF(msp430_backup(packets, lengths, 1, UINT32_MAX) != 1);
+    packet_pool_free(packets[0]);
+    FAIL_IF(msp430_restore(packets, lengths, NULL, BACKUP_BATCH) != 1 || !check_backup_packet(packets[0], lengths[0], 9));
+    packet_pool_free(packets[0]);
+}
+
+// the queue survives an MSP430 reset, lost commits and corrupted records do not duplicate packets
+static void test_queue(){
+    Packet_buf *packets[BACKUP_BATCH];
+    uint8_t lengths[BACKUP_BATCH];
+    uint16_t seqs[BACKUP_BATCH];
+    for(uint8_t p = 0; p < 3; p++){
+        packets[p] = packet_pool_alloc();
+        fill_backup_packet(packets[p], 20 + p);
+        lengths[p] = BACKUP_LEN;
+    }
+    FAIL_IF(msp430_backup(packets, lengths, 3, UINT32_MAX) != 3);
+    for(uint8_t p = 0; p < 3; p++){
+        packet_pool_free(packets[p]);
+    }
+    msp430_standin_power_loss();
+    FAIL_IF(msp430_status() != 3);
+    // the first two packets are delivered but the commit gets lost: they are sent again and dropped
+    msp430_standin_drop_next_commit();
+    FAIL_IF(msp430_restore(packets, lengths, seqs, 2) != 2 || !check_backup_packet(packets[0], lengths[0], 20));
+    uint16_t first = seqs[0];
+    FAIL_IF(seqs[1] != (uint16_t) (first + 1) || msp430_standin_stored() != 3);
+    packet_pool_free(packets[0]);
+    packet_pool_free(packets[1]);
+    FAIL_IF(msp430_restore(packets, lengths, seqs, BACKUP_BATCH) != 1 || !check_backup_packet(packets[0], lengths[0], 22));
+    FAIL_IF(seqs[0] != (uint16_t) (first + 2) || msp430_queue_depth() != 0 || msp430_standin_stored() != 0);
+    packet_pool_free(packets[0]);
+    // a corrupted record is skipped
+    for(uint8_t p = 0; p < 2; p++){
+        packets[p] = packet_pool_alloc();
+        fill_backup_packet(packets[p], 30 + p);
+        lengths[p] = BACKUP_LEN;
+    }
+    FAIL_IF(msp430_backup(packets, lengths, 2, UINT32_MAX) != 2);
+    packet_pool_free(packets[0]);
+    packet_pool_free(packets[1]);
+    msp430_standin_corrupt_record(0);
+    FAIL_IF(msp430_restore(packets, lengths, seqs, BACKUP_BATCH) != 1 || !check_backup_packet(packets[0], lengths[0], 31));
+    FAIL_IF(seqs[0] != (uint16_t) (first + 4) || msp430_queue_depth() != 0);
+    packet_pool_free(packets[0]);
+}
+
+// frames of every length modulo 4: the last data word of the PIO stream is full or partial
+static void test_lengths(){
+    Packet_buf *packets[BACKUP_BATCH];
+    uint8_t lengths[BACKUP_BATCH];
+    for(uint8_t len = 1; len <= 8; len++){
+        for(uint8_t count = 1; count <= 4; count++){
+            for(uint8_t p = 0; p < count; p++){
+                packets[p] = packet_pool_alloc();
+                for(uint8_t b = 0; b < len; b++){
+                    packets[p]->bytes[b] = 3 * len + count + p + b;
+                }
+                lengths[p] = len;
+            }
+            FAIL_IF(msp430_backup(packets, lengths, count, UINT32_MAX) != count);
+            for(uint8_t p = 0; p < count; p++){
+                packet_pool_free(packets[p]);
+            }
+            FAIL_IF(msp430_restore(packets, lengths, NULL, BACKUP_BATCH) != count);
+            for(uint8_t p = 0; p < count; p++){
+                FAIL_IF(lengths[p] != len);
+                for(uint8_t b = 0; b < len; b++){
+                    FAIL_IF(packets[p]->bytes[b] != (uint8_t) (3 * len + count + p + b));
+                }
+                packet_pool_free(packets[p]);
+            }
+        }
+    }
+}
+
+void test_msp430_backup(){
+    packet_pool_init();
+    msp430_standin_init(pio1, 3, 0);
+    msp430_backup_init(pio1, 5000000, 10, 11, 12, 2, 3, 1, 0);
+    test_batches();
+    test_lengths();
+    test_crc();
+    test_timeout();
+    test_queue();
+}
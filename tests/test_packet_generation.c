@@ -0,0 +1,139 @@
+/**
+ * Frames and payloads of packet_generation.h: data whitening, compressed payloads and frame formats
+ *
+ */
+
+#include <string.h>
+#include "pico/stdlib.h"
+#include "packet_generation.h"
+#include "packet_pool.h"
+#include "tests.h"
+
+/*
+ * PN9 data whitening (see whiten()) against the sequence of the CC2500 datasheet and DN509 (first 16 bytes)
+ * and a bitwise x^9 + x^5 + 1 register (all bytes), whitening twice restores the frame
+ */
+static void test_whitening(){
+    static const uint8_t datasheet[16] = {0xff, 0xe1, 0x1d, 0x9a, 0xed, 0x85, 0x33, 0x24, 0xea, 0x7a, 0xd2, 0x39, 0x70, 0x97, 0x57, 0x0a};
+    uint8_t frame[PN9_TABLE_LEN + 1] = {0};
+    uint8_t original[PN9_TABLE_LEN];
+    whiten(frame, sizeof(frame));
+    FAIL_IF(memcmp(frame, datasheet, sizeof(datasheet)) != 0 || frame[PN9_TABLE_LEN] != 0);
+    uint16_t pn9 = 0x1FF;
+    for(uint8_t i = 0; i < PN9_TABLE_LEN; i++){
+        FAIL_IF(frame[i] != (pn9 & 0xFF));
+        for(uint8_t b = 0; b < 8; b++){
+            pn9 = (pn9 >> 1) | (((pn9 ^ (pn9 >> 5)) & 1) << 8);
+        }
+    }
+    for(uint8_t i = 0; i < PN9_TABLE_LEN; i++){
+        original[i] = frame[i] = i;
+    }
+    whiten(frame, PN9_TABLE_LEN);
+    whiten(frame, PN9_TABLE_LEN);
+    FAIL_IF(memcmp(frame, original, PN9_TABLE_LEN) != 0);
+}
+
+/*
+ * compressed payloads (see generate_compressed()): every packet decodes on its own to the samples of the
+ * generator, the receiver regenerates the stream, more samples fit than uncompressed and corrupted streams
+ * or samples outside the Rice code (escape) decode without overrunning
+ */
+static void test_compression(){
+    uint8_t payload[PAYLOADSIZE], stream[PAYLOADSIZE - 2], raw[2 * 32];
+    uint16_t samples[32];
+    uint32_t total = 0;
+    file_position = 0;
+    for(uint16_t p = 0; p < 1000; p++){
+        uint16_t position = file_position;
+        uint8_t count = generate_compressed(payload, PAYLOADSIZE);
+        total += count;
+        FAIL_IF(((payload[0] << 8) | payload[1]) != position || file_position != (uint16_t) (position + 2 * count));
+        FAIL_IF(expected_compressed(stream, sizeof(stream), position) != count || memcmp(stream, &payload[2], sizeof(stream)) != 0);
+        FAIL_IF(decompress_samples(&payload[2], sizeof(stream), samples, 32) != count);
+        expected_data(raw, 2 * count, position);
+        for(uint8_t i = 0; i < count; i++){
+            FAIL_IF(samples[i] != ((raw[2*i] << 8) | raw[2*i+1]));
+        }
+    }
+    FAIL_IF(total < 6600); // uncompressed: 6 per packet
+
+    const uint16_t outliers[4] = {0xFFFF, 0x0000, SAMPLE_CENTER, 0x8000};
+    FAIL_IF(compress_samples(outliers, 4, stream, sizeof(stream), NULL) != 4);
+    FAIL_IF(decompress_samples(stream, sizeof(stream), samples, 32) != 4 || memcmp(samples, outliers, sizeof(outliers)) != 0);
+    FAIL_IF(decompress_samples(stream, sizeof(stream), samples, 2) != 2);
+    uint16_t garbage[8 * sizeof(stream) + 1];
+    for(uint16_t k = 0; k < 1000; k++){
+        for(uint8_t i = 0; i < sizeof(stream); i++){
+            stream[i] = k * 37 + i * 101; // at most one sample per bit
+        }
+        FAIL_IF(decompress_samples(stream, sizeof(stream), garbage, sizeof(garbage) / 2) > 8 * sizeof(stream));
+    }
+    memset(stream, 0xFF, sizeof(stream));
+    FAIL_IF(decompress_samples(stream, sizeof(stream), samples, 32) != 0);
+}
+
+/*
+ * frame formats (see Frame_format): the CC2500/CC1352 formats build the frames of the header templates, CRC and
+ * whitening as the CC2500 checks them, fixed length frames are padded, and frames of interleaved formats
+ * (shorter preamble, trailer) are told apart by frame_parse()
+ */
+static void test_frame_format(){
+    uint8_t payload[PAYLOADSIZE], bytes[PACKET_BUF_SIZE], legacy[HEADER_LEN + PAYLOADSIZE];
+    uint32_t words[PACKET_BUF_SIZE/4];
+    generate_data(payload, PAYLOADSIZE, true);
+    for(uint16_t receiver = 1352; receiver <= 2500; receiver += 2500 - 1352){
+        add_header(legacy, 7, packet_hdr_template(receiver));
+        memcpy(&legacy[HEADER_LEN], payload, PAYLOADSIZE);
+        uint8_t offset = frame_header(frame_format(receiver), bytes, 7);
+        memcpy(&bytes[offset], payload, PAYLOADSIZE);
+        FAIL_IF(offset != HEADER_LEN || frame_finish(frame_format(receiver), bytes, PAYLOADSIZE) != sizeof(legacy));
+        FAIL_IF(memcmp(bytes, legacy, sizeof(legacy)) != 0);
+    }
+    // CRC over the length byte and the payload, whitened with them
+    Frame_format format = frame_format_cc2500;
+    format.crc = true;
+    format.whitening = true;
+    uint8_t offset = frame_header(&format, bytes, 7);
+    memcpy(&bytes[offset], payload, PAYLOADSIZE);
+    uint8_t len = frame_finish(&format, bytes, PAYLOADSIZE);
+    whiten(&bytes[HEADER_LEN-2], len - HEADER_LEN + 2);
+    uint16_t crc = crc16_cc2500(legacy + HEADER_LEN - 2, PAYLOADSIZE + 2);
+    FAIL_IF(len != sizeof(legacy) + 2 || memcmp(bytes, legacy, sizeof(legacy)) != 0);
+    FAIL_IF(bytes[len-2] != (crc >> 8) || bytes[len-1] != (crc & 0xFF));
+    // fixed length: padded, longer payloads do not fit
+    format = (Frame_format) {.preamble = 4, .sync = {0xd3, 0x91}, .sync_len = 2, .length_mode = FRAME_LENGTH_FIXED, .fixed_len = 1 + PAYLOADSIZE};
+    memset(bytes, 0xee, sizeof(bytes));
+    offset = frame_header(&format, bytes, 7);
+    FAIL_IF(offset != 7 || frame_finish(&format, bytes, PAYLOADSIZE - 2) != 7 + PAYLOADSIZE);
+    FAIL_IF(bytes[offset + PAYLOADSIZE - 1] != 0 || bytes[offset + PAYLOADSIZE] != 0xee);
+    FAIL_IF(frame_finish(&format, bytes, PAYLOADSIZE + 1) != 0);
+
+    // interleaved: short preamble, the same sync word with a longer preamble, another sync word with trailer
+    Frame_format formats[3] = {frame_format_cc2500, frame_format_cc2500, frame_format_cc1352};
+    const Frame_format *list[3] = {&formats[0], &formats[1], &formats[2]};
+    formats[0].preamble = 2;
+    formats[0].whitening = true;
+    formats[1].crc = true;
+    formats[2].trailer[0] = 0x55;
+    formats[2].trailer_len = 1;
+    for(uint16_t i = 0; i < 300; i++){
+        const Frame_format *f = list[i % 3];
+        uint8_t payload_len = 2 + (i % 40);
+        offset = frame_header(f, bytes, i);
+        memset(&bytes[offset], 0xaa, payload_len); // like a preamble
+        len = frame_finish(f, bytes, payload_len);
+        pack_words(bytes, words, buffer_size(len, 0));
+        uint8_t seq, parsed;
+        FAIL_IF(len != frame_length(f, payload_len) || (i % 3 == 2 && bytes[len-1] != 0x55));
+        FAIL_IF(frame_parse(list, 3, words, &seq, &parsed) != i % 3 || seq != (i & 0xFF) || parsed != len);
+    }
+    words[1] ^= 0x00010000; // sync word
+    FAIL_IF(frame_parse(list, 3, words, NULL, NULL) != -1);
+}
+
+void test_packet_generation(){
+    test_whitening();
+    test_compression();
+    test_frame_format();
+}
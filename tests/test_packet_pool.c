@@ -0,0 +1,60 @@
+/**
+ * Fixed-capacity packet pool (see packet_pool.h): exhaustion and refill, double frees, foreign pointers
+ * and the high-water mark
+ *
+ */
+
+#include <stddef.h>
+#include "packet_pool.h"
+#include "tests.h"
+
+static Packet_buf *pool_bufs[PACKET_POOL_SLOTS];
+
+void test_packet_pool(){
+    packet_pool_init();
+    Packet_pool_stats stats;
+
+    /* exhaustion: every slot once, word-aligned, then NULL */
+    for(uint8_t i = 0; i < PACKET_POOL_SLOTS; i++){
+        pool_bufs[i] = packet_pool_alloc();
+        FAIL_IF(pool_bufs[i] == NULL || ((uintptr_t) pool_bufs[i]) % 4 != 0);
+        for(uint8_t j = 0; j < i; j++){
+            FAIL_IF(pool_bufs[j] == pool_bufs[i]);
+        }
+    }
+    FAIL_IF(packet_pool_alloc() != NULL || packet_pool_alloc() != NULL);
+    packet_pool_summary(&stats);
+    FAIL_IF(stats.in_use != PACKET_POOL_SLOTS || stats.high_water != PACKET_POOL_SLOTS || stats.failures != 2);
+
+    /* refill: a freed slot is handed out again */
+    Packet_buf *freed = pool_bufs[3];
+    FAIL_IF(!packet_pool_free(freed));
+    pool_bufs[3] = packet_pool_alloc();
+    FAIL_IF(pool_bufs[3] != freed || packet_pool_alloc() != NULL);
+
+    /* double free */
+    FAIL_IF(!packet_pool_free(pool_bufs[5]));
+    FAIL_IF(packet_pool_free(pool_bufs[5]));
+    packet_pool_summary(&stats);
+    FAIL_IF(stats.in_use != PACKET_POOL_SLOTS - 1);
+
+    /* foreign pointers: NULL, outside the pool and inside a slot are ignored */
+    Packet_buf foreign;
+    FAIL_IF(packet_pool_free(NULL) || packet_pool_free(&foreign));
+    FAIL_IF(packet_pool_free((Packet_buf *) &pool_bufs[6]->bytes[4]));
+    packet_pool_summary(&stats);
+    FAIL_IF(stats.in_use != PACKET_POOL_SLOTS - 1);
+
+    /* the high-water mark stays after freeing everything, a new init resets it */
+    for(uint8_t i = 0; i < PACKET_POOL_SLOTS; i++){
+        FAIL_IF(packet_pool_free(pool_bufs[i]) != (i != 5));
+    }
+    packet_pool_summary(&stats);
+    FAIL_IF(stats.in_use != 0 || stats.high_water != PACKET_POOL_SLOTS || stats.failures != 3);
+    packet_pool_init();
+    Packet_buf *a = packet_pool_alloc(), *b = packet_pool_alloc();
+    packet_pool_free(a);
+    packet_pool_free(b);
+    packet_pool_summary(&stats);
+    FAIL_IF(stats.in_use != 0 || stats.high_water != 2 || stats.failures != 0);
+}
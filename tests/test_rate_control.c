@@ -0,0 +1,53 @@
+/**
+ * Rate adaptation (see rate_control.h) against a trace-driven channel: the tag moves between 1 m and 8 m,
+ * the delivery of every packet is drawn from the PER of its profile at the current distance
+ * (simulator --config <profile> --distance 1:9:1 --carrier-distance 1 --tx-power 0, one profile per run since the
+ * SNR follows the receiver bandwidth of the first configuration)
+ * The goodput (bit-rate of the delivered packets) has to reach 75% of an oracle which knows the best profile.
+ *
+ */
+
+#include "rate_control.h"
+#include "tests.h"
+
+#define RATE_PROFILES 4
+static const uint32_t rate_bitrates[RATE_PROFILES] = {25000, 50000, 100000, 200000};
+static const uint32_t rate_per_ppm[RATE_PROFILES][9] = { // 1 m ... 9 m
+    {0,    0,      0,      0,       0,       0,       25000,   161000,  490000},
+    {0,    0,      0,      4000,    26000,   279000,  730000,  972000,  999000},
+    {0,    0,      2000,   146000,  735000,  993000,  1000000, 1000000, 1000000},
+    {2000, 629000, 962000, 1000000, 1000000, 1000000, 1000000, 1000000, 1000000},
+};
+static const struct { uint8_t distance_m; uint16_t packets; } rate_trace[] = {
+    {1, 1000}, {5, 1000}, {3, 1000}, {6, 600}, {8, 600}, {1, 800},
+};
+static Rate_control rate;
+static uint32_t rate_random = 1;
+
+static bool rate_delivered(uint8_t profile, uint8_t distance_m){
+    rate_random = rate_random * 1664525 + 1013904223;
+    return (rate_random >> 8) % 1000000 >= rate_per_ppm[profile][distance_m - 1];
+}
+
+void test_rate_control(){
+    rate_control_init(&rate, rate_bitrates, RATE_PROFILES, 2);
+    uint64_t goodput = 0, oracle = 0;
+    for(uint8_t t = 0; t < sizeof(rate_trace) / sizeof(rate_trace[0]); t++){
+        uint8_t d = rate_trace[t].distance_m;
+        uint64_t best = 0;
+        for(uint8_t p = 0; p < RATE_PROFILES; p++){
+            uint64_t expected = (uint64_t) rate_bitrates[p] * (1000000 - rate_per_ppm[p][d - 1]) / 1000000;
+            best = (expected > best) ? expected : best;
+        }
+        for(uint16_t i = 0; i < rate_trace[t].packets; i++){
+            uint8_t profile = rate_control_next(&rate);
+            bool delivered = rate_delivered(profile, d);
+            rate_control_feedback(&rate, profile, delivered);
+            goodput += delivered ? rate_bitrates[profile] : 0;
+            oracle += best;
+        }
+        // converged to the best profile of this distance
+        FAIL_IF((uint64_t) rate_control_goodput(&rate, rate.best) * 10 < best * 8);
+    }
+    FAIL_IF(goodput * 4 < oracle * 3);
+}
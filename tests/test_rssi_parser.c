@@ -0,0 +1,35 @@
+/**
+ * RSSI line parser (see rssi_parser.h): partial first line, blanks and trailing text, invalid lines,
+ * lost bytes and the moving average are checked
+ *
+ */
+
+#include "rssi_parser.h"
+#include "tests.h"
+
+static Rssi_parser rssi;
+
+// feed a string, returns the number of parsed values
+static uint32_t rssi_feed(const char *text){
+    uint32_t values = 0;
+    for(; *text != '\0'; text++){
+        values += rssi_parser_feed(&rssi, *text);
+    }
+    return values;
+}
+
+void test_rssi_parser(){
+    rssi_parser_init(&rssi);
+    FAIL_IF(rssi_feed("7\n") != 0 || rssi_parser_average(&rssi) != RSSI_NONE); // possibly partial
+    FAIL_IF(rssi_feed("-47\n") != 1 || rssi_parser_average(&rssi) != -47);
+    FAIL_IF(rssi_feed(" -45 dBm\r\n") != 1 || rssi_parser_average(&rssi) != -46);
+    FAIL_IF(rssi_feed("abc\n\n-\n") != 0 || rssi.errors != 3);
+    rssi_feed("-4");
+    rssi_parser_resync(&rssi);
+    FAIL_IF(rssi_feed("9\n-30\n") != 1 || rssi_parser_average(&rssi) != -41);
+    for(uint8_t i = 0; i < RSSI_AVERAGE_LEN; i++){
+        rssi_feed("-60\n");
+    }
+    FAIL_IF(rssi_parser_average(&rssi) != -60 || rssi.lines != 3 + RSSI_AVERAGE_LEN);
+    FAIL_IF(rssi_feed("123456\n") != 1 || rssi.window[(rssi.next + RSSI_AVERAGE_LEN - 1) % RSSI_AVERAGE_LEN] != 1234);
+}
@@ -0,0 +1,91 @@
+/**
+ * Scheduler policy (see scheduler.h) on a simulated clock and supply: a capacitor charged by the harvester,
+ * sensing and transmitting cost energy, the parameters are the ones of carrier-receiver-baseband.
+ * The packet rate has to follow the harvested power up to the TX gap and no task may start below its threshold.
+ *
+ */
+
+#include "pico/stdlib.h"
+#include "scheduler.h"
+#include "tests.h"
+
+#define SIM_TX_MV         2000
+#define SIM_POLL_US     100000
+#define SIM_IDLE_US    1000000
+#define SIM_TX_GAP_US   250000
+#define SIM_SENSE_COST_UV  20000 // 20 mV
+#define SIM_TX_COST_UV    150000
+#define SIM_DURATION_US 60000000
+static Scheduler sim_scheduler;
+static uint64_t sim_now_us;
+static uint32_t sim_supply_uv;
+static uint32_t sim_harvest_uv_per_ms;
+static bool sim_frame;
+static uint32_t sim_sent;
+
+static void sim_advance(uint64_t time_us){
+    if(time_us > sim_now_us){
+        uint64_t supply = sim_supply_uv + sim_harvest_uv_per_ms * ((time_us - sim_now_us) / 1000);
+        sim_supply_uv = (supply < 3300000) ? supply : 3300000;
+        sim_now_us = time_us;
+    }
+}
+
+static void sim_spend(Scheduler *s, uint32_t cost_uv, uint32_t duration_us){
+    FAIL_IF(s->supply < SIM_TX_MV); // started without enough energy
+    sim_supply_uv = (sim_supply_uv > cost_uv) ? sim_supply_uv - cost_uv : 0;
+    sim_advance(sim_now_us + duration_us);
+}
+
+static uint64_t sim_clock_us(){ return sim_now_us; }
+static uint16_t sim_supply_mv(){ return sim_supply_uv / 1000; }
+static void sim_sleep_until(uint64_t time_us){ sim_advance(time_us); }
+static bool sim_transmit_ready(const Scheduler *s){ (void) s; return sim_frame; }
+static bool sim_sense_ready(const Scheduler *s){ (void) s; return !sim_frame; }
+
+static uint32_t sim_transmit(Scheduler *s){
+    sim_spend(s, SIM_TX_COST_UV, 4000); // frame airtime
+    sim_frame = false;
+    sim_sent++;
+    return SIM_TX_GAP_US;
+}
+
+static uint32_t sim_sense(Scheduler *s){
+    sim_spend(s, SIM_SENSE_COST_UV, 1000);
+    sim_frame = true;
+    return 0;
+}
+
+static Sched_task sim_tasks[] = {
+    {"transmit", SIM_TX_MV, sim_transmit_ready, sim_transmit},
+    {"sense",    SIM_TX_MV, sim_sense_ready,    sim_sense},
+};
+
+// packets sent within SIM_DURATION_US at the harvested power [uV/ms = mV/s]
+static uint32_t sim_packets(uint32_t harvest_uv_per_ms){
+    sim_now_us = 0;
+    sim_supply_uv = 1800000; // below the threshold
+    sim_harvest_uv_per_ms = harvest_uv_per_ms;
+    sim_frame = false;
+    sim_sent = 0;
+    sched_init(&sim_scheduler, sim_tasks, 2, SIM_POLL_US, SIM_IDLE_US, sim_clock_us, sim_supply_mv, sim_sleep_until);
+    uint32_t steps = 0;
+    while(sim_now_us < SIM_DURATION_US){
+        sched_step(&sim_scheduler);
+        steps++;
+    }
+    // sleeping: a supply check per poll interval and the steps of the packets, no busy waiting
+    FAIL_IF(steps > SIM_DURATION_US / SIM_POLL_US + 4 * sim_sent);
+    return sim_sent;
+}
+
+void test_scheduler(){
+    uint32_t none = sim_packets(0);
+    uint32_t low = sim_packets(50);     // 50 mV/s: about one packet per 3.4 s
+    uint32_t high = sim_packets(200);
+    uint32_t plenty = sim_packets(100000);
+    FAIL_IF(none != 0);
+    FAIL_IF(low < 10 || high < 3 * low);
+    // limited by the TX gap (instead of the energy)
+    FAIL_IF(plenty > SIM_DURATION_US / SIM_TX_GAP_US + 1 || plenty < SIM_DURATION_US / SIM_TX_GAP_US * 9 / 10);
+}
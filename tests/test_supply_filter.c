@@ -0,0 +1,53 @@
+/**
+ * Supply filter (see supply_filter.h) on synthetic 1 kHz ADC samples with +-3 LSB noise: a constant supply,
+ * a falling and a rising ramp of 100 mV/s and a gap in the samples; voltage, slope and prediction are checked
+ *
+ */
+
+#include "supply_filter.h"
+#include "tests.h"
+
+static Supply_filter supply;
+static uint32_t noise_state = 1;
+
+static uint16_t supply_sample(int32_t uv){
+    noise_state = noise_state * 1664525 + 1013904223;
+    return (int64_t) uv * 4096 / 3300000 + (int32_t) (noise_state >> 29) - 3;
+}
+
+// feed samples of start_uv + slope * t from sample first to last, returns the true voltage at the end [uV]
+static int32_t supply_ramp(int32_t start_uv, int32_t slope_uv_per_s, uint32_t first, uint32_t last){
+    for(uint32_t t = first; t < last; t++){
+        supply_filter_add(&supply, supply_sample(start_uv + slope_uv_per_s / 1000 * (int32_t) t));
+    }
+    return start_uv + slope_uv_per_s / 1000 * (int32_t) last;
+}
+
+static bool near(int64_t value, int64_t expected, int64_t tolerance){
+    return value >= expected - tolerance && value <= expected + tolerance;
+}
+
+void test_supply_filter(){
+    supply_filter_init(&supply, 1000);
+    supply_ramp(2500000, 0, 0, 2000);
+    FAIL_IF(!near(supply_filter_mv(&supply), 2500, 5) || !near(supply_filter_slope(&supply), 0, 20000));
+    FAIL_IF(supply_filter_time_to(&supply, 1900) < 10000000); // no brown-out predicted
+
+    supply_filter_init(&supply, 1000);
+    int32_t uv = supply_ramp(2500000, -100000, 0, 3000);
+    FAIL_IF(!near(supply_filter_mv(&supply), uv / 1000, 5) || !near(supply_filter_slope(&supply), -100000, 10000));
+    FAIL_IF(!near(supply_filter_time_to(&supply, 1900), (uv - 1900000) * 10LL, 300000));
+    FAIL_IF(supply_filter_time_to(&supply, 2800) != 0); // past it
+    // lost samples: the filter restarts, the trend is kept
+    supply_filter_skip(&supply, 500);
+    uv = supply_ramp(2500000, -100000, 3500, 4000);
+    FAIL_IF(!near(supply_filter_mv(&supply), uv / 1000, 5) || !near(supply_filter_slope(&supply), -100000, 20000));
+    // below the threshold and falling: reached already
+    supply_ramp(2500000, -100000, 4000, 12000);
+    FAIL_IF(supply_filter_mv(&supply) >= 1900 || supply_filter_time_to(&supply, 1900) != 0);
+
+    supply_filter_init(&supply, 1000);
+    uv = supply_ramp(1800000, 100000, 0, 3000);
+    FAIL_IF(!near(supply_filter_time_to(&supply, 2500), (2500000 - uv) * 10LL, 300000));
+    FAIL_IF(supply_filter_time_to(&supply, 1900) != 0 || supply_filter_time_to(&supply, supply_filter_mv(&supply) + 1) > 100000);
+}
@@ -0,0 +1,70 @@
+/**
+ * Per-stage latency trace (see trace.h, compiled with TRACE_ENABLED here only): the dump lists the latest
+ * TRACE_LENGTH events oldest first with the number of overwritten ones, and a dump empties the ring
+ *
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "trace.h"
+#include "tests.h"
+
+#define TRACE_RECORDED (TRACE_LENGTH + 44)
+
+static char trace_line[128];
+
+// the output of trace_dump()
+static FILE *trace_capture(){
+    test_capture_begin();
+    trace_dump();
+    return test_capture_end();
+}
+
+// check the header and the stage names, returns the number of events
+static uint32_t trace_header(FILE *out, uint32_t overwritten){
+    unsigned events = 0, skipped = 0;
+    FAIL_IF(fgets(trace_line, sizeof(trace_line), out) == NULL);
+    FAIL_IF(sscanf(trace_line, "trace: dump %u events, %u overwritten", &events, &skipped) != 2 || skipped != overwritten);
+    for(uint8_t i = 0; i < TRACE_STAGES; i++){
+        unsigned stage = TRACE_STAGES;
+        FAIL_IF(fgets(trace_line, sizeof(trace_line), out) == NULL || sscanf(trace_line, "trace: stage %u", &stage) != 1 || stage != i);
+    }
+    return events;
+}
+
+// check the events (arg: index of the recording), returns the number of events until "trace: end"
+static uint32_t trace_events(FILE *out, uint32_t first){
+    uint32_t count = 0;
+    unsigned long long previous_us = 0;
+    while(fgets(trace_line, sizeof(trace_line), out) != NULL && strcmp(trace_line, "trace: end\n") != 0){
+        unsigned long long time_us;
+        unsigned stage, arg;
+        char phase;
+        FAIL_IF(sscanf(trace_line, "trace: %llu %u %c %u", &time_us, &stage, &phase, &arg) != 4);
+        FAIL_IF(arg != first + count || stage != arg % TRACE_STAGES || phase != ((arg & 1) ? TRACE_END : TRACE_BEGIN));
+        FAIL_IF(time_us < previous_us);
+        previous_us = time_us;
+        count++;
+    }
+    return count;
+}
+
+void test_trace(){
+    trace_init();
+    for(uint16_t i = 0; i < TRACE_RECORDED; i++){
+        trace_record(i % TRACE_STAGES, (i & 1) ? TRACE_END : TRACE_BEGIN, i);
+    }
+    FILE *out = trace_capture();
+    FAIL_IF(trace_header(out, TRACE_RECORDED - TRACE_LENGTH) != TRACE_LENGTH);
+    FAIL_IF(trace_events(out, TRACE_RECORDED - TRACE_LENGTH) != TRACE_LENGTH);
+    fclose(out);
+
+    /* the dump emptied the ring, recording goes on */
+    for(uint16_t i = 0; i < 3; i++){
+        trace_record(i % TRACE_STAGES, (i & 1) ? TRACE_END : TRACE_BEGIN, i);
+    }
+    out = trace_capture();
+    FAIL_IF(trace_header(out, 0) != 3);
+    FAIL_IF(trace_events(out, 0) != 3);
+    fclose(out);
+}
@@ -0,0 +1,41 @@
+/**
+ * Unit tests of project_pico_libs (host only)
+ *
+ * Every module is tested in test_<module>.c against the SDK stand-in (project_pico_libs/host).
+ * A failed check is printed with its location and counted, see main.c.
+ *
+ */
+
+#ifndef TESTS_LIB
+#define TESTS_LIB
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// the check fails if the condition holds
+#define FAIL_IF(condition) test_fail_if((condition), #condition, __FILE__, __LINE__)
+
+void test_fail_if(bool failed, const char *condition, const char *file, int line);
+
+// redirect stdout into a temporary file until test_capture_end(), which returns the file at its start
+void test_capture_begin();
+FILE *test_capture_end();
+
+void test_scheduler();
+void test_supply_filter();
+void test_rssi_parser();
+void test_rate_control();
+void test_arq();
+void test_fec();
+void test_packet_generation();
+void test_aggregator();
+void test_frame_ring();
+void test_msp430_backup();
+void test_boot_config();
+void test_link_stats();
+void test_packet_pool();
+void test_trace();
+void test_log_ring();
+
+#endif